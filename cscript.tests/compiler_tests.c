@@ -10,10 +10,16 @@
 #include "cscript/foreign.h"
 #include "cscript/preprocess.h"
 #include "cscript/alpha.h"
+#include "cscript/thread.h"
+#include "cscript/records.h"
+#include "cscript/arena.h"
+#include "cscript/parallel.h"
+#include "cscript/primitives.h"
 
 #include <math.h>
 #include <time.h>
 #include <stdlib.h>
+#include <stdio.h>
 
 static int debug = 0;
 static int preprocess = 0;
@@ -544,6 +550,11 @@ static void test_inc_dec()
 static void test_for_loop()
   {
   test_compile_flonum_aux(1225.0, "() float f = 0; for (int i = 0; i < 50; ++i) { f += i; } f;");
+  test_compile_fixnum_aux(0, "() int s = 0; for (int i = 0; i < 0; ++i) { s += 1; } s;");
+  test_compile_fixnum_aux(1, "() int s = 0; for (int i = 0; i < 1; ++i) { s += 1; } s;");
+  test_compile_fixnum_aux(45, "() int s = 0; int i = 0; while (i < 10) { s += i; ++i; } s;");
+  test_compile_fixnum_aux(7, "() int s = 7; int i = 5; while (i < 3) { s += i; ++i; } s;");
+  test_compile_fixnum_aux(100, "() int s = 0; for (int i = 0; i < 10; ++i) { for (int j = 0; j < 10; ++j) { s += 1; } } s;");
   }
 
 static void test_funccall()
@@ -748,6 +759,23 @@ static void test_array_address()
   cscript_close(ctxt);
   }
 
+static void test_array_address_other_context()
+  {
+  cscript_fixnum addr = 999;
+  cscript_context* ctxt = cscript_open(256);
+  cscript_function* fun = cscript_compile(ctxt, "(int* addr) int my_array[5] = { 10, 20, 30, 40, 50 }; *addr = my_array; 7;");
+  cscript_context* other = cscript_context_init(ctxt, 256);
+  cscript_fixnum pars[1];
+  pars[0] = (cscript_fixnum)&addr;
+  cscript_set_function_arguments(other, pars, 1);
+  cscript_fixnum* res = cscript_run(other, fun);
+  TEST_EQ_INT(7, *res);
+  TEST_EQ_INT(cast(cscript_fixnum, other->stack.vector_ptr) + sizeof(cscript_fixnum), addr);
+  cscript_context_destroy(other);
+  cscript_function_free(ctxt, fun);
+  cscript_close(ctxt);
+  }
+
 static void test_compile_flonum_aux_close(cscript_flonum expected, const char* script, int nr_parameters, void* pars, cscript_flonum threshold)
   {
   cscript_context* ctxt = cscript_open(256);
@@ -1433,6 +1461,1540 @@ static void test_preprocessor()
   preprocess = pre;
   }
 
+static cscript_fixnum run_with_options_aux(cscript_memsize* code_size, const char* script, const cscript_compile_options* options, int nr_parameters, cscript_fixnum* pars)
+  {
+  cscript_context* ctxt = cscript_open(256);
+  cscript_function* fun = cscript_compile_ex(ctxt, script, options);
+  TEST_EQ_INT(1, fun != NULL ? 1 : 0);
+  cscript_fixnum result = 0;
+  *code_size = 0;
+  if (fun)
+    {
+    *code_size = fun->code.vector_size;
+    cscript_set_function_arguments(ctxt, pars, nr_parameters);
+    cscript_fixnum* res = cscript_run(ctxt, fun);
+    result = *res;
+    cscript_function_free(ctxt, fun);
+    }
+  cscript_close(ctxt);
+  return result;
+  }
+
+static cscript_memsize compile_with_options_aux(cscript_fixnum expected, const char* script, const cscript_compile_options* options)
+  {
+  cscript_memsize size;
+  cscript_fixnum res = run_with_options_aux(&size, script, options, 0, NULL);
+  TEST_EQ_INT(expected, res);
+  return size;
+  }
+
+static void test_compile_options()
+  {
+  const char* script = "()\n"
+    "int i = 7;\n"
+    "int j = 8;\n"
+    "j += 9;\n"
+    "10;\n";
+  cscript_compile_options options;
+  cscript_compile_options_init(&options, 0);
+  TEST_EQ_INT(7, compile_with_options_aux(10, script, &options));
+  cscript_compile_options_init(&options, 1);
+  TEST_EQ_INT(6, compile_with_options_aux(10, script, &options));
+  cscript_compile_options_init(&options, 2);
+  TEST_EQ_INT(1, compile_with_options_aux(10, script, &options));
+  cscript_compile_options_init(&options, 3);
+  TEST_EQ_INT(1, compile_with_options_aux(10, script, &options));
+  TEST_EQ_INT(1, compile_with_options_aux(10, script, NULL));
+
+  const char* script2 = "() if (3 > 2) {3;} else {2;}";
+  cscript_compile_options_init(&options, 2);
+  options.constant_folding = 0;
+  TEST_EQ_INT(8, compile_with_options_aux(3, script2, &options));
+  options.constant_folding = 1;
+  TEST_EQ_INT(1, compile_with_options_aux(3, script2, &options));
+  }
+
+static void test_reassociation_fixnum_aux(const char* script, int nr_parameters, cscript_fixnum* pars)
+  {
+  cscript_compile_options options;
+  cscript_compile_options_init(&options, 2);
+  cscript_memsize size;
+  cscript_fixnum expected = run_with_options_aux(&size, script, &options, nr_parameters, pars);
+  options.fast_math = 1;
+  cscript_fixnum res = run_with_options_aux(&size, script, &options, nr_parameters, pars);
+  TEST_EQ_INT(expected, res);
+  }
+
+static void test_reassociation_flonum_aux(const char* script, int nr_parameters, cscript_fixnum* pars)
+  {
+  cscript_compile_options options;
+  cscript_compile_options_init(&options, 2);
+  cscript_memsize size;
+  cscript_fixnum expected = run_with_options_aux(&size, script, &options, nr_parameters, pars);
+  options.fast_math = 1;
+  cscript_fixnum res = run_with_options_aux(&size, script, &options, nr_parameters, pars);
+  TEST_EQ_DOUBLE(*cast(cscript_flonum*, &expected), *cast(cscript_flonum*, &res));
+  }
+
+static void test_reassociation()
+  {
+  cscript_fixnum pars[16] = { 3, 7, 11, 13, 17, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+  test_reassociation_fixnum_aux("(int a, int b, int c, int d) a*2 + 3 + b*c - 4 - d + 1;", 4, pars);
+  test_reassociation_fixnum_aux("(int a, int b, int c, int d, int e) a - b - c - d - e;", 5, pars);
+  test_reassociation_fixnum_aux("(int a, int b, int c, int d) -a - b + c - d;", 4, pars);
+  test_reassociation_fixnum_aux("(int a, int b, int c, int d) 2 - a + 3 - b - 5 + c - d;", 4, pars);
+  test_reassociation_fixnum_aux("(int a, int b, int c, int d) 2*a*3*b*c*d;", 4, pars);
+  test_reassociation_fixnum_aux("(int a, int b, int c, int d) a*b/c*d*2;", 4, pars);
+  test_reassociation_fixnum_aux("(int a, int b) ++a + a + 1 + 2 + b;", 2, pars);
+  test_reassociation_fixnum_aux("(int a, int b, int c) int s = 0; for (int i = 0; i < 4; ++i) { s += a*i + b + c*i*2 + 1; } s;", 3, pars);
+
+  for (int i = 0; i < 16; ++i)
+    pars[i] = convert_to_fx((double)(i + 1) * 0.5);
+  test_reassociation_flonum_aux("(float a0, float a1, float a2, float a3, float a4, float a5, float a6, float a7, float b0, float b1, float b2, float b3, float b4, float b5, float b6, float b7) a0*b0 + a1*b1 + a2*b2 + a3*b3 + a4*b4 + a5*b5 + a6*b6 + a7*b7;", 16, pars);
+  test_reassociation_flonum_aux("(float x, float y) 1.5 + x - 2.5 + y - x*0.5*4.0;", 2, pars);
+  test_reassociation_flonum_aux("(float x, float y) -sqrt(x) - y - 0.25;", 2, pars);
+
+  // constant terms are grouped so that they can be folded
+  cscript_compile_options options;
+  cscript_compile_options_init(&options, 2);
+  cscript_memsize size, size_fast_math;
+  run_with_options_aux(&size, "(float x) 1.5 + x + 2.5 + x;", &options, 1, pars);
+  options.fast_math = 1;
+  run_with_options_aux(&size_fast_math, "(float x) 1.5 + x + 2.5 + x;", &options, 1, pars);
+  TEST_EQ_INT(1, size_fast_math < size ? 1 : 0);
+  }
+
+static void test_run_batch()
+  {
+  cscript_context* ctxt = cscript_open(256);
+  cscript_function* fun = cscript_compile(ctxt, "(int a, float b) a*b + 1;");
+  cscript_fixnum args[20];
+  cscript_fixnum results[10];
+  for (int i = 0; i < 10; ++i)
+    {
+    args[i * 2] = i;
+    args[i * 2 + 1] = convert_to_fx(0.5);
+    }
+  cscript_run_batch(ctxt, fun, args, 2, 2, 10, results);
+  for (int i = 0; i < 10; ++i)
+    {
+    TEST_EQ_DOUBLE(i*0.5 + 1.0, *cast(cscript_flonum*, &results[i]));
+    }
+  cscript_function_free(ctxt, fun);
+
+  fun = cscript_compile(ctxt, "(int a) int s = 0; for (int i = 0; i < a; ++i) { s += i; } s;");
+  cscript_run_batch(ctxt, fun, args, 2, 2, 10, results);
+  for (int i = 0; i < 10; ++i)
+    {
+    TEST_EQ_INT(i*(i - 1) / 2, results[i]);
+    }
+  cscript_run_batch(ctxt, fun, args, 1, 4, 5, results); // one argument per row, the other values are padding
+  for (int i = 0; i < 5; ++i)
+    {
+    TEST_EQ_INT(2*i*(2*i - 1) / 2, results[i]);
+    }
+  cscript_function_free(ctxt, fun);
+  cscript_close(ctxt);
+  }
+
+static void test_run_spmd_aux(const char* script, int number_of_arguments, int count, cscript_fixnum* args)
+  {
+  cscript_context* ctxt = cscript_open(256);
+  cscript_function* fun = cscript_compile(ctxt, script);
+  TEST_EQ_INT(1, fun != NULL ? 1 : 0);
+  cscript_fixnum* expected = (cscript_fixnum*)malloc(sizeof(cscript_fixnum) * count);
+  cscript_fixnum* results = (cscript_fixnum*)malloc(sizeof(cscript_fixnum) * count);
+  cscript_run_batch(ctxt, fun, args, number_of_arguments, 2, count, expected);
+  cscript_run_spmd(ctxt, fun, args, number_of_arguments, 2, count, results);
+  for (int i = 0; i < count; ++i)
+    {
+    TEST_EQ_INT(expected[i], results[i]);
+    }
+  free(expected);
+  free(results);
+  cscript_function_free(ctxt, fun);
+  cscript_close(ctxt);
+  }
+
+static void test_run_spmd()
+  {
+  cscript_fixnum args[2 * 21];
+  for (int i = 0; i < 21; ++i)
+    {
+    args[i * 2] = i;
+    args[i * 2 + 1] = convert_to_fx(0.25 * i - 2.0);
+    }
+  test_run_spmd_aux("(int a, float b) a*b + 1;", 2, 21, args);
+  test_run_spmd_aux("(int a) int s = 0; for (int i = 0; i < a; ++i) { s += i; } s;", 1, 21, args);
+  test_run_spmd_aux("(int a) int s = 0; for (int i = 0; i < a; ++i) { if (i % 3 == 0) { s += i; } else { s -= 1; } } s;", 1, 21, args);
+  test_run_spmd_aux("(int a, float b) float r = 0; if (b > 0) { r = sqrt(b); } else { r = sin(b) * a; } r;", 2, 21, args);
+  test_run_spmd_aux("(int a) int v[10]; for (int i = 0; i < 10; ++i) { v[i] = i * a; } v[a % 10];", 1, 21, args);
+  test_run_spmd_aux("(int a) int n = 0; int x = a + 1; while (x != 1) { if (x % 2 == 0) { x = x / 2; } else { x = 3 * x + 1; } ++n; } n;", 1, 21, args);
+  // the lanes with a >= 2 skip the product in the if statement, but their registers still hold x * 1000 and 1000, which overflow
+  test_run_spmd_aux("(int a) int c = a < 2; int x = a * 100000000000000; int r = 0; 1 * (x * 1000); if (c) { r = x * 1000; } r + x;", 1, 21, args);
+  cscript_flonum out[3];
+  for (int i = 0; i < 3; ++i)
+    args[i * 2 + 1] = cast(cscript_fixnum, &out[i]);
+  test_run_spmd_aux("(int a, float* b) *b = a; a + 1;", 2, 3, args); // not lane-parallel, falls back to cscript_run_batch
+  TEST_EQ_DOUBLE(2.0, out[2]);
+  }
+
+static cscript_flonum add_half(cscript_flonum* x)
+  {
+  return *x + 0.5;
+  }
+
+static void test_run_batch_parallel_aux(cscript_context* ctxt, const char* script, int number_of_threads)
+  {
+  const int count = 1000;
+  cscript_function* fun = cscript_compile(ctxt, script);
+  TEST_EQ_INT(1, fun != NULL ? 1 : 0);
+  cscript_fixnum* args = (cscript_fixnum*)malloc(sizeof(cscript_fixnum) * count * 2);
+  cscript_fixnum* expected = (cscript_fixnum*)malloc(sizeof(cscript_fixnum) * count);
+  cscript_fixnum* results = (cscript_fixnum*)malloc(sizeof(cscript_fixnum) * count);
+  for (int i = 0; i < count; ++i)
+    {
+    args[i * 2] = i % 97;
+    args[i * 2 + 1] = convert_to_fx(i * 0.125);
+    }
+  cscript_run_batch(ctxt, fun, args, 2, 2, count, expected);
+  cscript_run_batch_parallel(ctxt, fun, args, 2, 2, count, results, number_of_threads);
+  for (int i = 0; i < count; ++i)
+    {
+    TEST_EQ_INT(expected[i], results[i]);
+    }
+  cscript_run_batch_parallel(ctxt, fun, args, 2, 2, 3, results, number_of_threads);
+  for (int i = 0; i < 3; ++i)
+    {
+    TEST_EQ_INT(expected[i], results[i]);
+    }
+  free(args);
+  free(expected);
+  free(results);
+  cscript_function_free(ctxt, fun);
+  }
+
+static void test_run_batch_parallel()
+  {
+  cscript_context* ctxt = cscript_open(256);
+  cscript_register_external_function(ctxt, "add_half", (void*)&add_half, cscript_foreign_flonum);
+  cscript_set_global_fixnum_value(ctxt, "$offset", 1000);
+  test_run_batch_parallel_aux(ctxt, "(int a, float b) int s = 0; for (int i = 0; i < a; ++i) { s += i; } s + b;", 4);
+  test_run_batch_parallel_aux(ctxt, "(int a, float b) add_half(b) * a;", 3);
+  test_run_batch_parallel_aux(ctxt, "(int a, float b) a + $offset;", 0);
+  cscript_set_global_fixnum_value(ctxt, "$offset", 2000); // the worker contexts are reused, but get the new value
+  test_run_batch_parallel_aux(ctxt, "(int a, float b) a + $offset;", 0);
+  cscript_close(ctxt);
+  }
+
+static void test_run_frame_aux(cscript_context* ctxt, const char* script, const cscript_externals* externals)
+  {
+  cscript_function* fun = cscript_compile(ctxt, script);
+  TEST_EQ_INT(1, fun != NULL ? 1 : 0);
+  const cscript_memsize frame_size = cscript_get_frame_size(fun);
+  TEST_EQ_INT(1, frame_size > 0 ? 1 : 0);
+  // one extra register to check that the frame size is respected
+  cscript_fixnum* frame = (cscript_fixnum*)malloc(sizeof(cscript_fixnum) * (frame_size + 1));
+  for (int i = 0; i < 20; ++i)
+    {
+    cscript_fixnum args[2];
+    args[0] = i;
+    args[1] = convert_to_fx(i * 0.25);
+    cscript_set_function_arguments(ctxt, args, 2);
+    cscript_fixnum expected = *cscript_run(ctxt, fun);
+    frame[frame_size] = 12345;
+    frame[0] = args[0];
+    frame[1] = args[1];
+    cscript_fixnum* res = cscript_run_frame(fun, externals, frame);
+    TEST_EQ_INT(expected, *res);
+    TEST_EQ_INT(12345, frame[frame_size]);
+    }
+  free(frame);
+  cscript_function_free(ctxt, fun);
+  }
+
+static void test_run_frame()
+  {
+  cscript_context* ctxt = cscript_open(256);
+  test_run_frame_aux(ctxt, "(int a, float b) a * 3 + 7;", NULL);
+  test_run_frame_aux(ctxt, "(int a, float b) int s = 0; for (int i = 0; i < a; ++i) { s += i; } s + b;", NULL);
+  test_run_frame_aux(ctxt, "(int a, float b) int arr[10]; for (int i = 0; i < 10; ++i) { arr[i] = i * a; } arr[a % 10];", NULL);
+  test_run_frame_aux(ctxt, "(int a, float b) int s = 0; for (int i = 0; i < 3; ++i) { int arr[8]; for (int j = 0; j < 8; ++j) { arr[j] = i + j; } s += arr[a % 8]; } s;", NULL);
+  test_run_frame_aux(ctxt, "(int a, float b) sqrt(b) + min(b, 2.0);", NULL);
+  cscript_register_external_function(ctxt, "add_half", (void*)&add_half, cscript_foreign_flonum);
+  cscript_set_global_fixnum_value(ctxt, "$offset", 1000);
+  cscript_externals externals = cscript_get_externals(ctxt);
+  test_run_frame_aux(ctxt, "(int a, float b) add_half(b) * a;", &externals);
+  test_run_frame_aux(ctxt, "(int a, float b) a + $offset;", &externals);
+
+  // writes to globals go to the globals of the externals, which can be private to the caller
+  TEST_EQ_INT(1, cscript_get_number_of_globals(ctxt));
+  cscript_fixnum globals[1];
+  globals[0] = 5;
+  externals.globals = globals;
+  cscript_function* fun = cscript_compile(ctxt, "(int a) $offset = $offset + a; $offset;");
+  cscript_fixnum* frame = (cscript_fixnum*)malloc(sizeof(cscript_fixnum) * cscript_get_frame_size(fun));
+  frame[0] = 3;
+  TEST_EQ_INT(8, *cscript_run_frame(fun, &externals, frame));
+  frame[0] = 4;
+  TEST_EQ_INT(12, *cscript_run_frame(fun, &externals, frame));
+  TEST_EQ_INT(12, globals[0]);
+  free(frame);
+  cscript_function_free(ctxt, fun);
+  fun = cscript_compile(ctxt, "() $offset;");
+  TEST_EQ_INT(1000, *cscript_run(ctxt, fun));
+  cscript_function_free(ctxt, fun);
+  cscript_close(ctxt);
+  }
+
+typedef struct pool_test_data
+  {
+  cscript_context_pool* pool;
+  cscript_function* fun;
+  int thread_index;
+  cscript_fixnum results[100];
+  int failed_acquires;
+  } pool_test_data;
+
+static void pool_test_thread(void* data)
+  {
+  pool_test_data* d = (pool_test_data*)data;
+  d->failed_acquires = 0;
+  for (int i = 0; i < 100; ++i)
+    {
+    cscript_context* ctxt = cscript_context_pool_acquire(d->pool);
+    if (ctxt == NULL)
+      {
+      ++d->failed_acquires;
+      d->results[i] = 0;
+      continue;
+      }
+    cscript_fixnum arg = d->thread_index * 1000 + i;
+    cscript_set_function_arguments(ctxt, &arg, 1);
+    d->results[i] = *cscript_run(ctxt, d->fun);
+    cscript_context_pool_release(d->pool, ctxt);
+    }
+  }
+
+static void test_context_pool()
+  {
+  cscript_context* ctxt = cscript_open(256);
+  cscript_register_external_function(ctxt, "add_half", (void*)&add_half, cscript_foreign_flonum);
+  cscript_set_global_fixnum_value(ctxt, "$offset", 1000);
+  cscript_function* fun = cscript_compile(ctxt, "(int a) $offset = $offset + a; float f = add_half(1.5); $offset + f;");
+  cscript_context_pool* pool = cscript_context_pool_new(ctxt, 256, 2);
+
+  cscript_context* c1 = cscript_context_pool_acquire(pool);
+  cscript_context* c2 = cscript_context_pool_acquire(pool);
+  TEST_EQ_INT(1, c1 != NULL ? 1 : 0);
+  TEST_EQ_INT(1, c2 != NULL ? 1 : 0);
+  TEST_EQ_INT(1, c1 != c2 ? 1 : 0);
+  TEST_EQ_INT(1, cscript_context_pool_acquire(pool) == NULL ? 1 : 0);
+
+  cscript_fixnum arg = 5;
+  cscript_set_function_arguments(c1, &arg, 1);
+  TEST_EQ_INT(convert_to_fx(1007.0), *cscript_run(c1, fun));
+  TEST_EQ_INT(convert_to_fx(1012.0), *cscript_run(c1, fun));
+  // the globals of the main context are not changed by the pooled contexts
+  cscript_set_function_arguments(ctxt, &arg, 1);
+  TEST_EQ_INT(convert_to_fx(1007.0), *cscript_run(ctxt, fun));
+
+  // release restores the globals from the main context, and the context is reused
+  cscript_context_pool_release(pool, c1);
+  cscript_context* c3 = cscript_context_pool_acquire(pool);
+  TEST_EQ_INT(1, c3 == c1 ? 1 : 0);
+  cscript_set_function_arguments(c3, &arg, 1);
+  TEST_EQ_INT(convert_to_fx(1012.0), *cscript_run(c3, fun));
+  cscript_context_pool_release(pool, c3);
+  cscript_context_pool_release(pool, c2);
+
+  // many threads sharing a pool that is smaller than the number of threads
+  cscript_set_global_fixnum_value(ctxt, "$offset", 0);
+  cscript_context_pool_free(pool);
+  pool = cscript_context_pool_new(ctxt, 256, 0);
+  pool_test_data data[4];
+  cscript_thread threads[4];
+  for (int t = 0; t < 4; ++t)
+    {
+    data[t].pool = pool;
+    data[t].fun = fun;
+    data[t].thread_index = t;
+    cscript_thread_create(&threads[t], pool_test_thread, &data[t]);
+    }
+  for (int t = 0; t < 4; ++t)
+    {
+    cscript_thread_join(&threads[t]);
+    TEST_EQ_INT(0, data[t].failed_acquires);
+    for (int i = 0; i < 100; ++i)
+      {
+      TEST_EQ_INT(convert_to_fx((cscript_flonum)(t * 1000 + i + 2)), data[t].results[i]);
+      }
+    }
+  cscript_context_pool_free(pool);
+  cscript_function_free(ctxt, fun);
+  cscript_close(ctxt);
+  }
+
+static void test_run_slice()
+  {
+  cscript_context* ctxt = cscript_open(256);
+  cscript_context* ctxt2 = cscript_context_init(ctxt, 256);
+  cscript_function* fun = cscript_compile(ctxt, "(int n) int s = 0; for (int i = 0; i < n; ++i) { int j = 0; while (j < 3) { s += i; ++j; } } s;");
+  cscript_function* fun2 = cscript_compile(ctxt, "(int n) int s = 1; for (int i = 0; i < n; ++i) { s += s; } s;");
+  cscript_fixnum arg = 100;
+  cscript_set_function_arguments(ctxt, &arg, 1);
+  const cscript_fixnum expected = *cscript_run(ctxt, fun);
+  TEST_EQ_INT(14850, expected);
+
+  // straight-line code and a large budget finish in one slice
+  cscript_run_state state;
+  cscript_run_state_init(&state);
+  cscript_set_function_arguments(ctxt, &arg, 1);
+  TEST_EQ_INT(cscript_run_finished, cscript_run_slice(ctxt, fun, 1000000, &state));
+  TEST_EQ_INT(expected, *state.result);
+  TEST_EQ_INT(0, state.pc);
+  cscript_function* straight = cscript_compile(ctxt, "(int n) n * 2 + 1;");
+  cscript_set_function_arguments(ctxt, &arg, 1);
+  TEST_EQ_INT(cscript_run_finished, cscript_run_slice(ctxt, straight, 0, &state));
+  TEST_EQ_INT(201, *state.result);
+  cscript_function_free(ctxt, straight);
+
+  // interleave two long running scripts on two contexts
+  cscript_run_state state2;
+  cscript_run_state_init(&state);
+  cscript_run_state_init(&state2);
+  cscript_set_function_arguments(ctxt, &arg, 1);
+  cscript_fixnum arg2 = 40;
+  cscript_set_function_arguments(ctxt2, &arg2, 1);
+  int slices = 0;
+  int slices2 = 0;
+  int done = 0;
+  int done2 = 0;
+  while (!done || !done2)
+    {
+    if (!done)
+      {
+      ++slices;
+      done = cscript_run_slice(ctxt, fun, 10, &state) == cscript_run_finished;
+      }
+    if (!done2)
+      {
+      ++slices2;
+      done2 = cscript_run_slice(ctxt2, fun2, 7, &state2) == cscript_run_finished;
+      }
+    }
+  TEST_EQ_INT(expected, *state.result);
+  TEST_EQ_INT(((cscript_fixnum)1) << 40, *state2.result);
+  // the loops test at the bottom, so fun takes 99 + 100*2 backward jumps, and fun2 takes 39 backward jumps.
+  // A slice executes budget backward jumps and is suspended at the next one.
+  TEST_EQ_INT(299 / 11 + 1, slices);
+  TEST_EQ_INT(39 / 8 + 1, slices2);
+
+  cscript_function_free(ctxt, fun);
+  cscript_function_free(ctxt, fun2);
+  cscript_context_destroy(ctxt2);
+  cscript_close(ctxt);
+  }
+
+static void test_parallel_for()
+  {
+  cscript_context* ctxt = cscript_open(256);
+  const int n = 10000;
+  cscript_flonum* x = cscript_newvector(NULL, n + 3, cscript_flonum);
+  cscript_flonum expected_sum = 0.0;
+  cscript_flonum expected_min = 1000000.0;
+  cscript_flonum expected_max = -1000000.0;
+  for (int i = 0; i < n; ++i)
+    {
+    x[i] = (cscript_flonum)((i * 37) % 101 - 50);
+    expected_sum += x[i];
+    expected_min = x[i] < expected_min ? x[i] : expected_min;
+    expected_max = x[i] > expected_max ? x[i] : expected_max;
+    }
+  cscript_function* fun = cscript_compile(ctxt, "(float* x, int n) float s = 0.0; float mn = 1000000.0; float mx = -1000000.0; parallel(sum s, min mn, max mx) for (int i = 0; i < n; ++i) { float v = x[i]; s += v; mn = min(mn, v); mx = max(mx, v); } x[n] = mn; x[n+1] = mx; s;");
+  TEST_EQ_INT(0, ctxt->number_of_compile_errors);
+  cscript_fixnum args[2] = { (cscript_fixnum)x, n };
+  cscript_set_function_arguments(ctxt, args, 2);
+  TEST_EQ_DOUBLE(expected_sum, *cast(cscript_flonum*, cscript_run(ctxt, fun)));
+  TEST_EQ_DOUBLE(expected_min, x[n]);
+  TEST_EQ_DOUBLE(expected_max, x[n + 1]);
+  // short loops run sequentially on the calling frame
+  args[1] = 10;
+  cscript_set_function_arguments(ctxt, args, 2);
+  TEST_EQ_DOUBLE(x[0] + x[1] + x[2] + x[3] + x[4] + x[5] + x[6] + x[7] + x[8] + x[9], *cast(cscript_flonum*, cscript_run(ctxt, fun)));
+  cscript_function_free(ctxt, fun);
+
+  fun = cscript_compile(ctxt, "(int n) int s = 0; parallel(sum s) for (int i = 1; i <= n; ++i) { s += i; } s;");
+  TEST_EQ_INT(0, ctxt->number_of_compile_errors);
+  cscript_fixnum arg = n;
+  cscript_set_function_arguments(ctxt, &arg, 1);
+  TEST_EQ_INT((cscript_fixnum)n * (n + 1) / 2, *cscript_run(ctxt, fun));
+  cscript_function_free(ctxt, fun);
+
+  // writes through pointers, and a nested parallel loop
+  fun = cscript_compile(ctxt, "(float* x, int n) parallel for (int i = 0; i < n; ++i) { int s = 0; parallel(sum s) for (int j = 0; j < 300; ++j) { s += j; } x[i] = s + i; } 0.0;");
+  TEST_EQ_INT(0, ctxt->number_of_compile_errors);
+  args[1] = n;
+  cscript_set_function_arguments(ctxt, args, 2);
+  cscript_run(ctxt, fun);
+  TEST_EQ_DOUBLE(44850.0, x[0]);
+  TEST_EQ_DOUBLE(44850.0 + n - 1, x[n - 1]);
+  cscript_function_free(ctxt, fun);
+
+  // loop-carried dependencies and unsupported loop forms are compile errors
+  fun = cscript_compile(ctxt, "(int n) int s = 0; parallel for (int i = 0; i < n; ++i) { s += i; } s;");
+  TEST_EQ_INT(1, ctxt->number_of_compile_errors > 0 ? 1 : 0);
+  if (fun != NULL)
+    cscript_function_free(ctxt, fun);
+  fun = cscript_compile(ctxt, "(int n) int s = 0; parallel(sum s) for (int i = 0; i < n; i += 2) { s += i; } s;");
+  TEST_EQ_INT(1, ctxt->number_of_compile_errors > 0 ? 1 : 0);
+  if (fun != NULL)
+    cscript_function_free(ctxt, fun);
+
+  // float sums are combined per chunk in chunk order, so they do not depend on which thread ran which chunk
+  for (int i = 0; i < n; ++i)
+    x[i] = (i % 3 == 0 ? 1e16 : 1.0) / (i + 1);
+  const int chunk_size = (n + CSCRIPT_PARALLEL_FOR_CHUNKS - 1) / CSCRIPT_PARALLEL_FOR_CHUNKS;
+  cscript_flonum expected_chunked_sum = 0.5;
+  for (int first = 0; first < n; first += chunk_size)
+    {
+    cscript_flonum partial = 0.0;
+    for (int i = first; i < first + chunk_size && i < n; ++i)
+      partial += x[i];
+    expected_chunked_sum += partial;
+    }
+  fun = cscript_compile(ctxt, "(float* x, int n) float s = 0.5; parallel(sum s) for (int i = 0; i < n; ++i) { s += x[i]; } s;");
+  TEST_EQ_INT(0, ctxt->number_of_compile_errors);
+  for (int run = 0; run < 10; ++run)
+    {
+    cscript_set_function_arguments(ctxt, args, 2);
+    const cscript_flonum sum = *cast(cscript_flonum*, cscript_run(ctxt, fun));
+    TEST_EQ_INT(1, sum == expected_chunked_sum ? 1 : 0);
+    }
+  cscript_function_free(ctxt, fun);
+
+  cscript_freevector(NULL, x, n + 3, cscript_flonum);
+  cscript_close(ctxt);
+  }
+
+typedef struct test_record
+  {
+  cscript_fixnum id;
+  cscript_flonum value;
+  cscript_fixnum padding;
+  } test_record;
+
+static void test_run_stream()
+  {
+  cscript_context* ctxt = cscript_open(256);
+  // more records than fit in one block, and a number of records that is not a multiple of the block size
+  const int n = CSCRIPT_STREAM_BLOCK_SIZE / (int)sizeof(test_record) * 2 + 123;
+  FILE* f = fopen("cscript_stream_in.bin", "wb");
+  for (int i = 0; i < n; ++i)
+    {
+    test_record r;
+    r.id = i;
+    r.value = i * 0.5;
+    r.padding = -1;
+    fwrite(&r, sizeof(test_record), 1, f);
+    }
+  fclose(f);
+
+  cscript_function* fun = cscript_compile(ctxt, "(float value, int id) value * 2.0 + id;");
+  TEST_EQ_INT(0, ctxt->number_of_compile_errors);
+  const int offsets[2] = { 8, 0 };
+  cscript_record_layout layout;
+  layout.record_size = (int)sizeof(test_record);
+  layout.number_of_fields = 2;
+  layout.field_offsets = offsets;
+  TEST_EQ_INT(n, cscript_run_stream(ctxt, fun, "cscript_stream_in.bin", &layout, "cscript_stream_out.bin"));
+
+  f = fopen("cscript_stream_out.bin", "rb");
+  cscript_flonum* results = cscript_newvector(NULL, n + 1, cscript_flonum);
+  TEST_EQ_INT(n, (int)fread(results, sizeof(cscript_flonum), n + 1, f));
+  fclose(f);
+  int wrong = 0;
+  for (int i = 0; i < n; ++i)
+    {
+    if (results[i] != 2.0 * i)
+      ++wrong;
+    }
+  TEST_EQ_INT(0, wrong);
+  cscript_freevector(NULL, results, n + 1, cscript_flonum);
+
+  TEST_EQ_INT(-1, cscript_run_stream(ctxt, fun, "cscript_stream_does_not_exist.bin", &layout, "cscript_stream_out.bin"));
+  remove("cscript_stream_out.bin");
+
+  // invalid layouts are rejected before the files are opened
+  const int outside_offsets[2] = { (int)sizeof(test_record) - 7, 0 };
+  const int negative_offsets[2] = { 8, -1 };
+  layout.field_offsets = outside_offsets;
+  TEST_EQ_INT(-1, cscript_run_stream(ctxt, fun, "cscript_stream_in.bin", &layout, "cscript_stream_out.bin"));
+  layout.field_offsets = negative_offsets;
+  TEST_EQ_INT(-1, cscript_run_stream(ctxt, fun, "cscript_stream_in.bin", &layout, "cscript_stream_out.bin"));
+  layout.field_offsets = offsets;
+  layout.record_size = 0;
+  TEST_EQ_INT(-1, cscript_run_stream(ctxt, fun, "cscript_stream_in.bin", &layout, "cscript_stream_out.bin"));
+  f = fopen("cscript_stream_out.bin", "rb");
+  TEST_EQ_INT(1, f == NULL ? 1 : 0);
+  if (f != NULL)
+    fclose(f);
+  remove("cscript_stream_in.bin");
+  remove("cscript_stream_out.bin");
+  cscript_function_free(ctxt, fun);
+  cscript_close(ctxt);
+  }
+
+static void test_map_file()
+  {
+  cscript_context* ctxt = cscript_open(256);
+  const int n = 100000;
+  FILE* f = fopen("cscript_mapped.bin", "wb");
+  for (int i = 0; i < n; ++i)
+    {
+    cscript_flonum v = i * 0.25;
+    fwrite(&v, sizeof(cscript_flonum), 1, f);
+    }
+  fclose(f);
+
+  cscript_mapped_file m;
+  TEST_EQ_INT(1, cscript_map_file(&m, "cscript_mapped.bin", cscript_map_read_only, cscript_access_sequential));
+  TEST_EQ_INT(n, (int)m.number_of_elements);
+  TEST_EQ_INT(n * (int)sizeof(cscript_flonum), (int)m.size);
+  cscript_function* fun = cscript_compile(ctxt, "(float* x, int n) float s = 0.0; for (int i = 0; i < n; ++i) { s += x[i]; } s;");
+  cscript_fixnum args[2] = { cscript_mapped_file_argument(&m), (cscript_fixnum)m.number_of_elements };
+  cscript_set_function_arguments(ctxt, args, 2);
+  TEST_EQ_DOUBLE(0.25 * (n - 1) * n / 2, *cast(cscript_flonum*, cscript_run(ctxt, fun)));
+  cscript_function_free(ctxt, fun);
+  cscript_unmap_file(&m);
+  TEST_EQ_INT(1, m.data == NULL ? 1 : 0);
+
+  // copy-on-write mappings can be written by the script, but the file does not change
+  TEST_EQ_INT(1, cscript_map_file(&m, "cscript_mapped.bin", cscript_map_copy_on_write, cscript_access_random));
+  fun = cscript_compile(ctxt, "(float* x) x[1] = 42.0; x[1] + x[2];");
+  args[0] = cscript_mapped_file_argument(&m);
+  cscript_set_function_arguments(ctxt, args, 1);
+  TEST_EQ_DOUBLE(42.5, *cast(cscript_flonum*, cscript_run(ctxt, fun)));
+  cscript_function_free(ctxt, fun);
+  cscript_unmap_file(&m);
+  TEST_EQ_INT(1, cscript_map_file(&m, "cscript_mapped.bin", cscript_map_read_only, cscript_access_normal));
+  TEST_EQ_DOUBLE(0.25, cast(const cscript_flonum*, m.data)[1]);
+  cscript_unmap_file(&m);
+
+  TEST_EQ_INT(0, cscript_map_file(&m, "cscript_mapped_does_not_exist.bin", cscript_map_read_only, cscript_access_normal));
+  remove("cscript_mapped.bin");
+  cscript_close(ctxt);
+  }
+
+static void test_arena()
+  {
+  cscript_arena arena;
+  cscript_arena_init(&arena, NULL);
+  // the most recent block grows in place
+  char* a = cast(char*, cscript_arena_realloc(&arena, NULL, 0, 10));
+  memcpy(a, "abcdefghi", 10);
+  char* b = cast(char*, cscript_arena_realloc(&arena, a, 10, 100));
+  TEST_EQ_INT(1, a == b ? 1 : 0);
+  char* c = cast(char*, cscript_arena_realloc(&arena, NULL, 0, 8));
+  b = cast(char*, cscript_arena_realloc(&arena, b, 100, 200));
+  TEST_EQ_INT(0, a == b ? 1 : 0);
+  TEST_EQ_INT(0, strcmp(b, "abcdefghi"));
+  TEST_EQ_INT(1, cscript_arena_owns(&arena, c));
+  // blocks larger than a chunk get their own chunk
+  char* big = cast(char*, cscript_arena_realloc(&arena, NULL, 0, CSCRIPT_ARENA_CHUNK_SIZE * 3));
+  big[CSCRIPT_ARENA_CHUNK_SIZE * 3 - 1] = 1;
+  TEST_EQ_INT(1, cscript_arena_owns(&arena, big));
+  TEST_EQ_INT(1, cscript_arena_owns(&arena, b));
+  int on_stack = 0;
+  TEST_EQ_INT(0, cscript_arena_owns(&arena, &on_stack));
+  cscript_arena_destroy(&arena);
+
+  // error reports are allocated outside the arena of the compilation, so they survive it
+  cscript_context* ctxt = cscript_open(256);
+  cscript_function* fun = cscript_compile(ctxt, "(int n) int s = 0; for (int i = 0; i < n; ++i) { s += i; } t;");
+  TEST_EQ_INT(1, fun == NULL ? 1 : 0);
+  TEST_EQ_INT(1, ctxt->number_of_compile_errors);
+  char buffer[256];
+  cscript_get_error_message(ctxt, buffer, 256);
+  TEST_EQ_INT(1, strstr(buffer, "variable unknown") != NULL ? 1 : 0);
+  fun = cscript_compile(ctxt, "(int n) int s = 0; for (int i = 0; i < n; ++i) { s += i; } s;");
+  TEST_EQ_INT(0, ctxt->number_of_compile_errors);
+  cscript_fixnum arg = 10;
+  cscript_set_function_arguments(ctxt, &arg, 1);
+  TEST_EQ_INT(45, *cscript_run(ctxt, fun));
+  cscript_function_free(ctxt, fun);
+  cscript_close(ctxt);
+  }
+
+static void test_symbols()
+  {
+  cscript_context* ctxt = cscript_open(256);
+  cscript_vector tokens = cscript_script2tokens(ctxt, "(int a) int x = a; { float x = 2.5; x += 1.0; } x += 3; int $y; $y = x; x;");
+  cscript_program prog = make_program(ctxt, &tokens);
+  cscript_alpha_conversion(ctxt, &prog);
+  // a, the outer x and the inner x
+  TEST_EQ_INT(3, prog.number_of_symbols);
+  TEST_EQ_INT(0, cscript_vector_at(&prog.parameters, 0, cscript_parameter)->symbol);
+  cscript_statement* outer_x = cscript_vector_at(&prog.statements, 0, cscript_statement);
+  TEST_EQ_INT(1, cscript_vector_at(&outer_x->statement.stmts.statements, 0, cscript_statement)->statement.fixnum.symbol);
+  cscript_statement* add_x = cscript_vector_at(&prog.statements, 2, cscript_statement);
+  TEST_EQ_INT(1, add_x->statement.assignment.symbol);
+  cscript_statement* global_y = cscript_vector_at(&prog.statements, 4, cscript_statement);
+  TEST_EQ_INT(-1, global_y->statement.assignment.symbol);
+  cscript_function* fun = cscript_compile_program(ctxt, &prog);
+  TEST_EQ_INT(0, ctxt->number_of_compile_errors);
+  cscript_fixnum arg = 4;
+  cscript_set_function_arguments(ctxt, &arg, 1);
+  TEST_EQ_INT(7, *cscript_run(ctxt, fun));
+  cscript_function_free(ctxt, fun);
+  cscript_program_destroy(ctxt, &prog);
+  destroy_tokens_vector(ctxt, &tokens);
+  cscript_close(ctxt);
+  }
+
+typedef struct cache_test_data
+  {
+  cscript_context_pool* pool;
+  cscript_compile_cache* cache;
+  int thread_index;
+  cscript_fixnum results[50];
+  } cache_test_data;
+
+static void cache_test_thread(void* data)
+  {
+  cache_test_data* d = (cache_test_data*)data;
+  const char* scripts[3] = { "(int a) a + 1;", "(int a) a * 2;", "(int a) a - 3;" };
+  for (int i = 0; i < 50; ++i)
+    {
+    cscript_context* ctxt = cscript_context_pool_acquire(d->pool);
+    cscript_function* fun = cscript_compile_cached(d->cache, ctxt, scripts[(i + d->thread_index) % 3], NULL);
+    cscript_fixnum arg = i;
+    cscript_set_function_arguments(ctxt, &arg, 1);
+    d->results[i] = fun != NULL ? *cscript_run(ctxt, fun) : -1000;
+    if (fun != NULL)
+      cscript_compile_cache_release(d->cache, fun);
+    cscript_context_pool_release(d->pool, ctxt);
+    }
+  }
+
+static void test_bundle()
+  {
+  const char* script = "(int n, float b) int $count = 2; int s = 0; parallel(sum s) for (int i = 1; i <= n; ++i) { s += i; } add_half(b) + s + $offset * $count;";
+  cscript_context* ctxt = cscript_open(256);
+  cscript_set_global_fixnum_value(ctxt, "$other", 7);
+  cscript_set_global_flonum_value(ctxt, "$offset", 0.25);
+  cscript_register_external_function(ctxt, "convert_to_fx", (void*)&convert_to_fx, cscript_foreign_fixnum);
+  cscript_register_external_function(ctxt, "add_half", (void*)&add_half, cscript_foreign_flonum);
+  cscript_function* fun = cscript_compile(ctxt, script);
+  TEST_EQ_INT(1, cscript_function_save(ctxt, fun, "cscript_function.bin"));
+  cscript_function* square = cscript_compile(ctxt, "(int a) a * a;");
+  cscript_function* functions[2] = { fun, square };
+  const char* names[2] = { "sum", "square" };
+  TEST_EQ_INT(1, cscript_bundle_save(ctxt, functions, names, 2, "cscript_bundle.bin"));
+  cscript_function_free(ctxt, fun);
+  cscript_function_free(ctxt, square);
+  cscript_close(ctxt);
+
+  // externals and globals are resolved by name in the loading context, whatever their positions
+  ctxt = cscript_open(256);
+  cscript_register_external_function(ctxt, "add_half", (void*)&add_half, cscript_foreign_flonum);
+  cscript_set_global_flonum_value(ctxt, "$offset", 1.5);
+  fun = cscript_function_load(ctxt, "cscript_function.bin");
+  TEST_EQ_INT(1, fun != NULL ? 1 : 0);
+  TEST_EQ_INT(2, cscript_get_number_of_globals(ctxt)); // $count is declared by the load
+  cscript_fixnum args[2];
+  args[0] = 10;
+  *cast(cscript_flonum*, &args[1]) = 1.0;
+  cscript_set_function_arguments(ctxt, args, 2);
+  TEST_EQ_DOUBLE(1.5 + 55.0 + 3.0, *cast(cscript_flonum*, cscript_run(ctxt, fun)));
+  cscript_function_free(ctxt, fun);
+
+  cscript_bundle* b = cscript_bundle_open(ctxt, "cscript_bundle.bin");
+  TEST_EQ_INT(1, b != NULL ? 1 : 0);
+  TEST_EQ_INT(2, cscript_bundle_size(b));
+  TEST_EQ_INT(1, cscript_bundle_find(b, "square"));
+  TEST_EQ_INT(-1, cscript_bundle_find(b, "cube"));
+  TEST_EQ_INT(1, strcmp(cscript_bundle_name(b, 0), "sum") == 0 ? 1 : 0);
+  square = cscript_bundle_load(ctxt, b, 1);
+  fun = cscript_bundle_load(ctxt, b, 0);
+  cscript_bundle_close(ctxt, b);
+  args[0] = 12;
+  cscript_set_function_arguments(ctxt, args, 1);
+  TEST_EQ_INT(144, *cscript_run(ctxt, square));
+  args[0] = 4;
+  cscript_set_function_arguments(ctxt, args, 2);
+  TEST_EQ_DOUBLE(1.5 + 10.0 + 3.0, *cast(cscript_flonum*, cscript_run(ctxt, fun)));
+  cscript_function_free(ctxt, fun);
+  cscript_function_free(ctxt, square);
+  cscript_close(ctxt);
+
+  // missing external functions and globals of another type are errors
+  ctxt = cscript_open(256);
+  TEST_EQ_INT(1, cscript_function_load(ctxt, "cscript_function.bin") == NULL ? 1 : 0);
+  TEST_EQ_INT(CSCRIPT_ERROR_EXTERNAL_UNKNOWN, cscript_vector_at(&ctxt->runtime_error_reports, 0, cscript_error_report)->errorcode);
+  cscript_register_external_function(ctxt, "add_half", (void*)&add_half, cscript_foreign_flonum);
+  cscript_set_global_fixnum_value(ctxt, "$offset", 1);
+  TEST_EQ_INT(1, cscript_function_load(ctxt, "cscript_function.bin") == NULL ? 1 : 0);
+  TEST_EQ_INT(CSCRIPT_ERROR_VARIABLE_UNKNOWN, cscript_vector_at(&ctxt->runtime_error_reports, 0, cscript_error_report)->errorcode);
+
+  // truncated and foreign files are rejected
+  FILE* f = fopen("cscript_function.bin", "rb");
+  char buffer[4096];
+  size_t size = fread(buffer, 1, sizeof(buffer), f);
+  fclose(f);
+  f = fopen("cscript_truncated.bin", "wb");
+  fwrite(buffer, 1, size - 16, f);
+  fclose(f);
+  TEST_EQ_INT(1, cscript_function_load(ctxt, "cscript_truncated.bin") == NULL ? 1 : 0);
+  f = fopen("cscript_truncated.bin", "wb");
+  fwrite("hello world, this is not a bundle", 1, 33, f);
+  fclose(f);
+  TEST_EQ_INT(1, cscript_bundle_open(ctxt, "cscript_truncated.bin") == NULL ? 1 : 0);
+  TEST_EQ_INT(1, cscript_bundle_open(ctxt, "cscript_does_not_exist.bin") == NULL ? 1 : 0);
+
+  // counts whose size in bytes wraps around, and result registers outside of the frame, are rejected
+  square = cscript_compile(ctxt, "(int a) a * a;");
+  TEST_EQ_INT(1, cscript_function_save(ctxt, square, "cscript_function.bin"));
+  uint32_t header[5];
+  header[0] = (uint32_t)square->result_position;
+  header[1] = (uint32_t)square->frame_size;
+  header[2] = (uint32_t)square->code.vector_size;
+  header[3] = (uint32_t)square->constants.vector_size;
+  header[4] = 0;
+  cscript_function_free(ctxt, square);
+  f = fopen("cscript_function.bin", "rb");
+  size = fread(buffer, 1, sizeof(buffer), f);
+  fclose(f);
+  size_t header_offset = 0;
+  while (header_offset + sizeof(header) <= size && memcmp(buffer + header_offset, header, sizeof(header)) != 0)
+    ++header_offset;
+  TEST_EQ_INT(1, header_offset + sizeof(header) <= size ? 1 : 0);
+  const uint32_t corrupt_values[3] = { 0x40000001, 0x20000001, (uint32_t)header[1] };
+  const int corrupt_fields[3] = { 2, 3, 0 };
+  for (int i = 0; i < 3; ++i)
+    {
+    char corrupt[4096];
+    memcpy(corrupt, buffer, size);
+    memcpy(corrupt + header_offset + corrupt_fields[i] * sizeof(uint32_t), &corrupt_values[i], sizeof(uint32_t));
+    f = fopen("cscript_truncated.bin", "wb");
+    fwrite(corrupt, 1, size, f);
+    fclose(f);
+    TEST_EQ_INT(1, cscript_function_load(ctxt, "cscript_truncated.bin") == NULL ? 1 : 0);
+    }
+  cscript_close(ctxt);
+  remove("cscript_function.bin");
+  remove("cscript_bundle.bin");
+  remove("cscript_truncated.bin");
+  }
+
+static int loads_corrupted(cscript_context* ctxt, const char* buffer, size_t size, size_t offset, uint32_t value)
+  {
+  char corrupt[4096];
+  memcpy(corrupt, buffer, size);
+  memcpy(corrupt + offset, &value, sizeof(uint32_t));
+  FILE* f = fopen("cscript_corrupt.bin", "wb");
+  fwrite(corrupt, 1, size, f);
+  fclose(f);
+  cscript_function* fun = cscript_function_load(ctxt, "cscript_corrupt.bin");
+  if (fun == NULL)
+    return 0;
+  cscript_function_free(ctxt, fun);
+  return 1;
+  }
+
+static int find_opcode(const cscript_function* fun, cscript_opcode op)
+  {
+  for (cscript_memsize i = 0; i < fun->code.vector_size; ++i)
+    {
+    if (CSCRIPT_GET_OPCODE(*cscript_vector_at(&fun->code, i, cscript_instruction)) == op)
+      return (int)i;
+    }
+  return -1;
+  }
+
+static void test_bundle_corrupt_operands()
+  {
+  const char* script = "(int n) int k = 0; for (int j = 0; j < n; ++j) { k += j; } int s = 0; parallel(sum s) for (int i = 0; i < n; ++i) { s += i; } s + k + 100000000000;";
+  cscript_context* ctxt = cscript_open(256);
+  cscript_function* fun = cscript_compile(ctxt, script);
+  TEST_EQ_INT(1, fun != NULL ? 1 : 0);
+  TEST_EQ_INT(1, cscript_function_save(ctxt, fun, "cscript_function.bin"));
+  FILE* f = fopen("cscript_function.bin", "rb");
+  char buffer[4096];
+  size_t size = fread(buffer, 1, sizeof(buffer), f);
+  fclose(f);
+  uint32_t header[5];
+  header[0] = (uint32_t)fun->result_position;
+  header[1] = (uint32_t)fun->frame_size;
+  header[2] = (uint32_t)fun->code.vector_size;
+  header[3] = (uint32_t)fun->constants.vector_size;
+  header[4] = (uint32_t)fun->parallel_loops.vector_size;
+  size_t header_offset = 0;
+  while (header_offset + sizeof(header) <= size && memcmp(buffer + header_offset, header, sizeof(header)) != 0)
+    ++header_offset;
+  TEST_EQ_INT(1, header_offset + sizeof(header) <= size ? 1 : 0);
+  const size_t code_offset = header_offset + sizeof(header);
+  const size_t reductions_offset = code_offset + fun->code.vector_size * sizeof(cscript_instruction) + fun->constants.vector_size * sizeof(cscript_fixnum);
+  const int loadk = find_opcode(fun, CSCRIPT_OPCODE_LOADK);
+  const int jmp = find_opcode(fun, CSCRIPT_OPCODE_JMP);
+  const int callprim = find_opcode(fun, CSCRIPT_OPCODE_CALLPRIM);
+  const int move = find_opcode(fun, CSCRIPT_OPCODE_MOVE);
+  TEST_EQ_INT(1, loadk >= 0 && jmp >= 0 && callprim >= 0 && move >= 0 ? 1 : 0);
+  TEST_EQ_INT(1, loads_corrupted(ctxt, buffer, size, header_offset, header[0]));
+
+  // a frame that does not fit the stack of the loading context
+  TEST_EQ_INT(0, loads_corrupted(ctxt, buffer, size, header_offset + sizeof(uint32_t), 257));
+  // registers outside of the frame
+  cscript_instruction i = *cscript_vector_at(&fun->code, loadk, cscript_instruction);
+  CSCRIPT_SETARG_A(i, fun->frame_size);
+  TEST_EQ_INT(0, loads_corrupted(ctxt, buffer, size, code_offset + loadk * sizeof(cscript_instruction), i));
+  i = *cscript_vector_at(&fun->code, move, cscript_instruction);
+  CSCRIPT_SETARG_B(i, fun->frame_size);
+  TEST_EQ_INT(0, loads_corrupted(ctxt, buffer, size, code_offset + move * sizeof(cscript_instruction), i));
+  // constants that do not exist
+  i = *cscript_vector_at(&fun->code, loadk, cscript_instruction);
+  CSCRIPT_SETARG_Bx(i, fun->constants.vector_size);
+  TEST_EQ_INT(0, loads_corrupted(ctxt, buffer, size, code_offset + loadk * sizeof(cscript_instruction), i));
+  // jumps outside of the code
+  i = *cscript_vector_at(&fun->code, jmp, cscript_instruction);
+  CSCRIPT_SETARG_sBx(i, (int)fun->code.vector_size);
+  TEST_EQ_INT(0, loads_corrupted(ctxt, buffer, size, code_offset + jmp * sizeof(cscript_instruction), i));
+  CSCRIPT_SETARG_sBx(i, -jmp - 2);
+  TEST_EQ_INT(0, loads_corrupted(ctxt, buffer, size, code_offset + jmp * sizeof(cscript_instruction), i));
+  // parallel loops and primitives that do not exist
+  i = *cscript_vector_at(&fun->code, callprim, cscript_instruction);
+  CSCRIPT_SETARG_B(i, CSCRIPT_PARALLEL_FOR);
+  CSCRIPT_SETARG_C(i, fun->parallel_loops.vector_size);
+  TEST_EQ_INT(0, loads_corrupted(ctxt, buffer, size, code_offset + callprim * sizeof(cscript_instruction), i));
+  CSCRIPT_SETARG_B(i, CSCRIPT_PARALLEL_FOR + 1);
+  TEST_EQ_INT(0, loads_corrupted(ctxt, buffer, size, code_offset + callprim * sizeof(cscript_instruction), i));
+  // reduction variables outside of the frame
+  TEST_EQ_INT(0, loads_corrupted(ctxt, buffer, size, reductions_offset + sizeof(uint32_t), header[1]));
+
+  cscript_function_free(ctxt, fun);
+  cscript_close(ctxt);
+  remove("cscript_function.bin");
+  remove("cscript_corrupt.bin");
+  }
+
+static int compiles_fast(const char* script)
+  {
+  cscript_context* ctxt = cscript_open(256);
+  cscript_register_external_function(ctxt, "add_half", (void*)&add_half, cscript_foreign_flonum);
+  cscript_set_global_flonum_value(ctxt, "$g", 2.0);
+  cscript_vector spans = cscript_script2spans(ctxt, script);
+  cscript_function* fun = cscript_compile_fast(ctxt, script, &spans, 1);
+  int result = fun != NULL ? 1 : 0;
+  if (fun)
+    cscript_function_free(ctxt, fun);
+  TEST_EQ_INT(1, cscript_context_is_error_free(ctxt));
+  TEST_EQ_INT(1, (int)cscript_get_number_of_globals(ctxt));
+  cscript_vector_destroy(ctxt, &spans);
+  cscript_close(ctxt);
+  return result;
+  }
+
+static void test_fast_compile_aux(const char* script, int nr_parameters, cscript_fixnum* pars)
+  {
+  cscript_compile_options options;
+  cscript_compile_options_init(&options, 2);
+  cscript_memsize size, size_fast;
+  options.fast_compile_max_length = 0;
+  cscript_fixnum expected = run_with_options_aux(&size, script, &options, nr_parameters, pars);
+  options.fast_compile_max_length = (cscript_memsize)-1;
+  TEST_EQ_INT(expected, run_with_options_aux(&size_fast, script, &options, nr_parameters, pars));
+  TEST_EQ_INT(1, compiles_fast(script));
+  }
+
+static void test_fast_compile()
+  {
+  cscript_fixnum pars[3] = { 7, 3, 0 };
+  test_fast_compile_aux("(int a, int b) a*b - a/b + a%b;", 2, pars);
+  test_fast_compile_aux("(int a, int b) (a < b) + (a >= b) * 2 + (a == 7) + (a != b) - (a <= b) + (b > a);", 2, pars);
+  test_fast_compile_aux("(int a) 10000000000 * a + 2 * 3 - 1;", 1, pars);
+  test_fast_compile_aux("() 2*3 + 4.5;", 0, pars);
+  test_fast_compile_aux("7 - 3 - 2;", 0, pars);
+  pars[0] = convert_to_fx(2.5);
+  pars[1] = 4;
+  pars[2] = convert_to_fx(-1.25);
+  test_fast_compile_aux("(float x) x*x + 3*x;", 1, pars);
+  test_fast_compile_aux("(float x, int n, float y) -x*n + -(2*3) - -y + +n;", 3, pars);
+  test_fast_compile_aux("(float x, int n, float y) sqrt(x*x + y*y) + min(x, n) * 2.0*0.5 - pow(2, 3);", 3, pars);
+  test_fast_compile_aux("(float x, int n, float y) x / n % 2 < y;", 3, pars);
+
+  // externals and declared globals are resolved while parsing
+  cscript_context* ctxt = cscript_open(256);
+  cscript_register_external_function(ctxt, "add_half", (void*)&add_half, cscript_foreign_flonum);
+  cscript_set_global_flonum_value(ctxt, "$g", 2.0);
+  cscript_vector spans = cscript_script2spans(ctxt, "(float b) add_half(b) * $g;");
+  cscript_function* fun = cscript_compile_fast(ctxt, "(float b) add_half(b) * $g;", &spans, 1);
+  TEST_EQ_INT(1, fun != NULL ? 1 : 0);
+  cscript_vector_destroy(ctxt, &spans);
+  pars[0] = convert_to_fx(1.5);
+  cscript_set_function_arguments(ctxt, pars, 1);
+  TEST_EQ_DOUBLE(4.0, *cast(cscript_flonum*, cscript_run(ctxt, fun)));
+  cscript_function_free(ctxt, fun);
+  // operations on literals are folded
+  spans = cscript_script2spans(ctxt, "(float x) x * (2.0 * 3.0) + 1;");
+  fun = cscript_compile_fast(ctxt, "(float x) x * (2.0 * 3.0) + 1;", &spans, 1);
+  TEST_EQ_INT(1, fun != NULL ? 1 : 0);
+  TEST_EQ_INT(2, (int)fun->constants.vector_size);
+  cscript_function_free(ctxt, fun);
+  // unless constant folding is disabled
+  fun = cscript_compile_fast(ctxt, "(float x) x * (2.0 * 3.0) + 1;", &spans, 0);
+  TEST_EQ_INT(1, fun != NULL ? 1 : 0);
+  TEST_EQ_INT(3, (int)fun->constants.vector_size);
+  pars[0] = convert_to_fx(2.0);
+  cscript_set_function_arguments(ctxt, pars, 1);
+  TEST_EQ_DOUBLE(13.0, *cast(cscript_flonum*, cscript_run(ctxt, fun)));
+  cscript_vector_destroy(ctxt, &spans);
+  cscript_function_free(ctxt, fun);
+
+  // everything else is left to the full pipeline, without errors or declarations
+  TEST_EQ_INT(1, compiles_fast("(float b) add_half(b) * $g;"));
+  TEST_EQ_INT(0, compiles_fast("(int a) int b = a; b;"));
+  TEST_EQ_INT(0, compiles_fast("(float* x) x[0];"));
+  TEST_EQ_INT(0, compiles_fast("(int a, int a) a;"));
+  TEST_EQ_INT(0, compiles_fast("(int a) a + c;"));
+  TEST_EQ_INT(0, compiles_fast("(int a) a"));
+  TEST_EQ_INT(0, compiles_fast("(int a) a; a;"));
+  TEST_EQ_INT(0, compiles_fast("(int a) $h + a;"));
+  TEST_EQ_INT(0, compiles_fast("(int a) unknown(a);"));
+  TEST_EQ_INT(0, compiles_fast("(int a) ++a;"));
+  TEST_EQ_INT(0, compiles_fast("(int a) - -a;"));
+  TEST_EQ_INT(0, compiles_fast(""));
+  cscript_close(ctxt);
+  }
+
+static void test_compile_batch()
+  {
+  const char* scripts[] = {
+    "(int a) a + 1;",
+    "(int a) int $g = 5; $g + a;",
+    "(int a) $g = $g + 1; $g * a;",
+    "(int a) a + b;",
+    "(int a) $pre * a;",
+    "(int a) float $h = 1.5; $h + a;",
+    "(int a) int s = 0; for (int i = 0; i < a; ++i) { s += i; } s + $g;",
+    "(int a) $h * 2.0 + $k;",
+    "(int a) int x = ;"
+    };
+  const int n = (int)(sizeof(scripts) / sizeof(scripts[0]));
+  cscript_function* functions[9];
+  cscript_context* ctxt = cscript_open(256);
+  cscript_set_global_fixnum_value(ctxt, "$pre", 3);
+  TEST_EQ_INT(2, cscript_compile_batch_ex(ctxt, scripts, n, functions, NULL, 4));
+  TEST_EQ_INT(1, functions[3] == NULL && functions[8] == NULL ? 1 : 0);
+  TEST_EQ_INT(1, ctxt->number_of_compile_errors);
+  TEST_EQ_INT(1, ctxt->number_of_syntax_errors >= 1 ? 1 : 0);
+  TEST_EQ_INT(1, strncmp(cscript_vector_at(&ctxt->compile_error_reports, 0, cscript_error_report)->message.string_ptr, "script 3: ", 10) == 0 ? 1 : 0);
+  TEST_EQ_INT(1, strncmp(cscript_vector_at(&ctxt->syntax_error_reports, 0, cscript_error_report)->message.string_ptr, "script 8: ", 10) == 0 ? 1 : 0);
+
+  // the same as compiling the scripts one by one
+  cscript_context* sequential = cscript_open(256);
+  cscript_set_global_fixnum_value(sequential, "$pre", 3);
+  TEST_EQ_INT(4, (int)cscript_get_number_of_globals(ctxt)); // $pre, $g, $h and $k
+  cscript_fixnum arg = 4;
+  for (int i = 0; i < n; ++i)
+    {
+    cscript_function* fun = cscript_compile(sequential, scripts[i]);
+    TEST_EQ_INT(fun == NULL ? 1 : 0, functions[i] == NULL ? 1 : 0);
+    if (fun == NULL || functions[i] == NULL)
+      continue;
+    cscript_set_function_arguments(sequential, &arg, 1);
+    cscript_fixnum expected = *cscript_run(sequential, fun);
+    cscript_set_function_arguments(ctxt, &arg, 1);
+    TEST_EQ_INT(expected, *cscript_run(ctxt, functions[i]));
+    cscript_function_free(sequential, fun);
+    cscript_function_free(ctxt, functions[i]);
+    }
+  TEST_EQ_INT((int)cscript_get_number_of_globals(sequential), (int)cscript_get_number_of_globals(ctxt));
+  cscript_close(sequential);
+
+  // the global variables of scripts that were compiled by the workers are remapped to their positions in ctxt
+  const char* redeclaring[] = {
+    "(int a) int $e = a; $e;", // redeclares $e of ctxt with the same type
+    "(int a) $e + 1;",
+    "(int a) float s = 0.0; parallel(sum s) for (int i = 0; i < 300; ++i) { s += $e; } s;",
+    "(int a) float $f = 0.5; $f + a;", // redeclares $f of ctxt with another type
+    "(int a) $f * 2.0;",
+    "(int a) $new * 2.0;", // declared by its first use
+    "(int a) $new + $e;",
+    "(int a) int $new = 3; $new;"
+    };
+  const int number_of_redeclaring = (int)(sizeof(redeclaring) / sizeof(redeclaring[0]));
+  cscript_function* redeclaring_functions[8];
+  cscript_context* batch = cscript_open(256);
+  sequential = cscript_open(256);
+  cscript_set_global_fixnum_value(batch, "$e", 100);
+  cscript_set_global_fixnum_value(batch, "$f", 7);
+  cscript_set_global_fixnum_value(sequential, "$e", 100);
+  cscript_set_global_fixnum_value(sequential, "$f", 7);
+  TEST_EQ_INT(0, cscript_compile_batch_ex(batch, redeclaring, number_of_redeclaring, redeclaring_functions, NULL, 3));
+  for (int i = 0; i < number_of_redeclaring; ++i)
+    {
+    cscript_function* fun = cscript_compile(sequential, redeclaring[i]);
+    cscript_set_function_arguments(sequential, &arg, 1);
+    cscript_fixnum expected = *cscript_run(sequential, fun);
+    cscript_set_function_arguments(batch, &arg, 1);
+    TEST_EQ_INT(expected, *cscript_run(batch, redeclaring_functions[i]));
+    cscript_function_free(sequential, fun);
+    cscript_function_free(batch, redeclaring_functions[i]);
+    }
+  TEST_EQ_INT((int)cscript_get_number_of_globals(sequential), (int)cscript_get_number_of_globals(batch));
+  cscript_close(sequential);
+  cscript_close(batch);
+
+  // many independent scripts
+  char texts[200][64];
+  const char* many[200];
+  cscript_function* many_functions[200];
+  for (int i = 0; i < 200; ++i)
+    {
+    sprintf(texts[i], "(int a) int s = a * %d; s + %d;", i, i % 7);
+    many[i] = texts[i];
+    }
+  TEST_EQ_INT(0, cscript_compile_batch(ctxt, many, 200, many_functions));
+  TEST_EQ_INT(1, cscript_context_is_error_free(ctxt));
+  for (int i = 0; i < 200; ++i)
+    {
+    cscript_set_function_arguments(ctxt, &arg, 1);
+    TEST_EQ_INT(4 * i + i % 7, *cscript_run(ctxt, many_functions[i]));
+    cscript_function_free(ctxt, many_functions[i]);
+    }
+  cscript_close(ctxt);
+  }
+
+static int statement_type(cscript_program* prog, int index)
+  {
+  cscript_statement* s = cscript_vector_at(&prog->statements, index, cscript_statement);
+  if (s->type == cscript_statement_type_comma_separated && s->statement.stmts.statements.vector_size == 1)
+    s = cscript_vector_begin(&s->statement.stmts.statements, cscript_statement);
+  return s->type;
+  }
+
+static void test_fused_preprocessing()
+  {
+  // constants propagate along a chain of declarations within a single round
+  cscript_context* ctxt = cscript_open(256);
+  cscript_compile_options options;
+  cscript_compile_options_init(&options, 1);
+  cscript_vector tokens = cscript_script2tokens(ctxt, "(int x) int a = 2; int b = a*3; float c = b + 0.5; c*x;");
+  cscript_program prog = make_program(ctxt, &tokens);
+  cscript_preprocess_ex(ctxt, &prog, &options);
+  TEST_EQ_INT(4, (int)prog.statements.vector_size);
+  for (int i = 0; i < 3; ++i)
+    TEST_EQ_INT(cscript_statement_type_nop, statement_type(&prog, i));
+  cscript_function* fun = cscript_compile_program(ctxt, &prog);
+  cscript_fixnum x = 4;
+  cscript_set_function_arguments(ctxt, &x, 1);
+  TEST_EQ_DOUBLE(26.0, *cast(cscript_flonum*, cscript_run(ctxt, fun)));
+  cscript_function_free(ctxt, fun);
+  destroy_tokens_vector(ctxt, &tokens);
+  cscript_program_destroy(ctxt, &prog);
+
+  // variables that are assigned to keep their declaration
+  tokens = cscript_script2tokens(ctxt, "(int x) int a = 2; int b = 3; b = b + x; for (int i = 0; i < 3; i = i + a) { x = x + b; } x;");
+  prog = make_program(ctxt, &tokens);
+  cscript_preprocess_ex(ctxt, &prog, &options);
+  TEST_EQ_INT(cscript_statement_type_nop, statement_type(&prog, 0));
+  TEST_EQ_INT(cscript_statement_type_fixnum, statement_type(&prog, 1));
+  fun = cscript_compile_program(ctxt, &prog);
+  cscript_set_function_arguments(ctxt, &x, 1);
+  TEST_EQ_INT(18, *cscript_run(ctxt, fun));
+  cscript_function_free(ctxt, fun);
+  destroy_tokens_vector(ctxt, &tokens);
+  cscript_program_destroy(ctxt, &prog);
+  cscript_close(ctxt);
+  }
+
+static void test_compile_report()
+  {
+  cscript_context* ctxt = cscript_open(256);
+  cscript_compile_report report;
+  TEST_EQ_INT(0, cscript_get_compile_report(ctxt, &report));
+  cscript_compile_report_enable(ctxt, 1);
+  cscript_compile_options options;
+  cscript_compile_options_init(&options, 2);
+  cscript_function* fun = cscript_compile_ex(ctxt, "(int a) int s = 0; for (int i = 0; i < a; ++i) { s += i * (2 + 3); } s;", &options);
+  TEST_EQ_INT(1, fun != NULL ? 1 : 0);
+  TEST_EQ_INT(1, cscript_get_compile_report(ctxt, &report));
+  TEST_EQ_INT(0, report.fast_path);
+  TEST_EQ_INT(37, (int)report.number_of_tokens);
+  TEST_EQ_INT(1, report.number_of_nodes > 0 ? 1 : 0);
+  // folding 2 + 3 removes nodes
+  TEST_EQ_INT(1, report.number_of_optimized_nodes < report.number_of_nodes ? 1 : 0);
+  TEST_EQ_INT(2, (int)report.phases[cscript_compile_phase_tokenize].number_of_runs);
+  TEST_EQ_INT(1, (int)report.phases[cscript_compile_phase_parse].number_of_runs);
+  TEST_EQ_INT(1, (int)report.phases[cscript_compile_phase_alpha_conversion].number_of_runs);
+  TEST_EQ_INT(2, (int)report.phases[cscript_compile_phase_constant_propagation].number_of_runs);
+  TEST_EQ_INT(2, (int)report.phases[cscript_compile_phase_constant_folding].number_of_runs);
+  TEST_EQ_INT(1, (int)report.phases[cscript_compile_phase_remove_dead_variables].number_of_runs);
+  TEST_EQ_INT(1, (int)report.phases[cscript_compile_phase_code_generation].number_of_runs);
+  TEST_EQ_INT(1, (int)report.phases[cscript_compile_phase_single_pass].number_of_runs);
+  double total = 0.0;
+  for (int i = 0; i < cscript_number_of_compile_phases; ++i)
+    {
+    TEST_EQ_INT(1, report.phases[i].time >= 0.0 ? 1 : 0);
+    TEST_EQ_INT(1, report.phases[i].number_of_allocations == 0 ? (report.phases[i].allocated_bytes == 0 ? 1 : 0) : 1);
+    total += report.phases[i].time;
+    }
+  TEST_EQ_INT(1, total <= report.time ? 1 : 0);
+  TEST_EQ_INT(1, report.phases[cscript_compile_phase_tokenize].number_of_allocations > 0 ? 1 : 0);
+  TEST_EQ_INT(1, report.phases[cscript_compile_phase_parse].allocated_bytes > 0 ? 1 : 0);
+  TEST_EQ_INT(1, report.phases[cscript_compile_phase_code_generation].allocated_bytes > 0 ? 1 : 0);
+  cscript_function_free(ctxt, fun);
+
+  // each compilation starts a new report
+  fun = cscript_compile_ex(ctxt, "(float x) x*x + 3*x;", &options);
+  TEST_EQ_INT(1, cscript_get_compile_report(ctxt, &report));
+  TEST_EQ_INT(1, report.fast_path);
+  TEST_EQ_INT(12, (int)report.number_of_tokens);
+  TEST_EQ_INT(0, (int)report.number_of_nodes);
+  TEST_EQ_INT(0, (int)report.phases[cscript_compile_phase_parse].number_of_runs);
+  TEST_EQ_INT(1, report.phases[cscript_compile_phase_single_pass].allocated_bytes > 0 ? 1 : 0);
+  cscript_function_free(ctxt, fun);
+
+  cscript_compile_report_enable(ctxt, 0);
+  TEST_EQ_INT(0, cscript_get_compile_report(ctxt, &report));
+  cscript_close(ctxt);
+  }
+
+static void test_keyword_tokens()
+  {
+  // parallel, sum, min and max are no keywords and remain valid names
+  test_compile_fixnum_aux(23, "int sum = 3; int max = 4; int parallel = 5; sum + max * parallel;");
+  test_compile_fixnum_aux(10, "int min = 0; parallel(sum min) for (int i = 0; i < 5; ++i) { min += i; } min;");
+  cscript_fixnum pars[2] = { 3, 4 };
+  test_compile_fixnum_pars_aux(7, "(int a, int b) a + b;", 2, pars);
+  test_compile_fixnum_pars_aux(12, "(int a, int b) int x = 0; if (a > b) { x = a; } else if (a < b) { x = b*a; } else { x = 1; } x;", 2, pars);
+
+  cscript_context* ctxt = cscript_open(256);
+  cscript_function* fun = cscript_compile(ctxt, "int while = 3; while;");
+  TEST_EQ_INT(1, fun == NULL ? 1 : 0);
+  TEST_EQ_INT(1, ctxt->number_of_syntax_errors > 0 ? 1 : 0);
+  fun = cscript_compile(ctxt, "(int a, double b) a;");
+  TEST_EQ_INT(1, fun == NULL ? 1 : 0);
+  TEST_EQ_INT(1, ctxt->number_of_syntax_errors > 0 ? 1 : 0);
+  // a misplaced keyword is reported, and ends the statements of a block once there are too many errors
+  fun = cscript_compile(ctxt, "int x = 0; if (x > 1) { x = 2; } x = 3; else { x = 4; } x;");
+  TEST_EQ_INT(1, fun == NULL ? 1 : 0);
+  fun = cscript_compile(ctxt, "int x = 0; if (x > 1) x = 2; else x = 4; x;");
+  TEST_EQ_INT(1, fun == NULL ? 1 : 0);
+  fun = cscript_compile(ctxt, "int a = 3 a;");
+  TEST_EQ_INT(1, fun == NULL ? 1 : 0);
+  char message[256];
+  cscript_get_error_message(ctxt, message, 256);
+  TEST_EQ_INT(1, strstr(message, ";") != NULL ? 1 : 0);
+  cscript_close(ctxt);
+  }
+
+typedef struct counting_allocator
+  {
+  cscript_mutex mutex;
+  int64_t live_bytes;
+  uint64_t number_of_calls;
+  } counting_allocator;
+
+static void* counting_reallocate(void* user_data, void* chunk, cscript_memsize old_size, cscript_memsize new_size)
+  {
+  counting_allocator* a = cast(counting_allocator*, user_data);
+  cscript_mutex_lock(&a->mutex);
+  a->live_bytes += cast(int64_t, new_size) - cast(int64_t, old_size);
+  ++a->number_of_calls;
+  cscript_mutex_unlock(&a->mutex);
+  if (new_size == 0)
+    {
+    free(chunk);
+    return NULL;
+    }
+  return realloc(chunk, new_size);
+  }
+
+static void test_memory_stats()
+  {
+  counting_allocator a;
+  cscript_mutex_init(&a.mutex);
+  a.live_bytes = 0;
+  a.number_of_calls = 0;
+  cscript_allocator allocator;
+  allocator.reallocate = &counting_reallocate;
+  allocator.user_data = &a;
+  cscript_context* ctxt = cscript_open_ex(256, &allocator);
+  cscript_memory_stats stats;
+  cscript_get_memory_stats(ctxt, &stats);
+  TEST_EQ_INT(1, a.number_of_calls > 0 ? 1 : 0);
+  TEST_EQ_INT(a.live_bytes, stats.live_bytes);
+  TEST_EQ_INT(1, stats.peak_bytes >= stats.live_bytes ? 1 : 0);
+  const int64_t open_bytes = stats.live_bytes;
+
+  cscript_compile_options options;
+  cscript_compile_options_init(&options, 2);
+  options.fast_compile_max_length = 0;
+  cscript_function* fun = cscript_compile_ex(ctxt, "(int n) int s = 0; for (int i = 0; i < n; ++i) { s += i*2; } s;", &options);
+  TEST_EQ_INT(1, fun != NULL ? 1 : 0);
+  cscript_get_memory_stats(ctxt, &stats);
+  TEST_EQ_INT(a.live_bytes, stats.live_bytes);
+  TEST_EQ_INT(1, stats.live_bytes > open_bytes ? 1 : 0);
+  TEST_EQ_INT(1, stats.peak_bytes > stats.live_bytes ? 1 : 0); // the arena of the compilation is released
+  TEST_EQ_INT(1, stats.category_bytes[cscript_memory_tokens] > 0 ? 1 : 0);
+  TEST_EQ_INT(1, stats.category_bytes[cscript_memory_ast] > 0 ? 1 : 0);
+  TEST_EQ_INT(1, stats.category_bytes[cscript_memory_bytecode] > 0 ? 1 : 0);
+  TEST_EQ_INT(1, stats.category_bytes[cscript_memory_maps] > 0 ? 1 : 0);
+  cscript_fixnum arg = 10;
+  cscript_set_function_arguments(ctxt, &arg, 1);
+  TEST_EQ_INT(90, *cscript_run(ctxt, fun));
+  cscript_function_free(ctxt, fun);
+  cscript_get_memory_stats(ctxt, &stats);
+  TEST_EQ_INT(a.live_bytes, stats.live_bytes);
+
+  // the fast path counts its code as bytecode
+  const uint64_t bytecode_bytes = stats.category_bytes[cscript_memory_bytecode];
+  const uint64_t tokens_bytes = stats.category_bytes[cscript_memory_tokens];
+  fun = cscript_compile(ctxt, "(int a, int b) a*b + 1;");
+  cscript_get_memory_stats(ctxt, &stats);
+  TEST_EQ_INT(1, stats.category_bytes[cscript_memory_bytecode] > bytecode_bytes ? 1 : 0);
+  TEST_EQ_INT(1, stats.category_bytes[cscript_memory_tokens] > tokens_bytes ? 1 : 0);
+  cscript_function_free(ctxt, fun);
+
+  // functions compiled by worker contexts are freed with ctxt, which receives the statistics of the workers
+  const char* scripts[4] = { "(int a) a + 1;", "(float x) x * 2.0;", "int $g = 3; $g;", "(int n) int s = 0; for (int i = 0; i < n; ++i) { s += i; } s;" };
+  cscript_function* functions[4];
+  const int number_of_failures = cscript_compile_batch_ex(ctxt, scripts, 4, functions, NULL, 3);
+  TEST_EQ_INT(0, number_of_failures);
+  for (int i = 0; i < 4; ++i)
+    cscript_function_free(ctxt, functions[i]);
+  cscript_get_memory_stats(ctxt, &stats);
+  TEST_EQ_INT(a.live_bytes, stats.live_bytes);
+
+  // the cache frees functions of ctxt with its own context
+  cscript_compile_cache* cache = cscript_compile_cache_new(ctxt, 1 << 20);
+  fun = cscript_compile_cached(cache, ctxt, "(int a) a * 3;", NULL);
+  TEST_EQ_INT(1, fun == cscript_compile_cached(cache, ctxt, "(int a) a * 3;", NULL) ? 1 : 0);
+  cscript_compile_cache_release(cache, fun);
+  cscript_compile_cache_release(cache, fun);
+  cscript_compile_cache_free(cache);
+  cscript_get_memory_stats(ctxt, &stats);
+  TEST_EQ_INT(a.live_bytes, stats.live_bytes);
+
+  // the default allocator keeps statistics as well
+  cscript_context* ctxt2 = cscript_open(256);
+  cscript_get_memory_stats(ctxt2, &stats);
+  TEST_EQ_INT(1, stats.live_bytes > 0 ? 1 : 0);
+  TEST_EQ_INT(1, stats.number_of_allocations > 0 ? 1 : 0);
+  cscript_close(ctxt2);
+
+  cscript_close(ctxt);
+  TEST_EQ_INT(0, a.live_bytes);
+  cscript_mutex_destroy(&a.mutex);
+  }
+
+static char* make_long_script(int number_of_statements)
+  {
+  const char* statement = "s = s + (i * 3 - 1) / 2;";
+  const size_t length = strlen(statement);
+  char* script = cast(char*, malloc(64 + number_of_statements * length));
+  strcpy(script, "(int i) int s = 0; ");
+  char* p = script + strlen(script);
+  for (int j = 0; j < number_of_statements; ++j, p += length)
+    memcpy(p, statement, length);
+  strcpy(p, " s;");
+  return script;
+  }
+
+static void test_memory_limit()
+  {
+  counting_allocator a;
+  cscript_mutex_init(&a.mutex);
+  a.live_bytes = 0;
+  a.number_of_calls = 0;
+  cscript_allocator allocator;
+  allocator.reallocate = &counting_reallocate;
+  allocator.user_data = &a;
+  cscript_context* ctxt = cscript_open_ex(256, &allocator);
+  char* script = make_long_script(4000);
+  cscript_memory_stats stats;
+  char message[256];
+
+  // without a limit the script compiles
+  cscript_function* fun = cscript_compile(ctxt, script);
+  TEST_EQ_INT(1, fun != NULL ? 1 : 0);
+  cscript_function_free(ctxt, fun);
+
+  cscript_get_memory_stats(ctxt, &stats);
+  cscript_set_memory_limit(ctxt, cast(cscript_memsize, stats.live_bytes) + 256 * 1024);
+  for (int round = 0; round < 2; ++round)
+    {
+    // the first round sizes the vectors of the error reports
+    cscript_get_memory_stats(ctxt, &stats);
+    const int64_t live_bytes = stats.live_bytes;
+    fun = cscript_compile(ctxt, script);
+    TEST_EQ_INT(1, fun == NULL ? 1 : 0);
+    cscript_get_error_message(ctxt, message, sizeof(message));
+    TEST_EQ_INT(1, strstr(message, "memory limit exceeded") != NULL ? 1 : 0);
+    TEST_EQ_INT(1, strstr(message, "bytes in use") != NULL ? 1 : 0);
+    cscript_get_memory_stats(ctxt, &stats);
+    TEST_EQ_INT(a.live_bytes, stats.live_bytes);
+    // small scripts still compile, and the aborted compilation left nothing behind
+    fun = cscript_compile_ex(ctxt, "(int a) int s = 0; for (int i = 0; i < a; ++i) { s += i; } s;", NULL);
+    TEST_EQ_INT(1, fun != NULL ? 1 : 0);
+    cscript_fixnum arg = 5;
+    cscript_set_function_arguments(ctxt, &arg, 1);
+    TEST_EQ_INT(10, *cscript_run(ctxt, fun));
+    cscript_function_free(ctxt, fun);
+    cscript_get_memory_stats(ctxt, &stats);
+    if (round > 0)
+      {
+      TEST_EQ_INT(live_bytes, stats.live_bytes);
+      }
+    }
+
+  // worker contexts inherit the limit
+  const char* scripts[2] = { "(int a) a + 1;", script };
+  cscript_function* functions[2];
+  const int number_of_failures = cscript_compile_batch_ex(ctxt, scripts, 2, functions, NULL, 2);
+  TEST_EQ_INT(1, number_of_failures);
+  TEST_EQ_INT(1, functions[1] == NULL ? 1 : 0);
+  cscript_function_free(ctxt, functions[0]);
+
+  cscript_set_memory_limit(ctxt, 0);
+  fun = cscript_compile(ctxt, script);
+  TEST_EQ_INT(1, fun != NULL ? 1 : 0);
+  cscript_fixnum arg = 3;
+  cscript_set_function_arguments(ctxt, &arg, 1);
+  TEST_EQ_INT(16000, *cscript_run(ctxt, fun));
+  cscript_function_free(ctxt, fun);
+
+  free(script);
+  cscript_close(ctxt);
+  TEST_EQ_INT(0, a.live_bytes);
+  cscript_mutex_destroy(&a.mutex);
+  }
+
+static void test_compile_cache()
+  {
+  cscript_context* ctxt = cscript_open(256);
+  cscript_compile_cache* cache = cscript_compile_cache_new(ctxt, 1 << 20);
+  cscript_compile_cache_stats stats;
+
+  cscript_function* f1 = cscript_compile_cached(cache, ctxt, "(int a) int s = 0; for (int i = 0; i < a; ++i) { s += i; } s;", NULL);
+  cscript_function* f2 = cscript_compile_cached(cache, ctxt, "(int a) int s = 0; for (int i = 0; i < a; ++i) { s += i; } s;", NULL);
+  TEST_EQ_INT(1, f1 != NULL && f1 == f2 ? 1 : 0);
+  cscript_fixnum arg = 10;
+  cscript_set_function_arguments(ctxt, &arg, 1);
+  TEST_EQ_INT(45, *cscript_run(ctxt, f2));
+  // other compile options give another function
+  cscript_compile_options options;
+  cscript_compile_options_init(&options, 0);
+  cscript_function* f3 = cscript_compile_cached(cache, ctxt, "(int a) int s = 0; for (int i = 0; i < a; ++i) { s += i; } s;", &options);
+  TEST_EQ_INT(1, f3 != NULL && f3 != f1 ? 1 : 0);
+  cscript_compile_cache_get_stats(cache, &stats);
+  TEST_EQ_INT(1, stats.hits);
+  TEST_EQ_INT(2, stats.misses);
+  TEST_EQ_INT(2, stats.number_of_functions);
+  cscript_compile_cache_release(cache, f1);
+  cscript_compile_cache_release(cache, f2);
+  cscript_compile_cache_release(cache, f3);
+
+  // errors are not cached
+  TEST_EQ_INT(1, cscript_compile_cached(cache, ctxt, "(int a) b;", NULL) == NULL ? 1 : 0);
+  TEST_EQ_INT(1, ctxt->number_of_compile_errors);
+  TEST_EQ_INT(1, cscript_compile_cached(cache, ctxt, "(int a) b;", NULL) == NULL ? 1 : 0);
+
+  // globals declared by a cached script are declared again on a hit
+  cscript_context* c1 = cscript_context_init(ctxt, 256);
+  cscript_context* c2 = cscript_context_init(ctxt, 256);
+  f1 = cscript_compile_cached(cache, c1, "(int a) int $g = 3; $g + a;", NULL);
+  f2 = cscript_compile_cached(cache, c2, "(int a) int $g = 3; $g + a;", NULL);
+  TEST_EQ_INT(1, f1 != NULL && f1 == f2 ? 1 : 0);
+  TEST_EQ_INT(1, cscript_get_number_of_globals(c2));
+  cscript_set_function_arguments(c2, &arg, 1);
+  TEST_EQ_INT(13, *cscript_run(c2, f2));
+  // c1 now knows $g, so the same script in c1 is another key
+  f3 = cscript_compile_cached(cache, c1, "(int a) $g + a;", NULL);
+  cscript_function* f4 = cscript_compile_cached(cache, ctxt, "(int a) $g + a;", NULL);
+  TEST_EQ_INT(1, f3 != NULL && f4 != NULL && f3 != f4 ? 1 : 0);
+  cscript_compile_cache_release(cache, f4);
+  // registering an external function changes the key
+  cscript_context* c3 = cscript_context_init(ctxt, 256);
+  cscript_register_external_function(c3, "add_half", (void*)&add_half, cscript_foreign_flonum);
+  f4 = cscript_compile_cached(cache, c3, "(int a) int $g = 3; $g + a;", NULL);
+  TEST_EQ_INT(1, f4 != NULL && f4 != f1 ? 1 : 0);
+  cscript_compile_cache_release(cache, f1);
+  cscript_compile_cache_release(cache, f2);
+  cscript_compile_cache_release(cache, f3);
+  cscript_compile_cache_release(cache, f4);
+  cscript_context_destroy(c1);
+  cscript_context_destroy(c2);
+  cscript_context_destroy(c3);
+  cscript_compile_cache_free(cache);
+
+  // least recently used functions are evicted, but stay valid until they are released
+  cache = cscript_compile_cache_new(ctxt, 1);
+  f1 = cscript_compile_cached(cache, ctxt, "(int a) a + 1;", NULL);
+  f2 = cscript_compile_cached(cache, ctxt, "(int a) a + 2;", NULL);
+  cscript_compile_cache_get_stats(cache, &stats);
+  TEST_EQ_INT(1, stats.evictions);
+  TEST_EQ_INT(1, stats.number_of_functions);
+  TEST_EQ_INT(11, *cscript_run(ctxt, f1));
+  cscript_compile_cache_release(cache, f1);
+  f1 = cscript_compile_cached(cache, ctxt, "(int a) a + 1;", NULL);
+  cscript_compile_cache_get_stats(cache, &stats);
+  TEST_EQ_INT(0, stats.hits);
+  TEST_EQ_INT(3, stats.misses);
+  cscript_compile_cache_release(cache, f1);
+  cscript_compile_cache_release(cache, f2);
+  cscript_compile_cache_free(cache);
+
+  // many threads compiling the same scripts
+  cache = cscript_compile_cache_new(ctxt, 1 << 20);
+  cscript_context_pool* pool = cscript_context_pool_new(ctxt, 256, 0);
+  cache_test_data data[4];
+  cscript_thread threads[4];
+  for (int t = 0; t < 4; ++t)
+    {
+    data[t].pool = pool;
+    data[t].cache = cache;
+    data[t].thread_index = t;
+    cscript_thread_create(&threads[t], cache_test_thread, &data[t]);
+    }
+  for (int t = 0; t < 4; ++t)
+    {
+    cscript_thread_join(&threads[t]);
+    for (int i = 0; i < 50; ++i)
+      {
+      const int script = (i + t) % 3;
+      TEST_EQ_INT(script == 0 ? i + 1 : (script == 1 ? i * 2 : i - 3), data[t].results[i]);
+      }
+    }
+  cscript_compile_cache_get_stats(cache, &stats);
+  TEST_EQ_INT(200, stats.hits + stats.misses);
+  TEST_EQ_INT(3, stats.number_of_functions);
+  cscript_context_pool_free(pool);
+  cscript_compile_cache_free(cache);
+
+  // a context with another allocator frees what it compiled itself, the cache keeps its own copy
+  counting_allocator a;
+  cscript_mutex_init(&a.mutex);
+  a.live_bytes = 0;
+  a.number_of_calls = 0;
+  cscript_allocator allocator;
+  allocator.reallocate = &counting_reallocate;
+  allocator.user_data = &a;
+  cscript_context* counted = cscript_open_ex(256, &allocator);
+  cache = cscript_compile_cache_new(ctxt, 1 << 20);
+  f1 = cscript_compile_cached(cache, counted, "(int a) a * 3;", NULL);
+  TEST_EQ_INT(1, f1 != NULL ? 1 : 0);
+  cscript_set_function_arguments(counted, &arg, 1);
+  TEST_EQ_INT(30, *cscript_run(counted, f1));
+  cscript_compile_cache_release(cache, f1);
+  cscript_compile_cache_free(cache);
+  cscript_close(counted);
+  TEST_EQ_INT(0, a.live_bytes);
+  cscript_mutex_destroy(&a.mutex);
+  cscript_close(ctxt);
+  }
+
 void run_all_compiler_tests()
   {
   for (int i = 0; i < 2; ++i)
@@ -1457,6 +3019,7 @@ void run_all_compiler_tests()
     test_array_assignment();
     text_external_calls();
     test_array_address();
+    test_array_address_other_context();
     test_harmonic();
     test_hamming();
     test_fibonacci();    
@@ -1470,4 +3033,27 @@ void run_all_compiler_tests()
     test_scope();
     }
   test_preprocessor();
+  test_compile_options();
+  test_reassociation();
+  test_run_batch();
+  test_run_spmd();
+  test_run_batch_parallel();
+  test_run_frame();
+  test_context_pool();
+  test_run_slice();
+  test_parallel_for();
+  test_run_stream();
+  test_map_file();
+  test_arena();
+  test_symbols();
+  test_compile_cache();
+  test_bundle();
+  test_bundle_corrupt_operands();
+  test_fast_compile();
+  test_compile_batch();
+  test_compile_report();
+  test_fused_preprocessing();
+  test_keyword_tokens();
+  test_memory_stats();
+  test_memory_limit();
   }
\ No newline at end of file
@@ -105,6 +105,71 @@ static void tokenize_floats()
   TEST_EQ_INT(0, scientific);
   }
 
+static void tokenize_spans()
+  {
+  cscript_context* ctxt = cscript_open(256);
+  const char* script = "(float* x, int n) // sum\n  float s = 0.0f; /* multi\n line */ for (int i = 0; i <= n; ++i) { s += x[i] * 2e3; s -= -1.5; --n; }\n if (s != 3 && !(s >= 2)) s /= 2; s % 3 == 1; &x[0];";
+  cscript_vector spans = cscript_script2spans(ctxt, script);
+
+  // the spans match the tokens of a stream
+  cscript_stream str;
+  cscript_stream_init(ctxt, &str, 10);
+  cscript_stream_write(ctxt, &str, script, (cscript_memsize)strlen(script), 0);
+  cscript_stream_rewind(&str);
+  cscript_vector tokens = tokenize(ctxt, &str);
+  cscript_stream_close(ctxt, &str);
+  TEST_EQ_INT(tokens.vector_size, spans.vector_size);
+  for (cscript_memsize i = 0; i < tokens.vector_size && i < spans.vector_size; ++i)
+    {
+    const token* tok = cscript_vector_at(&tokens, i, token);
+    const cscript_token_span* span = cscript_vector_at(&spans, i, cscript_token_span);
+    TEST_EQ_INT(tok->type, span->type);
+    TEST_EQ_INT(tok->line_nr, span->line_nr);
+    TEST_EQ_INT(tok->column_nr, span->column_nr);
+    TEST_EQ_INT((int)tok->value.string_length, span->length);
+    TEST_EQ_INT(0, strncmp(tok->value.string_ptr, script + span->offset, span->length));
+    }
+  destroy_tokens_vector(ctxt, &tokens);
+
+  const cscript_token_span* first = cscript_vector_at(&spans, 0, cscript_token_span);
+  TEST_EQ_INT(CSCRIPT_T_LEFT_ROUND_BRACKET, first->type);
+  TEST_EQ_INT(0, (int)first->offset);
+  TEST_EQ_INT(1, first->length);
+  const cscript_token_span* x = cscript_vector_at(&spans, 3, cscript_token_span);
+  TEST_EQ_INT(CSCRIPT_T_ID, x->type);
+  TEST_EQ_INT(8, (int)x->offset);
+  cscript_vector_destroy(ctxt, &spans);
+
+  spans = cscript_script2spans(ctxt, "");
+  TEST_EQ_INT(0, spans.vector_size);
+  cscript_vector_destroy(ctxt, &spans);
+  cscript_close(ctxt);
+  }
+
+static void tokenize_keywords()
+  {
+  cscript_context* ctxt = cscript_open(256);
+  const char* script = "int float if else for while parallel sum min max interval floats whiles i";
+  const int expected[] = { CSCRIPT_T_KEYWORD_INT, CSCRIPT_T_KEYWORD_FLOAT, CSCRIPT_T_KEYWORD_IF, CSCRIPT_T_KEYWORD_ELSE, CSCRIPT_T_KEYWORD_FOR, CSCRIPT_T_KEYWORD_WHILE,
+    CSCRIPT_T_ID, CSCRIPT_T_ID, CSCRIPT_T_ID, CSCRIPT_T_ID, CSCRIPT_T_ID, CSCRIPT_T_ID, CSCRIPT_T_ID, CSCRIPT_T_ID };
+  cscript_vector tokens = cscript_script2tokens(ctxt, script);
+  cscript_vector spans = cscript_script2spans(ctxt, script);
+  TEST_EQ_INT(14, tokens.vector_size);
+  TEST_EQ_INT(14, spans.vector_size);
+  for (cscript_memsize i = 0; i < tokens.vector_size && i < 14; ++i)
+    TEST_EQ_INT(expected[i], cscript_vector_at(&tokens, i, token)->type);
+  for (cscript_memsize i = 0; i < spans.vector_size && i < 14; ++i)
+    TEST_EQ_INT(expected[i], cscript_vector_at(&spans, i, cscript_token_span)->type);
+  destroy_tokens_vector(ctxt, &tokens);
+  cscript_vector_destroy(ctxt, &spans);
+
+  TEST_EQ_INT(CSCRIPT_T_KEYWORD_WHILE, cscript_keyword_type("while", 5));
+  TEST_EQ_INT(CSCRIPT_T_ID, cscript_keyword_type("whiles", 6));
+  TEST_EQ_INT(0, strcmp(cscript_token_type_text(CSCRIPT_T_KEYWORD_ELSE), "else"));
+  TEST_EQ_INT(0, strcmp(cscript_token_type_text(CSCRIPT_T_RELATIVE_LEQ), "<="));
+  cscript_close(ctxt);
+  }
+
 void run_all_token_tests()
   {
   test_number_recognition();
@@ -112,4 +177,6 @@ void run_all_token_tests()
   tokenize_fixnum_real();
   tokenize_comment();
   tokenize_floats();
+  tokenize_spans();
+  tokenize_keywords();
   }
\ No newline at end of file
@@ -34,7 +34,8 @@ cscript_string cscript_get_original_name_from_alpha(cscript_context* ctxt, cscri
 typedef struct cscript_alpha_conversion_visitor
   {
   cscript_memsize index;
-  cscript_vector variables; // linked chain of variable maps
+  cscript_vector variables; // linked chain of variable maps, mapping original names to symbol ids
+  cscript_vector names; // alpha names indexed by symbol id, owned by the declarations in the program
   cscript_visitor* visitor;
   } cscript_alpha_conversion_visitor;
 
@@ -48,25 +49,29 @@ static void pop_variables_child(cscript_context* ctxt, cscript_alpha_conversion_
   {
   cscript_map** child_map = cscript_vector_back(&v->variables, cscript_map*);
   cscript_map_keys_free(ctxt, *child_map);
-  //cscript_map_values_free(ctxt, *child_map);
   cscript_map_free(ctxt, *child_map);
   cscript_vector_pop_back(&v->variables);
   }
 
-static void add_variable(cscript_context* ctxt, cscript_alpha_conversion_visitor* v, cscript_string* var_name, cscript_string* alpha_name)
+// Interns a new declaration: gives it the next symbol id and returns that id.
+static int add_variable(cscript_context* ctxt, cscript_alpha_conversion_visitor* v, cscript_string* var_name, cscript_string* alpha_name)
   {
   cscript_assert(v->variables.vector_size > 0);
-  //cscript_string alpha_name = cscript_make_alpha_name(ctxt, var_name, v->index++);
+  cscript_assert(v->names.vector_size == v->index);
+  int symbol = cast(int, v->index++);
   cscript_map** active_map = cscript_vector_back(&v->variables, cscript_map*);
   cscript_object key;
   key.type = cscript_object_type_string;
   key.value.s = *var_name;
   cscript_object* obj = cscript_map_insert(ctxt, *active_map, &key);
-  obj->type = cscript_object_type_string;
-  obj->value.s = *alpha_name;
+  obj->type = cscript_object_type_fixnum;
+  obj->value.fx = symbol;
+  cscript_vector_push_back(ctxt, &v->names, *alpha_name, cscript_string);
+  return symbol;
   }
 
-static int find_variable(cscript_string* alpha_name, cscript_context* ctxt, cscript_alpha_conversion_visitor* v, cscript_string* var_name)
+// Returns the symbol id of the innermost declaration of var_name, or -1 if there is none.
+static int find_variable(cscript_context* ctxt, cscript_alpha_conversion_visitor* v, cscript_string* var_name)
   {
   cscript_object key;
   key.type = cscript_object_type_string;
@@ -79,14 +84,16 @@ static int find_variable(cscript_string* alpha_name, cscript_context* ctxt, cscr
     {
     cscript_object* obj = cscript_map_get(ctxt, *map_rit, &key);
     if (obj != NULL)
-      {
-      *alpha_name = obj->value.s;
-      return 1;
-      }
+      return cast(int, obj->value.fx);
     }
-  return 0;
+  return -1;
   }
 
+static void rename_variable(cscript_context* ctxt, cscript_alpha_conversion_visitor* v, cscript_string* name, int symbol)
+  {
+  cscript_string_clear(name);
+  cscript_string_append(ctxt, name, cscript_vector_at(&v->names, symbol, cscript_string));
+  }
 
 static int previsit_scoped_statements(cscript_context* ctxt, cscript_visitor* v, cscript_scoped_statements* s)
   {
@@ -106,24 +113,18 @@ static void postvisit_scoped_statements(cscript_context* ctxt, cscript_visitor*
 static int previsit_assignment(cscript_context* ctxt, cscript_visitor* v, cscript_parsed_assignment* s)
   {
   cscript_alpha_conversion_visitor* vis = (cscript_alpha_conversion_visitor*)(v->impl);
-  cscript_string alpha_name;
-  if (find_variable(&alpha_name, ctxt, vis, &s->name))
-    {
-    cscript_string_clear(&s->name);
-    cscript_string_append(ctxt, &s->name, &alpha_name);
-    }
+  s->symbol = find_variable(ctxt, vis, &s->name);
+  if (s->symbol >= 0)
+    rename_variable(ctxt, vis, &s->name, s->symbol);
   return 1;
   }
 
 static int previsit_var(cscript_context* ctxt, cscript_visitor* v, cscript_parsed_variable* s)
   {
   cscript_alpha_conversion_visitor* vis = (cscript_alpha_conversion_visitor*)(v->impl);
-  cscript_string alpha_name;
-  if (find_variable(&alpha_name, ctxt, vis, &s->name))
-    {
-    cscript_string_clear(&s->name);
-    cscript_string_append(ctxt, &s->name, &alpha_name);
-    }
+  s->symbol = find_variable(ctxt, vis, &s->name);
+  if (s->symbol >= 0)
+    rename_variable(ctxt, vis, &s->name, s->symbol);
   return 1;
   }
 
@@ -132,8 +133,8 @@ static int previsit_fixnum(cscript_context* ctxt, cscript_visitor* v, cscript_pa
   cscript_alpha_conversion_visitor* vis = (cscript_alpha_conversion_visitor*)(v->impl);
   if (s->name.string_ptr[0] != '$')
     {
-    cscript_string alpha_name = cscript_make_alpha_name(ctxt, &s->name, vis->index++);
-    add_variable(ctxt, vis, &s->name, &alpha_name);
+    cscript_string alpha_name = cscript_make_alpha_name(ctxt, &s->name, vis->index);
+    s->symbol = add_variable(ctxt, vis, &s->name, &alpha_name);
     s->name = alpha_name;
     }
   return 1;
@@ -144,8 +145,8 @@ static int previsit_flonum(cscript_context* ctxt, cscript_visitor* v, cscript_pa
   cscript_alpha_conversion_visitor* vis = (cscript_alpha_conversion_visitor*)(v->impl);
   if (s->name.string_ptr[0] != '$')
     {
-    cscript_string alpha_name = cscript_make_alpha_name(ctxt, &s->name, vis->index++);
-    add_variable(ctxt, vis, &s->name, &alpha_name);
+    cscript_string alpha_name = cscript_make_alpha_name(ctxt, &s->name, vis->index);
+    s->symbol = add_variable(ctxt, vis, &s->name, &alpha_name);
     s->name = alpha_name;
     }
   return 1;
@@ -156,8 +157,8 @@ static void visit_parameter(cscript_context* ctxt, cscript_visitor* v, cscript_p
   cscript_alpha_conversion_visitor* vis = (cscript_alpha_conversion_visitor*)(v->impl);
   if (s->name.string_ptr[0] != '$')
     {
-    cscript_string alpha_name = cscript_make_alpha_name(ctxt, &s->name, vis->index++);
-    add_variable(ctxt, vis, &s->name, &alpha_name);
+    cscript_string alpha_name = cscript_make_alpha_name(ctxt, &s->name, vis->index);
+    s->symbol = add_variable(ctxt, vis, &s->name, &alpha_name);
     s->name = alpha_name;
     }
   }
@@ -181,6 +182,7 @@ static void cscript_alpha_conversion_visitor_free(cscript_context* ctxt, cscript
   if (v)
     {
     cscript_vector_destroy(ctxt, &v->variables);
+    cscript_vector_destroy(ctxt, &v->names);
     v->visitor->destroy(ctxt, v->visitor);
     cscript_delete(ctxt, v);
     }
@@ -192,8 +194,10 @@ void cscript_alpha_conversion(cscript_context* ctxt, cscript_program* program)
   cscript_alpha_conversion_visitor* v = cscript_alpha_conversion_visitor_new(ctxt);
   v->index = 0;
   cscript_vector_init(ctxt, &v->variables, cscript_map*);
+  cscript_vector_init(ctxt, &v->names, cscript_string);
   push_variables_child(ctxt, v);
   cscript_visit_program(ctxt, v->visitor, program);
   pop_variables_child(ctxt, v);
+  program->number_of_symbols = cast(int, v->index);
   cscript_alpha_conversion_visitor_free(ctxt, v);
   }
\ No newline at end of file
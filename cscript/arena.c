@@ -0,0 +1,124 @@
+#include "arena.h"
+#include "context.h"
+#include "memory.h"
+
+#include <string.h>
+
+#define ARENA_ALIGNMENT sizeof(cscript_alignment)
+
+static cscript_memsize align_size(cscript_memsize size)
+  {
+  return (size + ARENA_ALIGNMENT - 1) & ~(cast(cscript_memsize, ARENA_ALIGNMENT) - 1);
+  }
+
+static cscript_memsize chunk_size(cscript_memsize size)
+  {
+  return align_size(sizeof(cscript_arena_chunk)) + size;
+  }
+
+static cscript_arena_chunk* new_chunk(cscript_arena* arena, cscript_memsize minimum_size)
+  {
+  cscript_memsize size = arena->next_chunk_size;
+  if (size < minimum_size)
+    size = minimum_size;
+  cscript_arena_chunk* chunk = cast(cscript_arena_chunk*, cscript_heap_realloc(arena->ctxt, NULL, 0, chunk_size(size)));
+  if (chunk == NULL && arena->ctxt != NULL && arena->ctxt->memory_limit > 0)
+    {
+    // close to the memory limit of the context, the last chunk takes what is left if the block fits in it
+    const int64_t left = cast(int64_t, arena->ctxt->memory_limit) - arena->ctxt->memory.live_bytes - cast(int64_t, chunk_size(0));
+    if (left >= cast(int64_t, minimum_size) && left < cast(int64_t, size))
+      {
+      size = cast(cscript_memsize, left);
+      chunk = cast(cscript_arena_chunk*, cscript_heap_realloc(arena->ctxt, NULL, 0, chunk_size(size)));
+      if (chunk != NULL)
+        arena->ctxt->memory_limit_request = 0;
+      }
+    }
+  if (chunk == NULL)
+    return NULL;
+  chunk->previous = arena->current;
+  chunk->begin = cast(char*, chunk) + align_size(sizeof(cscript_arena_chunk));
+  chunk->end = chunk->begin + size;
+  chunk->top = chunk->begin;
+  chunk->last = NULL;
+  arena->current = chunk;
+  if (arena->next_chunk_size < CSCRIPT_ARENA_MAX_CHUNK_SIZE)
+    arena->next_chunk_size *= 2;
+  return chunk;
+  }
+
+void cscript_arena_init(cscript_arena* arena, cscript_context* ctxt)
+  {
+  arena->current = NULL;
+  arena->next_chunk_size = CSCRIPT_ARENA_CHUNK_SIZE;
+  arena->suspended = 0;
+  arena->ctxt = ctxt;
+  }
+
+void cscript_arena_destroy(cscript_arena* arena)
+  {
+  cscript_arena_chunk* chunk = arena->current;
+  while (chunk != NULL)
+    {
+    cscript_arena_chunk* previous = chunk->previous;
+    cscript_heap_realloc(arena->ctxt, chunk, chunk_size(cast(cscript_memsize, chunk->end - chunk->begin)), 0);
+    chunk = previous;
+    }
+  arena->current = NULL;
+  }
+
+int cscript_arena_owns(const cscript_arena* arena, const void* chunk)
+  {
+  const char* p = cast(const char*, chunk);
+  for (const cscript_arena_chunk* c = arena->current; c != NULL; c = c->previous)
+    {
+    if (p >= c->begin && p < c->end)
+      return 1;
+    }
+  return 0;
+  }
+
+void* cscript_arena_realloc(cscript_arena* arena, void* chunk, cscript_memsize old_size, cscript_memsize new_size)
+  {
+  cscript_arena_chunk* current = arena->current;
+  const int is_last = current != NULL && chunk != NULL && cast(char*, chunk) == current->last;
+  if (new_size == 0)
+    {
+    if (is_last)
+      {
+      current->top = current->last;
+      current->last = NULL;
+      }
+    return NULL;
+    }
+  const cscript_memsize size = align_size(new_size);
+  if (is_last && cast(cscript_memsize, current->end - current->last) >= size)
+    {
+    current->top = current->last + size;
+    return chunk;
+    }
+  if (current == NULL || cast(cscript_memsize, current->end - current->top) < size)
+    {
+    current = new_chunk(arena, size);
+    if (current == NULL)
+      return NULL;
+    }
+  char* block = current->top;
+  current->top += size;
+  current->last = block;
+  if (chunk != NULL)
+    memcpy(block, chunk, old_size < new_size ? old_size : new_size);
+  return block;
+  }
+
+void cscript_arena_suspend(cscript_context* ctxt)
+  {
+  if (ctxt->arena != NULL)
+    ++ctxt->arena->suspended;
+  }
+
+void cscript_arena_resume(cscript_context* ctxt)
+  {
+  if (ctxt->arena != NULL)
+    --ctxt->arena->suspended;
+  }
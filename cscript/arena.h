@@ -0,0 +1,51 @@
+#ifndef CSCRIPT_ARENA_H
+#define CSCRIPT_ARENA_H
+
+#include "cscript.h"
+#include "limits.h"
+
+/*
+Bump allocator for the short-lived structures of one compilation: tokens, the syntax tree, and the
+maps and strings of the preprocessing passes.
+While an arena is attached to a context, cscript_realloc serves new blocks from the arena, and
+frees of arena blocks are no-ops. All blocks are released at once by cscript_arena_destroy.
+*/
+
+#ifndef CSCRIPT_ARENA_CHUNK_SIZE
+#define CSCRIPT_ARENA_CHUNK_SIZE (64 * 1024)
+#endif
+
+#ifndef CSCRIPT_ARENA_MAX_CHUNK_SIZE
+#define CSCRIPT_ARENA_MAX_CHUNK_SIZE (4 * 1024 * 1024)
+#endif
+
+typedef struct cscript_arena_chunk
+  {
+  struct cscript_arena_chunk* previous;
+  char* begin;
+  char* end;
+  char* top; // first free byte
+  char* last; // most recent allocation, which can be grown or freed in place
+  } cscript_arena_chunk;
+
+typedef struct cscript_arena
+  {
+  cscript_arena_chunk* current;
+  cscript_memsize next_chunk_size;
+  int suspended; // while > 0, new blocks are allocated on the heap, e.g. for error reports that outlive the compilation
+  cscript_context* ctxt; // the chunks are allocated with the allocator of ctxt, or with the default allocator if NULL
+  } cscript_arena;
+
+void cscript_arena_init(cscript_arena* arena, cscript_context* ctxt);
+void cscript_arena_destroy(cscript_arena* arena);
+
+// same contract as cscript_realloc. Returns NULL if out of memory.
+void* cscript_arena_realloc(cscript_arena* arena, void* chunk, cscript_memsize old_size, cscript_memsize new_size);
+
+int cscript_arena_owns(const cscript_arena* arena, const void* chunk);
+
+// allocations of ctxt go to the heap until the matching cscript_arena_resume
+void cscript_arena_suspend(cscript_context* ctxt);
+void cscript_arena_resume(cscript_context* ctxt);
+
+#endif //CSCRIPT_ARENA_H
@@ -0,0 +1,674 @@
+#include "bundle.h"
+#include "context.h"
+#include "environment.h"
+#include "error.h"
+#include "foreign.h"
+#include "func.h"
+#include "map.h"
+#include "parser.h"
+#include "primitives.h"
+#include "syscalls.h"
+#include "vm.h"
+
+#include <string.h>
+
+static const char bundle_magic[4] = { 'C', 'S', 'C', 'B' };
+static const uint32_t bundle_byte_order_mark = 0x01020304;
+
+struct cscript_bundle
+  {
+  cscript_mapped_file file;
+  int number_of_functions;
+  uint32_t* offsets; // of the function records
+  const char** names; // point into the mapped file
+  };
+
+/*
+Writing
+*/
+
+typedef struct bundle_writer
+  {
+  cscript_context* ctxt;
+  char* data;
+  cscript_memsize size;
+  cscript_memsize capacity;
+  } bundle_writer;
+
+static void write_bytes(bundle_writer* w, const void* bytes, cscript_memsize number_of_bytes)
+  {
+  if (number_of_bytes == 0)
+    return;
+  if (w->size + number_of_bytes > w->capacity)
+    {
+    cscript_memsize new_capacity = w->capacity * 2;
+    if (new_capacity < w->size + number_of_bytes)
+      new_capacity = w->size + number_of_bytes;
+    cscript_reallocvector(w->ctxt, w->data, w->capacity, new_capacity, char);
+    w->capacity = new_capacity;
+    }
+  memcpy(w->data + w->size, bytes, number_of_bytes);
+  w->size += number_of_bytes;
+  }
+
+static void write_u32(bundle_writer* w, uint32_t value)
+  {
+  write_bytes(w, &value, sizeof(uint32_t));
+  }
+
+static void patch_u32(bundle_writer* w, cscript_memsize offset, uint32_t value)
+  {
+  memcpy(w->data + offset, &value, sizeof(uint32_t));
+  }
+
+static void write_name(bundle_writer* w, uint32_t type, const char* name, cscript_memsize length)
+  {
+  write_u32(w, type);
+  write_u32(w, cast(uint32_t, length));
+  write_bytes(w, name, length);
+  }
+
+// positions in the compiling context of the externals and globals that a function refers to, in order of first use
+typedef struct symbol_tables
+  {
+  cscript_vector externals; // vector of type int
+  cscript_vector globals; // vector of type int
+  } symbol_tables;
+
+static int symbol_index(cscript_context* ctxt, cscript_vector* table, int position)
+  {
+  for (cscript_memsize i = 0; i < table->vector_size; ++i)
+    {
+    if (*cscript_vector_at(table, i, int) == position)
+      return cast(int, i);
+    }
+  cscript_vector_push_back(ctxt, table, position, int);
+  return cast(int, table->vector_size - 1);
+  }
+
+static void collect_symbols(cscript_context* ctxt, const cscript_function* fun, symbol_tables* tables)
+  {
+  const cscript_instruction* it = cscript_vector_begin(&fun->code, cscript_instruction);
+  const cscript_instruction* it_end = cscript_vector_end(&fun->code, cscript_instruction);
+  for (; it != it_end; ++it)
+    {
+    const cscript_opcode op = CSCRIPT_GET_OPCODE(*it);
+    if (op == CSCRIPT_OPCODE_CALLFOREIGN)
+      symbol_index(ctxt, &tables->externals, CSCRIPT_GETARG_B(*it));
+    else if (op == CSCRIPT_OPCODE_LOADGLOBAL || op == CSCRIPT_OPCODE_STOREGLOBAL)
+      symbol_index(ctxt, &tables->globals, CSCRIPT_GETARG_Bx(*it));
+    }
+  const cscript_parallel_loop* loop = cscript_vector_begin(&fun->parallel_loops, cscript_parallel_loop);
+  const cscript_parallel_loop* loop_end = cscript_vector_end(&fun->parallel_loops, cscript_parallel_loop);
+  for (; loop != loop_end; ++loop)
+    collect_symbols(ctxt, loop->body, tables);
+  }
+
+static void write_body(bundle_writer* w, const cscript_function* fun, symbol_tables* tables)
+  {
+  write_u32(w, cast(uint32_t, fun->result_position));
+  write_u32(w, cast(uint32_t, fun->frame_size));
+  write_u32(w, cast(uint32_t, fun->code.vector_size));
+  write_u32(w, cast(uint32_t, fun->constants.vector_size));
+  write_u32(w, cast(uint32_t, fun->parallel_loops.vector_size));
+  const cscript_instruction* it = cscript_vector_begin(&fun->code, cscript_instruction);
+  const cscript_instruction* it_end = cscript_vector_end(&fun->code, cscript_instruction);
+  for (; it != it_end; ++it)
+    {
+    cscript_instruction i = *it;
+    const cscript_opcode op = CSCRIPT_GET_OPCODE(i);
+    if (op == CSCRIPT_OPCODE_CALLFOREIGN)
+      CSCRIPT_SETARG_B(i, symbol_index(w->ctxt, &tables->externals, CSCRIPT_GETARG_B(i)));
+    else if (op == CSCRIPT_OPCODE_LOADGLOBAL || op == CSCRIPT_OPCODE_STOREGLOBAL)
+      CSCRIPT_SETARG_Bx(i, symbol_index(w->ctxt, &tables->globals, CSCRIPT_GETARG_Bx(i)));
+    write_bytes(w, &i, sizeof(cscript_instruction));
+    }
+  write_bytes(w, fun->constants.vector_ptr, fun->constants.vector_size * sizeof(cscript_fixnum));
+  const cscript_parallel_loop* loop = cscript_vector_begin(&fun->parallel_loops, cscript_parallel_loop);
+  const cscript_parallel_loop* loop_end = cscript_vector_end(&fun->parallel_loops, cscript_parallel_loop);
+  for (; loop != loop_end; ++loop)
+    {
+    write_u32(w, cast(uint32_t, loop->reductions.vector_size));
+    const cscript_parallel_reduction* r = cscript_vector_begin(&loop->reductions, cscript_parallel_reduction);
+    const cscript_parallel_reduction* r_end = cscript_vector_end(&loop->reductions, cscript_parallel_reduction);
+    for (; r != r_end; ++r)
+      {
+      write_u32(w, cast(uint32_t, r->position));
+      write_u32(w, cast(uint32_t, r->op));
+      write_u32(w, cast(uint32_t, r->is_flonum));
+      }
+    write_body(w, loop->body, tables);
+    }
+  }
+
+static int write_function(cscript_context* ctxt, bundle_writer* w, const cscript_function* fun)
+  {
+  symbol_tables tables;
+  cscript_vector_init(ctxt, &tables.externals, int);
+  cscript_vector_init(ctxt, &tables.globals, int);
+  collect_symbols(ctxt, fun, &tables);
+  int success = 1;
+  write_u32(w, cast(uint32_t, tables.externals.vector_size));
+  for (cscript_memsize i = 0; i < tables.externals.vector_size; ++i)
+    {
+    const cscript_external_function* ext = cscript_vector_at(&ctxt->externals, *cscript_vector_at(&tables.externals, i, int), cscript_external_function);
+    write_name(w, cast(uint32_t, ext->return_type), ext->name.string_ptr, ext->name.string_length);
+    }
+  write_u32(w, cast(uint32_t, tables.globals.vector_size));
+  for (cscript_memsize i = 0; i < tables.globals.vector_size; ++i)
+    {
+    cscript_object* key = cscript_environment_find_key_given_position(ctxt, *cscript_vector_at(&tables.globals, i, int));
+    cscript_environment_entry entry;
+    if (key == NULL || !cscript_environment_find_recursive(&entry, ctxt, &key->value.s))
+      {
+      cscript_runtime_error_cstr(ctxt, CSCRIPT_ERROR_VARIABLE_UNKNOWN, -1, -1, "the function refers to a global variable that ctxt does not know");
+      success = 0;
+      break;
+      }
+    write_name(w, cast(uint32_t, entry.register_type), key->value.s.string_ptr, key->value.s.string_length);
+    }
+  if (success)
+    write_body(w, fun, &tables);
+  cscript_vector_destroy(ctxt, &tables.externals);
+  cscript_vector_destroy(ctxt, &tables.globals);
+  return success;
+  }
+
+int cscript_bundle_save(cscript_context* ctxt, cscript_function** functions, const char** names, int number_of_functions, const char* filename)
+  {
+  bundle_writer w;
+  w.ctxt = ctxt;
+  w.size = 0;
+  w.capacity = 1024;
+  w.data = cscript_newvector(ctxt, w.capacity, char);
+  write_bytes(&w, bundle_magic, 4);
+  write_u32(&w, CSCRIPT_BUNDLE_VERSION);
+  write_u32(&w, bundle_byte_order_mark);
+  write_u32(&w, sizeof(cscript_fixnum));
+  write_u32(&w, sizeof(cscript_instruction));
+  write_u32(&w, cast(uint32_t, number_of_functions));
+  cscript_memsize* offset_positions = cscript_newvector(ctxt, number_of_functions > 0 ? number_of_functions : 1, cscript_memsize);
+  for (int i = 0; i < number_of_functions; ++i)
+    {
+    offset_positions[i] = w.size;
+    write_u32(&w, 0);
+    const cscript_memsize length = cast(cscript_memsize, strlen(names[i]));
+    write_u32(&w, cast(uint32_t, length));
+    write_bytes(&w, names[i], length + 1);
+    }
+  int success = 1;
+  for (int i = 0; success && i < number_of_functions; ++i)
+    {
+    patch_u32(&w, offset_positions[i], cast(uint32_t, w.size));
+    success = write_function(ctxt, &w, functions[i]);
+    }
+  cscript_freevector(ctxt, offset_positions, number_of_functions > 0 ? number_of_functions : 1, cscript_memsize);
+  if (success)
+    {
+    int fd = cscript_open_binary_output_file(filename);
+    cscript_memsize written = 0;
+    while (fd >= 0 && written < w.size)
+      {
+      const int n = cscript_write(fd, w.data + written, w.size - written);
+      if (n <= 0)
+        break;
+      written += cast(cscript_memsize, n);
+      }
+    if (fd >= 0)
+      cscript_close_file(fd);
+    success = (fd >= 0 && written == w.size) ? 1 : 0;
+    }
+  cscript_freevector(ctxt, w.data, w.capacity, char);
+  return success;
+  }
+
+int cscript_function_save(cscript_context* ctxt, cscript_function* fun, const char* filename)
+  {
+  const char* name = "";
+  return cscript_bundle_save(ctxt, &fun, &name, 1, filename);
+  }
+
+/*
+Reading
+*/
+
+typedef struct bundle_reader
+  {
+  const char* data;
+  cscript_memsize size;
+  cscript_memsize position;
+  int failed; // set when reading past the end of the file
+  } bundle_reader;
+
+static const char* read_bytes(bundle_reader* r, cscript_memsize number_of_bytes)
+  {
+  if (r->failed || number_of_bytes > r->size - r->position)
+    {
+    r->failed = 1;
+    return NULL;
+    }
+  const char* bytes = r->data + r->position;
+  r->position += number_of_bytes;
+  return bytes;
+  }
+
+// checks that count elements of element_size bytes fit in the rest of the file, before their size is computed
+static int read_fits(bundle_reader* r, uint32_t count, cscript_memsize element_size)
+  {
+  if (r->failed || count > (r->size - r->position) / element_size)
+    {
+    r->failed = 1;
+    return 0;
+    }
+  return 1;
+  }
+
+static uint32_t read_u32(bundle_reader* r)
+  {
+  uint32_t value = 0;
+  const char* bytes = read_bytes(r, sizeof(uint32_t));
+  if (bytes)
+    memcpy(&value, bytes, sizeof(uint32_t));
+  return value;
+  }
+
+static void load_error(cscript_context* ctxt, int errorcode, const char* msg, const char* name, cscript_memsize name_length)
+  {
+  cscript_string s;
+  cscript_string_init(ctxt, &s, msg);
+  if (name != NULL)
+    {
+    cscript_string_push_back(ctxt, &s, ' ');
+    cscript_string tmp;
+    cscript_string_init_ranged(ctxt, &tmp, name, name + name_length);
+    cscript_string_append(ctxt, &s, &tmp);
+    cscript_string_destroy(ctxt, &tmp);
+    }
+  cscript_runtime_error(ctxt, errorcode, -1, -1, &s); // takes ownership of s
+  }
+
+// positions in the loading context of the externals and globals of a record
+typedef struct resolved_symbols
+  {
+  int* externals;
+  uint32_t number_of_externals;
+  int* globals;
+  uint32_t number_of_globals;
+  } resolved_symbols;
+
+static int resolve_externals(cscript_context* ctxt, bundle_reader* r, resolved_symbols* symbols)
+  {
+  for (uint32_t i = 0; i < symbols->number_of_externals; ++i)
+    {
+    const uint32_t return_type = read_u32(r);
+    const uint32_t length = read_u32(r);
+    const char* name = read_bytes(r, length);
+    if (r->failed)
+      return 0;
+    int position = -1;
+    cscript_external_function* it = cscript_vector_begin(&ctxt->externals, cscript_external_function);
+    cscript_external_function* it_end = cscript_vector_end(&ctxt->externals, cscript_external_function);
+    for (; it != it_end; ++it)
+      {
+      if (it->name.string_length == length && memcmp(it->name.string_ptr, name, length) == 0)
+        {
+        position = cast(int, it - cscript_vector_begin(&ctxt->externals, cscript_external_function));
+        break;
+        }
+      }
+    if (position < 0 || position > CSCRIPT_MAXARG_B)
+      {
+      load_error(ctxt, CSCRIPT_ERROR_EXTERNAL_UNKNOWN, "external function unknown:", name, length);
+      return 0;
+      }
+    if (cast(uint32_t, it->return_type) != return_type)
+      {
+      load_error(ctxt, CSCRIPT_ERROR_EXTERNAL_UNKNOWN, "external function has another return type:", name, length);
+      return 0;
+      }
+    symbols->externals[i] = position;
+    }
+  return 1;
+  }
+
+static int resolve_globals(cscript_context* ctxt, bundle_reader* r, resolved_symbols* symbols)
+  {
+  for (uint32_t i = 0; i < symbols->number_of_globals; ++i)
+    {
+    const uint32_t register_type = read_u32(r);
+    const uint32_t length = read_u32(r);
+    const char* name = read_bytes(r, length);
+    if (r->failed)
+      return 0;
+    cscript_string s;
+    cscript_string_init_ranged(ctxt, &s, name, name + length);
+    cscript_environment_entry entry;
+    if (cscript_environment_find_recursive(&entry, ctxt, &s))
+      {
+      cscript_string_destroy(ctxt, &s);
+      if (entry.type != CSCRIPT_ENV_TYPE_GLOBAL || cast(uint32_t, entry.register_type) != register_type)
+        {
+        load_error(ctxt, CSCRIPT_ERROR_VARIABLE_UNKNOWN, "global variable has another type:", name, length);
+        return 0;
+        }
+      }
+    else
+      {
+      entry.type = CSCRIPT_ENV_TYPE_GLOBAL;
+      entry.position = ctxt->globals.vector_size;
+      entry.register_type = cast(int, register_type);
+      cscript_environment_add_to_base(ctxt, &s, entry);
+      cscript_vector_push_back(ctxt, &ctxt->globals, 0, cscript_fixnum);
+      }
+    if (entry.position > CSCRIPT_MAXARG_Bx)
+      {
+      load_error(ctxt, CSCRIPT_ERROR_VARIABLE_UNKNOWN, "too many global variables to load", NULL, 0);
+      return 0;
+      }
+    symbols->globals[i] = cast(int, entry.position);
+    }
+  return 1;
+  }
+
+static int valid_register(const cscript_function* fun, int reg)
+  {
+  return reg >= 0 && cast(cscript_memsize, reg) < fun->frame_size;
+  }
+
+/*
+Checks that the registers, constants, jump targets and parallel loops that the code of fun refers to are in
+range, so that running a function from a corrupt bundle cannot read or write outside of its frame and vectors.
+The elements that arrays index at run time (MOVE_TO_ARR and MOVE_FROM_ARR) and memory addresses cannot be checked.
+*/
+static int valid_code(const cscript_function* fun, uint32_t number_of_loops)
+  {
+  const cscript_instruction* it_begin = cscript_vector_begin(&fun->code, cscript_instruction);
+  const cscript_instruction* it_end = cscript_vector_end(&fun->code, cscript_instruction);
+  for (const cscript_instruction* it = it_begin; it != it_end; ++it)
+    {
+    const cscript_instruction instruc = *it;
+    const int a = CSCRIPT_GETARG_A(instruc);
+    const int b = CSCRIPT_GETARG_B(instruc);
+    const int c = CSCRIPT_GETARG_C(instruc);
+    int valid = valid_register(fun, a);
+    switch (CSCRIPT_GET_OPCODE(instruc))
+      {
+      case CSCRIPT_OPCODE_MOVE:
+      case CSCRIPT_OPCODE_STORE_MEMORY:
+      case CSCRIPT_OPCODE_LOAD_MEMORY:
+      case CSCRIPT_OPCODE_ADDRESS:
+        valid = valid && valid_register(fun, b);
+        break;
+      case CSCRIPT_OPCODE_MOVE_TO_ARR:
+      case CSCRIPT_OPCODE_MOVE_FROM_ARR:
+        valid = valid && valid_register(fun, b) && valid_register(fun, c);
+        break;
+      case CSCRIPT_OPCODE_LOADK:
+        valid = valid && cast(cscript_memsize, CSCRIPT_GETARG_Bx(instruc)) < fun->constants.vector_size;
+        break;
+      case CSCRIPT_OPCODE_CALLPRIM:
+        valid = valid && valid_register(fun, a + 1) && b <= CSCRIPT_PARALLEL_FOR && (b != CSCRIPT_PARALLEL_FOR || cast(uint32_t, c) < number_of_loops);
+        break;
+      case CSCRIPT_OPCODE_CALLFOREIGN:
+        valid = valid && (c == 0 || valid_register(fun, a + c - 1));
+        break;
+      case CSCRIPT_OPCODE_NEQ:
+        valid = valid && it + 1 != it_end && CSCRIPT_GET_OPCODE(*(it + 1)) == CSCRIPT_OPCODE_JMP;
+        break;
+      case CSCRIPT_OPCODE_JMP:
+      {
+      const cscript_memsize target = cast(cscript_memsize, it + 1 - it_begin) + CSCRIPT_GETARG_sBx(instruc);
+      valid = target <= fun->code.vector_size;
+      break;
+      }
+      case CSCRIPT_OPCODE_RETURN:
+        valid = a == 0 || (valid && (b == 0 || valid_register(fun, a + b - 1)));
+        break;
+      case CSCRIPT_OPCODE_SETFIXNUM:
+      case CSCRIPT_OPCODE_LOADGLOBAL:
+      case CSCRIPT_OPCODE_STOREGLOBAL:
+      case CSCRIPT_OPCODE_CAST:
+        break;
+      default:
+        valid = 0;
+        break;
+      }
+    if (!valid)
+      return 0;
+    }
+  return 1;
+  }
+
+static cscript_function* read_body(cscript_context* ctxt, bundle_reader* r, const resolved_symbols* symbols)
+  {
+  const uint32_t result_position = read_u32(r);
+  const uint32_t frame_size = read_u32(r);
+  const uint32_t number_of_instructions = read_u32(r);
+  const uint32_t number_of_constants = read_u32(r);
+  const uint32_t number_of_loops = read_u32(r);
+  if (!read_fits(r, number_of_instructions, sizeof(cscript_instruction)))
+    return NULL;
+  const char* code = read_bytes(r, number_of_instructions * sizeof(cscript_instruction));
+  if (!read_fits(r, number_of_constants, sizeof(cscript_fixnum)))
+    return NULL;
+  const char* constants = read_bytes(r, number_of_constants * sizeof(cscript_fixnum));
+  if (r->failed || result_position >= frame_size || frame_size > ctxt->stack.vector_size)
+    return NULL;
+  cscript_function* fun = cscript_function_new(ctxt);
+  fun->result_position = result_position;
+  fun->frame_size = frame_size;
+  fun->number_of_constants = cast(int, number_of_constants);
+  cscript_reallocvector(ctxt, fun->code.vector_ptr, fun->code.vector_capacity, number_of_instructions, cscript_instruction);
+  fun->code.vector_capacity = number_of_instructions;
+  fun->code.vector_size = number_of_instructions;
+  if (number_of_instructions > 0)
+    memcpy(fun->code.vector_ptr, code, number_of_instructions * sizeof(cscript_instruction));
+  cscript_reallocvector(ctxt, fun->constants.vector_ptr, fun->constants.vector_capacity, number_of_constants, cscript_fixnum);
+  fun->constants.vector_capacity = number_of_constants;
+  fun->constants.vector_size = number_of_constants;
+  if (number_of_constants > 0)
+    memcpy(fun->constants.vector_ptr, constants, number_of_constants * sizeof(cscript_fixnum));
+  int valid = valid_code(fun, number_of_loops);
+  cscript_instruction* it = cscript_vector_begin(&fun->code, cscript_instruction);
+  cscript_instruction* it_end = cscript_vector_end(&fun->code, cscript_instruction);
+  for (; it != it_end; ++it)
+    {
+    const cscript_opcode op = CSCRIPT_GET_OPCODE(*it);
+    if (op == CSCRIPT_OPCODE_CALLFOREIGN)
+      {
+      const uint32_t index = cast(uint32_t, CSCRIPT_GETARG_B(*it));
+      if (index >= symbols->number_of_externals)
+        valid = 0;
+      else
+        CSCRIPT_SETARG_B(*it, symbols->externals[index]);
+      }
+    else if (op == CSCRIPT_OPCODE_LOADGLOBAL || op == CSCRIPT_OPCODE_STOREGLOBAL)
+      {
+      const uint32_t index = cast(uint32_t, CSCRIPT_GETARG_Bx(*it));
+      if (index >= symbols->number_of_globals)
+        valid = 0;
+      else
+        CSCRIPT_SETARG_Bx(*it, symbols->globals[index]);
+      }
+    }
+  for (uint32_t l = 0; valid && l < number_of_loops; ++l)
+    {
+    cscript_parallel_loop loop;
+    cscript_vector_init(ctxt, &loop.reductions, cscript_parallel_reduction);
+    const uint32_t number_of_reductions = read_u32(r);
+    for (uint32_t i = 0; i < number_of_reductions && !r->failed; ++i)
+      {
+      cscript_parallel_reduction red;
+      red.position = cast(int, read_u32(r));
+      red.op = cast(int, read_u32(r));
+      red.is_flonum = cast(int, read_u32(r));
+      if (!valid_register(fun, red.position) || red.op < cscript_reduction_sum || red.op > cscript_reduction_max)
+        r->failed = 1;
+      cscript_vector_push_back(ctxt, &loop.reductions, red, cscript_parallel_reduction);
+      }
+    loop.body = r->failed ? NULL : read_body(ctxt, r, symbols);
+    // the reduction variables are also registers of the frame of the body
+    const cscript_parallel_reduction* red = cscript_vector_begin(&loop.reductions, cscript_parallel_reduction);
+    const cscript_parallel_reduction* red_end = cscript_vector_end(&loop.reductions, cscript_parallel_reduction);
+    for (; loop.body != NULL && red != red_end; ++red)
+      {
+      if (!valid_register(loop.body, red->position))
+        {
+        cscript_function_free(ctxt, loop.body);
+        loop.body = NULL;
+        }
+      }
+    if (loop.body == NULL)
+      {
+      cscript_vector_destroy(ctxt, &loop.reductions);
+      valid = 0;
+      break;
+      }
+    cscript_vector_push_back(ctxt, &fun->parallel_loops, loop, cscript_parallel_loop);
+    }
+  if (!valid)
+    {
+    cscript_function_free(ctxt, fun);
+    return NULL;
+    }
+  return fun;
+  }
+
+static cscript_function* read_function(cscript_context* ctxt, const char* data, cscript_memsize size, uint32_t offset)
+  {
+  bundle_reader r;
+  r.data = data;
+  r.size = size;
+  r.position = offset;
+  r.failed = offset > size ? 1 : 0;
+  resolved_symbols symbols;
+  symbols.number_of_externals = read_u32(&r);
+  if (r.failed || symbols.number_of_externals > size)
+    {
+    load_error(ctxt, CSCRIPT_ERROR_INVALID_ARGUMENT, "corrupt bundle", NULL, 0);
+    return NULL;
+    }
+  symbols.externals = cscript_newvector(ctxt, symbols.number_of_externals + 1, int);
+  symbols.number_of_globals = 0;
+  symbols.globals = NULL;
+  cscript_function* fun = NULL;
+  if (resolve_externals(ctxt, &r, &symbols))
+    {
+    symbols.number_of_globals = read_u32(&r);
+    if (!r.failed && symbols.number_of_globals <= size)
+      {
+      symbols.globals = cscript_newvector(ctxt, symbols.number_of_globals + 1, int);
+      if (resolve_globals(ctxt, &r, &symbols))
+        fun = read_body(ctxt, &r, &symbols);
+      }
+    }
+  if (fun == NULL && cscript_context_is_error_free(ctxt))
+    load_error(ctxt, CSCRIPT_ERROR_INVALID_ARGUMENT, "corrupt bundle", NULL, 0);
+  cscript_freevector(ctxt, symbols.externals, symbols.number_of_externals + 1, int);
+  if (symbols.globals != NULL)
+    cscript_freevector(ctxt, symbols.globals, symbols.number_of_globals + 1, int);
+  return fun;
+  }
+
+cscript_bundle* cscript_bundle_open(cscript_context* ctxt, const char* filename)
+  {
+  cscript_bundle* b = cscript_new(ctxt, cscript_bundle);
+  b->number_of_functions = 0;
+  b->offsets = NULL;
+  b->names = NULL;
+  if (!cscript_map_file(&b->file, filename, cscript_map_read_only, cscript_access_random))
+    {
+    cscript_delete(ctxt, b);
+    load_error(ctxt, CSCRIPT_ERROR_INVALID_ARGUMENT, "cannot open bundle", filename, cast(cscript_memsize, strlen(filename)));
+    return NULL;
+    }
+  bundle_reader r;
+  r.data = cast(const char*, b->file.data);
+  r.size = b->file.size;
+  r.position = 0;
+  r.failed = 0;
+  const char* magic = read_bytes(&r, 4);
+  const uint32_t version = read_u32(&r);
+  const uint32_t byte_order_mark = read_u32(&r);
+  const uint32_t fixnum_size = read_u32(&r);
+  const uint32_t instruction_size = read_u32(&r);
+  const uint32_t number_of_functions = read_u32(&r);
+  if (r.failed || memcmp(magic, bundle_magic, 4) != 0 || version != CSCRIPT_BUNDLE_VERSION || byte_order_mark != bundle_byte_order_mark
+    || fixnum_size != sizeof(cscript_fixnum) || instruction_size != sizeof(cscript_instruction) || number_of_functions > r.size)
+    {
+    cscript_unmap_file(&b->file);
+    cscript_delete(ctxt, b);
+    load_error(ctxt, CSCRIPT_ERROR_INVALID_ARGUMENT, "incompatible bundle", filename, cast(cscript_memsize, strlen(filename)));
+    return NULL;
+    }
+  b->number_of_functions = cast(int, number_of_functions);
+  b->offsets = cscript_newvector(ctxt, number_of_functions + 1, uint32_t);
+  b->names = cscript_newvector(ctxt, number_of_functions + 1, const char*);
+  for (uint32_t i = 0; i < number_of_functions; ++i)
+    {
+    b->offsets[i] = read_u32(&r);
+    const uint32_t length = read_u32(&r);
+    b->names[i] = read_bytes(&r, length + 1);
+    if (!r.failed && b->names[i][length] != 0)
+      r.failed = 1;
+    }
+  if (r.failed)
+    {
+    cscript_bundle_close(ctxt, b);
+    load_error(ctxt, CSCRIPT_ERROR_INVALID_ARGUMENT, "corrupt bundle", filename, cast(cscript_memsize, strlen(filename)));
+    return NULL;
+    }
+  return b;
+  }
+
+void cscript_bundle_close(cscript_context* ctxt, cscript_bundle* b)
+  {
+  if (b->offsets != NULL)
+    cscript_freevector(ctxt, b->offsets, b->number_of_functions + 1, uint32_t);
+  if (b->names != NULL)
+    cscript_freevector(ctxt, b->names, b->number_of_functions + 1, const char*);
+  cscript_unmap_file(&b->file);
+  cscript_delete(ctxt, b);
+  }
+
+int cscript_bundle_size(const cscript_bundle* b)
+  {
+  return b->number_of_functions;
+  }
+
+const char* cscript_bundle_name(const cscript_bundle* b, int index)
+  {
+  return b->names[index];
+  }
+
+int cscript_bundle_find(const cscript_bundle* b, const char* name)
+  {
+  for (int i = 0; i < b->number_of_functions; ++i)
+    {
+    if (strcmp(b->names[i], name) == 0)
+      return i;
+    }
+  return -1;
+  }
+
+cscript_function* cscript_bundle_load(cscript_context* ctxt, const cscript_bundle* b, int index)
+  {
+  cscript_runtime_errors_clear(ctxt);
+  if (index < 0 || index >= b->number_of_functions)
+    {
+    load_error(ctxt, CSCRIPT_ERROR_INVALID_ARGUMENT, "invalid bundle index", NULL, 0);
+    return NULL;
+    }
+  return read_function(ctxt, cast(const char*, b->file.data), b->file.size, b->offsets[index]);
+  }
+
+cscript_function* cscript_function_load(cscript_context* ctxt, const char* filename)
+  {
+  cscript_runtime_errors_clear(ctxt);
+  cscript_bundle* b = cscript_bundle_open(ctxt, filename);
+  if (b == NULL)
+    return NULL;
+  cscript_function* fun = cscript_bundle_load(ctxt, b, 0);
+  cscript_bundle_close(ctxt, b);
+  return fun;
+  }
@@ -0,0 +1,30 @@
+#ifndef CSCRIPT_BUNDLE_H
+#define CSCRIPT_BUNDLE_H
+
+#include "cscript.h"
+
+/*
+Binary format of saved functions. A file written by cscript_function_save is a bundle with a single function.
+All numbers are stored in the byte order of the machine that wrote the file; files written by machines with
+another byte order, or with other sizes of cscript_fixnum or cscript_instruction, are rejected on load.
+
+  header:   "CSCB", u32 version, u32 byte order mark 0x01020304, u32 sizeof(cscript_fixnum),
+            u32 sizeof(cscript_instruction), u32 number of functions
+  index:    per function: u32 offset of the function record, u32 name length, name bytes and a terminating 0
+  records:  u32 number of externals, per external: u32 return type, u32 name length, name bytes
+            u32 number of globals, per global: u32 register type, u32 name length, name bytes
+            body
+
+  body:     u32 result_position, u32 frame_size, u32 number of instructions, u32 number of constants,
+            u32 number of parallel loops, instructions, constants,
+            per parallel loop: u32 number of reductions, per reduction: u32 position, u32 op, u32 is_flonum, body
+
+The externals and globals of a record are the ones its code refers to. In the saved code, the B argument of
+CALLFOREIGN and the Bx argument of LOADGLOBAL and STOREGLOBAL index these tables instead of the context, and they
+are resolved by name in the loading context: external functions should be registered with the same return
+type, and global variables that do not exist yet are declared, as compiling the script would have done.
+*/
+
+#define CSCRIPT_BUNDLE_VERSION 1
+
+#endif //CSCRIPT_BUNDLE_H
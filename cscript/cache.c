@@ -0,0 +1,441 @@
+#include "cache.h"
+#include "context.h"
+#include "environment.h"
+#include "error.h"
+#include "foreign.h"
+#include "func.h"
+#include "syscalls.h"
+#include "thread.h"
+#include "vector.h"
+
+#include <string.h>
+
+typedef struct cache_global
+  {
+  cscript_string name;
+  int register_type;
+  } cache_global;
+
+typedef struct cache_entry
+  {
+  uint64_t hash;
+  cscript_string script;
+  cscript_string signature;
+  cscript_function* fun;
+  cscript_vector globals; // vector of type cache_global, the global variables declared by the script
+  cscript_memsize size;
+  int references;
+  int evicted; // evicted entries are only kept until their last reference is released
+  struct cache_entry* previous; // more recently used entry
+  struct cache_entry* next; // less recently used entry
+  struct cache_entry* next_in_bucket;
+  struct cache_entry* next_in_function_bucket;
+  } cache_entry;
+
+struct cscript_compile_cache
+  {
+  cscript_context* ctxt; // used for the allocations of the cache, never for compiling
+  cscript_memsize max_size;
+  cscript_memsize number_of_buckets;
+  cache_entry** buckets; // indexed by hash
+  cache_entry** function_buckets; // indexed by function address, also holds evicted entries that are still referenced
+  cscript_memsize number_of_entries; // entries in function_buckets
+  cache_entry* most_recent;
+  cache_entry* least_recent;
+  cscript_compile_cache_stats stats;
+  cscript_mutex mutex; // protects everything above
+  };
+
+static uint64_t hash_bytes(uint64_t h, const char* s, cscript_memsize length)
+  {
+  for (cscript_memsize i = 0; i < length; ++i)
+    {
+    h ^= (uint64_t)(unsigned char)s[i];
+    h *= 0x100000001b3ULL;
+    }
+  return h;
+  }
+
+static cscript_memsize function_bucket(const cscript_compile_cache* cache, const cscript_function* fun)
+  {
+  uint64_t h = (uint64_t)(uintptr_t)fun;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return cast(cscript_memsize, h & (cache->number_of_buckets - 1));
+  }
+
+static void append_name(cscript_context* ctxt, cscript_string* s, char tag, cscript_string* name, int type)
+  {
+  char buffer[32];
+  cscript_string_push_back(ctxt, s, tag);
+  cscript_memsize_to_char(buffer, name->string_length);
+  cscript_string_append_cstr(ctxt, s, buffer);
+  cscript_string_push_back(ctxt, s, ':');
+  cscript_string_append(ctxt, s, name);
+  cscript_string_push_back(ctxt, s, ':');
+  cscript_memsize_to_char(buffer, cast(cscript_memsize, type));
+  cscript_string_append_cstr(ctxt, s, buffer);
+  }
+
+static void append_number(cscript_context* ctxt, cscript_string* s, cscript_memsize value)
+  {
+  char buffer[32];
+  cscript_memsize_to_char(buffer, value);
+  cscript_string_append_cstr(ctxt, s, buffer);
+  cscript_string_push_back(ctxt, s, ',');
+  }
+
+// fills globals (of size number_of_globals, indexed by position) with the global variables of ctxt from position first onwards
+static void get_globals(cscript_context* ctxt, cscript_environment_entry* globals, cscript_string* names, cscript_memsize first)
+  {
+  const cscript_memsize base_size = cscript_environment_base_size(ctxt);
+  for (cscript_memsize i = 0; i < base_size; ++i)
+    {
+    cscript_environment_entry entry;
+    cscript_string name;
+    if (cscript_environment_base_at(&entry, &name, ctxt, i) && entry.type == CSCRIPT_ENV_TYPE_GLOBAL && entry.position >= cast(cscript_fixnum, first))
+      {
+      globals[entry.position - first] = entry;
+      names[entry.position - first] = name;
+      }
+    }
+  }
+
+// the part of the key that describes the context: compile options, external functions and global variables
+static cscript_string make_signature(cscript_context* ctxt, const cscript_compile_options* options)
+  {
+  cscript_string s;
+  cscript_string_init(ctxt, &s, "O");
+  append_number(ctxt, &s, cast(cscript_memsize, options->constant_propagation));
+  append_number(ctxt, &s, cast(cscript_memsize, options->constant_folding));
+  append_number(ctxt, &s, cast(cscript_memsize, options->remove_dead_variables));
+  append_number(ctxt, &s, cast(cscript_memsize, options->optimization_rounds));
+  append_number(ctxt, &s, cast(cscript_memsize, options->fast_math));
+  append_number(ctxt, &s, options->time_budget);
+  append_number(ctxt, &s, options->fast_compile_max_length);
+  cscript_external_function* ext = cscript_vector_begin(&ctxt->externals, cscript_external_function);
+  cscript_external_function* ext_end = cscript_vector_end(&ctxt->externals, cscript_external_function);
+  for (; ext != ext_end; ++ext)
+    append_name(ctxt, &s, 'E', &ext->name, cast(int, ext->return_type));
+  const cscript_memsize number_of_globals = ctxt->globals.vector_size;
+  if (number_of_globals > 0)
+    {
+    cscript_environment_entry* globals = cscript_newvector(ctxt, number_of_globals, cscript_environment_entry);
+    cscript_string* names = cscript_newvector(ctxt, number_of_globals, cscript_string);
+    memset(names, 0, number_of_globals * sizeof(cscript_string));
+    get_globals(ctxt, globals, names, 0);
+    for (cscript_memsize i = 0; i < number_of_globals; ++i)
+      {
+      if (names[i].string_ptr != NULL)
+        append_name(ctxt, &s, 'G', &names[i], globals[i].register_type);
+      }
+    cscript_freevector(ctxt, names, number_of_globals, cscript_string);
+    cscript_freevector(ctxt, globals, number_of_globals, cscript_environment_entry);
+    }
+  return s;
+  }
+
+static void unlink_lru(cscript_compile_cache* cache, cache_entry* e)
+  {
+  if (e->previous)
+    e->previous->next = e->next;
+  else
+    cache->most_recent = e->next;
+  if (e->next)
+    e->next->previous = e->previous;
+  else
+    cache->least_recent = e->previous;
+  e->previous = NULL;
+  e->next = NULL;
+  }
+
+static void push_front_lru(cscript_compile_cache* cache, cache_entry* e)
+  {
+  e->previous = NULL;
+  e->next = cache->most_recent;
+  if (cache->most_recent)
+    cache->most_recent->previous = e;
+  cache->most_recent = e;
+  if (cache->least_recent == NULL)
+    cache->least_recent = e;
+  }
+
+static void entry_free(cscript_compile_cache* cache, cache_entry* e)
+  {
+  cscript_context* ctxt = cache->ctxt;
+  cscript_function_free(ctxt, e->fun);
+  cache_global* it = cscript_vector_begin(&e->globals, cache_global);
+  cache_global* it_end = cscript_vector_end(&e->globals, cache_global);
+  for (; it != it_end; ++it)
+    cscript_string_destroy(ctxt, &it->name);
+  cscript_vector_destroy(ctxt, &e->globals);
+  cscript_string_destroy(ctxt, &e->script);
+  cscript_string_destroy(ctxt, &e->signature);
+  cscript_delete(ctxt, e);
+  }
+
+static void remove_from_function_table(cscript_compile_cache* cache, cache_entry* e)
+  {
+  cache_entry** link = &cache->function_buckets[function_bucket(cache, e->fun)];
+  while (*link != e)
+    link = &(*link)->next_in_function_bucket;
+  *link = e->next_in_function_bucket;
+  --cache->number_of_entries;
+  }
+
+static void evict(cscript_compile_cache* cache, cache_entry* e)
+  {
+  cache_entry** link = &cache->buckets[cast(cscript_memsize, e->hash & (cache->number_of_buckets - 1))];
+  while (*link != e)
+    link = &(*link)->next_in_bucket;
+  *link = e->next_in_bucket;
+  unlink_lru(cache, e);
+  cache->stats.size -= e->size;
+  --cache->stats.number_of_functions;
+  ++cache->stats.evictions;
+  e->evicted = 1;
+  if (e->references == 0)
+    {
+    remove_from_function_table(cache, e);
+    entry_free(cache, e);
+    }
+  }
+
+static void grow_buckets(cscript_compile_cache* cache)
+  {
+  cscript_context* ctxt = cache->ctxt;
+  const cscript_memsize old_number_of_buckets = cache->number_of_buckets;
+  cache_entry** old_function_buckets = cache->function_buckets;
+  cscript_freevector(ctxt, cache->buckets, old_number_of_buckets, cache_entry*);
+  cache->number_of_buckets *= 2;
+  cache->buckets = cscript_newvector(ctxt, cache->number_of_buckets, cache_entry*);
+  cache->function_buckets = cscript_newvector(ctxt, cache->number_of_buckets, cache_entry*);
+  memset(cache->buckets, 0, cache->number_of_buckets * sizeof(cache_entry*));
+  memset(cache->function_buckets, 0, cache->number_of_buckets * sizeof(cache_entry*));
+  for (cscript_memsize i = 0; i < old_number_of_buckets; ++i)
+    {
+    cache_entry* e = old_function_buckets[i];
+    while (e)
+      {
+      cache_entry* next = e->next_in_function_bucket;
+      cache_entry** fb = &cache->function_buckets[function_bucket(cache, e->fun)];
+      e->next_in_function_bucket = *fb;
+      *fb = e;
+      if (!e->evicted)
+        {
+        cache_entry** b = &cache->buckets[cast(cscript_memsize, e->hash & (cache->number_of_buckets - 1))];
+        e->next_in_bucket = *b;
+        *b = e;
+        }
+      e = next;
+      }
+    }
+  cscript_freevector(ctxt, old_function_buckets, old_number_of_buckets, cache_entry*);
+  }
+
+static cache_entry* find(cscript_compile_cache* cache, uint64_t hash, const char* script, const cscript_string* signature)
+  {
+  cache_entry* e = cache->buckets[cast(cscript_memsize, hash & (cache->number_of_buckets - 1))];
+  for (; e != NULL; e = e->next_in_bucket)
+    {
+    if (e->hash == hash && strcmp(e->signature.string_ptr, signature->string_ptr) == 0 && strcmp(e->script.string_ptr, script) == 0)
+      return e;
+    }
+  return NULL;
+  }
+
+static void use(cscript_compile_cache* cache, cache_entry* e)
+  {
+  ++e->references;
+  unlink_lru(cache, e);
+  push_front_lru(cache, e);
+  }
+
+// declares the global variables of a cached script in ctxt, as compiling the script would have done
+static void declare_globals(cscript_context* ctxt, const cache_entry* e)
+  {
+  const cache_global* it = cscript_vector_begin(&e->globals, cache_global);
+  const cache_global* it_end = cscript_vector_end(&e->globals, cache_global);
+  for (; it != it_end; ++it)
+    {
+    cscript_environment_entry entry;
+    entry.type = CSCRIPT_ENV_TYPE_GLOBAL;
+    entry.position = ctxt->globals.vector_size;
+    entry.register_type = it->register_type;
+    cscript_string name;
+    cscript_string_copy(ctxt, &name, &it->name);
+    cscript_environment_add_to_base(ctxt, &name, entry);
+    cscript_vector_push_back(ctxt, &ctxt->globals, 0, cscript_fixnum);
+    }
+  }
+
+cscript_compile_cache* cscript_compile_cache_new(cscript_context* ctxt, cscript_memsize max_size)
+  {
+  cscript_context* cache_ctxt = cscript_context_init(ctxt, 1);
+  cscript_compile_cache* cache = cscript_new(cache_ctxt, cscript_compile_cache);
+  cache->ctxt = cache_ctxt;
+  cache->max_size = max_size;
+  cache->number_of_buckets = CSCRIPT_COMPILE_CACHE_BUCKETS;
+  cache->buckets = cscript_newvector(cache_ctxt, cache->number_of_buckets, cache_entry*);
+  cache->function_buckets = cscript_newvector(cache_ctxt, cache->number_of_buckets, cache_entry*);
+  memset(cache->buckets, 0, cache->number_of_buckets * sizeof(cache_entry*));
+  memset(cache->function_buckets, 0, cache->number_of_buckets * sizeof(cache_entry*));
+  cache->number_of_entries = 0;
+  cache->most_recent = NULL;
+  cache->least_recent = NULL;
+  memset(&cache->stats, 0, sizeof(cscript_compile_cache_stats));
+  cscript_mutex_init(&cache->mutex);
+  return cache;
+  }
+
+void cscript_compile_cache_free(cscript_compile_cache* cache)
+  {
+  cscript_context* ctxt = cache->ctxt;
+  for (cscript_memsize i = 0; i < cache->number_of_buckets; ++i)
+    {
+    cache_entry* e = cache->function_buckets[i];
+    while (e)
+      {
+      cache_entry* next = e->next_in_function_bucket;
+      cscript_assert(e->references == 0); // all functions should have been released
+      entry_free(cache, e);
+      e = next;
+      }
+    }
+  cscript_freevector(ctxt, cache->buckets, cache->number_of_buckets, cache_entry*);
+  cscript_freevector(ctxt, cache->function_buckets, cache->number_of_buckets, cache_entry*);
+  cscript_mutex_destroy(&cache->mutex);
+  cscript_delete(ctxt, cache);
+  cscript_context_destroy(ctxt);
+  }
+
+cscript_function* cscript_compile_cached(cscript_compile_cache* cache, cscript_context* ctxt, const char* script, const cscript_compile_options* options)
+  {
+  cscript_compile_options default_options;
+  if (options == NULL)
+    {
+    cscript_compile_options_init(&default_options, 2);
+    options = &default_options;
+    }
+  cscript_string signature = make_signature(ctxt, options);
+  const uint64_t hash = hash_bytes(hash_bytes(0xcbf29ce484222325ULL, signature.string_ptr, signature.string_length), script, cast(cscript_memsize, strlen(script)));
+
+  cscript_mutex_lock(&cache->mutex);
+  cache_entry* e = find(cache, hash, script, &signature);
+  if (e != NULL)
+    {
+    use(cache, e);
+    ++cache->stats.hits;
+    }
+  else
+    ++cache->stats.misses;
+  cscript_mutex_unlock(&cache->mutex);
+
+  if (e != NULL)
+    {
+    cscript_string_destroy(ctxt, &signature);
+    cscript_syntax_errors_clear(ctxt);
+    cscript_compile_errors_clear(ctxt);
+    cscript_runtime_errors_clear(ctxt);
+    // the entry cannot be freed while it is referenced, and its globals never change
+    declare_globals(ctxt, e);
+    return e->fun;
+    }
+
+  const cscript_memsize first_new_global = ctxt->globals.vector_size;
+  cscript_function* fun = cscript_compile_ex(ctxt, script, options);
+  if (fun == NULL)
+    {
+    cscript_string_destroy(ctxt, &signature);
+    return NULL;
+    }
+  const cscript_memsize number_of_new_globals = ctxt->globals.vector_size - first_new_global;
+  cscript_environment_entry* new_globals = NULL;
+  cscript_string* new_global_names = NULL;
+  if (number_of_new_globals > 0)
+    {
+    new_globals = cscript_newvector(ctxt, number_of_new_globals, cscript_environment_entry);
+    new_global_names = cscript_newvector(ctxt, number_of_new_globals, cscript_string);
+    get_globals(ctxt, new_globals, new_global_names, first_new_global);
+    }
+
+  cscript_function* result = NULL;
+  cscript_mutex_lock(&cache->mutex);
+  cache_entry* existing = find(cache, hash, script, &signature);
+  if (existing != NULL) // another thread compiled the same script in the meantime
+    {
+    use(cache, existing);
+    result = existing->fun;
+    }
+  else
+    {
+    cscript_context* cache_ctxt = cache->ctxt;
+    e = cscript_new(cache_ctxt, cache_entry);
+    e->hash = hash;
+    cscript_string_init(cache_ctxt, &e->script, script);
+    cscript_string_copy(cache_ctxt, &e->signature, &signature);
+    // the cache frees its functions with its own context, which may not share the allocator of ctxt
+    e->fun = cscript_function_copy(cache_ctxt, fun);
+    result = e->fun;
+    cscript_vector_init_reserve(cache_ctxt, &e->globals, number_of_new_globals > 0 ? number_of_new_globals : 1, cache_global);
+    for (cscript_memsize i = 0; i < number_of_new_globals; ++i)
+      {
+      cache_global g;
+      cscript_string_copy(cache_ctxt, &g.name, &new_global_names[i]);
+      g.register_type = new_globals[i].register_type;
+      cscript_vector_push_back(cache_ctxt, &e->globals, g, cache_global);
+      }
+    e->size = cscript_function_memory_size(e->fun) + e->script.string_capacity + e->signature.string_capacity + sizeof(cache_entry);
+    e->references = 1;
+    e->evicted = 0;
+    e->previous = NULL;
+    e->next = NULL;
+    if (cache->number_of_entries >= cache->number_of_buckets)
+      grow_buckets(cache);
+    cache_entry** b = &cache->buckets[cast(cscript_memsize, hash & (cache->number_of_buckets - 1))];
+    e->next_in_bucket = *b;
+    *b = e;
+    cache_entry** fb = &cache->function_buckets[function_bucket(cache, e->fun)];
+    e->next_in_function_bucket = *fb;
+    *fb = e;
+    ++cache->number_of_entries;
+    push_front_lru(cache, e);
+    cache->stats.size += e->size;
+    ++cache->stats.number_of_functions;
+    while (cache->stats.size > cache->max_size && cache->least_recent != e)
+      evict(cache, cache->least_recent);
+    }
+  cscript_mutex_unlock(&cache->mutex);
+
+  if (number_of_new_globals > 0)
+    {
+    cscript_freevector(ctxt, new_global_names, number_of_new_globals, cscript_string);
+    cscript_freevector(ctxt, new_globals, number_of_new_globals, cscript_environment_entry);
+    }
+  cscript_string_destroy(ctxt, &signature);
+  cscript_function_free(ctxt, fun);
+  return result;
+  }
+
+void cscript_compile_cache_release(cscript_compile_cache* cache, cscript_function* fun)
+  {
+  cscript_mutex_lock(&cache->mutex);
+  cache_entry* e = cache->function_buckets[function_bucket(cache, fun)];
+  while (e != NULL && e->fun != fun)
+    e = e->next_in_function_bucket;
+  cscript_assert(e != NULL && e->references > 0);
+  if (e != NULL && --e->references == 0 && e->evicted)
+    {
+    remove_from_function_table(cache, e);
+    entry_free(cache, e);
+    }
+  cscript_mutex_unlock(&cache->mutex);
+  }
+
+void cscript_compile_cache_get_stats(cscript_compile_cache* cache, cscript_compile_cache_stats* stats)
+  {
+  cscript_mutex_lock(&cache->mutex);
+  *stats = cache->stats;
+  cscript_mutex_unlock(&cache->mutex);
+  }
@@ -0,0 +1,22 @@
+#ifndef CSCRIPT_CACHE_H
+#define CSCRIPT_CACHE_H
+
+#include "cscript.h"
+
+/*
+Cached functions are looked up by a 64 bit FNV-1a hash of the script and of a signature of the compiling
+context: the compile options, the names and return types of the external functions in registration order,
+and the names and types of the global variables in position order. A hit also compares the script and the
+signature themselves, so that hash collisions never return the wrong function.
+
+The compiled code refers to external functions and global variables by position, which is why they are part
+of the signature. Global variables that a script declares are recorded with the cached function and declared
+again in the context of every hit, so that the context ends up in the same state as after cscript_compile.
+*/
+
+// initial number of buckets of the hash tables of a cache, a power of 2
+#ifndef CSCRIPT_COMPILE_CACHE_BUCKETS
+#define CSCRIPT_COMPILE_CACHE_BUCKETS 64
+#endif
+
+#endif //CSCRIPT_CACHE_H
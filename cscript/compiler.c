@@ -8,6 +8,7 @@
 #include "environment.h"
 #include "constant.h"
 #include "foreign.h"
+#include "arena.h"
 
 #include <string.h>
 
@@ -73,22 +74,73 @@ static int get_k(cscript_context* ctxt, cscript_function* fun, cscript_object* k
 #define cscript_reg_typeinfo_fixnum_pointer 4 // 100
 #define cscript_reg_typeinfo_flonum_pointer 5 // 101
 
+/*
+Local variables are resolved through their symbol id (see alpha.c) by indexing this table.
+Programs that did not go through alpha conversion fall back to the environment.
+*/
+typedef struct compiler_local
+  {
+  int defined;
+  cscript_environment_entry entry;
+  } compiler_local;
+
 typedef struct compiler_state
   {
   int freereg;
+  int max_freereg; // highest freereg reached by local declarations, so that arrays are included in the frame size
   int reg_typeinfo;
   cscript_function* fun;
+  int parallel_base; // inside the body of a parallel for loop: registers below parallel_base belong to the enclosing code, -1 otherwise
+  const cscript_vector* parallel_reductions; // reductions of the innermost parallel for loop
+  cscript_vector* locals; // vector of type compiler_local, indexed by symbol id
   } compiler_state;
 
 compiler_state init_compiler_state(int freereg, int typeinfo, cscript_function* fun)
   {
   compiler_state state;
   state.freereg = freereg;
+  state.max_freereg = freereg;
   state.reg_typeinfo = typeinfo;
   state.fun = fun;
+  state.parallel_base = -1;
+  state.parallel_reductions = NULL;
+  state.locals = NULL;
   return state;
   }
 
+static int find_variable(cscript_environment_entry* entry, cscript_context* ctxt, compiler_state* state, cscript_string* name, int symbol)
+  {
+  if (symbol >= 0 && state->locals != NULL)
+    {
+    compiler_local* local = cscript_vector_at(state->locals, symbol, compiler_local);
+    *entry = local->entry;
+    return local->defined;
+    }
+  return cscript_environment_find_recursive(entry, ctxt, name);
+  }
+
+static int local_exists(cscript_context* ctxt, compiler_state* state, cscript_string* name, int symbol)
+  {
+  if (symbol >= 0 && state->locals != NULL)
+    return cscript_vector_at(state->locals, symbol, compiler_local)->defined;
+  cscript_environment_entry entry;
+  return cscript_environment_find(&entry, ctxt, name);
+  }
+
+static void add_local(cscript_context* ctxt, compiler_state* state, cscript_string* name, int symbol, cscript_environment_entry entry)
+  {
+  if (symbol >= 0 && state->locals != NULL)
+    {
+    compiler_local* local = cscript_vector_at(state->locals, symbol, compiler_local);
+    local->defined = 1;
+    local->entry = entry;
+    return;
+    }
+  cscript_string s;
+  cscript_string_copy(ctxt, &s, name);
+  cscript_environment_add(ctxt, &s, entry);
+  }
+
 static void compile_number(cscript_context* ctxt, compiler_state* state, cscript_parsed_number* n)
   {
   cscript_object obj;
@@ -122,19 +174,38 @@ static void compile_number(cscript_context* ctxt, compiler_state* state, cscript
 static void compile_expression(cscript_context* ctxt, compiler_state* state, cscript_parsed_expression* e);
 static void compile_statement(cscript_context* ctxt, compiler_state* state, cscript_statement* stmt);
 
+// global variables outlive the compilation, so they are declared outside of the arena
+static cscript_environment_entry declare_global(cscript_context* ctxt, cscript_string* name, int register_type, int implicit)
+  {
+  cscript_environment_entry entry;
+  entry.type = CSCRIPT_ENV_TYPE_GLOBAL;
+  entry.position = ctxt->globals.vector_size;
+  entry.register_type = register_type;
+  cscript_arena_suspend(ctxt);
+  cscript_string s;
+  cscript_string_copy(ctxt, &s, name);
+  cscript_environment_add_to_base(ctxt, &s, entry);
+  cscript_vector_push_back(ctxt, &ctxt->globals, 0, cscript_fixnum);
+  if (ctxt->declaration_log != NULL)
+    {
+    cscript_global_declaration d;
+    cscript_string_copy(ctxt, &d.name, name);
+    d.position = entry.position;
+    d.register_type = register_type;
+    d.implicit = implicit;
+    cscript_vector_push_back(ctxt, ctxt->declaration_log, d, cscript_global_declaration);
+    }
+  cscript_arena_resume(ctxt);
+  return entry;
+  }
+
 static void compile_global_variable(cscript_context* ctxt, compiler_state* state, cscript_parsed_variable* v)
   {
   cscript_environment_entry entry;
   if (!cscript_environment_find_recursive(&entry, ctxt, &v->name))
     {
     // the global variable was not yet declared, but since it's a global, we will then declare it here as being a real value.
-    entry.type = CSCRIPT_ENV_TYPE_GLOBAL;
-    entry.position = ctxt->globals.vector_size;
-    entry.register_type = cscript_reg_typeinfo_flonum;
-    cscript_string s;
-    cscript_string_copy(ctxt, &s, &v->name);
-    cscript_environment_add_to_base(ctxt, &s, entry);
-    cscript_vector_push_back(ctxt, &ctxt->globals, 0, cscript_fixnum);
+    entry = declare_global(ctxt, &v->name, cscript_reg_typeinfo_flonum, 1);
     }
   make_code_abx(ctxt, state->fun, CSCRIPT_OPCODE_LOADGLOBAL, state->freereg, (int)entry.position);
   state->reg_typeinfo = entry.register_type;
@@ -143,7 +214,7 @@ static void compile_global_variable(cscript_context* ctxt, compiler_state* state
 static void compile_local_variable(cscript_context* ctxt, compiler_state* state, cscript_parsed_variable* v)
   {
   cscript_environment_entry entry;
-  if (!cscript_environment_find_recursive(&entry, ctxt, &v->name))
+  if (!find_variable(&entry, ctxt, state, &v->name, v->symbol))
     {
     cscript_compile_error_cstr(ctxt, CSCRIPT_ERROR_VARIABLE_UNKNOWN, v->line_nr, v->column_nr, &v->filename, v->name.string_ptr);
     }
@@ -209,17 +280,8 @@ static void compile_local_variable(cscript_context* ctxt, compiler_state* state,
           }
         else // get address, not value
           {
-          cscript_fixnum address = cast(cscript_fixnum, ctxt->stack.vector_ptr) + entry.position * sizeof(cscript_fixnum);
-          if (address <= CSCRIPT_MAXARG_sBx && address >= -CSCRIPT_MAXARG_sBx)
-            {
-            make_code_asbx(ctxt, state->fun, CSCRIPT_OPCODE_SETFIXNUM, state->freereg, cast(int, address));
-            }
-          else
-            {
-            cscript_object obj = make_cscript_object_fixnum(address);
-            int k_pos = get_k(ctxt, state->fun, &obj);
-            make_code_abx(ctxt, state->fun, CSCRIPT_OPCODE_LOADK, state->freereg, k_pos);
-            }
+          // the address is computed at runtime relative to the stack of the context that runs the function
+          make_code_ab(ctxt, state->fun, CSCRIPT_OPCODE_ADDRESS, state->freereg, (int)entry.position);
           state->reg_typeinfo = cscript_reg_typeinfo_fixnum;
           }
         }
@@ -235,18 +297,48 @@ static void compile_variable(cscript_context* ctxt, compiler_state* state, cscri
     compile_local_variable(ctxt, state, v);
   }
 
+/*
+The iterations of a parallel for loop run on copies of the registers of the enclosing code, so writes to
+variables of the enclosing code would be lost, and would introduce a dependency between iterations.
+Only reduction variables and writes through pointers are allowed.
+*/
+static void check_parallel_write(cscript_context* ctxt, compiler_state* state, cscript_string* name, cscript_environment_entry* entry, int line_nr, int column_nr, cscript_string* filename)
+  {
+  if (state->parallel_base < 0)
+    return;
+  if (entry->type == CSCRIPT_ENV_TYPE_STACK && (int)entry->position >= state->parallel_base)
+    return;
+  if (entry->type == CSCRIPT_ENV_TYPE_STACK)
+    {
+    const cscript_parallel_reduction* it = cscript_vector_begin(state->parallel_reductions, cscript_parallel_reduction);
+    const cscript_parallel_reduction* it_end = cscript_vector_end(state->parallel_reductions, cscript_parallel_reduction);
+    for (; it != it_end; ++it)
+      {
+      if (it->position == (int)entry->position)
+        return;
+      }
+    }
+  cscript_string msg;
+  cscript_string_init(ctxt, &msg, "loop-carried dependency in parallel for loop: ");
+  cscript_string_append(ctxt, &msg, name);
+  cscript_compile_error_cstr(ctxt, CSCRIPT_ERROR_BAD_SYNTAX, line_nr, column_nr, filename, msg.string_ptr);
+  cscript_string_destroy(ctxt, &msg);
+  }
+
 static void compile_lvalue_operator(cscript_context* ctxt, compiler_state* state, cscript_parsed_lvalue_operator* lvop)
   {
   int adder = 1;
   if (strcmp(lvop->name.string_ptr, "--") == 0)
     adder = -1;
   cscript_environment_entry entry;
-  if (!cscript_environment_find_recursive(&entry, ctxt, &lvop->lvalue.name))
+  if (!find_variable(&entry, ctxt, state, &lvop->lvalue.name, lvop->lvalue.symbol))
     {
     cscript_compile_error_cstr(ctxt, CSCRIPT_ERROR_VARIABLE_UNKNOWN, lvop->lvalue.line_nr, lvop->lvalue.column_nr, &lvop->lvalue.filename, lvop->lvalue.name.string_ptr);
     }
   else
     {
+    if (lvop->lvalue.dims.vector_size == 0 || entry.register_type < cscript_reg_typeinfo_fixnum_pointer)
+      check_parallel_write(ctxt, state, &lvop->lvalue.name, &entry, lvop->lvalue.line_nr, lvop->lvalue.column_nr, &lvop->lvalue.filename);
     if (lvop->lvalue.dims.vector_size > 0)
       {
       if (entry.register_type >= cscript_reg_typeinfo_fixnum_pointer) // pointer type
@@ -733,19 +825,17 @@ static void compile_fixnum_array(cscript_context* ctxt, compiler_state* state, c
     else
       init_values = cscript_get_constant_value_expression(ctxt, &fx->expr);
     }
-  cscript_environment_entry entry;
-  if (cscript_environment_find(&entry, ctxt, &fx->name))
+  if (local_exists(ctxt, state, &fx->name, fx->symbol))
     {
     cscript_compile_error_cstr(ctxt, CSCRIPT_ERROR_BAD_SYNTAX, fx->line_nr, fx->column_nr, &fx->filename, "variable already exists");
     }
   else
     {
+    cscript_environment_entry entry;
     entry.type = CSCRIPT_ENV_TYPE_STACK;
     entry.position = state->freereg;
     entry.register_type = cscript_reg_typeinfo_fixnum_array;
-    cscript_string s;
-    cscript_string_copy(ctxt, &s, &fx->name);
-    cscript_environment_add(ctxt, &s, entry);
+    add_local(ctxt, state, &fx->name, fx->symbol, entry);
     cscript_vector dim_size_vec = cscript_get_constant_value_expression(ctxt, dim_expr);
     cscript_assert(dim_size_vec.vector_size == 1);
     cscript_constant_value dim_size = *cscript_vector_begin(&dim_size_vec, cscript_constant_value);
@@ -756,6 +846,8 @@ static void compile_fixnum_array(cscript_context* ctxt, compiler_state* state, c
     else
       dimension = (int)dim_size.number.fl;
     state->freereg += dimension;
+    if (state->freereg > state->max_freereg)
+      state->max_freereg = state->freereg;
     if (init)
       {
       if ((int)init_values.vector_size != dimension)
@@ -806,13 +898,7 @@ static void compile_fixnum_global_single(cscript_context* ctxt, compiler_state*
     }
   else
     {
-    entry.type = CSCRIPT_ENV_TYPE_GLOBAL;
-    entry.position = ctxt->globals.vector_size;
-    entry.register_type = cscript_reg_typeinfo_fixnum;
-    cscript_string s;
-    cscript_string_copy(ctxt, &s, &fx->name);
-    cscript_environment_add_to_base(ctxt, &s, entry);
-    cscript_vector_push_back(ctxt, &ctxt->globals, 0, cscript_fixnum);
+    entry = declare_global(ctxt, &fx->name, cscript_reg_typeinfo_fixnum, 0);
     if (init)
       {
       make_code_abx(ctxt, state->fun, CSCRIPT_OPCODE_STOREGLOBAL, state->freereg, (int)entry.position);
@@ -832,19 +918,17 @@ static void compile_fixnum_single(cscript_context* ctxt, compiler_state* state,
       state->reg_typeinfo = cscript_number_type_fixnum;
       }
     }
-  cscript_environment_entry entry;
-  if (cscript_environment_find(&entry, ctxt, &fx->name))
+  if (local_exists(ctxt, state, &fx->name, fx->symbol))
     {
     cscript_compile_error_cstr(ctxt, CSCRIPT_ERROR_BAD_SYNTAX, fx->line_nr, fx->column_nr, &fx->filename, "variable already exists");
     }
   else
     {
+    cscript_environment_entry entry;
     entry.type = CSCRIPT_ENV_TYPE_STACK;
     entry.position = state->freereg;
     entry.register_type = cscript_reg_typeinfo_fixnum;
-    cscript_string s;
-    cscript_string_copy(ctxt, &s, &fx->name);
-    cscript_environment_add(ctxt, &s, entry);
+    add_local(ctxt, state, &fx->name, fx->symbol, entry);
     ++state->freereg;
     }
   }
@@ -897,19 +981,17 @@ static void compile_flonum_array(cscript_context* ctxt, compiler_state* state, c
     else
       init_values = cscript_get_constant_value_expression(ctxt, &fl->expr);
     }
-  cscript_environment_entry entry;
-  if (cscript_environment_find(&entry, ctxt, &fl->name))
+  if (local_exists(ctxt, state, &fl->name, fl->symbol))
     {
     cscript_compile_error_cstr(ctxt, CSCRIPT_ERROR_BAD_SYNTAX, fl->line_nr, fl->column_nr, &fl->filename, "Variable already exists");
     }
   else
     {
+    cscript_environment_entry entry;
     entry.type = CSCRIPT_ENV_TYPE_STACK;
     entry.position = state->freereg;
     entry.register_type = cscript_reg_typeinfo_flonum_array;
-    cscript_string s;
-    cscript_string_copy(ctxt, &s, &fl->name);
-    cscript_environment_add(ctxt, &s, entry);
+    add_local(ctxt, state, &fl->name, fl->symbol, entry);
     cscript_vector dim_size_vec = cscript_get_constant_value_expression(ctxt, dim_expr);
     cscript_assert(dim_size_vec.vector_size == 1);
     cscript_constant_value dim_size = *cscript_vector_begin(&dim_size_vec, cscript_constant_value);
@@ -920,6 +1002,8 @@ static void compile_flonum_array(cscript_context* ctxt, compiler_state* state, c
     else
       dimension = (int)dim_size.number.fl;
     state->freereg += dimension;
+    if (state->freereg > state->max_freereg)
+      state->max_freereg = state->freereg;
     if (init)
       {
       if ((int)init_values.vector_size != dimension)
@@ -970,13 +1054,7 @@ static void compile_flonum_global_single(cscript_context* ctxt, compiler_state*
     }
   else
     {
-    entry.type = CSCRIPT_ENV_TYPE_GLOBAL;
-    entry.position = ctxt->globals.vector_size;
-    entry.register_type = cscript_reg_typeinfo_flonum;
-    cscript_string s;
-    cscript_string_copy(ctxt, &s, &fl->name);
-    cscript_environment_add_to_base(ctxt, &s, entry);
-    cscript_vector_push_back(ctxt, &ctxt->globals, 0, cscript_fixnum);
+    entry = declare_global(ctxt, &fl->name, cscript_reg_typeinfo_flonum, 0);
     if (init)
       {
       make_code_abx(ctxt, state->fun, CSCRIPT_OPCODE_STOREGLOBAL, state->freereg, (int)entry.position);
@@ -996,19 +1074,17 @@ static void compile_flonum_single(cscript_context* ctxt, compiler_state* state,
       state->reg_typeinfo = cscript_number_type_flonum;
       }
     }
-  cscript_environment_entry entry;
-  if (cscript_environment_find(&entry, ctxt, &fl->name))
+  if (local_exists(ctxt, state, &fl->name, fl->symbol))
     {
     cscript_compile_error_cstr(ctxt, CSCRIPT_ERROR_BAD_SYNTAX, fl->line_nr, fl->column_nr, &fl->filename, "Variable already exists");
     }
   else
     {
+    cscript_environment_entry entry;
     entry.type = CSCRIPT_ENV_TYPE_STACK;
     entry.position = state->freereg;
     entry.register_type = cscript_reg_typeinfo_flonum;
-    cscript_string s;
-    cscript_string_copy(ctxt, &s, &fl->name);
-    cscript_environment_add(ctxt, &s, entry);
+    add_local(ctxt, state, &fl->name, fl->symbol, entry);
     ++state->freereg;
     }
   }
@@ -1360,12 +1436,14 @@ static void compile_global_assignment_single(cscript_context* ctxt, compiler_sta
 static void compile_assignment(cscript_context* ctxt, compiler_state* state, cscript_parsed_assignment* a)
   {
   cscript_environment_entry entry;
-  if (!cscript_environment_find_recursive(&entry, ctxt, &a->name))
+  if (!find_variable(&entry, ctxt, state, &a->name, a->symbol))
     {
     cscript_compile_error_cstr(ctxt, CSCRIPT_ERROR_VARIABLE_UNKNOWN, a->line_nr, a->column_nr, &a->filename, a->name.string_ptr);
     }
   else
     {
+    if (a->derefence == 0 && (a->dims.vector_size == 0 || entry.register_type < cscript_reg_typeinfo_fixnum_pointer))
+      check_parallel_write(ctxt, state, &a->name, &entry, a->line_nr, a->column_nr, &a->filename);
     if (a->name.string_ptr[0] == '$')
       {
       compile_global_assignment_single(ctxt, state, a, entry);
@@ -1395,8 +1473,30 @@ static void compile_assignment(cscript_context* ctxt, compiler_state* state, csc
     }
   }
 
+/*
+Loops are rotated so that each iteration only executes a single jump:
+
+  init
+  cond
+  NEQ cond, 0      (skip the next jump if cond holds)
+  JMP exit
+body:
+  statements
+  inc
+  cond
+  NEQ cond, 0, 1   (skip the next jump if cond does not hold)
+  JMP body
+exit:
+*/
+static void compile_parallel_for(cscript_context* ctxt, compiler_state* state, cscript_parsed_for* f);
+
 static void compile_for(cscript_context* ctxt, compiler_state* state, cscript_parsed_for* f)
   {
+  if (f->parallel)
+    {
+    compile_parallel_for(ctxt, state, f);
+    return;
+    }
   cscript_statement* init = cscript_vector_at(&f->init_cond_inc, 0, cscript_statement);
   cscript_statement* cond = cscript_vector_at(&f->init_cond_inc, 1, cscript_statement);
   cscript_statement* inc = cscript_vector_at(&f->init_cond_inc, 2, cscript_statement);
@@ -1408,6 +1508,7 @@ static void compile_for(cscript_context* ctxt, compiler_state* state, cscript_pa
   CSCRIPT_SET_OPCODE(i1, CSCRIPT_OPCODE_JMP);
   cscript_vector_push_back(ctxt, &state->fun->code, i1, cscript_instruction);
   int for_loop_jump = (int)state->fun->code.vector_size - 1;
+  int for_loop_body_start = (int)state->fun->code.vector_size;
 
   cscript_statement* it = cscript_vector_begin(&f->statements, cscript_statement);
   cscript_statement* it_end = cscript_vector_end(&f->statements, cscript_statement);
@@ -1420,13 +1521,155 @@ static void compile_for(cscript_context* ctxt, compiler_state* state, cscript_pa
 
   cscript_instruction i2 = 0;
   CSCRIPT_SET_OPCODE(i2, CSCRIPT_OPCODE_JMP);
-  CSCRIPT_SETARG_sBx(i2, for_loop_cond_start - (int)state->fun->code.vector_size - 1);
+  if (cond->type == cscript_statement_type_expression)
+    {
+    // the condition is compiled a second time as the bottom test
+    compile_statement(ctxt, state, cond);
+    make_code_abc(ctxt, state->fun, CSCRIPT_OPCODE_NEQ, state->freereg, 0, 1);
+    CSCRIPT_SETARG_sBx(i2, for_loop_body_start - (int)state->fun->code.vector_size - 1);
+    }
+  else
+    {
+    // conditions that declare variables cannot be compiled twice, so we jump back to the top test
+    CSCRIPT_SETARG_sBx(i2, for_loop_cond_start - (int)state->fun->code.vector_size - 1);
+    }
   cscript_vector_push_back(ctxt, &state->fun->code, i2, cscript_instruction);
 
   cscript_instruction* first_jump = cscript_vector_at(&state->fun->code, for_loop_jump, cscript_instruction);
   CSCRIPT_SETARG_sBx(*first_jump, (int)state->fun->code.vector_size - for_loop_jump - 1);
   }
 
+static cscript_memsize compute_frame_size(const cscript_function* fun, int max_freereg);
+
+static cscript_parsed_factor* get_single_factor(cscript_statement* stmt)
+  {
+  if (stmt->type != cscript_statement_type_expression || stmt->statement.expr.operands.vector_size != 1)
+    return NULL;
+  cscript_parsed_relop* r = cscript_vector_begin(&stmt->statement.expr.operands, cscript_parsed_relop);
+  if (r->operands.vector_size != 1)
+    return NULL;
+  cscript_parsed_term* t = cscript_vector_begin(&r->operands, cscript_parsed_term);
+  if (t->operands.vector_size != 1)
+    return NULL;
+  return cscript_vector_begin(&t->operands, cscript_parsed_factor);
+  }
+
+/*
+Returns the upper bound of the loop variable if the loop has the form
+for (int i = start; i < end; ++i) or for (int i = start; i <= end; ++i), and NULL otherwise.
+*/
+static cscript_parsed_relop* get_parallel_for_bound(cscript_parsed_for* f, int* inclusive)
+  {
+  cscript_statement* init = cscript_vector_at(&f->init_cond_inc, 0, cscript_statement);
+  cscript_statement* cond = cscript_vector_at(&f->init_cond_inc, 1, cscript_statement);
+  cscript_statement* inc = cscript_vector_at(&f->init_cond_inc, 2, cscript_statement);
+  if (init->type == cscript_statement_type_comma_separated && init->statement.stmts.statements.vector_size == 1)
+    init = cscript_vector_begin(&init->statement.stmts.statements, cscript_statement);
+  if (init->type != cscript_statement_type_fixnum || init->statement.fixnum.dims.vector_size > 0 || init->statement.fixnum.name.string_ptr[0] == '$')
+    return NULL;
+  const char* loop_var = init->statement.fixnum.name.string_ptr;
+  cscript_parsed_factor* incf = get_single_factor(inc);
+  if (incf == NULL || incf->type != cscript_factor_type_lvalue_operator || strcmp(incf->factor.lvop.name.string_ptr, "++") != 0)
+    return NULL;
+  if (incf->factor.lvop.lvalue.dims.vector_size > 0 || strcmp(incf->factor.lvop.lvalue.name.string_ptr, loop_var) != 0)
+    return NULL;
+  if (cond->type != cscript_statement_type_expression || cond->statement.expr.operands.vector_size != 2)
+    return NULL;
+  const int op = *cscript_vector_begin(&cond->statement.expr.fops, int);
+  if (op != cscript_op_less && op != cscript_op_leq)
+    return NULL;
+  cscript_parsed_relop* lhs = cscript_vector_at(&cond->statement.expr.operands, 0, cscript_parsed_relop);
+  if (lhs->operands.vector_size != 1)
+    return NULL;
+  cscript_parsed_term* t = cscript_vector_begin(&lhs->operands, cscript_parsed_term);
+  if (t->operands.vector_size != 1)
+    return NULL;
+  cscript_parsed_factor* lhsf = cscript_vector_begin(&t->operands, cscript_parsed_factor);
+  if (lhsf->type != cscript_factor_type_variable || lhsf->sign == '-' || lhsf->factor.var.dims.vector_size > 0 || strcmp(lhsf->factor.var.name.string_ptr, loop_var) != 0)
+    return NULL;
+  *inclusive = op == cscript_op_leq ? 1 : 0;
+  return cscript_vector_at(&cond->statement.expr.operands, 1, cscript_parsed_relop);
+  }
+
+/*
+The body of a parallel for loop is compiled to a separate function that uses the same register layout as
+the enclosing code. The loop itself becomes
+
+  init                         (R(A) := start)
+  R(A+1) := end
+  CALLPRIM A, CSCRIPT_PARALLEL_FOR, k
+
+which runs the body of parallel loop k for R(A) <= i < R(A+1) (see parallel.c), and leaves R(A) equal to R(A+1).
+*/
+static void compile_parallel_for(cscript_context* ctxt, compiler_state* state, cscript_parsed_for* f)
+  {
+  int inclusive = 0;
+  cscript_parsed_relop* bound = get_parallel_for_bound(f, &inclusive);
+  if (bound == NULL)
+    {
+    cscript_compile_error_cstr(ctxt, CSCRIPT_ERROR_BAD_SYNTAX, f->line_nr, f->column_nr, &f->filename, "parallel for loops should have the form parallel for (int i = start; i < end; ++i)");
+    return;
+    }
+  cscript_parallel_loop loop;
+  cscript_vector_init(ctxt, &loop.reductions, cscript_parallel_reduction);
+  cscript_parsed_reduction* red_it = cscript_vector_begin(&f->reductions, cscript_parsed_reduction);
+  cscript_parsed_reduction* red_it_end = cscript_vector_end(&f->reductions, cscript_parsed_reduction);
+  for (; red_it != red_it_end; ++red_it)
+    {
+    cscript_environment_entry entry;
+    if (!find_variable(&entry, ctxt, state, &red_it->var.name, red_it->var.symbol))
+      {
+      cscript_compile_error_cstr(ctxt, CSCRIPT_ERROR_VARIABLE_UNKNOWN, red_it->var.line_nr, red_it->var.column_nr, &red_it->var.filename, red_it->var.name.string_ptr);
+      }
+    else if (entry.type != CSCRIPT_ENV_TYPE_STACK || entry.register_type > cscript_reg_typeinfo_flonum || red_it->var.dims.vector_size > 0)
+      {
+      cscript_compile_error_cstr(ctxt, CSCRIPT_ERROR_BAD_SYNTAX, red_it->var.line_nr, red_it->var.column_nr, &red_it->var.filename, "reduction variables should be local int or float variables");
+      }
+    else
+      {
+      cscript_parallel_reduction r;
+      r.position = (int)entry.position;
+      r.op = red_it->op;
+      r.is_flonum = entry.register_type == cscript_reg_typeinfo_flonum ? 1 : 0;
+      cscript_vector_push_back(ctxt, &loop.reductions, r, cscript_parallel_reduction);
+      }
+    }
+
+  compile_statement(ctxt, state, cscript_vector_at(&f->init_cond_inc, 0, cscript_statement));
+  const int loop_register = state->freereg - 1;
+  compile_relop(ctxt, state, bound);
+  if (state->reg_typeinfo == cscript_reg_typeinfo_flonum)
+    {
+    make_code_ab(ctxt, state->fun, CSCRIPT_OPCODE_CAST, state->freereg, cscript_number_type_fixnum);
+    state->reg_typeinfo = cscript_reg_typeinfo_fixnum;
+    }
+  if (inclusive)
+    {
+    make_code_asbx(ctxt, state->fun, CSCRIPT_OPCODE_SETFIXNUM, state->freereg + 1, 1);
+    make_code_ab(ctxt, state->fun, CSCRIPT_OPCODE_CALLPRIM, state->freereg, CSCRIPT_ADD_FIXNUM);
+    }
+
+  loop.body = cscript_function_new(ctxt);
+  compiler_state body_state = init_compiler_state(loop_register + 2, cscript_reg_typeinfo_fixnum, loop.body);
+  body_state.parallel_base = loop_register + 1;
+  body_state.parallel_reductions = &loop.reductions;
+  body_state.locals = state->locals;
+  cscript_statement* it = cscript_vector_begin(&f->statements, cscript_statement);
+  cscript_statement* it_end = cscript_vector_end(&f->statements, cscript_statement);
+  for (; it != it_end; ++it)
+    {
+    compile_statement(ctxt, &body_state, it);
+    }
+  loop.body->result_position = body_state.freereg;
+  loop.body->frame_size = compute_frame_size(loop.body, body_state.max_freereg);
+  if ((int)loop.body->frame_size > state->max_freereg)
+    state->max_freereg = (int)loop.body->frame_size;
+
+  const int loop_index = (int)state->fun->parallel_loops.vector_size;
+  cscript_vector_push_back(ctxt, &state->fun->parallel_loops, loop, cscript_parallel_loop);
+  make_code_abc(ctxt, state->fun, CSCRIPT_OPCODE_CALLPRIM, loop_register, CSCRIPT_PARALLEL_FOR, loop_index);
+  }
+
 static void compile_if(cscript_context* ctxt, compiler_state* state, cscript_parsed_if* i)
   {
   cscript_parsed_expression* cond = cscript_vector_at(&i->condition, 0, cscript_parsed_expression);
@@ -1516,7 +1759,7 @@ static void compile_statement(cscript_context* ctxt, compiler_state* state, cscr
     }
   }
 
-static void compile_parameter(cscript_context* ctxt, cscript_parameter* p, cscript_fixnum pos)
+static void compile_parameter(cscript_context* ctxt, compiler_state* state, cscript_parameter* p, cscript_fixnum pos)
   {
   cscript_environment_entry entry;
   entry.type = CSCRIPT_ENV_TYPE_STACK;
@@ -1539,9 +1782,61 @@ static void compile_parameter(cscript_context* ctxt, cscript_parameter* p, cscri
       cscript_assert(0);
       break;
     }
-  cscript_string s;
-  cscript_string_copy(ctxt, &s, &p->name);
-  cscript_environment_add(ctxt, &s, entry);
+  add_local(ctxt, state, &p->name, p->symbol, entry);
+  }
+
+static void update_frame_size(cscript_memsize* frame_size, int last_register)
+  {
+  if (last_register >= 0 && cast(cscript_memsize, last_register) >= *frame_size)
+    *frame_size = cast(cscript_memsize, last_register) + 1;
+  }
+
+static cscript_memsize compute_frame_size(const cscript_function* fun, int max_freereg)
+  {
+  cscript_memsize frame_size = cast(cscript_memsize, max_freereg);
+  update_frame_size(&frame_size, (int)fun->result_position);
+  const cscript_instruction* it = cscript_vector_begin(&fun->code, cscript_instruction);
+  const cscript_instruction* it_end = cscript_vector_end(&fun->code, cscript_instruction);
+  for (; it != it_end; ++it)
+    {
+    const cscript_instruction instruc = *it;
+    const int a = CSCRIPT_GETARG_A(instruc);
+    const int b = CSCRIPT_GETARG_B(instruc);
+    const int c = CSCRIPT_GETARG_C(instruc);
+    switch (CSCRIPT_GET_OPCODE(instruc))
+      {
+      case CSCRIPT_OPCODE_MOVE:
+      case CSCRIPT_OPCODE_STORE_MEMORY:
+      case CSCRIPT_OPCODE_LOAD_MEMORY:
+      case CSCRIPT_OPCODE_ADDRESS:
+        update_frame_size(&frame_size, a);
+        update_frame_size(&frame_size, b);
+        break;
+      case CSCRIPT_OPCODE_MOVE_TO_ARR:
+      case CSCRIPT_OPCODE_MOVE_FROM_ARR:
+        update_frame_size(&frame_size, a);
+        update_frame_size(&frame_size, b);
+        update_frame_size(&frame_size, c);
+        break;
+      case CSCRIPT_OPCODE_CALLPRIM:
+        update_frame_size(&frame_size, a + 1);
+        break;
+      case CSCRIPT_OPCODE_CALLFOREIGN:
+        update_frame_size(&frame_size, a + c - 1);
+        update_frame_size(&frame_size, a);
+        break;
+      case CSCRIPT_OPCODE_RETURN:
+        if (a != 0)
+          update_frame_size(&frame_size, a + b - 1);
+        break;
+      case CSCRIPT_OPCODE_JMP:
+        break;
+      default:
+        update_frame_size(&frame_size, a);
+        break;
+      }
+    }
+  return frame_size;
   }
 
 cscript_function* cscript_compile_program(cscript_context* ctxt, cscript_program* prog)
@@ -1549,14 +1844,19 @@ cscript_function* cscript_compile_program(cscript_context* ctxt, cscript_program
   cscript_compile_errors_clear(ctxt);
   cscript_environment_push_child(ctxt);
   cscript_function* fun = cscript_function_new(ctxt);
+  compiler_state state = init_compiler_state(prog->parameters.vector_size, cscript_reg_typeinfo_fixnum, fun);
+  cscript_vector locals;
+  cscript_vector_init_with_size(ctxt, &locals, prog->number_of_symbols, compiler_local);
+  if (prog->number_of_symbols > 0)
+    memset(locals.vector_ptr, 0, prog->number_of_symbols * sizeof(compiler_local));
+  state.locals = &locals;
   cscript_parameter* pit = cscript_vector_begin(&prog->parameters, cscript_parameter);
   cscript_parameter* pit_end = cscript_vector_end(&prog->parameters, cscript_parameter);
   cscript_fixnum parameter_pos = 0;
   for (; pit != pit_end; ++pit, ++parameter_pos)
     {
-    compile_parameter(ctxt, pit, parameter_pos);
+    compile_parameter(ctxt, &state, pit, parameter_pos);
     }
-  compiler_state state = init_compiler_state(prog->parameters.vector_size, cscript_reg_typeinfo_fixnum, fun);
   cscript_statement* it = cscript_vector_begin(&prog->statements, cscript_statement);
   cscript_statement* it_end = cscript_vector_end(&prog->statements, cscript_statement);
   for (; it != it_end; ++it)
@@ -1564,6 +1864,477 @@ cscript_function* cscript_compile_program(cscript_context* ctxt, cscript_program
     compile_statement(ctxt, &state, it);
     }
   fun->result_position = state.freereg;
+  fun->frame_size = compute_frame_size(fun, state.max_freereg);
+  cscript_vector_destroy(ctxt, &locals);
   cscript_environment_pop_child(ctxt);
   return fun;
-  }
\ No newline at end of file
+  }
+/*
+Single pass compilation of scripts that consist of parameters and one expression, such as "(float x) x*x + 3*x;".
+Code is emitted while the spans are parsed, with the register layout of compile_expression, so no syntax tree is
+built and none of the preprocessing passes run. Literals are kept as pending constants until they are needed in a
+register, so that an operation on two literals can be folded. Scripts outside this subset, including scripts with
+errors, are rejected without changing ctxt, and should be compiled by the full pipeline instead.
+*/
+
+typedef struct fast_operand
+  {
+  int is_constant; // the value is not in a register yet
+  int typeinfo; // cscript_reg_typeinfo_fixnum or cscript_reg_typeinfo_flonum
+  cscript_fixnum fx;
+  cscript_flonum fl;
+  } fast_operand;
+
+typedef struct fast_parameter
+  {
+  const cscript_token_span* name;
+  int typeinfo;
+  } fast_parameter;
+
+typedef struct fast_compiler
+  {
+  cscript_context* ctxt;
+  const char* script;
+  const cscript_token_span* it;
+  const cscript_token_span* it_end;
+  cscript_vector parameters; // vector of type fast_parameter
+  compiler_state state;
+  int constant_folding;
+  int failed;
+  } fast_compiler;
+
+static int fast_type(fast_compiler* fc)
+  {
+  return fc->it != fc->it_end ? fc->it->type : -1;
+  }
+
+static int fast_accept(fast_compiler* fc, int type)
+  {
+  if (fast_type(fc) != type)
+    return 0;
+  ++fc->it;
+  return 1;
+  }
+
+// copies the text of the span into buffer, as the maps and number conversions expect null terminated strings
+static int fast_span_copy(fast_compiler* fc, const cscript_token_span* span, char* buffer)
+  {
+  if (span->length >= CSCRIPT_FAST_COMPILE_MAX_NAME)
+    {
+    fc->failed = 1;
+    return 0;
+    }
+  memcpy(buffer, fc->script + span->offset, span->length);
+  buffer[span->length] = 0;
+  return 1;
+  }
+
+static fast_operand fast_register(int typeinfo)
+  {
+  fast_operand op;
+  op.is_constant = 0;
+  op.typeinfo = typeinfo;
+  op.fx = 0;
+  op.fl = 0;
+  return op;
+  }
+
+static void fast_load(fast_compiler* fc, fast_operand* op, int reg)
+  {
+  if (op->is_constant == 0)
+    return;
+  op->is_constant = 0;
+  cscript_object obj;
+  if (op->typeinfo == cscript_reg_typeinfo_fixnum)
+    {
+    if (op->fx <= CSCRIPT_MAXARG_sBx && op->fx >= -CSCRIPT_MAXARG_sBx)
+      {
+      make_code_asbx(fc->ctxt, fc->state.fun, CSCRIPT_OPCODE_SETFIXNUM, reg, cast(int, op->fx));
+      return;
+      }
+    obj = make_cscript_object_fixnum(op->fx);
+    }
+  else
+    {
+    obj = make_cscript_object_flonum(op->fl);
+    }
+  make_code_abx(fc->ctxt, fc->state.fun, CSCRIPT_OPCODE_LOADK, reg, get_k(fc->ctxt, fc->state.fun, &obj));
+  }
+
+static void fast_to_flonum(fast_compiler* fc, fast_operand* op, int reg)
+  {
+  if (op->typeinfo == cscript_reg_typeinfo_flonum)
+    return;
+  if (op->is_constant)
+    op->fl = cast(cscript_flonum, op->fx);
+  else
+    make_code_ab(fc->ctxt, fc->state.fun, CSCRIPT_OPCODE_CAST, reg, cscript_number_type_flonum);
+  op->typeinfo = cscript_reg_typeinfo_flonum;
+  }
+
+static int fast_primitive(int op, int typeinfo)
+  {
+  const int fl = typeinfo == cscript_reg_typeinfo_flonum ? 1 : 0;
+  switch (op)
+    {
+    case cscript_op_mul: return fl ? CSCRIPT_MUL_FLONUM : CSCRIPT_MUL_FIXNUM;
+    case cscript_op_div: return fl ? CSCRIPT_DIV_FLONUM : CSCRIPT_DIV_FIXNUM;
+    case cscript_op_percent: return fl ? CSCRIPT_MOD_FLONUM : CSCRIPT_MOD_FIXNUM;
+    case cscript_op_plus: return fl ? CSCRIPT_ADD_FLONUM : CSCRIPT_ADD_FIXNUM;
+    case cscript_op_minus: return fl ? CSCRIPT_SUB_FLONUM : CSCRIPT_SUB_FIXNUM;
+    case cscript_op_less: return fl ? CSCRIPT_LESS_FLONUM : CSCRIPT_LESS_FIXNUM;
+    case cscript_op_leq: return fl ? CSCRIPT_LEQ_FLONUM : CSCRIPT_LEQ_FIXNUM;
+    case cscript_op_greater: return fl ? CSCRIPT_GREATER_FLONUM : CSCRIPT_GREATER_FIXNUM;
+    case cscript_op_geq: return fl ? CSCRIPT_GEQ_FLONUM : CSCRIPT_GEQ_FIXNUM;
+    case cscript_op_equal: return fl ? CSCRIPT_EQUAL_FLONUM : CSCRIPT_EQUAL_FIXNUM;
+    default: return fl ? CSCRIPT_NOT_EQUAL_FLONUM : CSCRIPT_NOT_EQUAL_FIXNUM;
+    }
+  }
+
+// folds a op b into a if both are constants of the same type, only for the operations that cannot fail
+static int fast_fold(fast_operand* a, const fast_operand* b, int op)
+  {
+  if (a->is_constant == 0 || b->is_constant == 0)
+    return 0;
+  if (a->typeinfo == cscript_reg_typeinfo_fixnum)
+    {
+    switch (op)
+      {
+      case cscript_op_mul: a->fx *= b->fx; return 1;
+      case cscript_op_plus: a->fx += b->fx; return 1;
+      case cscript_op_minus: a->fx -= b->fx; return 1;
+      default: return 0;
+      }
+    }
+  switch (op)
+    {
+    case cscript_op_mul: a->fl *= b->fl; return 1;
+    case cscript_op_div: a->fl /= b->fl; return 1;
+    case cscript_op_plus: a->fl += b->fl; return 1;
+    case cscript_op_minus: a->fl -= b->fl; return 1;
+    default: return 0;
+    }
+  }
+
+// a is in register freereg, b in register freereg + 1, the result goes to freereg
+static void fast_binary(fast_compiler* fc, fast_operand* a, fast_operand* b, int freereg, int op)
+  {
+  if (a->typeinfo != b->typeinfo)
+    {
+    fast_to_flonum(fc, a, freereg);
+    fast_to_flonum(fc, b, freereg + 1);
+    }
+  if (fc->constant_folding && fast_fold(a, b, op))
+    return;
+  fast_load(fc, a, freereg);
+  fast_load(fc, b, freereg + 1);
+  make_code_ab(fc->ctxt, fc->state.fun, CSCRIPT_OPCODE_CALLPRIM, freereg, fast_primitive(op, a->typeinfo));
+  if (op >= cscript_op_less)
+    a->typeinfo = cscript_reg_typeinfo_fixnum;
+  }
+
+static fast_operand fast_operation(fast_compiler* fc, int level);
+
+static fast_operand fast_call(fast_compiler* fc)
+  {
+  fast_operand result = fast_register(cscript_reg_typeinfo_flonum);
+  char name[CSCRIPT_FAST_COMPILE_MAX_NAME];
+  if (!fast_span_copy(fc, fc->it, name))
+    return result;
+  fc->it += 2; // name and (
+  cscript_string s;
+  s.string_ptr = name;
+  s.string_length = strlen(name);
+  s.string_capacity = s.string_length + 1;
+  cscript_object* primitive = find_primitive(fc->ctxt, &s);
+  cscript_external_function* external_fun = NULL;
+  cscript_fixnum position = 0;
+  if (primitive == NULL)
+    {
+    cscript_object key;
+    key.type = cscript_object_type_string;
+    key.value.s = s;
+    cscript_object* pos = cscript_map_get(fc->ctxt, fc->ctxt->externals_map, &key);
+    if (pos == NULL)
+      {
+      fc->failed = 1;
+      return result;
+      }
+    position = pos->value.fx;
+    external_fun = cscript_vector_at(&fc->ctxt->externals, position, cscript_external_function);
+    if (external_fun->return_type != cscript_foreign_flonum && external_fun->return_type != cscript_foreign_fixnum)
+      {
+      fc->failed = 1;
+      return result;
+      }
+    }
+  const int freereg = fc->state.freereg;
+  int number_of_arguments = 0;
+  if (fast_type(fc) != CSCRIPT_T_RIGHT_ROUND_BRACKET)
+    {
+    do
+      {
+      fast_operand arg = fast_operation(fc, 0);
+      if (fc->failed)
+        return result;
+      if (primitive != NULL)
+        fast_to_flonum(fc, &arg, fc->state.freereg);
+      fast_load(fc, &arg, fc->state.freereg);
+      ++fc->state.freereg;
+      ++number_of_arguments;
+      } while (fast_accept(fc, CSCRIPT_T_COMMA));
+    }
+  fc->state.freereg = freereg;
+  if (!fast_accept(fc, CSCRIPT_T_RIGHT_ROUND_BRACKET))
+    {
+    fc->failed = 1;
+    return result;
+    }
+  if (primitive != NULL)
+    {
+    make_code_ab(fc->ctxt, fc->state.fun, CSCRIPT_OPCODE_CALLPRIM, freereg, cast(int, primitive->value.fx));
+    }
+  else
+    {
+    if (external_fun->return_type == cscript_foreign_fixnum)
+      result.typeinfo = cscript_reg_typeinfo_fixnum;
+    make_code_abc(fc->ctxt, fc->state.fun, CSCRIPT_OPCODE_CALLFOREIGN, freereg, cast(int, position), number_of_arguments);
+    }
+  return result;
+  }
+
+static fast_operand fast_variable(fast_compiler* fc)
+  {
+  fast_operand result = fast_register(cscript_reg_typeinfo_fixnum);
+  const cscript_token_span* name = fc->it++;
+  if (fast_type(fc) == CSCRIPT_T_LEFT_SQUARE_BRACKET)
+    {
+    fc->failed = 1;
+    return result;
+    }
+  if (fc->script[name->offset] == '$')
+    {
+    char buffer[CSCRIPT_FAST_COMPILE_MAX_NAME];
+    if (!fast_span_copy(fc, name, buffer))
+      return result;
+    cscript_string s;
+    s.string_ptr = buffer;
+    s.string_length = strlen(buffer);
+    s.string_capacity = s.string_length + 1;
+    cscript_environment_entry entry;
+    // undeclared globals are declared by the full pipeline
+    if (!cscript_environment_find_recursive(&entry, fc->ctxt, &s) || entry.type != CSCRIPT_ENV_TYPE_GLOBAL || entry.register_type > cscript_reg_typeinfo_flonum)
+      {
+      fc->failed = 1;
+      return result;
+      }
+    make_code_abx(fc->ctxt, fc->state.fun, CSCRIPT_OPCODE_LOADGLOBAL, fc->state.freereg, cast(int, entry.position));
+    result.typeinfo = entry.register_type;
+    return result;
+    }
+  const fast_parameter* it = cscript_vector_begin(&fc->parameters, fast_parameter);
+  const fast_parameter* it_end = cscript_vector_end(&fc->parameters, fast_parameter);
+  for (; it != it_end; ++it)
+    {
+    if (it->name->length == name->length && memcmp(fc->script + it->name->offset, fc->script + name->offset, name->length) == 0)
+      {
+      const int position = cast(int, it - cscript_vector_begin(&fc->parameters, fast_parameter));
+      make_code_ab(fc->ctxt, fc->state.fun, CSCRIPT_OPCODE_MOVE, fc->state.freereg, position);
+      result.typeinfo = it->typeinfo;
+      return result;
+      }
+    }
+  fc->failed = 1;
+  return result;
+  }
+
+static fast_operand fast_factor(fast_compiler* fc)
+  {
+  int sign = '+';
+  if (fast_accept(fc, CSCRIPT_T_MINUS))
+    sign = '-';
+  else
+    fast_accept(fc, CSCRIPT_T_PLUS);
+  fast_operand f = fast_register(cscript_reg_typeinfo_fixnum);
+  char buffer[CSCRIPT_FAST_COMPILE_MAX_NAME];
+  switch (fast_type(fc))
+    {
+    case CSCRIPT_T_LEFT_ROUND_BRACKET:
+      ++fc->it;
+      f = fast_operation(fc, 0);
+      if (!fc->failed && !fast_accept(fc, CSCRIPT_T_RIGHT_ROUND_BRACKET))
+        fc->failed = 1;
+      break;
+    case CSCRIPT_T_FIXNUM:
+      if (fast_span_copy(fc, fc->it++, buffer))
+        {
+        f.is_constant = 1;
+        f.fx = cscript_to_fixnum(buffer);
+        }
+      break;
+    case CSCRIPT_T_FLONUM:
+      if (fast_span_copy(fc, fc->it++, buffer))
+        {
+        f.is_constant = 1;
+        f.typeinfo = cscript_reg_typeinfo_flonum;
+        f.fl = cscript_to_flonum(buffer);
+        }
+      break;
+    case CSCRIPT_T_ID:
+      if (fc->it + 1 != fc->it_end && (fc->it + 1)->type == CSCRIPT_T_LEFT_ROUND_BRACKET)
+        f = fast_call(fc);
+      else
+        f = fast_variable(fc);
+      break;
+    default:
+      fc->failed = 1;
+      break;
+    }
+  if (fc->failed || sign == '+')
+    return f;
+  if (f.is_constant)
+    {
+    f.fx = -f.fx;
+    f.fl = -f.fl;
+    }
+  else if (f.typeinfo == cscript_reg_typeinfo_fixnum)
+    {
+    make_code_asbx(fc->ctxt, fc->state.fun, CSCRIPT_OPCODE_SETFIXNUM, fc->state.freereg + 1, -1);
+    make_code_ab(fc->ctxt, fc->state.fun, CSCRIPT_OPCODE_CALLPRIM, fc->state.freereg, CSCRIPT_MUL_FIXNUM);
+    }
+  else
+    {
+    make_code_asbx(fc->ctxt, fc->state.fun, CSCRIPT_OPCODE_SETFIXNUM, fc->state.freereg + 1, -1);
+    make_code_ab(fc->ctxt, fc->state.fun, CSCRIPT_OPCODE_CAST, fc->state.freereg + 1, cscript_number_type_flonum);
+    make_code_ab(fc->ctxt, fc->state.fun, CSCRIPT_OPCODE_CALLPRIM, fc->state.freereg, CSCRIPT_MUL_FLONUM);
+    }
+  return f;
+  }
+
+static int fast_operator(int token_type, int level)
+  {
+  switch (level)
+    {
+    case 0: // the operators of cscript_parsed_expression
+      switch (token_type)
+        {
+        case CSCRIPT_T_RELATIVE_LESS: return cscript_op_less;
+        case CSCRIPT_T_RELATIVE_LEQ: return cscript_op_leq;
+        case CSCRIPT_T_RELATIVE_GREATER: return cscript_op_greater;
+        case CSCRIPT_T_RELATIVE_GEQ: return cscript_op_geq;
+        case CSCRIPT_T_RELATIVE_EQUAL: return cscript_op_equal;
+        case CSCRIPT_T_RELATIVE_NOTEQUAL: return cscript_op_not_equal;
+        default: return -1;
+        }
+    case 1: // the operators of cscript_parsed_relop
+      switch (token_type)
+        {
+        case CSCRIPT_T_PLUS: return cscript_op_plus;
+        case CSCRIPT_T_MINUS: return cscript_op_minus;
+        default: return -1;
+        }
+    default: // the operators of cscript_parsed_term
+      switch (token_type)
+        {
+        case CSCRIPT_T_MUL: return cscript_op_mul;
+        case CSCRIPT_T_DIV: return cscript_op_div;
+        case CSCRIPT_T_PERCENT: return cscript_op_percent;
+        default: return -1;
+        }
+    }
+  }
+
+// level 0 parses an expression, level 1 a relop and level 2 a term, with the same precedence as the parser
+static fast_operand fast_operation(fast_compiler* fc, int level)
+  {
+  const int freereg = fc->state.freereg;
+  fast_operand a = level < 2 ? fast_operation(fc, level + 1) : fast_factor(fc);
+  while (!fc->failed)
+    {
+    const int op = fast_operator(fast_type(fc), level);
+    if (op < 0)
+      break;
+    ++fc->it;
+    fc->state.freereg = freereg + 1;
+    fast_operand b = level < 2 ? fast_operation(fc, level + 1) : fast_factor(fc);
+    if (fc->failed)
+      break;
+    fast_binary(fc, &a, &b, freereg, op);
+    }
+  fc->state.freereg = freereg;
+  return a;
+  }
+
+static void fast_parameters(fast_compiler* fc)
+  {
+  if (fast_type(fc) != CSCRIPT_T_LEFT_ROUND_BRACKET || fc->it + 1 == fc->it_end)
+    return;
+  if ((fc->it + 1)->type == CSCRIPT_T_RIGHT_ROUND_BRACKET)
+    {
+    fc->it += 2;
+    return;
+    }
+  const int first_type = (fc->it + 1)->type;
+  if (first_type != CSCRIPT_T_KEYWORD_INT && first_type != CSCRIPT_T_KEYWORD_FLOAT && first_type != CSCRIPT_T_ID)
+    return; // an expression between brackets
+  ++fc->it;
+  do
+    {
+    fast_parameter p;
+    if (fast_accept(fc, CSCRIPT_T_KEYWORD_INT))
+      p.typeinfo = cscript_reg_typeinfo_fixnum;
+    else if (fast_accept(fc, CSCRIPT_T_KEYWORD_FLOAT))
+      p.typeinfo = cscript_reg_typeinfo_flonum;
+    else
+      break;
+    if (fast_type(fc) != CSCRIPT_T_ID || fc->script[fc->it->offset] == '$')
+      break;
+    p.name = fc->it++;
+    const fast_parameter* it = cscript_vector_begin(&fc->parameters, fast_parameter);
+    const fast_parameter* it_end = cscript_vector_end(&fc->parameters, fast_parameter);
+    for (; it != it_end; ++it)
+      {
+      if (it->name->length == p.name->length && memcmp(fc->script + it->name->offset, fc->script + p.name->offset, p.name->length) == 0)
+        break;
+      }
+    if (it != it_end)
+      break;
+    cscript_vector_push_back(fc->ctxt, &fc->parameters, p, fast_parameter);
+    if (fast_accept(fc, CSCRIPT_T_RIGHT_ROUND_BRACKET))
+      return;
+    } while (fast_accept(fc, CSCRIPT_T_COMMA));
+  // pointers, invalid declarations and repeated names are left to the full pipeline
+  fc->failed = 1;
+  }
+
+cscript_function* cscript_compile_fast(cscript_context* ctxt, const char* script, const cscript_vector* spans, int constant_folding)
+  {
+  fast_compiler fc;
+  fc.ctxt = ctxt;
+  fc.script = script;
+  fc.it = cscript_vector_begin(spans, cscript_token_span);
+  fc.it_end = cscript_vector_end(spans, cscript_token_span);
+  fc.constant_folding = constant_folding;
+  fc.failed = 0;
+  cscript_vector_init(ctxt, &fc.parameters, fast_parameter);
+  fast_parameters(&fc);
+  cscript_function* fun = cscript_function_new(ctxt);
+  fc.state = init_compiler_state(cast(int, fc.parameters.vector_size), cscript_reg_typeinfo_fixnum, fun);
+  fast_operand result = fast_register(cscript_reg_typeinfo_fixnum);
+  if (fc.failed == 0 && fc.it != fc.it_end)
+    result = fast_operation(&fc, 0);
+  else
+    fc.failed = 1;
+  if (fc.failed == 0 && (!fast_accept(&fc, CSCRIPT_T_SEMICOLON) || fc.it != fc.it_end))
+    fc.failed = 1;
+  cscript_vector_destroy(ctxt, &fc.parameters);
+  if (fc.failed)
+    {
+    cscript_function_free(ctxt, fun);
+    return NULL;
+    }
+  fast_load(&fc, &result, fc.state.freereg);
+  fun->result_position = fc.state.freereg;
+  fun->frame_size = compute_frame_size(fun, fc.state.max_freereg);
+  return fun;
+  }
@@ -3,8 +3,37 @@
 
 #include "func.h"
 #include "parser.h"
+#include "token.h"
 #include "vector.h"
 
 CSCRIPT_API cscript_function* cscript_compile_program(cscript_context* ctxt, cscript_program* prog);
 
+// a global variable declared by a compilation, logged if the context has a declaration_log
+typedef struct cscript_global_declaration
+  {
+  cscript_string name;
+  cscript_fixnum position;
+  int register_type;
+  int implicit; // declared by its first use, which only happens if no global variable of that name exists
+  } cscript_global_declaration;
+
+/*
+Compiles scripts that consist of parameters and a single expression in one pass over the spans (see
+cscript_script2spans), without building a syntax tree. If constant_folding is set, as with
+cscript_compile_options.constant_folding, operations on two literals are folded; no other optimization is done.
+Returns NULL, without reporting errors, if the script is not of this form or does not compile;
+such scripts should go through the full pipeline.
+*/
+CSCRIPT_API cscript_function* cscript_compile_fast(cscript_context* ctxt, const char* script, const cscript_vector* spans, int constant_folding);
+
+// default of cscript_compile_options.fast_compile_max_length
+#ifndef CSCRIPT_FAST_COMPILE_MAX_LENGTH
+#define CSCRIPT_FAST_COMPILE_MAX_LENGTH 256
+#endif
+
+// longest name or number that the fast path handles
+#ifndef CSCRIPT_FAST_COMPILE_MAX_NAME
+#define CSCRIPT_FAST_COMPILE_MAX_NAME 256
+#endif
+
 #endif //CSCRIPT_COMPILER_H
\ No newline at end of file
@@ -12,11 +12,6 @@
 #include <math.h>
 #include <string.h>
 
-typedef struct cscript_constant_folding_visitor
-  {
-  cscript_visitor* visitor;
-  } cscript_constant_folding_visitor;
-
 static cscript_object* find_primitive(cscript_context* ctxt, cscript_string* s)
   {
   cscript_object key;
@@ -295,7 +290,7 @@ static void postvisit_statement(cscript_context* ctxt, cscript_visitor* v, cscri
     }
   }
 
-static cscript_constant_folding_visitor* cscript_constant_folding_visitor_new(cscript_context* ctxt)
+cscript_constant_folding_visitor* cscript_constant_folding_visitor_new(cscript_context* ctxt)
   {
   cscript_constant_folding_visitor* v = cscript_new(ctxt, cscript_constant_folding_visitor);
   v->visitor = cscript_visitor_new(ctxt, v);
@@ -307,7 +302,7 @@ static cscript_constant_folding_visitor* cscript_constant_folding_visitor_new(cs
   return v;
   }
 
-static void cscript_constant_folding_visitor_free(cscript_context* ctxt, cscript_constant_folding_visitor* v)
+void cscript_constant_folding_visitor_free(cscript_context* ctxt, cscript_constant_folding_visitor* v)
   {
   if (v)
     {
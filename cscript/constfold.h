@@ -3,6 +3,16 @@
 
 #include "cscript.h"
 #include "parser.h"
+#include "visitor.h"
+
+// folds bottom-up, in postvisit callbacks only, so that it can be fused with other passes (see cscript_fused_visitor)
+typedef struct cscript_constant_folding_visitor
+  {
+  cscript_visitor* visitor;
+  } cscript_constant_folding_visitor;
+
+cscript_constant_folding_visitor* cscript_constant_folding_visitor_new(cscript_context* ctxt);
+void cscript_constant_folding_visitor_free(cscript_context* ctxt, cscript_constant_folding_visitor* v);
 
 void cscript_constant_folding(cscript_context* ctxt, cscript_program* program);
 
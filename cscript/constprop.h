@@ -3,6 +3,25 @@
 
 #include "cscript.h"
 #include "parser.h"
+#include "visitor.h"
+
+/*
+Constant propagation replaces the local variables that are declared once, without dimensions, and never assigned
+to, by the constant value of their declaration. cscript_constant_propagation_visitor_new finds these variables with
+a traversal of the whole program. The visitor it returns then replaces their uses, and turns their declarations into
+nops, in a single traversal: a declaration is always visited before the uses of its variable, as alpha conversion
+gave every variable a unique symbol. The visitor only rewrites the nodes it is given, so it can be fused with
+constant folding (see cscript_fused_visitor).
+*/
+typedef struct cscript_constant_propagation_visitor
+  {
+  cscript_visitor* visitor;
+  cscript_vector is_unmutable; // vector of type int, indexed by symbol id
+  cscript_vector constants; // the value of the variables with a constant value, indexed by symbol id
+  } cscript_constant_propagation_visitor;
+
+cscript_constant_propagation_visitor* cscript_constant_propagation_visitor_new(cscript_context* ctxt, cscript_program* program);
+void cscript_constant_propagation_visitor_free(cscript_context* ctxt, cscript_constant_propagation_visitor* v);
 
 void cscript_constant_propagation(cscript_context* ctxt, cscript_program* program);
 
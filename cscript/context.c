@@ -4,19 +4,47 @@
 #include "environment.h"
 #include "primitives.h"
 #include "foreign.h"
+#include "report.h"
 #include <stddef.h>
+#include <string.h>
 
-static cscript_context* context_new(cscript_context* ctxt)
+// the context block is allocated outside of any arena, and is counted in its own statistics
+static cscript_context* context_new(const cscript_allocator* allocator, cscript_context* parent)
   {
-  cscript_byte* block = (cscript_byte*)cscript_malloc(ctxt, sizeof(cscript_context));
+  cscript_byte* block = (cscript_byte*)allocator->reallocate(allocator->user_data, NULL, 0, sizeof(cscript_context));
   if (block == NULL)
     return NULL;
-  else
-    return cast(cscript_context*, block);
+  cscript_context* ctxt = cast(cscript_context*, block);
+  ctxt->error_jmp = NULL;
+  ctxt->arena = NULL;
+  ctxt->recorder = NULL;
+  ctxt->allocator = *allocator;
+  memset(&ctxt->memory, 0, sizeof(cscript_memory_stats));
+  ctxt->memory_category = cscript_memory_other;
+  ctxt->parent = parent;
+  ctxt->memory_limit = parent != NULL ? parent->memory_limit : 0;
+  ctxt->memory_limit_request = 0;
+  ctxt->batch_contexts = NULL;
+  ctxt->next_idle = NULL;
+  ctxt->declaration_log = NULL;
+  cscript_memory_count(ctxt, 0, sizeof(cscript_context));
+  ctxt->memory.category_bytes[cscript_memory_other] += sizeof(cscript_context);
+  return ctxt;
+  }
+
+// the worker contexts use the global state, so they are freed before it
+static void free_batch_contexts(cscript_context* ctxt)
+  {
+  if (ctxt->batch_contexts != NULL)
+    {
+    cscript_context_pool_free(ctxt->batch_contexts);
+    ctxt->batch_contexts = NULL;
+    }
   }
 
 static void context_free(cscript_context* ctxt)
   {  
+  free_batch_contexts(ctxt);
   cscript_syntax_errors_clear(ctxt);
   cscript_compile_errors_clear(ctxt);
   cscript_runtime_errors_clear(ctxt);
@@ -41,13 +69,17 @@ static void context_free(cscript_context* ctxt)
     cscript_external_function_destroy(ctxt, fit);
     }
   cscript_vector_destroy(ctxt, &ctxt->externals);
-  cscript_free(ctxt, ctxt, sizeof(cscript_context));
+  cscript_compile_recorder_free(ctxt);
+  cscript_memory_count(ctxt, sizeof(cscript_context), 0);
+  if (ctxt->parent != NULL)
+    cscript_memory_stats_merge(&ctxt->parent->memory, &ctxt->memory);
+  const cscript_allocator allocator = ctxt->allocator;
+  allocator.reallocate(allocator.user_data, ctxt, sizeof(cscript_context), 0);
   }
 
 static void context_init(cscript_context* ctxt, cscript_memsize stack_size)
   {
   cscript_assert(ctxt->global != NULL);  
-  ctxt->error_jmp = NULL;
   ctxt->number_of_syntax_errors = 0;
   ctxt->number_of_compile_errors = 0;
   ctxt->number_of_runtime_errors = 0;
@@ -63,13 +95,24 @@ static void context_init(cscript_context* ctxt, cscript_memsize stack_size)
   }
 
 cscript_context* cscript_open(cscript_memsize stack_size)
+  {
+  return cscript_open_ex(stack_size, NULL);
+  }
+
+cscript_context* cscript_open_ex(cscript_memsize stack_size, const cscript_allocator* allocator)
   {
   cscript_assert(sizeof(cscript_fixnum) == sizeof(cscript_flonum));
   cscript_assert(sizeof(cscript_fixnum) == sizeof(void*));
-  cscript_context* ctxt = context_new(NULL);
+  cscript_allocator default_allocator;
+  if (allocator == NULL)
+    {
+    cscript_default_allocator(&default_allocator);
+    allocator = &default_allocator;
+    }
+  cscript_context* ctxt = context_new(allocator, NULL);
   if (ctxt)
     {
-    cscript_global_context* g = cscript_new(NULL, cscript_global_context);
+    cscript_global_context* g = cscript_new(ctxt, cscript_global_context);
     ctxt->global = g;
     get_key(g->dummy_node)->type = cscript_object_type_undefined;
     get_value(g->dummy_node)->type = cscript_object_type_undefined;
@@ -84,6 +127,7 @@ cscript_context* cscript_open(cscript_memsize stack_size)
 void cscript_close(cscript_context* ctxt)
   {
   ctxt = ctxt->global->main_context; 
+  free_batch_contexts(ctxt);
   cscript_map_keys_free(ctxt, ctxt->global->primitives_map);
   cscript_map_free(ctxt, ctxt->global->primitives_map);
   cscript_free(ctxt, ctxt->global, sizeof(cscript_global_context));
@@ -93,7 +137,7 @@ void cscript_close(cscript_context* ctxt)
 cscript_context* cscript_context_init(cscript_context* ctxt, cscript_memsize stack_size)
   {
   cscript_assert(ctxt->global != NULL);
-  cscript_context* ctxt_new = context_new(ctxt);
+  cscript_context* ctxt_new = context_new(&ctxt->allocator, ctxt);
   if (ctxt_new)
     {
     ctxt_new->global = ctxt->global;
@@ -108,3 +152,73 @@ void cscript_context_destroy(cscript_context* ctxt)
   cscript_assert(ctxt != ctxt->global->main_context);
   context_free(ctxt);
   }
+
+void cscript_get_memory_stats(cscript_context* ctxt, cscript_memory_stats* stats)
+  {
+  *stats = ctxt->memory;
+  }
+
+void cscript_set_memory_limit(cscript_context* ctxt, cscript_memsize limit)
+  {
+  ctxt->memory_limit = limit;
+  }
+
+static void register_missing_externals(cscript_context* shared_ctxt, cscript_context* ctxt)
+  {
+  cscript_external_function* it = cscript_vector_begin(&ctxt->externals, cscript_external_function) + shared_ctxt->externals.vector_size;
+  cscript_external_function* it_end = cscript_vector_end(&ctxt->externals, cscript_external_function);
+  for (; it < it_end; ++it)
+    cscript_register_external_function(shared_ctxt, it->name.string_ptr, it->address, it->return_type);
+  }
+
+static void copy_globals(cscript_context* shared_ctxt, cscript_context* ctxt)
+  {
+  if (shared_ctxt->globals.vector_capacity < ctxt->globals.vector_size)
+    {
+    cscript_vector_destroy(shared_ctxt, &shared_ctxt->globals);
+    cscript_vector_init_reserve(shared_ctxt, &shared_ctxt->globals, ctxt->globals.vector_size, cscript_fixnum);
+    }
+  memcpy(shared_ctxt->globals.vector_ptr, ctxt->globals.vector_ptr, ctxt->globals.vector_size * sizeof(cscript_fixnum));
+  shared_ctxt->globals.vector_size = ctxt->globals.vector_size;
+  }
+
+cscript_context* cscript_context_init_shared(cscript_context* ctxt, cscript_memsize stack_size)
+  {
+  cscript_context* shared_ctxt = cscript_context_init(ctxt, stack_size);
+  if (shared_ctxt)
+    {
+    register_missing_externals(shared_ctxt, ctxt);
+    copy_globals(shared_ctxt, ctxt);
+    }
+  return shared_ctxt;
+  }
+
+void cscript_context_reset_shared(cscript_context* shared_ctxt, cscript_context* ctxt)
+  {
+  if (shared_ctxt->syntax_error_reports.vector_size > 0 || shared_ctxt->number_of_syntax_errors > 0)
+    cscript_syntax_errors_clear(shared_ctxt);
+  if (shared_ctxt->compile_error_reports.vector_size > 0 || shared_ctxt->number_of_compile_errors > 0)
+    cscript_compile_errors_clear(shared_ctxt);
+  if (shared_ctxt->runtime_error_reports.vector_size > 0 || shared_ctxt->number_of_runtime_errors > 0)
+    cscript_runtime_errors_clear(shared_ctxt);
+  shared_ctxt->error_jmp = NULL;
+  if (shared_ctxt->externals.vector_size < ctxt->externals.vector_size)
+    register_missing_externals(shared_ctxt, ctxt);
+  copy_globals(shared_ctxt, ctxt);
+  }
+
+void cscript_context_copy_declarations(cscript_context* target, cscript_context* ctxt)
+  {
+  const cscript_memsize size = cscript_environment_base_size(ctxt);
+  for (cscript_memsize i = 0; i < size; ++i)
+    {
+    cscript_environment_entry entry;
+    cscript_string name;
+    if (cscript_environment_base_at(&entry, &name, ctxt, i) && entry.type == CSCRIPT_ENV_TYPE_GLOBAL)
+      {
+      cscript_string s;
+      cscript_string_copy(target, &s, &name);
+      cscript_environment_add_to_base(target, &s, entry);
+      }
+    }
+  }
@@ -41,6 +41,37 @@ struct cscript_context
   cscript_vector environment; // linked chain of environment maps
   cscript_vector externals;
   cscript_map* externals_map;
+  struct cscript_arena* arena; // allocator of the compilation in progress, NULL otherwise (see arena.h)
+  struct cscript_compile_recorder* recorder; // statistics of the compilations, NULL unless enabled (see report.h)
+  cscript_allocator allocator; // shared with the contexts created from this one
+  cscript_memory_stats memory;
+  cscript_memory_category memory_category; // of the allocations in progress, see cscript_memory_category_set
+  cscript_context* parent; // the context this one was created from, which receives its memory statistics when it is destroyed, NULL for the main context
+  cscript_memsize memory_limit; // of the compilations, 0 if there is no limit (see cscript_set_memory_limit)
+  cscript_memsize memory_limit_request; // size of the allocation that exceeded memory_limit, 0 if none did
+  cscript_context_pool* batch_contexts; // worker contexts of cscript_run_batch_parallel, NULL until it is first called
+  cscript_context* next_idle; // next context in the freelist of a context pool while this one is idle
+  cscript_vector* declaration_log; // of type cscript_global_declaration (see compiler.h), filled by the compiler if not NULL
   };
 
+/*
+Creates a context that shares the global state of ctxt, with the external functions of ctxt registered
+in the same order (so that the CALLFOREIGN instructions of functions compiled by ctxt stay valid) and
+a copy of the global variables of ctxt.
+*/
+cscript_context* cscript_context_init_shared(cscript_context* ctxt, cscript_memsize stack_size);
+
+/*
+Restores the run-time state of a context created by cscript_context_init_shared: the error reports are
+cleared, the global variables are copied again from ctxt, and external functions that were registered
+in ctxt afterwards are added.
+*/
+void cscript_context_reset_shared(cscript_context* shared_ctxt, cscript_context* ctxt);
+
+/*
+Declares the global variables of ctxt in target, with the same positions and types, so that target compiles
+scripts as ctxt would. Only the declarations are copied, the values are left unchanged.
+*/
+void cscript_context_copy_declarations(cscript_context* target, cscript_context* ctxt);
+
 #endif //CSCRIPT_CONTEXT_H
\ No newline at end of file
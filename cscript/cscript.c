@@ -7,44 +7,154 @@
 #include "error.h"
 #include "context.h"
 #include "environment.h"
+#include "foreign.h"
+#include "arena.h"
+#include "report.h"
+#include "memory.h"
+#include "syscalls.h"
 
 #include <string.h>
 
+void cscript_compile_options_init(cscript_compile_options* options, int optimization_level)
+  {
+  if (optimization_level < 0)
+    optimization_level = 0;
+  if (optimization_level > 3)
+    optimization_level = 3;
+  options->optimization_level = optimization_level;
+  options->constant_propagation = optimization_level > 0 ? 1 : 0;
+  options->constant_folding = optimization_level > 0 ? 1 : 0;
+  options->remove_dead_variables = optimization_level > 1 ? 1 : 0;
+  options->optimization_rounds = optimization_level == 0 ? 0 : (optimization_level == 1 ? 1 : (optimization_level == 2 ? 2 : 4));
+  options->fast_math = 0;
+  options->time_budget = 0;
+  options->fast_compile_max_length = CSCRIPT_FAST_COMPILE_MAX_LENGTH;
+  }
+
 cscript_function* cscript_compile(cscript_context* ctxt, const char* script)
   {
-  cscript_syntax_errors_clear(ctxt);
-  cscript_compile_errors_clear(ctxt);
-  cscript_runtime_errors_clear(ctxt);
-  assert(cscript_context_is_error_free(ctxt) != 0);
-  cscript_vector tokens = cscript_script2tokens(ctxt, script);
-  if (cscript_context_is_error_free(ctxt) == 0)
+  return cscript_compile_ex(ctxt, script, NULL);
+  }
+
+typedef struct compile_call
+  {
+  const char* script;
+  const cscript_compile_options* options;
+  cscript_function* fun; // result, NULL until the compilation succeeded
+  } compile_call;
+
+// code is generated in the arena, so that an aborted compilation leaves nothing behind, and copied out once it is complete
+static cscript_function* keep_function(cscript_context* ctxt, const cscript_function* fun)
+  {
+  cscript_memory_limit_check(ctxt, cscript_function_memory_size(fun));
+  cscript_arena_suspend(ctxt);
+  cscript_function* result = cscript_function_copy(ctxt, fun);
+  cscript_arena_resume(ctxt);
+  return result;
+  }
+
+static void compile_script(cscript_context* ctxt, void* data)
+  {
+  compile_call* call = cast(compile_call*, data);
+  const char* script = call->script;
+  const cscript_compile_options* options = call->options;
+  cscript_compile_phase_begin(ctxt, cscript_compile_phase_tokenize);
+  cscript_vector spans = cscript_script2spans(ctxt, script);
+  cscript_compile_phase_end(ctxt);
+  cscript_compile_report_tokens(ctxt, spans.vector_size);
+  // the fast path does not reassociate, so it is skipped when fast_math asks for it
+  if (options->fast_math == 0 && options->fast_compile_max_length > 0 && strlen(script) <= options->fast_compile_max_length)
     {
-    destroy_tokens_vector(ctxt, &tokens);
-    return NULL;
+    cscript_compile_phase_begin(ctxt, cscript_compile_phase_single_pass);
+    cscript_function* fun = cscript_compile_fast(ctxt, script, &spans, options->constant_folding);
+    cscript_compile_phase_end(ctxt);
+    if (fun != NULL)
+      {
+      call->fun = keep_function(ctxt, fun);
+      cscript_compile_report_fast_path(ctxt);
+      return;
+      }
     }
-  cscript_program prog = make_program(ctxt, &tokens);
+  cscript_compile_phase_begin(ctxt, cscript_compile_phase_tokenize);
+  cscript_vector tokens = cscript_spans2tokens(ctxt, script, &spans);
+  cscript_compile_phase_end(ctxt);
   if (cscript_context_is_error_free(ctxt) == 0)
+    return;
+  cscript_compile_phase_begin(ctxt, cscript_compile_phase_parse);
+  cscript_program prog = make_program(ctxt, &tokens);
+  cscript_compile_phase_end(ctxt);
+  if (cscript_context_is_error_free(ctxt) != 0)
     {
-    destroy_tokens_vector(ctxt, &tokens);
-    cscript_program_destroy(ctxt, &prog);
-    return NULL;
+    cscript_compile_report_nodes(ctxt, &prog, 0);
+    cscript_preprocess_ex(ctxt, &prog, options);
+    cscript_compile_report_nodes(ctxt, &prog, 1);
     }
-  cscript_preprocess(ctxt, &prog);
   if (cscript_context_is_error_free(ctxt) == 0)
+    return;
+  cscript_compile_phase_begin(ctxt, cscript_compile_phase_code_generation);
+  cscript_function* fun = cscript_compile_program(ctxt, &prog);
+  cscript_compile_phase_end(ctxt);
+  if (cscript_context_is_error_free(ctxt) != 0)
+    call->fun = keep_function(ctxt, fun);
+  }
+
+static void report_aborted_compilation(cscript_context* ctxt, int errorcode, int64_t bytes_in_use)
+  {
+  char number[256];
+  cscript_string msg;
+  cscript_fixnum_to_char(number, cast(cscript_fixnum, bytes_in_use));
+  cscript_string_init(ctxt, &msg, number);
+  cscript_string_append_cstr(ctxt, &msg, " bytes in use");
+  if (ctxt->memory_limit_request > 0)
     {
-    destroy_tokens_vector(ctxt, &tokens);
-    cscript_program_destroy(ctxt, &prog);
-    return NULL;
+    cscript_string_append_cstr(ctxt, &msg, ", ");
+    cscript_fixnum_to_char(number, cast(cscript_fixnum, ctxt->memory_limit_request));
+    cscript_string_append_cstr(ctxt, &msg, number);
+    cscript_string_append_cstr(ctxt, &msg, " more requested, limit ");
+    cscript_fixnum_to_char(number, cast(cscript_fixnum, ctxt->memory_limit));
+    cscript_string_append_cstr(ctxt, &msg, number);
     }
-  cscript_function* fun = cscript_compile_program(ctxt, &prog);
-  destroy_tokens_vector(ctxt, &tokens);
-  cscript_program_destroy(ctxt, &prog);
-  if (cscript_context_is_error_free(ctxt) == 0)
+  cscript_compile_error(ctxt, errorcode, -1, -1, NULL, &msg);
+  }
+
+cscript_function* cscript_compile_ex(cscript_context* ctxt, const char* script, const cscript_compile_options* options)
+  {
+  cscript_compile_options default_options;
+  if (options == NULL)
     {
-    cscript_function_free(ctxt, fun);
-    return NULL;
+    cscript_compile_options_init(&default_options, 2);
+    options = &default_options;
     }
-  return fun;
+  cscript_syntax_errors_clear(ctxt);
+  cscript_compile_errors_clear(ctxt);
+  cscript_runtime_errors_clear(ctxt);
+  assert(cscript_context_is_error_free(ctxt) != 0);
+  cscript_compile_report_begin(ctxt);
+  ctxt->memory_limit_request = 0;
+  // tokens, syntax tree, code and pass-local data live in the arena and are released at once, without visiting the tree
+  cscript_arena arena;
+  cscript_arena_init(&arena, ctxt);
+  ctxt->arena = &arena;
+  const cscript_memsize environment_size = ctxt->environment.vector_size;
+  compile_call call;
+  call.script = script;
+  call.options = options;
+  call.fun = NULL;
+  const int status = cscript_run_protected(ctxt, compile_script, &call);
+  int64_t bytes_in_use = 0;
+  if (status != 0)
+    {
+    // the scopes that were still open are maps in the arena
+    cscript_compile_phase_end(ctxt);
+    ctxt->environment.vector_size = environment_size;
+    bytes_in_use = ctxt->memory.live_bytes;
+    }
+  ctxt->arena = NULL;
+  cscript_arena_destroy(&arena);
+  if (status != 0)
+    report_aborted_compilation(ctxt, status, bytes_in_use);
+  cscript_compile_report_end(ctxt);
+  return call.fun;
   }
 
 void cscript_get_error_message(cscript_context* ctxt, char* buffer, cscript_memsize buffer_size)
@@ -133,4 +243,17 @@ int cscript_set_global_fixnum_value(cscript_context* ctxt, const char* global_na
     }
   cscript_string_destroy(ctxt, &name);
   return 1;
-  }
\ No newline at end of file
+  }
+
+cscript_externals cscript_get_externals(cscript_context* ctxt)
+  {
+  cscript_externals externals;
+  externals.functions = cscript_vector_begin(&ctxt->externals, cscript_external_function);
+  externals.globals = cscript_vector_begin(&ctxt->globals, cscript_fixnum);
+  return externals;
+  }
+
+cscript_memsize cscript_get_number_of_globals(cscript_context* ctxt)
+  {
+  return ctxt->globals.vector_size;
+  }
@@ -5,6 +5,10 @@
 
 typedef struct cscript_context cscript_context;
 typedef struct cscript_function cscript_function;
+typedef struct cscript_external_function cscript_external_function;
+typedef struct cscript_context_pool cscript_context_pool;
+typedef struct cscript_compile_cache cscript_compile_cache;
+typedef struct cscript_bundle cscript_bundle;
 
 #ifndef CSCRIPT_FLONUM
 typedef double cscript_flonum;
@@ -35,26 +39,328 @@ typedef enum cscript_foreign_return_type
   cscript_foreign_void
   } cscript_foreign_return_type;
 
+// the external functions and global variables a function is executed with, see cscript_run_frame
+typedef struct cscript_externals
+  {
+  const cscript_external_function* functions; // indexed in the order of registration in the compiling context
+  cscript_fixnum* globals; // indexed in the order of declaration in the compiling context
+  } cscript_externals;
+
+typedef enum cscript_run_status
+  {
+  cscript_run_finished,
+  cscript_run_suspended
+  } cscript_run_status;
+
+// execution state of cscript_run_slice, initialize with cscript_run_state_init
+typedef struct cscript_run_state
+  {
+  cscript_memsize pc; // offset of the next instruction
+  cscript_run_status status;
+  cscript_fixnum* result; // result of the function once status is cscript_run_finished, NULL otherwise
+  } cscript_run_state;
+
+typedef struct cscript_compile_options
+  {
+  int optimization_level; // 0 to 3, see cscript_compile_options_init
+  int constant_propagation;
+  int constant_folding;
+  int remove_dead_variables;
+  int optimization_rounds; // number of times constant propagation and folding are repeated
+  int fast_math; // allows floating point transformations that are not bit exact, such as reassociation of sums and products
+  cscript_memsize time_budget; // compile time budget in milliseconds of wall time for the optional passes, 0 means no budget
+  cscript_memsize fast_compile_max_length; // scripts up to this many characters that are a single expression are compiled in one pass unless fast_math is set, 0 disables the fast path
+  } cscript_compile_options;
+
+typedef enum cscript_compile_phase
+  {
+  cscript_compile_phase_tokenize, // cscript_script2tokens
+  cscript_compile_phase_parse, // make_program
+  cscript_compile_phase_alpha_conversion,
+  cscript_compile_phase_constant_propagation, // finding the variables with a constant value, all rounds together
+  cscript_compile_phase_constant_folding, // one traversal per round that substitutes these constants, reassociates with fast_math, and folds
+  cscript_compile_phase_remove_dead_variables,
+  cscript_compile_phase_code_generation, // cscript_compile_program
+  cscript_compile_phase_single_pass, // the fast path, also timed when the script turns out not to be supported
+  cscript_number_of_compile_phases
+  } cscript_compile_phase;
+
+typedef struct cscript_compile_phase_stats
+  {
+  double time; // wall time in milliseconds
+  cscript_memsize number_of_runs; // 0 if the phase was skipped
+  cscript_memsize number_of_allocations; // blocks allocated or grown, frees are not counted
+  cscript_memsize allocated_bytes; // bytes added by these allocations
+  } cscript_compile_phase_stats;
+
+// statistics of one compilation, see cscript_compile_report_enable
+typedef struct cscript_compile_report
+  {
+  cscript_compile_phase_stats phases[cscript_number_of_compile_phases];
+  double time; // wall time in milliseconds of the whole compilation
+  cscript_memsize number_of_tokens;
+  cscript_memsize number_of_nodes; // statements, expressions, relations, terms and factors of the syntax tree after parsing
+  cscript_memsize number_of_optimized_nodes; // the same after the optimization passes
+  int fast_path; // 1 if the script was compiled by the fast path
+  } cscript_compile_report;
+
+/*
+An allocator has the same contract as realloc: reallocate(user_data, NULL, 0, size) allocates a block, and
+reallocate(user_data, chunk, old_size, 0) frees it and returns NULL. It returns NULL if out of memory. Blocks
+should be aligned for any type, as the blocks of malloc are. A context and the contexts created from it (see
+cscript_context_init, cscript_context_pool_new, cscript_compile_cache_new and cscript_compile_batch_ex) share
+the allocator, so it is called from every thread that uses one of these contexts. Only the worker pool and the
+worker frames of parallel for loops, which run without a context, are allocated with the default allocator.
+*/
+typedef struct cscript_allocator
+  {
+  void* (*reallocate)(void* user_data, void* chunk, cscript_memsize old_size, cscript_memsize new_size);
+  void* user_data;
+  } cscript_allocator;
+
+typedef enum cscript_memory_category
+  {
+  cscript_memory_other,
+  cscript_memory_tokens, // tokenizing
+  cscript_memory_ast, // parsing and the optimization passes, except for their maps
+  cscript_memory_bytecode, // code generation and the fast path
+  cscript_memory_maps, // hash maps, e.g. of the environment and the constant propagation
+  cscript_number_of_memory_categories
+  } cscript_memory_category;
+
+/*
+Memory statistics of a context. live_bytes, peak_bytes and number_of_allocations count the blocks of the
+allocator, including the chunks of the arena of a compilation, which serve the tokens and the syntax tree.
+category_bytes counts the bytes of all blocks that were allocated or grown with the context, also the ones
+served by the arena, by the category of the code that asked for them. A block counts for the context it is
+freed with, so a context that frees blocks of other contexts can have negative live_bytes. When a context
+that was created from ctxt is destroyed, its statistics are added to the ones of ctxt, which does not change
+the peak of ctxt.
+*/
+typedef struct cscript_memory_stats
+  {
+  int64_t live_bytes;
+  int64_t peak_bytes;
+  uint64_t number_of_allocations; // blocks allocated or grown, frees are not counted
+  uint64_t category_bytes[cscript_number_of_memory_categories];
+  } cscript_memory_stats;
+
 CSCRIPT_API cscript_context* cscript_open(cscript_memsize stack_size);
+// same as cscript_open, but all memory of the context is allocated with allocator, or with the default allocator if allocator is NULL
+CSCRIPT_API cscript_context* cscript_open_ex(cscript_memsize stack_size, const cscript_allocator* allocator);
 CSCRIPT_API void cscript_close(cscript_context* ctxt);
 CSCRIPT_API cscript_context* cscript_context_init(cscript_context* ctxt, cscript_memsize stack_size);
 CSCRIPT_API void cscript_context_destroy(cscript_context* ctxt);
+CSCRIPT_API void cscript_get_memory_stats(cscript_context* ctxt, cscript_memory_stats* stats);
+/*
+Limits the memory of compilations with ctxt to limit bytes of live_bytes (see cscript_memory_stats), or removes
+the limit if limit is 0, which is the default. A compilation that would exceed the limit stops at the allocation
+that exceeds it: it returns NULL and reports a CSCRIPT_ERROR_MEMORY_LIMIT compile error with the bytes in use.
+Everything the compilation allocated is released, except for the global variables it already declared, as with
+other compile errors. The tokens, syntax tree and code of a compilation count against the limit, the error
+reports and global variable declarations do not. Contexts created from ctxt afterwards get the same limit.
+*/
+CSCRIPT_API void cscript_set_memory_limit(cscript_context* ctxt, cscript_memsize limit);
+
+/*
+A context pool hands out contexts that share the global state and the external functions of ctxt,
+and start with a copy of the global variables of ctxt. Contexts are created on demand, up to max_size
+contexts (no limit if max_size <= 0), and are reused after release. Releasing a context clears its error
+reports and copies the global variables of ctxt again. Acquire and release can be called from any thread,
+but ctxt should not be modified while contexts are acquired. All contexts should be released before the
+pool is freed, and the pool should be freed before ctxt is closed.
+*/
+CSCRIPT_API cscript_context_pool* cscript_context_pool_new(cscript_context* ctxt, cscript_memsize stack_size, int max_size);
+CSCRIPT_API void cscript_context_pool_free(cscript_context_pool* pool);
+// returns NULL if max_size contexts are in use
+CSCRIPT_API cscript_context* cscript_context_pool_acquire(cscript_context_pool* pool);
+CSCRIPT_API void cscript_context_pool_release(cscript_context_pool* pool, cscript_context* ctxt);
 
 CSCRIPT_API void cscript_environment_clear(cscript_context* ctxt);
 
 CSCRIPT_API void cscript_register_external_function(cscript_context* ctxt, const char* name, void* address, cscript_foreign_return_type ret_type);
 
 CSCRIPT_API cscript_function* cscript_compile(cscript_context* ctxt, const char* script);
+// fills options with the pass settings for the given optimization level:
+// 0: no optional passes (lowest compile latency)
+// 1: one round of constant propagation and folding
+// 2: two rounds of constant propagation and folding, and dead variable removal (default of cscript_compile)
+// 3: four rounds of constant propagation and folding, and dead variable removal
+CSCRIPT_API void cscript_compile_options_init(cscript_compile_options* options, int optimization_level);
+// options can be NULL, in which case the defaults of cscript_compile are used
+CSCRIPT_API cscript_function* cscript_compile_ex(cscript_context* ctxt, const char* script, const cscript_compile_options* options);
 CSCRIPT_API void cscript_function_free(cscript_context* ctxt, cscript_function* f);
+/*
+Compiles the scripts concurrently on number_of_threads workers (or the number of logical processors if
+number_of_threads <= 0 or if there are fewer) of the thread pool of cscript_run_batch_parallel, and writes the
+compiled function of scripts[i] to functions[i], or NULL if it fails.
+The result is the same as compiling the scripts one by one with cscript_compile_ex: global variables declared
+by a script are declared in ctxt in the order of the scripts, and are visible to the scripts that follow it.
+The error reports of ctxt hold the errors of all scripts, each prefixed with the index of its script.
+Returns the number of scripts that failed. ctxt should not be used by other threads during the call.
+*/
+CSCRIPT_API int cscript_compile_batch_ex(cscript_context* ctxt, const char** scripts, int number_of_scripts, cscript_function** functions, const cscript_compile_options* options, int number_of_threads);
+// same as cscript_compile_batch_ex with the default options and threads
+CSCRIPT_API int cscript_compile_batch(cscript_context* ctxt, const char** scripts, int number_of_scripts, cscript_function** functions);
+
+// Compilations with ctxt collect a cscript_compile_report once enabled. Reporting is off by default, as it times every phase and counts allocations.
+CSCRIPT_API void cscript_compile_report_enable(cscript_context* ctxt, int enable);
+// copies the report of the last cscript_compile or cscript_compile_ex with ctxt. Returns 0 if reporting is not enabled.
+CSCRIPT_API int cscript_get_compile_report(cscript_context* ctxt, cscript_compile_report* report);
+
+typedef struct cscript_compile_cache_stats
+  {
+  cscript_memsize hits;
+  cscript_memsize misses;
+  cscript_memsize evictions;
+  cscript_memsize number_of_functions; // functions in the cache
+  cscript_memsize size; // bytes used by the functions in the cache
+  } cscript_compile_cache_stats;
+
+/*
+A compile cache keeps the functions compiled by cscript_compile_cached, keyed by the script text, the compile
+options and the external functions and global variables of the compiling context (see cache.h). When the
+functions in the cache use more than max_size bytes, the least recently used ones are evicted.
+The cache can be used from many threads at once, each thread compiling with its own context. These contexts
+should be ctxt or contexts created from ctxt (see cscript_context_init and cscript_context_pool_new).
+*/
+CSCRIPT_API cscript_compile_cache* cscript_compile_cache_new(cscript_context* ctxt, cscript_memsize max_size);
+// all functions should have been released
+CSCRIPT_API void cscript_compile_cache_free(cscript_compile_cache* cache);
+/*
+Same as cscript_compile_ex, but returns the cached function if the same script was compiled before in the same
+context state. The function is owned by the cache: it stays valid until it is given back with
+cscript_compile_cache_release, also if it is evicted in the meantime. Returns NULL on errors, which are not cached.
+*/
+CSCRIPT_API cscript_function* cscript_compile_cached(cscript_compile_cache* cache, cscript_context* ctxt, const char* script, const cscript_compile_options* options);
+CSCRIPT_API void cscript_compile_cache_release(cscript_compile_cache* cache, cscript_function* fun);
+CSCRIPT_API void cscript_compile_cache_get_stats(cscript_compile_cache* cache, cscript_compile_cache_stats* stats);
+
+/*
+Compiled functions can be saved to a binary file and loaded again without compiling (see bundle.h for the format).
+The external functions that a saved function calls should be registered in the loading context with the same
+return type, and its global variables are declared in the loading context if they do not exist yet.
+Files are only compatible between machines with the same byte order and the same sizes of cscript_fixnum.
+A function whose frame does not fit the stack of the loading context, or whose code refers to registers,
+constants, jump targets or parallel loops that do not exist, is rejected as a corrupt bundle.
+Save returns 0 on failure, load returns NULL and reports an error in ctxt.
+*/
+CSCRIPT_API int cscript_function_save(cscript_context* ctxt, cscript_function* fun, const char* filename);
+CSCRIPT_API cscript_function* cscript_function_load(cscript_context* ctxt, const char* filename);
+// A bundle holds many named functions in one file.
+CSCRIPT_API int cscript_bundle_save(cscript_context* ctxt, cscript_function** functions, const char** names, int number_of_functions, const char* filename);
+// The file is memory mapped: only the functions that are loaded are read from disk.
+CSCRIPT_API cscript_bundle* cscript_bundle_open(cscript_context* ctxt, const char* filename);
+CSCRIPT_API void cscript_bundle_close(cscript_context* ctxt, cscript_bundle* b);
+CSCRIPT_API int cscript_bundle_size(const cscript_bundle* b);
+CSCRIPT_API const char* cscript_bundle_name(const cscript_bundle* b, int index);
+// returns -1 if the bundle has no function with this name
+CSCRIPT_API int cscript_bundle_find(const cscript_bundle* b, const char* name);
+// the function is owned by the caller, and stays valid after the bundle is closed
+CSCRIPT_API cscript_function* cscript_bundle_load(cscript_context* ctxt, const cscript_bundle* b, int index);
+
 CSCRIPT_API void cscript_get_error_message(cscript_context* ctxt, char* buffer, cscript_memsize buffer_size);
 
 CSCRIPT_API void cscript_set_function_arguments(cscript_context* ctxt, cscript_fixnum* arguments, int number_of_arguments);
 CSCRIPT_API cscript_fixnum* cscript_run(cscript_context* ctxt, cscript_function* fun);
+/*
+Runs fun on the caller-owned frame of registers, which should hold at least cscript_get_frame_size(fun) values,
+with the arguments in the first registers. The returned pointer points into frame.
+No context is used or modified, so different threads can run the same function at the same time, each on its
+own frame. Global variables are read and written through externals->globals, so give each thread its own
+copy of the globals if the script writes them. externals can be NULL if fun uses no external functions and no globals.
+Returns NULL if fun reaches an unsupported opcode or primitive, where cscript_run throws CSCRIPT_ERROR_NOT_IMPLEMENTED.
+Without a context nothing is thrown, so callers should check the result.
+*/
+CSCRIPT_API cscript_fixnum* cscript_run_frame(const cscript_function* fun, const cscript_externals* externals, cscript_fixnum* frame);
+CSCRIPT_API void cscript_run_state_init(cscript_run_state* state);
+/*
+Runs fun from state->pc until it finishes, or until budget backward jumps (loop iterations) have been executed,
+in which case execution is suspended and cscript_run_suspended is returned. A later call with the same state
+resumes where execution was suspended. The registers are kept in the stack of ctxt, so ctxt should not run other
+functions until fun has finished. Once finished, state->result holds the result and the next call starts over.
+*/
+CSCRIPT_API cscript_run_status cscript_run_slice(cscript_context* ctxt, cscript_function* fun, cscript_memsize budget, cscript_run_state* state);
+/*
+Runs fun count times: row i copies number_of_arguments values from args + i*args_stride into the argument
+registers, and its result is written to results[i]. args_stride may be larger than number_of_arguments, so
+rows can be taken from a wider array. Each row is a separate run of the interpreter with the context's stack,
+globals and externals looked up once for all rows; nothing else is carried over between rows.
+*/
+CSCRIPT_API void cscript_run_batch(cscript_context* ctxt, cscript_function* fun, const cscript_fixnum* args, int number_of_arguments, int args_stride, int count, cscript_fixnum* results);
+// same as cscript_run_batch, but runs blocks of rows in lockstep, one row per lane (see spmd.h)
+CSCRIPT_API void cscript_run_spmd(cscript_context* ctxt, cscript_function* fun, const cscript_fixnum* args, int number_of_arguments, int args_stride, int count, cscript_fixnum* results);
+/*
+Same as cscript_run_batch, but the rows are divided over number_of_threads workers (or the number of logical
+processors if number_of_threads <= 0 or if there are fewer). The results are written in the order of the rows.
+The workers run on a process-wide pool of threads that is created on first use, see parallel.c. Each worker
+runs on its own context, with the externals of ctxt and a copy of the global variables of ctxt. Global
+variables that are written by the script are therefore only visible to later rows handled by the same worker,
+and ctxt's globals are left unchanged. The worker contexts are kept by ctxt for the next calls.
+*/
+CSCRIPT_API void cscript_run_batch_parallel(cscript_context* ctxt, cscript_function* fun, const cscript_fixnum* args, int number_of_arguments, int args_stride, int count, cscript_fixnum* results, int number_of_threads);
+
+// binary records of a file, see cscript_run_stream
+typedef struct cscript_record_layout
+  {
+  int record_size; // number of bytes per record
+  int number_of_fields;
+  const int* field_offsets; // byte offset in the record of each field. Fields are 8 byte int64 or double values.
+  } cscript_record_layout;
+/*
+Runs fun once for each record of the binary file in_path, with field i of the record as argument i,
+and writes the 8 byte results in the order of the records to the file out_path.
+The file is processed in blocks of CSCRIPT_STREAM_BLOCK_SIZE bytes (see records.h). While a block is computed,
+the results of the previous block are written and the next block is read on a second thread.
+Trailing bytes that do not form a complete record are ignored.
+Returns the number of records that were processed, or -1 if a file could not be opened, read or written.
+Also returns -1, without opening the files, if the layout is invalid: record_size should be positive, there should
+be no more fields than the stack of ctxt holds, and each field should lie inside the record.
+*/
+CSCRIPT_API cscript_fixnum cscript_run_stream(cscript_context* ctxt, cscript_function* fun, const char* in_path, const cscript_record_layout* layout, const char* out_path);
+
+typedef enum cscript_map_mode
+  {
+  cscript_map_read_only, // writing to the mapped memory is an access violation
+  cscript_map_copy_on_write // written pages become private copies, the file is never modified
+  } cscript_map_mode;
+
+typedef enum cscript_access_hint
+  {
+  cscript_access_normal,
+  cscript_access_sequential,
+  cscript_access_random
+  } cscript_access_hint;
+
+typedef struct cscript_mapped_file
+  {
+  void* data; // NULL for an empty file
+  cscript_memsize size; // in bytes
+  cscript_memsize number_of_elements; // number of int or float values
+  void* file_handle;
+  void* mapping_handle;
+  } cscript_mapped_file;
+
+/*
+Maps the binary file filename in memory, so that it can be passed to int* or float* parameters without
+reading it first (see cscript_mapped_file_argument). Pages are loaded on first access and are shared through
+the page cache by all processes that map the same file read-only. hint is passed on to the operating
+system (madvise) to tune read-ahead. Returns 0 on failure.
+*/
+CSCRIPT_API int cscript_map_file(cscript_mapped_file* m, const char* filename, cscript_map_mode mode, cscript_access_hint hint);
+CSCRIPT_API void cscript_unmap_file(cscript_mapped_file* m);
+// the value to pass as an int* or float* argument
+CSCRIPT_API cscript_fixnum cscript_mapped_file_argument(const cscript_mapped_file* m);
 
 // returns 0 if failure
 CSCRIPT_API int cscript_set_global_flonum_value(cscript_context* ctxt, const char* global_name, cscript_flonum value);
 CSCRIPT_API int cscript_set_global_fixnum_value(cscript_context* ctxt, const char* global_name, cscript_fixnum value);
 
 CSCRIPT_API cscript_memsize cscript_get_function_size(cscript_function* fun);
+// number of registers fun needs, see cscript_run_frame
+CSCRIPT_API cscript_memsize cscript_get_frame_size(const cscript_function* fun);
+// the external functions and global variables of ctxt. The pointers are invalidated when externals or globals are added to ctxt.
+CSCRIPT_API cscript_externals cscript_get_externals(cscript_context* ctxt);
+CSCRIPT_API cscript_memsize cscript_get_number_of_globals(cscript_context* ctxt);
 
 #endif //CSCRIPT_H
\ No newline at end of file
@@ -294,6 +294,19 @@ static void dump_for(cscript_context* ctxt, cscript_visitor* v, cscript_parsed_f
   cscript_statement* init = cscript_vector_at(&f->init_cond_inc, 0, cscript_statement);
   cscript_statement* cond = cscript_vector_at(&f->init_cond_inc, 1, cscript_statement);
   cscript_statement* inc = cscript_vector_at(&f->init_cond_inc, 2, cscript_statement);
+  if (f->parallel)
+    {
+    cscript_string_append_cstr(ctxt, &(d->s), "parallel");
+    cscript_parsed_reduction* red_it = cscript_vector_begin(&f->reductions, cscript_parsed_reduction);
+    cscript_parsed_reduction* red_it_end = cscript_vector_end(&f->reductions, cscript_parsed_reduction);
+    for (; red_it != red_it_end; ++red_it)
+      {
+      cscript_string_append_cstr(ctxt, &(d->s), red_it == cscript_vector_begin(&f->reductions, cscript_parsed_reduction) ? "(" : ", ");
+      cscript_string_append_cstr(ctxt, &(d->s), red_it->op == cscript_reduction_sum ? "sum " : (red_it->op == cscript_reduction_min ? "min " : "max "));
+      cscript_string_append(ctxt, &(d->s), &red_it->var.name);
+      }
+    cscript_string_append_cstr(ctxt, &(d->s), f->reductions.vector_size > 0 ? ") " : " ");
+    }
   cscript_string_append_cstr(ctxt, &(d->s), "for (");
   dump_statement(ctxt, v, init);
   cscript_string_append_cstr(ctxt, &(d->s), "; ");
@@ -45,7 +45,11 @@ void cscript_environment_add_to_base(cscript_context* ctxt, cscript_string* name
   cscript_object key;
   key.type = cscript_object_type_string;
   key.value.s = *name;
-  cscript_object* entry_object = cscript_map_insert(ctxt, *active_map, &key);
+  cscript_object* entry_object = cscript_map_get(ctxt, *active_map, &key);
+  if (entry_object != NULL)
+    cscript_string_destroy(ctxt, name); // a redeclaration: the map keeps its own key
+  else
+    entry_object = cscript_map_insert(ctxt, *active_map, &key);
   //abusing cscript_object type fo fit in cscript_environment_entry, but avoiding 0
   entry_object->type = (cast(int, entry.type) + 1) | (entry.register_type << 2);
   entry_object->value.fx = entry.position;
@@ -138,7 +142,8 @@ int cscript_environment_base_at(cscript_environment_entry* entry, cscript_string
   cscript_assert(pos < cast(cscript_memsize, node_size((*parent_map))));
   if (cscript_object_get_type(&(*parent_map)->node[pos].key) == cscript_object_type_string) // valid node
     {
-    entry->type = (*parent_map)->node[pos].value.type - 1;
+    entry->type = ((*parent_map)->node[pos].value.type & 3) - 1;
+    entry->register_type = (*parent_map)->node[pos].value.type >> 2;
     entry->position = (*parent_map)->node[pos].value.value.fx;
     *name = (*parent_map)->node[pos].key.value.s;
     return 1;
@@ -197,7 +202,7 @@ cscript_object* cscript_environment_find_key_given_position(cscript_context* ctx
     {
     if (cscript_object_get_type(&base_map->node[i].key) == cscript_object_type_string)
       {
-      if ((base_map->node[i].value.type == CSCRIPT_ENV_TYPE_GLOBAL + 1) && (base_map->node[i].value.value.fx == global_position))
+      if ((((base_map->node[i].value.type) & 3) == CSCRIPT_ENV_TYPE_GLOBAL + 1) && (base_map->node[i].value.value.fx == global_position))
         {
         return &base_map->node[i].key;
         }
@@ -1,4 +1,5 @@
 #include "error.h"
+#include "arena.h"
 #include "limits.h"
 #include "context.h"
 #include "syscalls.h"
@@ -19,6 +20,18 @@ void cscript_throw(cscript_context* ctxt, int errorcode)
   exit(errorcode);
   }
 
+int cscript_run_protected(cscript_context* ctxt, cscript_protected_function f, void* data)
+  {
+  cscript_longjmp jmp;
+  jmp.status = 0;
+  jmp.previous = ctxt->error_jmp;
+  ctxt->error_jmp = &jmp;
+  if (setjmp(jmp.jmp) == 0)
+    f(ctxt, data);
+  ctxt->error_jmp = jmp.previous;
+  return jmp.status;
+  }
+
 static void append_error_code(cscript_context* ctxt, cscript_string* message, int errorcode)
   {
   switch (errorcode)
@@ -33,12 +46,15 @@ static void append_error_code(cscript_context* ctxt, cscript_string* message, in
     case CSCRIPT_ERROR_INVALID_ARGUMENT: cscript_string_append_cstr(ctxt, message, "invalid argument"); break;
     case CSCRIPT_ERROR_VARIABLE_UNKNOWN: cscript_string_append_cstr(ctxt, message, "variable unknown"); break;
     case CSCRIPT_ERROR_EXTERNAL_UNKNOWN: cscript_string_append_cstr(ctxt, message, "external unknown"); break;
+    case CSCRIPT_ERROR_MEMORY_LIMIT: cscript_string_append_cstr(ctxt, message, "memory limit exceeded"); break;
     default: break;
     }
   }
 
 void cscript_syntax_error(cscript_context* ctxt, int errorcode, int line_nr, int column_nr, cscript_string* filename, cscript_string* msg)
   {
+  // the report outlives the arena of the compilation
+  cscript_arena_suspend(ctxt);
   cscript_string message;
   cscript_string_init(ctxt, &message, "syntax error");
   if (filename && filename->string_length > 0)
@@ -73,6 +89,7 @@ void cscript_syntax_error(cscript_context* ctxt, int errorcode, int line_nr, int
   report.errorcode = errorcode;
   report.message = message;
   cscript_vector_push_back(ctxt, &ctxt->syntax_error_reports, report, cscript_error_report);
+  cscript_arena_resume(ctxt);
   }
 
 void cscript_syntax_error_cstr(cscript_context* ctxt, int errorcode, int line_nr, int column_nr, cscript_string* filename, const char* msg)
@@ -84,6 +101,7 @@ void cscript_syntax_error_cstr(cscript_context* ctxt, int errorcode, int line_nr
 
 void cscript_compile_error(cscript_context* ctxt, int errorcode, int line_nr, int column_nr, cscript_string* filename, cscript_string* msg)
   {
+  cscript_arena_suspend(ctxt);
   cscript_string message;
   cscript_string_init(ctxt, &message, "compile error");
   if (filename && filename->string_length > 0)
@@ -118,6 +136,7 @@ void cscript_compile_error(cscript_context* ctxt, int errorcode, int line_nr, in
   report.errorcode = errorcode;
   report.message = message;
   cscript_vector_push_back(ctxt, &ctxt->compile_error_reports, report, cscript_error_report);
+  cscript_arena_resume(ctxt);
   }
 
 void cscript_compile_error_cstr(cscript_context* ctxt, int errorcode, int line_nr, int column_nr, cscript_string* filename, const char* msg)
@@ -129,6 +148,7 @@ void cscript_compile_error_cstr(cscript_context* ctxt, int errorcode, int line_n
 
 void cscript_runtime_error(cscript_context* ctxt, int errorcode, int line_nr, int column_nr, cscript_string* msg)
   {
+  cscript_arena_suspend(ctxt);
   cscript_string message;
   cscript_string_init(ctxt, &message, "runtime error");
   if (line_nr >= 0 && column_nr >= 0)
@@ -157,6 +177,7 @@ void cscript_runtime_error(cscript_context* ctxt, int errorcode, int line_nr, in
   report.errorcode = errorcode;
   report.message = message;
   cscript_vector_push_back(ctxt, &ctxt->runtime_error_reports, report, cscript_error_report);
+  cscript_arena_resume(ctxt);
   }
 
 void cscript_runtime_error_cstr(cscript_context* ctxt, int errorcode, int line_nr, int column_nr, const char* msg)
@@ -14,9 +14,15 @@
 #define CSCRIPT_ERROR_INVALID_ARGUMENT 8
 #define CSCRIPT_ERROR_VARIABLE_UNKNOWN 9
 #define CSCRIPT_ERROR_EXTERNAL_UNKNOWN 10
+#define CSCRIPT_ERROR_MEMORY_LIMIT 11
 
 void cscript_throw(cscript_context* ctxt, int errorcode);
 
+typedef void (*cscript_protected_function)(cscript_context* ctxt, void* data);
+
+// calls f(ctxt, data) with a recovery point for cscript_throw. Returns 0, or the error code that was thrown.
+int cscript_run_protected(cscript_context* ctxt, cscript_protected_function f, void* data);
+
 void cscript_syntax_error(cscript_context* ctxt, int errorcode, int line_nr, int column_nr, cscript_string* filename, cscript_string* msg);
 void cscript_syntax_error_cstr(cscript_context* ctxt, int errorcode, int line_nr, int column_nr, cscript_string* filename, const char* msg);
 void cscript_compile_error(cscript_context* ctxt, int errorcode, int line_nr, int column_nr, cscript_string* filename, cscript_string* msg);
@@ -2,6 +2,8 @@
 #include "context.h"
 #include "error.h"
 
+#include <string.h>
+
 static cscript_external_function external_function_init(cscript_context* ctxt, const char* name, void* address, cscript_foreign_return_type ret_type)
   {
   cscript_external_function ext;
@@ -33,10 +35,9 @@ void cscript_external_function_destroy(cscript_context* ctxt, cscript_external_f
   cscript_string_destroy(ctxt, &ext->name);
   }
 
-static void* get_argument_pointer(cscript_context* ctxt, int stack_offset)
+static void* get_argument_pointer(cscript_fixnum* stack, int stack_offset)
   {
-  cscript_fixnum* fx = cscript_vector_at(&ctxt->stack, stack_offset, cscript_fixnum);
-  return fx;
+  return stack + stack_offset;
   }
 
 #define CSCRIPT_CALL_EXTERNAL(funargs, args) \
@@ -65,7 +66,7 @@ static void* get_argument_pointer(cscript_context* ctxt, int stack_offset)
       } \
       }
 
-cscript_object cscript_call_external(cscript_context* ctxt, cscript_external_function* ext, int argument_stack_offset, int nr_of_args)
+cscript_object cscript_call_external(cscript_context* ctxt, const cscript_external_function* ext, cscript_fixnum* stack, int argument_stack_offset, int nr_of_args)
   {
   cscript_object obj;
   obj.type = cscript_object_type_undefined;
@@ -78,83 +79,84 @@ cscript_object cscript_call_external(cscript_context* ctxt, cscript_external_fun
     }
     case 1:
     {
-    void* arg1 = get_argument_pointer(ctxt, argument_stack_offset);
+    void* arg1 = get_argument_pointer(stack, argument_stack_offset);
     CSCRIPT_CALL_EXTERNAL((void*), (arg1));
     break;
     }
     case 2:
     {
-    void* arg1 = get_argument_pointer(ctxt, argument_stack_offset);
-    void* arg2 = get_argument_pointer(ctxt, argument_stack_offset + 1);
+    void* arg1 = get_argument_pointer(stack, argument_stack_offset);
+    void* arg2 = get_argument_pointer(stack, argument_stack_offset + 1);
     CSCRIPT_CALL_EXTERNAL((void*, void*), (arg1, arg2));
     break;
     }
     case 3:
     {
-    void* arg1 = get_argument_pointer(ctxt, argument_stack_offset);
-    void* arg2 = get_argument_pointer(ctxt, argument_stack_offset + 1);
-    void* arg3 = get_argument_pointer(ctxt, argument_stack_offset + 2);
+    void* arg1 = get_argument_pointer(stack, argument_stack_offset);
+    void* arg2 = get_argument_pointer(stack, argument_stack_offset + 1);
+    void* arg3 = get_argument_pointer(stack, argument_stack_offset + 2);
     CSCRIPT_CALL_EXTERNAL((void*, void*, void*), (arg1, arg2, arg3));
     break;
     }
     case 4:
     {
-    void* arg1 = get_argument_pointer(ctxt, argument_stack_offset);
-    void* arg2 = get_argument_pointer(ctxt, argument_stack_offset + 1);
-    void* arg3 = get_argument_pointer(ctxt, argument_stack_offset + 2);
-    void* arg4 = get_argument_pointer(ctxt, argument_stack_offset + 3);
+    void* arg1 = get_argument_pointer(stack, argument_stack_offset);
+    void* arg2 = get_argument_pointer(stack, argument_stack_offset + 1);
+    void* arg3 = get_argument_pointer(stack, argument_stack_offset + 2);
+    void* arg4 = get_argument_pointer(stack, argument_stack_offset + 3);
     CSCRIPT_CALL_EXTERNAL((void*, void*, void*, void*), (arg1, arg2, arg3, arg4));
     break;
     }
     case 5:
     {
-    void* arg1 = get_argument_pointer(ctxt, argument_stack_offset);
-    void* arg2 = get_argument_pointer(ctxt, argument_stack_offset + 1);
-    void* arg3 = get_argument_pointer(ctxt, argument_stack_offset + 2);
-    void* arg4 = get_argument_pointer(ctxt, argument_stack_offset + 3);
-    void* arg5 = get_argument_pointer(ctxt, argument_stack_offset + 4);
+    void* arg1 = get_argument_pointer(stack, argument_stack_offset);
+    void* arg2 = get_argument_pointer(stack, argument_stack_offset + 1);
+    void* arg3 = get_argument_pointer(stack, argument_stack_offset + 2);
+    void* arg4 = get_argument_pointer(stack, argument_stack_offset + 3);
+    void* arg5 = get_argument_pointer(stack, argument_stack_offset + 4);
     CSCRIPT_CALL_EXTERNAL((void*, void*, void*, void*, void*), (arg1, arg2, arg3, arg4, arg5));
     break;
     }
     case 6:
     {
-    void* arg1 = get_argument_pointer(ctxt, argument_stack_offset);
-    void* arg2 = get_argument_pointer(ctxt, argument_stack_offset + 1);
-    void* arg3 = get_argument_pointer(ctxt, argument_stack_offset + 2);
-    void* arg4 = get_argument_pointer(ctxt, argument_stack_offset + 3);
-    void* arg5 = get_argument_pointer(ctxt, argument_stack_offset + 4);
-    void* arg6 = get_argument_pointer(ctxt, argument_stack_offset + 5);
+    void* arg1 = get_argument_pointer(stack, argument_stack_offset);
+    void* arg2 = get_argument_pointer(stack, argument_stack_offset + 1);
+    void* arg3 = get_argument_pointer(stack, argument_stack_offset + 2);
+    void* arg4 = get_argument_pointer(stack, argument_stack_offset + 3);
+    void* arg5 = get_argument_pointer(stack, argument_stack_offset + 4);
+    void* arg6 = get_argument_pointer(stack, argument_stack_offset + 5);
     CSCRIPT_CALL_EXTERNAL((void*, void*, void*, void*, void*, void*), (arg1, arg2, arg3, arg4, arg5, arg6));
     break;
     }
     case 7:
     {
-    void* arg1 = get_argument_pointer(ctxt, argument_stack_offset);
-    void* arg2 = get_argument_pointer(ctxt, argument_stack_offset + 1);
-    void* arg3 = get_argument_pointer(ctxt, argument_stack_offset + 2);
-    void* arg4 = get_argument_pointer(ctxt, argument_stack_offset + 3);
-    void* arg5 = get_argument_pointer(ctxt, argument_stack_offset + 4);
-    void* arg6 = get_argument_pointer(ctxt, argument_stack_offset + 5);
-    void* arg7 = get_argument_pointer(ctxt, argument_stack_offset + 6);
+    void* arg1 = get_argument_pointer(stack, argument_stack_offset);
+    void* arg2 = get_argument_pointer(stack, argument_stack_offset + 1);
+    void* arg3 = get_argument_pointer(stack, argument_stack_offset + 2);
+    void* arg4 = get_argument_pointer(stack, argument_stack_offset + 3);
+    void* arg5 = get_argument_pointer(stack, argument_stack_offset + 4);
+    void* arg6 = get_argument_pointer(stack, argument_stack_offset + 5);
+    void* arg7 = get_argument_pointer(stack, argument_stack_offset + 6);
     CSCRIPT_CALL_EXTERNAL((void*, void*, void*, void*, void*, void*, void*), (arg1, arg2, arg3, arg4, arg5, arg6, arg7));
     break;
     }
     case 8:
     {
-    void* arg1 = get_argument_pointer(ctxt, argument_stack_offset);
-    void* arg2 = get_argument_pointer(ctxt, argument_stack_offset + 1);
-    void* arg3 = get_argument_pointer(ctxt, argument_stack_offset + 2);
-    void* arg4 = get_argument_pointer(ctxt, argument_stack_offset + 3);
-    void* arg5 = get_argument_pointer(ctxt, argument_stack_offset + 4);
-    void* arg6 = get_argument_pointer(ctxt, argument_stack_offset + 5);
-    void* arg7 = get_argument_pointer(ctxt, argument_stack_offset + 6);
-    void* arg8 = get_argument_pointer(ctxt, argument_stack_offset + 7);
+    void* arg1 = get_argument_pointer(stack, argument_stack_offset);
+    void* arg2 = get_argument_pointer(stack, argument_stack_offset + 1);
+    void* arg3 = get_argument_pointer(stack, argument_stack_offset + 2);
+    void* arg4 = get_argument_pointer(stack, argument_stack_offset + 3);
+    void* arg5 = get_argument_pointer(stack, argument_stack_offset + 4);
+    void* arg6 = get_argument_pointer(stack, argument_stack_offset + 5);
+    void* arg7 = get_argument_pointer(stack, argument_stack_offset + 6);
+    void* arg8 = get_argument_pointer(stack, argument_stack_offset + 7);
     CSCRIPT_CALL_EXTERNAL((void*, void*, void*, void*, void*, void*, void*, void*), (arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8));
     break;
     }
     default:
     {
-    cscript_runtime_error_cstr(ctxt, CSCRIPT_ERROR_INVALID_NUMBER_OF_ARGUMENTS, -1, -1, "Too many parameters for external call");
+    if (ctxt != NULL)
+      cscript_runtime_error_cstr(ctxt, CSCRIPT_ERROR_INVALID_NUMBER_OF_ARGUMENTS, -1, -1, "Too many parameters for external call");
     break;
     }
     }
@@ -15,12 +15,12 @@ typedef enum cscript_foreign_return_type
   } cscript_foreign_return_type;
 */
 
-typedef struct cscript_external_function
+struct cscript_external_function
   {
   cscript_string name;
   void* address;
   cscript_foreign_return_type return_type;
-  } cscript_external_function;
+  };
 
 //CSCRIPT_API cscript_external_function cscript_external_function_init(cscript_context* ctxt, const char* name, void* address, cscript_foreign_return_type ret_type);
 
@@ -28,6 +28,8 @@ void cscript_external_function_destroy(cscript_context* ctxt, cscript_external_f
 
 //CSCRIPT_API void cscript_register_external_function(cscript_context* ctxt, cscript_external_function* ext);
 
-cscript_object cscript_call_external(cscript_context* ctxt, cscript_external_function* ext, int argument_stack_offset, int nr_of_args);
+// the arguments are the registers stack[argument_stack_offset] up to stack[argument_stack_offset + nr_of_args - 1].
+// ctxt is only used to report errors and can be NULL.
+cscript_object cscript_call_external(cscript_context* ctxt, const cscript_external_function* ext, cscript_fixnum* stack, int argument_stack_offset, int nr_of_args);
 
 #endif //CSCRIPT_FOREIGN_H
\ No newline at end of file
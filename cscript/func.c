@@ -2,6 +2,7 @@
 #include "vector.h"
 #include "object.h"
 #include <stddef.h>
+#include <string.h>
 
 cscript_function* cscript_function_new(cscript_context* ctxt)
   {
@@ -11,6 +12,8 @@ cscript_function* cscript_function_new(cscript_context* ctxt)
   cscript_vector_init(ctxt, &fun->code, cscript_instruction);
   fun->number_of_constants = 0;
   fun->result_position = 0;
+  fun->frame_size = 0;
+  cscript_vector_init(ctxt, &fun->parallel_loops, cscript_parallel_loop);
   return fun;
   }
 
@@ -19,10 +22,68 @@ void cscript_function_free(cscript_context* ctxt, cscript_function* f)
   cscript_map_free(ctxt, f->constants_map);
   cscript_vector_destroy(ctxt, &f->constants);
   cscript_vector_destroy(ctxt, &f->code);
+  cscript_parallel_loop* it = cscript_vector_begin(&f->parallel_loops, cscript_parallel_loop);
+  cscript_parallel_loop* it_end = cscript_vector_end(&f->parallel_loops, cscript_parallel_loop);
+  for (; it != it_end; ++it)
+    {
+    cscript_function_free(ctxt, it->body);
+    cscript_vector_destroy(ctxt, &it->reductions);
+    }
+  cscript_vector_destroy(ctxt, &f->parallel_loops);
   cscript_delete(ctxt, f);
   }
 
+static void vector_copy(cscript_context* ctxt, cscript_vector* target, const cscript_vector* source)
+  {
+  target->vector_ptr = cscript_malloc(ctxt, source->vector_size * source->element_size);
+  target->vector_capacity = source->vector_size;
+  target->vector_size = source->vector_size;
+  target->element_size = source->element_size;
+  if (source->vector_size > 0)
+    memcpy(target->vector_ptr, source->vector_ptr, source->vector_size * source->element_size);
+  }
+
+cscript_function* cscript_function_copy(cscript_context* ctxt, const cscript_function* fun)
+  {
+  cscript_function* result = cscript_new(ctxt, cscript_function);
+  result->constants_map = cscript_map_new(ctxt, 0, 0);
+  vector_copy(ctxt, &result->constants, &fun->constants);
+  vector_copy(ctxt, &result->code, &fun->code);
+  result->number_of_constants = fun->number_of_constants;
+  result->result_position = fun->result_position;
+  result->frame_size = fun->frame_size;
+  vector_copy(ctxt, &result->parallel_loops, &fun->parallel_loops);
+  cscript_parallel_loop* it = cscript_vector_begin(&result->parallel_loops, cscript_parallel_loop);
+  cscript_parallel_loop* it_end = cscript_vector_end(&result->parallel_loops, cscript_parallel_loop);
+  for (; it != it_end; ++it)
+    {
+    const cscript_vector reductions = it->reductions;
+    it->body = cscript_function_copy(ctxt, it->body);
+    vector_copy(ctxt, &it->reductions, &reductions);
+    }
+  return result;
+  }
+
+cscript_memsize cscript_function_memory_size(const cscript_function* fun)
+  {
+  cscript_memsize size = sizeof(cscript_function);
+  size += sizeof(cscript_map) + node_size(fun->constants_map) * sizeof(cscript_map_node) + fun->constants_map->array_size * sizeof(cscript_object);
+  size += fun->constants.vector_capacity * fun->constants.element_size;
+  size += fun->code.vector_capacity * fun->code.element_size;
+  size += fun->parallel_loops.vector_capacity * fun->parallel_loops.element_size;
+  const cscript_parallel_loop* it = cscript_vector_begin(&fun->parallel_loops, cscript_parallel_loop);
+  const cscript_parallel_loop* it_end = cscript_vector_end(&fun->parallel_loops, cscript_parallel_loop);
+  for (; it != it_end; ++it)
+    size += cscript_function_memory_size(it->body) + it->reductions.vector_capacity * it->reductions.element_size;
+  return size;
+  }
+
 cscript_memsize cscript_get_function_size(cscript_function* fun)
   {
   return fun->code.vector_size;
   }
+
+cscript_memsize cscript_get_frame_size(const cscript_function* fun)
+  {
+  return fun->frame_size;
+  }
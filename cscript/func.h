@@ -5,6 +5,19 @@
 #include "vector.h"
 #include "map.h"
 
+typedef struct cscript_parallel_reduction
+  {
+  int position; // register of the reduction variable
+  int op; // cscript_reduction_sum, cscript_reduction_min or cscript_reduction_max (see parser.h)
+  int is_flonum;
+  } cscript_parallel_reduction;
+
+typedef struct cscript_parallel_loop
+  {
+  cscript_function* body; // executed once per iteration, on a frame with the registers of the enclosing function
+  cscript_vector reductions; // vector of type cscript_parallel_reduction
+  } cscript_parallel_loop;
+
 typedef struct cscript_function
   {
   cscript_map* constants_map;
@@ -12,10 +25,19 @@ typedef struct cscript_function
   cscript_vector code;
   int number_of_constants;
   cscript_memsize result_position;
+  cscript_memsize frame_size; // number of registers used by the code
+  cscript_vector parallel_loops; // vector of type cscript_parallel_loop, indexed by the C argument of CALLPRIM CSCRIPT_PARALLEL_FOR
   } cscript_function;
 
 
 cscript_function* cscript_function_new(cscript_context* ctxt);
+/*
+Copies fun and the bodies of its parallel loops, with vectors of the exact size. The constants map, which is
+only needed while code is generated, is left empty as for functions read from a bundle.
+*/
+cscript_function* cscript_function_copy(cscript_context* ctxt, const cscript_function* fun);
+// number of bytes allocated for fun, including the bodies of its parallel loops
+cscript_memsize cscript_function_memory_size(const cscript_function* fun);
 //void cscript_function_free(cscript_context* ctxt, cscript_function* f);
 
 #endif //CSCRIPT_FUNC_H
\ No newline at end of file
@@ -194,12 +194,15 @@ static void cscript_rehash(cscript_context* ctxt, cscript_map* map)
   {
   cscript_memsize nasize, nhsize;
   numuse(map, &nasize, &nhsize);  /* compute new sizes for array and hash parts */
+  const cscript_memory_category category = cscript_memory_category_set(ctxt, cscript_memory_maps);
   resize(ctxt, map, nasize, cscript_log2(nhsize) + 1);
+  cscript_memory_category_set(ctxt, category);
   }
 
 
 cscript_map* cscript_map_new(cscript_context* ctxt, cscript_memsize array_size, cscript_memsize log_node_size)
   {
+  const cscript_memory_category category = cscript_memory_category_set(ctxt, cscript_memory_maps);
   cscript_map* m = cscript_new(ctxt, cscript_map);
   m->array = NULL;
   m->node = NULL;
@@ -207,6 +210,7 @@ cscript_map* cscript_map_new(cscript_context* ctxt, cscript_memsize array_size,
   m->log_node_size = 0;
   cscript_create_array_vector(ctxt, m, array_size);
   cscript_create_node_vector(ctxt, m, log_node_size);
+  cscript_memory_category_set(ctxt, category);
   return m;
   }
 
@@ -232,7 +236,8 @@ void cscript_map_values_free(cscript_context* ctxt, cscript_map* map)
 
 void cscript_map_free(cscript_context* ctxt, cscript_map* map)
   {
-  cscript_freevector(ctxt, map->node, node_size(map), cscript_map_node);
+  if (map->log_node_size > 0) /* the empty hash part is the shared dummy node */
+    cscript_freevector(ctxt, map->node, node_size(map), cscript_map_node);
   cscript_freevector(ctxt, map->array, map->array_size, cscript_object);
   cscript_delete(ctxt, map);
   }
@@ -1,5 +1,8 @@
 #include "memory.h"
+#include "arena.h"
+#include "context.h"
 #include "error.h"
+#include "report.h"
 
 #include <stdlib.h>
 
@@ -29,31 +32,113 @@
 #endif
 #endif
 
-void* cscript_realloc(cscript_context* ctxt, void* chunk, cscript_memsize old_size, cscript_memsize new_size)
+static void* default_reallocate(void* user_data, void* chunk, cscript_memsize old_size, cscript_memsize new_size)
   {
+  UNUSED(user_data);
   UNUSED(old_size);
-  cscript_assert((old_size == 0) == (chunk == NULL));
   if (new_size == 0)
     {
     if (chunk != NULL)
-      {
       CSCRIPT_FREE(chunk, old_size);
-      chunk = NULL;
-      }
-    else return NULL;
+    return NULL;
     }
-  else
+  return CSCRIPT_REALLOC(chunk, old_size, new_size);
+  }
+
+void cscript_default_allocator(cscript_allocator* allocator)
+  {
+  allocator->reallocate = &default_reallocate;
+  allocator->user_data = NULL;
+  }
+
+void cscript_memory_count(cscript_context* ctxt, cscript_memsize old_size, cscript_memsize new_size)
+  {
+  cscript_memory_stats* stats = &ctxt->memory;
+  stats->live_bytes += cast(int64_t, new_size) - cast(int64_t, old_size);
+  if (new_size > old_size)
+    {
+    ++stats->number_of_allocations;
+    if (stats->live_bytes > stats->peak_bytes)
+      stats->peak_bytes = stats->live_bytes;
+    }
+  }
+
+void cscript_memory_stats_merge(cscript_memory_stats* target, const cscript_memory_stats* source)
+  {
+  target->live_bytes += source->live_bytes;
+  target->number_of_allocations += source->number_of_allocations;
+  for (int i = 0; i < cscript_number_of_memory_categories; ++i)
+    target->category_bytes[i] += source->category_bytes[i];
+  }
+
+cscript_memory_category cscript_memory_category_set(cscript_context* ctxt, cscript_memory_category category)
+  {
+  if (ctxt == NULL)
+    return cscript_memory_other;
+  const cscript_memory_category previous = ctxt->memory_category;
+  ctxt->memory_category = category;
+  return previous;
+  }
+
+static int exceeds_memory_limit(cscript_context* ctxt, cscript_memsize size)
+  {
+  return ctxt->memory_limit > 0 && ctxt->memory.live_bytes + cast(int64_t, size) > cast(int64_t, ctxt->memory_limit) ? 1 : 0;
+  }
+
+void cscript_memory_limit_check(cscript_context* ctxt, cscript_memsize size)
+  {
+  if (exceeds_memory_limit(ctxt, size))
+    {
+    ctxt->memory_limit_request = size;
+    cscript_throw(ctxt, CSCRIPT_ERROR_MEMORY_LIMIT);
+    }
+  }
+
+void* cscript_heap_realloc(cscript_context* ctxt, void* chunk, cscript_memsize old_size, cscript_memsize new_size)
+  {
+  if (ctxt == NULL)
+    return default_reallocate(NULL, chunk, old_size, new_size);
+  if (new_size > old_size && ctxt->arena != NULL && ctxt->arena->suspended == 0 && exceeds_memory_limit(ctxt, new_size - old_size))
+    {
+    ctxt->memory_limit_request = new_size - old_size;
+    return NULL;
+    }
+  // the allocator is copied first, as the block can be the context itself
+  const cscript_allocator allocator = ctxt->allocator;
+  if (new_size == 0)
     {
-    chunk = CSCRIPT_REALLOC(chunk, old_size, new_size);
     if (chunk == NULL)
+      return NULL;
+    cscript_memory_count(ctxt, old_size, 0);
+    return allocator.reallocate(allocator.user_data, chunk, old_size, 0);
+    }
+  chunk = allocator.reallocate(allocator.user_data, chunk, old_size, new_size);
+  if (chunk != NULL)
+    cscript_memory_count(ctxt, old_size, new_size);
+  return chunk;
+  }
+
+void* cscript_realloc(cscript_context* ctxt, void* chunk, cscript_memsize old_size, cscript_memsize new_size)
+  {
+  cscript_assert((old_size == 0) == (chunk == NULL));
+  if (ctxt == NULL)
+    return default_reallocate(NULL, chunk, old_size, new_size);
+  if (new_size > old_size)
+    {
+    ctxt->memory.category_bytes[ctxt->memory_category] += new_size - old_size;
+    if (ctxt->recorder != NULL && ctxt->recorder->phase >= 0)
       {
-      if (ctxt)
-        cscript_throw(ctxt, CSCRIPT_ERROR_MEMORY);
-      else
-        return NULL;
+      cscript_compile_phase_stats* stats = &ctxt->recorder->report.phases[ctxt->recorder->phase];
+      ++stats->number_of_allocations;
+      stats->allocated_bytes += new_size - old_size;
       }
     }
-
+  if (ctxt->arena != NULL && (chunk == NULL ? ctxt->arena->suspended == 0 : cscript_arena_owns(ctxt->arena, chunk)))
+    chunk = cscript_arena_realloc(ctxt->arena, chunk, old_size, new_size);
+  else
+    chunk = cscript_heap_realloc(ctxt, chunk, old_size, new_size);
+  if (chunk == NULL && new_size != 0)
+    cscript_throw(ctxt, ctxt->memory_limit_request > 0 ? CSCRIPT_ERROR_MEMORY_LIMIT : CSCRIPT_ERROR_MEMORY);
   return chunk;
   }
 
@@ -6,8 +6,33 @@
 
 #define CSCRIPT_MINSIZEVECTOR 2
 
+/*
+Blocks of a context are allocated with the allocator of the context, and blocks without a context (ctxt is NULL)
+with the default allocator, which uses CSCRIPT_REALLOC and CSCRIPT_FREE. While an arena is attached to ctxt, new
+blocks are served by the arena instead (see arena.h). Out of memory throws CSCRIPT_ERROR_MEMORY in ctxt.
+The memory limit of ctxt applies while its arena is attached and not suspended, that is to the allocations of
+the compilation itself: the heap blocks that would bring the live bytes of ctxt above the limit are refused,
+and throw CSCRIPT_ERROR_MEMORY_LIMIT instead.
+*/
 CSCRIPT_API void* cscript_realloc(cscript_context* ctxt, void* chunk, cscript_memsize old_size, cscript_memsize new_size);
 
+void cscript_default_allocator(cscript_allocator* allocator);
+
+// allocates with the allocator of ctxt, bypassing its arena, and counts the block in the statistics of ctxt. Returns NULL if out of memory.
+void* cscript_heap_realloc(cscript_context* ctxt, void* chunk, cscript_memsize old_size, cscript_memsize new_size);
+
+// throws CSCRIPT_ERROR_MEMORY_LIMIT if allocating size more bytes would exceed the memory limit of ctxt
+void cscript_memory_limit_check(cscript_context* ctxt, cscript_memsize size);
+
+// counts a block of the allocator of ctxt that was resized from old_size to new_size bytes
+void cscript_memory_count(cscript_context* ctxt, cscript_memsize old_size, cscript_memsize new_size);
+
+// adds the statistics of source to target
+void cscript_memory_stats_merge(cscript_memory_stats* target, const cscript_memory_stats* source);
+
+// sets the category of the next allocations with ctxt, and returns the previous one
+cscript_memory_category cscript_memory_category_set(cscript_context* ctxt, cscript_memory_category category);
+
 #define cscript_free(ctxt, chunk, chunksize) cscript_realloc(ctxt, (chunk), (chunksize), 0)
 #define cscript_delete(ctxt, chunk) cscript_realloc(ctxt, (chunk), sizeof(*(chunk)), 0)
 #define cscript_freevector(ctxt, chunk, vector_size, element_type)	cscript_realloc(ctxt, (chunk), cast(cscript_memsize, vector_size)*cast(cscript_memsize, sizeof(element_type)), 0)
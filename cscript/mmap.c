@@ -0,0 +1,123 @@
+#include "cscript.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static void clear_mapped_file(cscript_mapped_file* m)
+  {
+  m->data = NULL;
+  m->size = 0;
+  m->number_of_elements = 0;
+  m->file_handle = NULL;
+  m->mapping_handle = NULL;
+  }
+
+#ifdef _WIN32
+
+int cscript_map_file(cscript_mapped_file* m, const char* filename, cscript_map_mode mode, cscript_access_hint hint)
+  {
+  clear_mapped_file(m);
+  HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+    hint == cscript_access_sequential ? FILE_FLAG_SEQUENTIAL_SCAN : (hint == cscript_access_random ? FILE_FLAG_RANDOM_ACCESS : FILE_ATTRIBUTE_NORMAL), NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return 0;
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size))
+    {
+    CloseHandle(file);
+    return 0;
+    }
+  m->file_handle = file;
+  m->size = (cscript_memsize)file_size.QuadPart;
+  m->number_of_elements = m->size / sizeof(cscript_fixnum);
+  if (m->size == 0)
+    return 1;
+  HANDLE mapping = CreateFileMappingA(file, NULL, mode == cscript_map_copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL)
+    {
+    cscript_unmap_file(m);
+    return 0;
+    }
+  m->mapping_handle = mapping;
+  m->data = MapViewOfFile(mapping, mode == cscript_map_copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+  if (m->data == NULL)
+    {
+    cscript_unmap_file(m);
+    return 0;
+    }
+  return 1;
+  }
+
+void cscript_unmap_file(cscript_mapped_file* m)
+  {
+  if (m->data != NULL)
+    UnmapViewOfFile(m->data);
+  if (m->mapping_handle != NULL)
+    CloseHandle((HANDLE)m->mapping_handle);
+  if (m->file_handle != NULL)
+    CloseHandle((HANDLE)m->file_handle);
+  clear_mapped_file(m);
+  }
+
+#else
+
+int cscript_map_file(cscript_mapped_file* m, const char* filename, cscript_map_mode mode, cscript_access_hint hint)
+  {
+  clear_mapped_file(m);
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return 0;
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+    {
+    close(fd);
+    return 0;
+    }
+  m->size = (cscript_memsize)st.st_size;
+  m->number_of_elements = m->size / sizeof(cscript_fixnum);
+  if (m->size == 0)
+    {
+    close(fd);
+    return 1;
+    }
+  // copy-on-write pages are private to this process, read-only pages are shared with all processes through the page cache
+  void* data = mmap(NULL, m->size, mode == cscript_map_copy_on_write ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping keeps its own reference to the file
+  close(fd);
+  if (data == MAP_FAILED)
+    {
+    clear_mapped_file(m);
+    return 0;
+    }
+  m->data = data;
+  switch (hint)
+    {
+    case cscript_access_sequential: madvise(data, m->size, MADV_SEQUENTIAL); break;
+    case cscript_access_random: madvise(data, m->size, MADV_RANDOM); break;
+    default: break;
+    }
+  return 1;
+  }
+
+void cscript_unmap_file(cscript_mapped_file* m)
+  {
+  if (m->data != NULL)
+    munmap(m->data, m->size);
+  clear_mapped_file(m);
+  }
+
+#endif
+
+cscript_fixnum cscript_mapped_file_argument(const cscript_mapped_file* m)
+  {
+  return (cscript_fixnum)m->data;
+  }
@@ -0,0 +1,828 @@
+#include "parallel.h"
+#include "compiler.h"
+#include "context.h"
+#include "environment.h"
+#include "error.h"
+#include "syscalls.h"
+#include "func.h"
+#include "parser.h"
+#include "thread.h"
+#include "vector.h"
+#include "vm.h"
+
+#include <string.h>
+
+typedef struct batch_queue
+  {
+  cscript_mutex mutex;
+  int begin; // first chunk that is not taken yet
+  int end; // one past the last chunk that is not taken yet
+  } batch_queue;
+
+/*
+The worker threads are kept in a process-wide pool, which is created on first use with one thread less than
+the number of logical processors, as the calling thread works as well. The threads live until the process
+exits. The pool runs one job at a time: a job that is started while the pool is busy, e.g. by another thread,
+runs on the calling thread only.
+*/
+
+typedef void (*worker_pool_function)(void* data, int worker);
+
+typedef struct worker_pool
+  {
+  cscript_mutex mutex;
+  cscript_condition job_posted;
+  cscript_condition job_done;
+  cscript_thread* threads;
+  int number_of_threads;
+  int busy; // a job is in progress
+  worker_pool_function fun; // of the current job
+  void* data; // of the current job
+  int number_of_helpers; // threads wanted by the current job
+  int number_of_claimed; // threads that took a worker of the current job
+  int number_of_running; // threads that are still running a worker of the current job
+  } worker_pool;
+
+static worker_pool* the_worker_pool = NULL;
+static cscript_once worker_pool_once = CSCRIPT_ONCE_INIT;
+
+static void worker_pool_thread(void* data)
+  {
+  worker_pool* p = (worker_pool*)data;
+  cscript_mutex_lock(&p->mutex);
+  for (;;)
+    {
+    while (p->number_of_claimed >= p->number_of_helpers)
+      cscript_condition_wait(&p->job_posted, &p->mutex);
+    const int worker = ++p->number_of_claimed;
+    ++p->number_of_running;
+    worker_pool_function fun = p->fun;
+    void* job = p->data;
+    cscript_mutex_unlock(&p->mutex);
+    fun(job, worker);
+    cscript_mutex_lock(&p->mutex);
+    if (--p->number_of_running == 0)
+      cscript_condition_signal(&p->job_done);
+    }
+  }
+
+static void worker_pool_create(void)
+  {
+  worker_pool* p = cscript_new(NULL, worker_pool);
+  cscript_mutex_init(&p->mutex);
+  cscript_condition_init(&p->job_posted);
+  cscript_condition_init(&p->job_done);
+  p->busy = 0;
+  p->fun = NULL;
+  p->data = NULL;
+  p->number_of_helpers = 0;
+  p->number_of_claimed = 0;
+  p->number_of_running = 0;
+  const int n = cscript_hardware_concurrency() - 1;
+  p->threads = cscript_newvector(NULL, n > 0 ? n : 1, cscript_thread);
+  p->number_of_threads = 0;
+  for (int i = 0; i < n; ++i)
+    {
+    if (cscript_thread_create(&p->threads[p->number_of_threads], worker_pool_thread, p))
+      ++p->number_of_threads;
+    }
+  the_worker_pool = p;
+  }
+
+// number of workers that can run at the same time: the threads of the pool and the calling thread
+static int worker_pool_size()
+  {
+  cscript_call_once(&worker_pool_once, worker_pool_create);
+  return the_worker_pool->number_of_threads + 1;
+  }
+
+/*
+Calls fun(data, 0) on the calling thread and fun(data, w) for 0 < w < number_of_workers on the threads of
+the pool, and returns when all calls have finished. Workers that do not get a thread, because the pool is
+busy or smaller, are not called, so the called workers should take over their work.
+*/
+static void worker_pool_run(worker_pool_function fun, void* data, int number_of_workers)
+  {
+  cscript_call_once(&worker_pool_once, worker_pool_create);
+  worker_pool* p = the_worker_pool;
+  int number_of_helpers = 0;
+  if (number_of_workers > 1 && p->number_of_threads > 0)
+    {
+    cscript_mutex_lock(&p->mutex);
+    if (!p->busy)
+      {
+      number_of_helpers = number_of_workers - 1 < p->number_of_threads ? number_of_workers - 1 : p->number_of_threads;
+      p->busy = 1;
+      p->fun = fun;
+      p->data = data;
+      p->number_of_claimed = 0;
+      p->number_of_helpers = number_of_helpers;
+      cscript_condition_broadcast(&p->job_posted);
+      }
+    cscript_mutex_unlock(&p->mutex);
+    }
+  fun(data, 0);
+  if (number_of_helpers > 0)
+    {
+    cscript_mutex_lock(&p->mutex);
+    p->number_of_helpers = p->number_of_claimed; // the work is done, so threads that did not start yet are not needed
+    while (p->number_of_running > 0)
+      cscript_condition_wait(&p->job_done, &p->mutex);
+    p->busy = 0;
+    cscript_mutex_unlock(&p->mutex);
+    }
+  }
+
+typedef struct batch_job
+  {
+  cscript_function* fun;
+  const cscript_fixnum* args;
+  int number_of_arguments;
+  int args_stride;
+  int count;
+  cscript_fixnum* results;
+  int chunk_size;
+  int number_of_workers;
+  batch_queue* queues;
+  cscript_context** contexts; // of each worker
+  } batch_job;
+
+static int pop_chunk(batch_queue* q)
+  {
+  int chunk = -1;
+  cscript_mutex_lock(&q->mutex);
+  if (q->begin < q->end)
+    chunk = q->begin++;
+  cscript_mutex_unlock(&q->mutex);
+  return chunk;
+  }
+
+static int steal_chunk(batch_queue* q)
+  {
+  int chunk = -1;
+  cscript_mutex_lock(&q->mutex);
+  if (q->begin < q->end)
+    chunk = --q->end;
+  cscript_mutex_unlock(&q->mutex);
+  return chunk;
+  }
+
+static void worker_run(void* data, int worker)
+  {
+  batch_job* job = (batch_job*)data;
+  cscript_context* ctxt = job->contexts[worker];
+  for (;;)
+    {
+    int chunk = pop_chunk(&job->queues[worker]);
+    for (int i = 1; chunk < 0 && i < job->number_of_workers; ++i)
+      chunk = steal_chunk(&job->queues[(worker + i) % job->number_of_workers]);
+    if (chunk < 0)
+      break;
+    const int first = chunk * job->chunk_size;
+    const int rows = job->count - first < job->chunk_size ? job->count - first : job->chunk_size;
+    cscript_run_batch(ctxt, job->fun, job->args + (size_t)first * (size_t)job->args_stride, job->number_of_arguments, job->args_stride, rows, job->results + first);
+    }
+  }
+
+void cscript_run_batch_parallel(cscript_context* ctxt, cscript_function* fun, const cscript_fixnum* args, int number_of_arguments, int args_stride, int count, cscript_fixnum* results, int number_of_threads)
+  {
+  if (count <= 0)
+    return;
+  if (number_of_threads <= 0 || number_of_threads > worker_pool_size())
+    number_of_threads = worker_pool_size();
+  int chunk_size = count / (number_of_threads * CSCRIPT_CHUNKS_PER_THREAD);
+  if (chunk_size < 1)
+    chunk_size = 1;
+  const int number_of_chunks = (count + chunk_size - 1) / chunk_size;
+  if (number_of_threads > number_of_chunks)
+    number_of_threads = number_of_chunks;
+
+  // the worker contexts are kept in a pool of ctxt, and get the current globals and externals of ctxt
+  if (ctxt->batch_contexts == NULL)
+    ctxt->batch_contexts = cscript_context_pool_new(ctxt, ctxt->stack.vector_size, 0);
+  batch_job job;
+  job.fun = fun;
+  job.args = args;
+  job.number_of_arguments = number_of_arguments;
+  job.args_stride = args_stride;
+  job.count = count;
+  job.results = results;
+  job.chunk_size = chunk_size;
+  job.number_of_workers = number_of_threads;
+  job.queues = cscript_newvector(ctxt, number_of_threads, batch_queue);
+  job.contexts = cscript_newvector(ctxt, number_of_threads, cscript_context*);
+  for (int i = 0; i < number_of_threads; ++i)
+    {
+    cscript_mutex_init(&job.queues[i].mutex);
+    job.queues[i].begin = (int)(((int64_t)number_of_chunks * i) / number_of_threads);
+    job.queues[i].end = (int)(((int64_t)number_of_chunks * (i + 1)) / number_of_threads);
+    job.contexts[i] = cscript_context_pool_acquire(ctxt->batch_contexts);
+    cscript_context_reset_shared(job.contexts[i], ctxt);
+    }
+  worker_pool_run(worker_run, &job, number_of_threads);
+  for (int i = 0; i < number_of_threads; ++i)
+    {
+    cscript_context_pool_release(ctxt->batch_contexts, job.contexts[i]);
+    cscript_mutex_destroy(&job.queues[i].mutex);
+    }
+  cscript_freevector(ctxt, job.contexts, number_of_threads, cscript_context*);
+  cscript_freevector(ctxt, job.queues, number_of_threads, batch_queue);
+  }
+
+typedef struct loop_job
+  {
+  const cscript_parallel_loop* loop;
+  cscript_externals externals;
+  const cscript_fixnum* stack; // registers of the enclosing code, which are not changed while the workers run
+  int a;
+  cscript_fixnum start;
+  cscript_fixnum count;
+  cscript_fixnum chunk_size;
+  int number_of_workers;
+  batch_queue* queues;
+  struct loop_worker* workers;
+  cscript_fixnum* partials; // the reduction values of each chunk
+  } loop_job;
+
+typedef struct loop_worker
+  {
+  cscript_fixnum* frame;
+  int failed;
+  } loop_worker;
+
+static CSCRIPT_THREAD_LOCAL int inside_parallel_loop = 0;
+
+// sums start at 0, min and max are idempotent, so they start from the value before the loop
+static void init_reductions(const cscript_parallel_loop* loop, cscript_fixnum* frame, const cscript_fixnum* stack)
+  {
+  const cscript_parallel_reduction* it = cscript_vector_begin(&loop->reductions, cscript_parallel_reduction);
+  const cscript_parallel_reduction* it_end = cscript_vector_end(&loop->reductions, cscript_parallel_reduction);
+  for (; it != it_end; ++it)
+    {
+    if (it->op == cscript_reduction_sum)
+      {
+      if (it->is_flonum)
+        {
+        cscript_flonum zero = 0;
+        memcpy(frame + it->position, &zero, sizeof(cscript_fixnum));
+        }
+      else
+        frame[it->position] = 0;
+      }
+    else
+      frame[it->position] = stack[it->position];
+    }
+  }
+
+static void store_reductions(const cscript_parallel_loop* loop, cscript_fixnum* partial, const cscript_fixnum* frame)
+  {
+  const cscript_parallel_reduction* it = cscript_vector_begin(&loop->reductions, cscript_parallel_reduction);
+  const cscript_parallel_reduction* it_end = cscript_vector_end(&loop->reductions, cscript_parallel_reduction);
+  for (; it != it_end; ++it)
+    *partial++ = frame[it->position];
+  }
+
+static void combine_reductions(const cscript_parallel_loop* loop, cscript_fixnum* target, const cscript_fixnum* partial)
+  {
+  const cscript_parallel_reduction* it = cscript_vector_begin(&loop->reductions, cscript_parallel_reduction);
+  const cscript_parallel_reduction* it_end = cscript_vector_end(&loop->reductions, cscript_parallel_reduction);
+  for (; it != it_end; ++it, ++partial)
+    {
+    if (it->is_flonum)
+      {
+      cscript_flonum* t = cast(cscript_flonum*, target + it->position);
+      const cscript_flonum v = *cast(const cscript_flonum*, partial);
+      switch (it->op)
+        {
+        case cscript_reduction_sum: *t += v; break;
+        case cscript_reduction_min: if (v < *t) *t = v; break;
+        case cscript_reduction_max: if (v > *t) *t = v; break;
+        }
+      }
+    else
+      {
+      cscript_fixnum* t = target + it->position;
+      const cscript_fixnum v = *partial;
+      switch (it->op)
+        {
+        case cscript_reduction_sum: *t += v; break;
+        case cscript_reduction_min: if (v < *t) *t = v; break;
+        case cscript_reduction_max: if (v > *t) *t = v; break;
+        }
+      }
+    }
+  }
+
+static void loop_worker_run(void* data, int worker)
+  {
+  loop_job* job = (loop_job*)data;
+  loop_worker* w = job->workers + worker;
+  const cscript_memsize number_of_reductions = job->loop->reductions.vector_size;
+  const int outer_inside_parallel_loop = inside_parallel_loop;
+  inside_parallel_loop = 1;
+  for (;;)
+    {
+    int chunk = pop_chunk(&job->queues[worker]);
+    for (int i = 1; chunk < 0 && i < job->number_of_workers; ++i)
+      chunk = steal_chunk(&job->queues[(worker + i) % job->number_of_workers]);
+    if (chunk < 0)
+      break;
+    const cscript_fixnum first = job->start + chunk * job->chunk_size;
+    cscript_fixnum last = first + job->chunk_size;
+    if (last > job->start + job->count)
+      last = job->start + job->count;
+    for (cscript_fixnum i = first; i < last && !w->failed; ++i)
+      {
+      w->frame[job->a] = i;
+      if (cscript_run_frame(job->loop->body, &job->externals, w->frame) == NULL)
+        w->failed = 1;
+      }
+    if (number_of_reductions > 0)
+      {
+      store_reductions(job->loop, job->partials + chunk * number_of_reductions, w->frame);
+      init_reductions(job->loop, w->frame, job->stack);
+      }
+    }
+  inside_parallel_loop = outer_inside_parallel_loop;
+  }
+
+int cscript_run_parallel_loop(const cscript_function* fun, int loop_index, cscript_fixnum* stack, int a, cscript_fixnum* globals, const cscript_external_function* externals)
+  {
+  if (loop_index < 0 || loop_index >= (int)fun->parallel_loops.vector_size)
+    return 0;
+  const cscript_parallel_loop* loop = cscript_vector_at(&fun->parallel_loops, loop_index, cscript_parallel_loop);
+  const cscript_fixnum start = stack[a];
+  const cscript_fixnum end = stack[a + 1];
+  const cscript_fixnum count = end > start ? end - start : 0;
+  cscript_externals ext;
+  ext.functions = externals;
+  ext.globals = globals;
+
+  if (inside_parallel_loop || count < CSCRIPT_PARALLEL_FOR_MIN_ITERATIONS)
+    {
+    // the body uses the same register layout as the enclosing code, so it can run on the calling frame
+    for (cscript_fixnum i = start; i < end; ++i)
+      {
+      stack[a] = i;
+      if (cscript_run_frame(loop->body, &ext, stack) == NULL)
+        return 0;
+      }
+    stack[a] = end > start ? end : start;
+    return 1;
+    }
+
+  // the chunks do not depend on the number of threads, so that the reductions are combined in the same way,
+  // also if there is a single thread
+  int number_of_threads = worker_pool_size();
+  const cscript_fixnum chunk_size = (count + CSCRIPT_PARALLEL_FOR_CHUNKS - 1) / CSCRIPT_PARALLEL_FOR_CHUNKS;
+  const cscript_fixnum number_of_chunks = (count + chunk_size - 1) / chunk_size;
+  if (number_of_threads > number_of_chunks)
+    number_of_threads = (int)number_of_chunks;
+  const cscript_memsize number_of_partials = cast(cscript_memsize, number_of_chunks) * loop->reductions.vector_size;
+
+  loop_job job;
+  job.loop = loop;
+  job.externals = ext;
+  job.stack = stack;
+  job.a = a;
+  job.start = start;
+  job.count = count;
+  job.chunk_size = chunk_size;
+  job.number_of_workers = number_of_threads;
+  job.queues = cscript_newvector(NULL, number_of_threads, batch_queue);
+  loop_worker* workers = cscript_newvector(NULL, number_of_threads, loop_worker);
+  job.workers = workers;
+  job.partials = number_of_partials > 0 ? cscript_newvector(NULL, number_of_partials, cscript_fixnum) : NULL;
+  cscript_memsize frame_size = loop->body->frame_size;
+  if (frame_size < cast(cscript_memsize, a + 2))
+    frame_size = cast(cscript_memsize, a + 2);
+  for (int i = 0; i < number_of_threads; ++i)
+    {
+    cscript_mutex_init(&job.queues[i].mutex);
+    job.queues[i].begin = (int)((number_of_chunks * i) / number_of_threads);
+    job.queues[i].end = (int)((number_of_chunks * (i + 1)) / number_of_threads);
+    workers[i].frame = cscript_newvector(NULL, frame_size, cscript_fixnum);
+    memcpy(workers[i].frame, stack, (a + 2) * sizeof(cscript_fixnum));
+    init_reductions(loop, workers[i].frame, stack);
+    workers[i].failed = 0;
+    }
+  worker_pool_run(loop_worker_run, &job, number_of_threads);
+  int failed = 0;
+  for (int i = 0; i < number_of_threads; ++i)
+    {
+    failed |= workers[i].failed;
+    cscript_freevector(NULL, workers[i].frame, frame_size, cscript_fixnum);
+    cscript_mutex_destroy(&job.queues[i].mutex);
+    }
+  // combined in the order of the chunks, so that sums of floats do not depend on which worker ran which chunk
+  for (cscript_fixnum chunk = 0; chunk < number_of_chunks && number_of_partials > 0; ++chunk)
+    combine_reductions(loop, stack, job.partials + chunk * loop->reductions.vector_size);
+  if (job.partials != NULL)
+    cscript_freevector(NULL, job.partials, number_of_partials, cscript_fixnum);
+  cscript_freevector(NULL, workers, number_of_threads, loop_worker);
+  cscript_freevector(NULL, job.queues, number_of_threads, batch_queue);
+  stack[a] = end;
+  return failed ? 0 : 1;
+  }
+
+/*
+Scripts of a batch are compiled concurrently, each in a worker context that declares the global variables of
+ctxt as they were before the batch. A worker context is replaced after a script declares global variables, so
+that every script is compiled against the same declarations. Afterwards the results are merged into ctxt in the
+order of the batch: the global variables that a script declared are declared in ctxt, and the global variable
+operands of its code are remapped to their positions in ctxt, as bundle.c does when loading. A script is only
+compiled again on ctxt if it would compile differently there: if a global variable that it uses got another
+type by an earlier script of the batch, or if it failed while earlier scripts or the script itself declared
+global variables, as compiling it on ctxt then gives other errors or leaves other declarations.
+*/
+
+typedef struct compile_batch_result
+  {
+  cscript_function* fun;
+  cscript_context* owner; // context that allocated fun, the declarations and the error reports
+  int declares; // the compilation changed the global variables of its context
+  cscript_memsize number_of_globals; // of the worker context after the compilation
+  cscript_vector declarations; // vector of type cscript_global_declaration
+  cscript_vector errors; // vector of type compile_batch_error
+  } compile_batch_result;
+
+// a global variable of ctxt at the start of the batch
+typedef struct batch_global
+  {
+  cscript_string name; // string_ptr is NULL if no name refers to the position anymore
+  int register_type;
+  } batch_global;
+
+typedef struct compile_batch_error
+  {
+  int kind; // 0: syntax error, 1: compile error, 2: runtime error
+  cscript_error_report report;
+  } compile_batch_error;
+
+typedef struct retired_context
+  {
+  cscript_context* ctxt;
+  struct retired_context* next;
+  } retired_context;
+
+typedef struct compile_batch_worker
+  {
+  cscript_context* ctxt;
+  retired_context* retired; // contexts that own results, but that were replaced after a script declared globals
+  } compile_batch_worker;
+
+typedef struct compile_batch_job
+  {
+  cscript_context* ctxt;
+  const char** scripts;
+  const cscript_compile_options* options;
+  compile_batch_result* results;
+  batch_queue queue;
+  compile_batch_worker* workers;
+  } compile_batch_job;
+
+static cscript_context* compile_context_new(cscript_context* ctxt)
+  {
+  cscript_context* compile_ctxt = cscript_context_init_shared(ctxt, 1);
+  cscript_context_copy_declarations(compile_ctxt, ctxt);
+  return compile_ctxt;
+  }
+
+static void move_reports(cscript_vector* errors, cscript_context* ctxt, cscript_vector* reports, int kind)
+  {
+  cscript_error_report* it = cscript_vector_begin(reports, cscript_error_report);
+  cscript_error_report* it_end = cscript_vector_end(reports, cscript_error_report);
+  for (; it != it_end; ++it)
+    {
+    compile_batch_error e;
+    e.kind = kind;
+    e.report = *it;
+    cscript_vector_push_back(ctxt, errors, e, compile_batch_error);
+    }
+  reports->vector_size = 0;
+  }
+
+// moves the error reports of ctxt to errors, which then owns the messages
+static void take_errors(cscript_vector* errors, cscript_context* ctxt)
+  {
+  cscript_vector_init(ctxt, errors, compile_batch_error);
+  move_reports(errors, ctxt, &ctxt->syntax_error_reports, 0);
+  move_reports(errors, ctxt, &ctxt->compile_error_reports, 1);
+  move_reports(errors, ctxt, &ctxt->runtime_error_reports, 2);
+  ctxt->number_of_syntax_errors = 0;
+  ctxt->number_of_compile_errors = 0;
+  ctxt->number_of_runtime_errors = 0;
+  }
+
+static void destroy_errors(cscript_vector* errors, cscript_context* ctxt)
+  {
+  compile_batch_error* it = cscript_vector_begin(errors, compile_batch_error);
+  compile_batch_error* it_end = cscript_vector_end(errors, compile_batch_error);
+  for (; it != it_end; ++it)
+    cscript_string_destroy(ctxt, &it->report.message);
+  cscript_vector_destroy(ctxt, errors);
+  }
+
+static void compile_batch_worker_run(void* data, int worker)
+  {
+  compile_batch_job* job = (compile_batch_job*)data;
+  compile_batch_worker* w = job->workers + worker;
+  for (;;)
+    {
+    const int i = pop_chunk(&job->queue);
+    if (i < 0)
+      break;
+    compile_batch_result* r = job->results + i;
+    const cscript_memsize number_of_globals = w->ctxt->globals.vector_size;
+    cscript_vector_init(w->ctxt, &r->declarations, cscript_global_declaration);
+    w->ctxt->declaration_log = &r->declarations;
+    r->fun = cscript_compile_ex(w->ctxt, job->scripts[i], job->options);
+    w->ctxt->declaration_log = NULL;
+    r->owner = w->ctxt;
+    r->number_of_globals = w->ctxt->globals.vector_size;
+    r->declares = r->number_of_globals != number_of_globals ? 1 : 0;
+    take_errors(&r->errors, w->ctxt);
+    if (r->declares)
+      {
+      // the next scripts should be compiled against the declarations of ctxt only
+      retired_context* retired = cscript_new(w->ctxt, retired_context);
+      retired->ctxt = w->ctxt;
+      retired->next = w->retired;
+      w->retired = retired;
+      w->ctxt = compile_context_new(job->ctxt);
+      }
+    }
+  }
+
+static void destroy_declarations(cscript_vector* declarations, cscript_context* ctxt)
+  {
+  cscript_global_declaration* it = cscript_vector_begin(declarations, cscript_global_declaration);
+  cscript_global_declaration* it_end = cscript_vector_end(declarations, cscript_global_declaration);
+  for (; it != it_end; ++it)
+    cscript_string_destroy(ctxt, &it->name);
+  cscript_vector_destroy(ctxt, declarations);
+  }
+
+// the names and types of the global variables of ctxt, indexed by position
+static batch_global* snapshot_globals(cscript_context* ctxt)
+  {
+  const cscript_memsize number_of_globals = ctxt->globals.vector_size;
+  batch_global* snapshot = cscript_newvector(ctxt, number_of_globals > 0 ? number_of_globals : 1, batch_global);
+  memset(snapshot, 0, (number_of_globals > 0 ? number_of_globals : 1) * sizeof(batch_global));
+  const cscript_memsize size = cscript_environment_base_size(ctxt);
+  for (cscript_memsize i = 0; i < size; ++i)
+    {
+    cscript_environment_entry entry;
+    cscript_string name;
+    if (cscript_environment_base_at(&entry, &name, ctxt, i) && entry.type == CSCRIPT_ENV_TYPE_GLOBAL && entry.position < cast(cscript_fixnum, number_of_globals))
+      {
+      cscript_string_copy(ctxt, &snapshot[entry.position].name, &name);
+      snapshot[entry.position].register_type = entry.register_type;
+      }
+    }
+  return snapshot;
+  }
+
+static void free_snapshot(cscript_context* ctxt, batch_global* snapshot, cscript_memsize number_of_globals)
+  {
+  for (cscript_memsize i = 0; i < number_of_globals; ++i)
+    {
+    if (snapshot[i].name.string_ptr != NULL)
+      cscript_string_destroy(ctxt, &snapshot[i].name);
+    }
+  cscript_freevector(ctxt, snapshot, number_of_globals > 0 ? number_of_globals : 1, batch_global);
+  }
+
+/*
+Finds the positions in ctxt of the global variables of the snapshot that fun uses, and fills them in remap.
+Returns 0 if one of them is no longer a global variable of the same type in ctxt.
+*/
+static int remap_snapshot_globals(cscript_context* ctxt, const cscript_function* fun, batch_global* snapshot, cscript_memsize snapshot_size, cscript_fixnum* remap)
+  {
+  const cscript_instruction* it = cscript_vector_begin(&fun->code, cscript_instruction);
+  const cscript_instruction* it_end = cscript_vector_end(&fun->code, cscript_instruction);
+  for (; it != it_end; ++it)
+    {
+    const cscript_opcode op = CSCRIPT_GET_OPCODE(*it);
+    if (op != CSCRIPT_OPCODE_LOADGLOBAL && op != CSCRIPT_OPCODE_STOREGLOBAL)
+      continue;
+    const cscript_memsize position = cast(cscript_memsize, CSCRIPT_GETARG_Bx(*it));
+    if (position >= snapshot_size || remap[position] >= 0)
+      continue;
+    cscript_environment_entry entry;
+    if (snapshot[position].name.string_ptr == NULL || !cscript_environment_find_recursive(&entry, ctxt, &snapshot[position].name))
+      return 0;
+    if (entry.type != CSCRIPT_ENV_TYPE_GLOBAL || entry.register_type != snapshot[position].register_type)
+      return 0;
+    remap[position] = entry.position;
+    }
+  const cscript_parallel_loop* loop = cscript_vector_begin(&fun->parallel_loops, cscript_parallel_loop);
+  const cscript_parallel_loop* loop_end = cscript_vector_end(&fun->parallel_loops, cscript_parallel_loop);
+  for (; loop != loop_end; ++loop)
+    {
+    if (!remap_snapshot_globals(ctxt, loop->body, snapshot, snapshot_size, remap))
+      return 0;
+    }
+  return 1;
+  }
+
+// a global variable that is used before it is declared becomes a float, unless ctxt already knows the name
+static int implicit_declarations_fit(cscript_context* ctxt, cscript_vector* declarations)
+  {
+  cscript_global_declaration* it = cscript_vector_begin(declarations, cscript_global_declaration);
+  cscript_global_declaration* it_end = cscript_vector_end(declarations, cscript_global_declaration);
+  for (; it != it_end; ++it)
+    {
+    cscript_environment_entry entry;
+    if (it->implicit && cscript_environment_find_recursive(&entry, ctxt, &it->name) && (entry.type != CSCRIPT_ENV_TYPE_GLOBAL || entry.register_type != it->register_type))
+      return 0;
+    }
+  return 1;
+  }
+
+// declares the global variables of a script in ctxt as compiling it on ctxt would, and fills their positions in remap
+static void merge_declarations(cscript_context* ctxt, cscript_vector* declarations, cscript_fixnum* remap)
+  {
+  cscript_global_declaration* it = cscript_vector_begin(declarations, cscript_global_declaration);
+  cscript_global_declaration* it_end = cscript_vector_end(declarations, cscript_global_declaration);
+  for (; it != it_end; ++it)
+    {
+    cscript_environment_entry entry;
+    if (!it->implicit || !cscript_environment_find_recursive(&entry, ctxt, &it->name))
+      {
+      entry.type = CSCRIPT_ENV_TYPE_GLOBAL;
+      entry.position = ctxt->globals.vector_size;
+      entry.register_type = it->register_type;
+      cscript_string name;
+      cscript_string_copy(ctxt, &name, &it->name);
+      cscript_environment_add_to_base(ctxt, &name, entry);
+      cscript_vector_push_back(ctxt, &ctxt->globals, 0, cscript_fixnum);
+      }
+    remap[it->position] = entry.position;
+    }
+  }
+
+static void remap_globals(cscript_function* fun, const cscript_fixnum* remap)
+  {
+  cscript_instruction* it = cscript_vector_begin(&fun->code, cscript_instruction);
+  cscript_instruction* it_end = cscript_vector_end(&fun->code, cscript_instruction);
+  for (; it != it_end; ++it)
+    {
+    const cscript_opcode op = CSCRIPT_GET_OPCODE(*it);
+    if (op == CSCRIPT_OPCODE_LOADGLOBAL || op == CSCRIPT_OPCODE_STOREGLOBAL)
+      CSCRIPT_SETARG_Bx(*it, cast(int, remap[CSCRIPT_GETARG_Bx(*it)]));
+    }
+  cscript_parallel_loop* loop = cscript_vector_begin(&fun->parallel_loops, cscript_parallel_loop);
+  cscript_parallel_loop* loop_end = cscript_vector_end(&fun->parallel_loops, cscript_parallel_loop);
+  for (; loop != loop_end; ++loop)
+    remap_globals(loop->body, remap);
+  }
+
+/*
+Merges a script that a worker compiled successfully into ctxt, as if it had been compiled on ctxt.
+Returns 0, leaving ctxt unchanged, if the script would have compiled differently on ctxt.
+*/
+static int merge_result(cscript_context* ctxt, compile_batch_result* r, batch_global* snapshot, cscript_memsize snapshot_size)
+  {
+  if (r->number_of_globals == 0 || (r->declarations.vector_size == 0 && ctxt->globals.vector_size == snapshot_size))
+    return 1; // the declarations of ctxt are still the ones the script was compiled against
+  if (ctxt->globals.vector_size + r->declarations.vector_size > cast(cscript_memsize, CSCRIPT_MAXARG_Bx))
+    return 0;
+  cscript_fixnum* remap = cscript_newvector(ctxt, r->number_of_globals, cscript_fixnum);
+  for (cscript_memsize i = 0; i < r->number_of_globals; ++i)
+    remap[i] = -1;
+  // the checks use ctxt before the declarations of the script, as the compilation of the script did
+  const int fits = remap_snapshot_globals(ctxt, r->fun, snapshot, snapshot_size, remap) && implicit_declarations_fit(ctxt, &r->declarations);
+  if (fits)
+    {
+    merge_declarations(ctxt, &r->declarations, remap);
+    remap_globals(r->fun, remap);
+    }
+  cscript_freevector(ctxt, remap, r->number_of_globals, cscript_fixnum);
+  return fits;
+  }
+
+// copies the error reports of script i to the reports of ctxt, prefixed with the index of the script
+static void report_errors(cscript_context* ctxt, const cscript_vector* errors, int i)
+  {
+  char number[32];
+  cscript_int_to_char(number, i);
+  const compile_batch_error* it = cscript_vector_begin(errors, compile_batch_error);
+  const compile_batch_error* it_end = cscript_vector_end(errors, compile_batch_error);
+  for (; it != it_end; ++it)
+    {
+    cscript_error_report report = it->report;
+    cscript_string_init(ctxt, &report.message, "script ");
+    cscript_string_append_cstr(ctxt, &report.message, number);
+    cscript_string_append_cstr(ctxt, &report.message, ": ");
+    cscript_string_append(ctxt, &report.message, cast(cscript_string*, &it->report.message));
+    switch (it->kind)
+      {
+      case 0:
+        cscript_vector_push_back(ctxt, &ctxt->syntax_error_reports, report, cscript_error_report);
+        ++ctxt->number_of_syntax_errors;
+        break;
+      case 1:
+        cscript_vector_push_back(ctxt, &ctxt->compile_error_reports, report, cscript_error_report);
+        ++ctxt->number_of_compile_errors;
+        break;
+      default:
+        cscript_vector_push_back(ctxt, &ctxt->runtime_error_reports, report, cscript_error_report);
+        ++ctxt->number_of_runtime_errors;
+        break;
+      }
+    }
+  }
+
+int cscript_compile_batch_ex(cscript_context* ctxt, const char** scripts, int number_of_scripts, cscript_function** functions, const cscript_compile_options* options, int number_of_threads)
+  {
+  cscript_syntax_errors_clear(ctxt);
+  cscript_compile_errors_clear(ctxt);
+  cscript_runtime_errors_clear(ctxt);
+  if (number_of_scripts <= 0)
+    return 0;
+  if (number_of_threads <= 0 || number_of_threads > worker_pool_size())
+    number_of_threads = worker_pool_size();
+  if (number_of_threads > number_of_scripts)
+    number_of_threads = number_of_scripts;
+
+  compile_batch_job job;
+  job.ctxt = ctxt;
+  job.scripts = scripts;
+  job.options = options;
+  job.results = cscript_newvector(ctxt, number_of_scripts, compile_batch_result);
+  cscript_mutex_init(&job.queue.mutex);
+  job.queue.begin = 0;
+  job.queue.end = number_of_scripts;
+  compile_batch_worker* workers = cscript_newvector(ctxt, number_of_threads, compile_batch_worker);
+  job.workers = workers;
+  for (int i = 0; i < number_of_threads; ++i)
+    {
+    workers[i].ctxt = compile_context_new(ctxt);
+    workers[i].retired = NULL;
+    }
+  // the scripts are taken from one queue, so the workers that get a thread of the pool take over the others
+  worker_pool_run(compile_batch_worker_run, &job, number_of_threads);
+
+  // merge in the order of the scripts
+  const cscript_memsize snapshot_size = ctxt->globals.vector_size;
+  batch_global* snapshot = snapshot_globals(ctxt);
+  cscript_vector errors;
+  int number_of_failures = 0;
+  for (int i = 0; i < number_of_scripts; ++i)
+    {
+    compile_batch_result* r = job.results + i;
+    int merged;
+    if (r->fun != NULL)
+      merged = merge_result(ctxt, r, snapshot, snapshot_size);
+    else
+      merged = !r->declares && ctxt->globals.vector_size == snapshot_size;
+    destroy_declarations(&r->declarations, r->owner);
+    if (merged)
+      {
+      functions[i] = r->fun;
+      }
+    else
+      {
+      if (r->fun != NULL)
+        cscript_function_free(r->owner, r->fun);
+      destroy_errors(&r->errors, r->owner);
+      functions[i] = cscript_compile_ex(ctxt, scripts[i], options);
+      take_errors(&errors, ctxt);
+      r->errors = errors;
+      r->owner = ctxt;
+      }
+    if (functions[i] == NULL)
+      ++number_of_failures;
+    }
+  free_snapshot(ctxt, snapshot, snapshot_size);
+  // the reports are added at the end, as compiling on ctxt clears its reports
+  for (int i = 0; i < number_of_scripts; ++i)
+    {
+    compile_batch_result* r = job.results + i;
+    report_errors(ctxt, &r->errors, i);
+    destroy_errors(&r->errors, r->owner);
+    }
+
+  for (int i = 0; i < number_of_threads; ++i)
+    {
+    while (workers[i].retired != NULL)
+      {
+      retired_context* retired = workers[i].retired;
+      workers[i].retired = retired->next;
+      cscript_context* retired_ctxt = retired->ctxt;
+      cscript_delete(retired_ctxt, retired);
+      cscript_context_destroy(retired_ctxt);
+      }
+    cscript_context_destroy(workers[i].ctxt);
+    }
+  cscript_mutex_destroy(&job.queue.mutex);
+  cscript_freevector(ctxt, workers, number_of_threads, compile_batch_worker);
+  cscript_freevector(ctxt, job.results, number_of_scripts, compile_batch_result);
+  return number_of_failures;
+  }
+
+int cscript_compile_batch(cscript_context* ctxt, const char** scripts, int number_of_scripts, cscript_function** functions)
+  {
+  return cscript_compile_batch_ex(ctxt, scripts, number_of_scripts, functions, NULL, 0);
+  }
@@ -0,0 +1,41 @@
+#ifndef CSCRIPT_PARALLEL_H
+#define CSCRIPT_PARALLEL_H
+
+#include "cscript.h"
+
+/*
+The rows of a batch are split in chunks, such that each worker thread initially owns
+CSCRIPT_CHUNKS_PER_THREAD chunks. Workers that run out of chunks steal chunks from the
+back of the other workers' ranges.
+*/
+#ifndef CSCRIPT_CHUNKS_PER_THREAD
+#define CSCRIPT_CHUNKS_PER_THREAD 8
+#endif
+
+/*
+Parallel for loops with fewer iterations than CSCRIPT_PARALLEL_FOR_MIN_ITERATIONS run sequentially
+on the calling thread, as handing them to the worker threads costs more than it gains.
+*/
+#ifndef CSCRIPT_PARALLEL_FOR_MIN_ITERATIONS
+#define CSCRIPT_PARALLEL_FOR_MIN_ITERATIONS 256
+#endif
+
+/*
+The iterations of a parallel for loop are split in CSCRIPT_PARALLEL_FOR_CHUNKS chunks, whatever the
+number of threads (also a single one), which are divided over the workers as the rows of a batch.
+*/
+#ifndef CSCRIPT_PARALLEL_FOR_CHUNKS
+#define CSCRIPT_PARALLEL_FOR_CHUNKS 64
+#endif
+
+/*
+Runs parallel loop loop_index of fun for stack[a] <= i < stack[a+1] (see CSCRIPT_PARALLEL_FOR).
+Each worker runs the loop body on its own copy of the registers of the enclosing code.
+Sums start at 0 in each chunk, min and max at the value before the loop, and the values of the chunks are combined
+in chunk order afterwards, so float sums give the same result whichever worker ran which chunk.
+Parallel loops that are nested inside the body of another parallel loop run sequentially.
+Returns 0 if the body could not be executed.
+*/
+int cscript_run_parallel_loop(const cscript_function* fun, int loop_index, cscript_fixnum* stack, int a, cscript_fixnum* globals, const cscript_external_function* externals);
+
+#endif //CSCRIPT_PARALLEL_H
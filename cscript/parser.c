@@ -2,6 +2,7 @@
 #include "error.h"
 #include "context.h"
 #include "visitor.h"
+#include "thread.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -50,8 +51,9 @@ static token make_bad_token()
   return t;
   }
 
-token popped_token;
-token last_token;
+// per thread, so that scripts can be parsed concurrently (see cscript_compile_batch)
+static CSCRIPT_THREAD_LOCAL token popped_token;
+static CSCRIPT_THREAD_LOCAL token last_token;
 
 static void invalidate_popped()
   {
@@ -92,7 +94,7 @@ static int check_token_available(cscript_context* ctxt, token** token_it, token*
   return 1;
   }
 
-static int token_require(cscript_context* ctxt, token** token_it, token** token_it_end, const char* required)
+static int token_require(cscript_context* ctxt, token** token_it, token** token_it_end, int required)
   {
   if (*token_it == *token_it_end)
     {
@@ -104,12 +106,12 @@ static int token_require(cscript_context* ctxt, token** token_it, token** token_
     }
   else
     {
-    if (strcmp((*token_it)->value.string_ptr, required) != 0)
+    if ((*token_it)->type != required)
       {
       cscript_string* fn = NULL;
       if (ctxt->filenames_list.vector_size > 0)
         fn = cscript_vector_back(&ctxt->filenames_list, cscript_string);
-      cscript_syntax_error_cstr(ctxt, CSCRIPT_ERROR_EXPECTED_KEYWORD, (*token_it)->line_nr, (*token_it)->column_nr, fn, required);
+      cscript_syntax_error_cstr(ctxt, CSCRIPT_ERROR_EXPECTED_KEYWORD, (*token_it)->line_nr, (*token_it)->column_nr, fn, cscript_token_type_text(required));
       return 0;
       }
     popped_token = (**token_it);
@@ -119,28 +121,7 @@ static int token_require(cscript_context* ctxt, token** token_it, token** token_
     }
   }
 
-static int next_token_equals(token** token_it, token** token_it_end, const char* expected)
-  {
-  if (*token_it == *token_it_end)
-    return 0;
-  token* it = *token_it;
-  ++it;
-  if (it == *token_it_end)
-    return 0;
-  return strcmp(it->value.string_ptr, expected) == 0;
-  }
-
-static int next_token_type(token** token_it, token** token_it_end)
-  {
-  if (*token_it == *token_it_end)
-    return CSCRIPT_T_BAD;
-  token* it = *token_it;
-  ++it;
-  if (it == *token_it_end)
-    return CSCRIPT_T_BAD;
-  return it->type;
-  }
-
+// for the words that are no keywords (see cscript_keyword_type), keywords and operators are recognized by their token type
 static int current_token_equals(token** token_it, token** token_it_end, const char* expected)
   {
   if (*token_it == *token_it_end)
@@ -164,12 +145,12 @@ static void check_for_semicolon(cscript_context* ctxt, token** token_it, token**
     optional = 1;
   if (optional)
     {
-    if (current_token_equals(token_it, token_it_end, ";"))
+    if (current_token_type(token_it, token_it_end) == CSCRIPT_T_SEMICOLON)
       token_next(ctxt, token_it, token_it_end);
     }
   else
     {
-    token_require(ctxt, token_it, token_it_end, ";");
+    token_require(ctxt, token_it, token_it_end, CSCRIPT_T_SEMICOLON);
     }
   }
 
@@ -196,7 +177,7 @@ cscript_parsed_function make_function(cscript_context* ctxt, token** token_it, t
   cscript_string_copy(ctxt, &f.name, &(*token_it)->value);
   cscript_vector_init(ctxt, &f.args, cscript_parsed_expression);
   token_next(ctxt, token_it, token_it_end);
-  token_require(ctxt, token_it, token_it_end, "(");
+  token_require(ctxt, token_it, token_it_end, CSCRIPT_T_LEFT_ROUND_BRACKET);
   if (current_token_type(token_it, token_it_end) == CSCRIPT_T_RIGHT_ROUND_BRACKET)
     {
     token_next(ctxt, token_it, token_it_end);
@@ -210,7 +191,7 @@ cscript_parsed_function make_function(cscript_context* ctxt, token** token_it, t
     e = cscript_make_expression(ctxt, token_it, token_it_end);
     cscript_vector_push_back(ctxt, &f.args, e, cscript_parsed_expression);
     }
-  token_require(ctxt, token_it, token_it_end, ")");
+  token_require(ctxt, token_it, token_it_end, CSCRIPT_T_RIGHT_ROUND_BRACKET);
   return f;
   }
 
@@ -222,6 +203,7 @@ cscript_parsed_variable make_variable(cscript_context* ctxt, token** token_it, t
   var.filename = make_null_string();
   var.dims = make_null_vector();
   var.dereference = 0;
+  var.symbol = -1;
   if ((*token_it)->type == CSCRIPT_T_MUL)
     {
     var.dereference = 1;
@@ -237,7 +219,7 @@ cscript_parsed_variable make_variable(cscript_context* ctxt, token** token_it, t
     token_next(ctxt, token_it, token_it_end);
     cscript_parsed_expression expr = cscript_make_expression(ctxt, token_it, token_it_end);
     cscript_vector_push_back(ctxt, &var.dims, expr, cscript_parsed_expression);
-    token_require(ctxt, token_it, token_it_end, "]");
+    token_require(ctxt, token_it, token_it_end, CSCRIPT_T_RIGHT_SQUARE_BRACKET);
     }
   return var;
   }
@@ -261,10 +243,10 @@ cscript_parsed_expression_list make_expression_list(cscript_context* ctxt, token
   l.line_nr = (*token_it)->line_nr;
   l.filename = make_null_string();
   l.expressions = make_null_vector();
-  token_require(ctxt, token_it, token_it_end, "{");
+  token_require(ctxt, token_it, token_it_end, CSCRIPT_T_LEFT_CURLY_BRACE);
   if (current_token_type(token_it, token_it_end) == CSCRIPT_T_RIGHT_CURLY_BRACE)
     {
-    token_require(ctxt, token_it, token_it_end, "}");
+    token_require(ctxt, token_it, token_it_end, CSCRIPT_T_RIGHT_CURLY_BRACE);
     return l;
     }
   cscript_vector_init(ctxt, &l.expressions, cscript_parsed_expression);
@@ -276,7 +258,7 @@ cscript_parsed_expression_list make_expression_list(cscript_context* ctxt, token
     e = cscript_make_expression(ctxt, token_it, token_it_end);
     cscript_vector_push_back(ctxt, &l.expressions, e, cscript_parsed_expression);
     }
-  token_require(ctxt, token_it, token_it_end, "}");
+  token_require(ctxt, token_it, token_it_end, CSCRIPT_T_RIGHT_CURLY_BRACE);
   return l;
   }
 
@@ -286,12 +268,12 @@ cscript_parsed_factor cscript_make_factor(cscript_context* ctxt, token** token_i
   expr.sign = '+';
   int line_nr = (*token_it)->line_nr;
   int column_nr = (*token_it)->column_nr;
-  if (current_token_equals(token_it, token_it_end, "+"))
+  if (current_token_type(token_it, token_it_end) == CSCRIPT_T_PLUS)
     {
     expr.sign = '+';
     token_next(ctxt, token_it, token_it_end);
     }
-  else if (current_token_equals(token_it, token_it_end, "-"))
+  else if (current_token_type(token_it, token_it_end) == CSCRIPT_T_MINUS)
     {
     expr.sign = '-';
     token_next(ctxt, token_it, token_it_end);
@@ -313,7 +295,7 @@ cscript_parsed_factor cscript_make_factor(cscript_context* ctxt, token** token_i
       token_next(ctxt, token_it, token_it_end);
       expr.factor.expr = cscript_make_expression(ctxt, token_it, token_it_end);
       expr.type = cscript_factor_type_expression;
-      token_require(ctxt, token_it, token_it_end, ")");
+      token_require(ctxt, token_it, token_it_end, CSCRIPT_T_RIGHT_ROUND_BRACKET);
       break;
     case CSCRIPT_T_FLONUM:
       expr.factor.number.column_nr = column_nr;
@@ -395,14 +377,9 @@ cscript_parsed_term cscript_make_term(cscript_context* ctxt, token** token_it, t
   cscript_vector_push_back(ctxt, &expr.operands, f1, cscript_parsed_factor);
   while (1)
     {
-    if (token_it == token_it_end)
-      break;
-    if ((*token_it)->value.string_length != 1)
-      break;
-    char op = (*token_it)->value.string_ptr[0];
-    switch (op)
+    switch (current_token_type(token_it, token_it_end))
       {
-      case '*':
+      case CSCRIPT_T_MUL:
       {
       cscript_vector_push_back(ctxt, &expr.fops, cscript_op_mul, int);
       token_next(ctxt, token_it, token_it_end);
@@ -410,7 +387,7 @@ cscript_parsed_term cscript_make_term(cscript_context* ctxt, token** token_it, t
       cscript_vector_push_back(ctxt, &expr.operands, f2, cscript_parsed_factor);
       continue;
       }
-      case '/':
+      case CSCRIPT_T_DIV:
       {
       cscript_vector_push_back(ctxt, &expr.fops, cscript_op_div, int);
       token_next(ctxt, token_it, token_it_end);
@@ -418,7 +395,7 @@ cscript_parsed_term cscript_make_term(cscript_context* ctxt, token** token_it, t
       cscript_vector_push_back(ctxt, &expr.operands, f2, cscript_parsed_factor);
       continue;
       }
-      case '%':
+      case CSCRIPT_T_PERCENT:
       {
       cscript_vector_push_back(ctxt, &expr.fops, cscript_op_percent, int);
       token_next(ctxt, token_it, token_it_end);
@@ -446,14 +423,9 @@ cscript_parsed_relop cscript_make_relop(cscript_context* ctxt, token** token_it,
   cscript_vector_push_back(ctxt, &expr.operands, t1, cscript_parsed_term);
   while (1)
     {
-    if (token_it == token_it_end)
-      break;
-    if ((*token_it)->value.string_length != 1)
-      break;
-    char op = (*token_it)->value.string_ptr[0];
-    switch (op)
+    switch (current_token_type(token_it, token_it_end))
       {
-      case '+':
+      case CSCRIPT_T_PLUS:
       {
       cscript_vector_push_back(ctxt, &expr.fops, cscript_op_plus, int);
       token_next(ctxt, token_it, token_it_end);
@@ -461,7 +433,7 @@ cscript_parsed_relop cscript_make_relop(cscript_context* ctxt, token** token_it,
       cscript_vector_push_back(ctxt, &expr.operands, t2, cscript_parsed_term);
       continue;
       }
-      case '-':
+      case CSCRIPT_T_MINUS:
       {
       cscript_vector_push_back(ctxt, &expr.fops, cscript_op_minus, int);
       token_next(ctxt, token_it, token_it_end);
@@ -490,9 +462,10 @@ cscript_statement make_int(cscript_context* ctxt, token** token_it, token** toke
     i.column_nr = (*token_it)->column_nr;
     i.filename = make_null_string();
     i.expr = make_null_expr();
+    i.symbol = -1;
     cscript_vector_init(ctxt, &i.dims, cscript_parsed_expression);
     if (first_time)
-      token_require(ctxt, token_it, token_it_end, "int");
+      token_require(ctxt, token_it, token_it_end, CSCRIPT_T_KEYWORD_INT);
 
     if (check_token_available(ctxt, token_it, token_it_end))
       cscript_string_copy(ctxt, &i.name, &(*token_it)->value);
@@ -504,7 +477,7 @@ cscript_statement make_int(cscript_context* ctxt, token** token_it, token** toke
       token_next(ctxt, token_it, token_it_end);
       cscript_parsed_expression expr = cscript_make_expression(ctxt, token_it, token_it_end);
       cscript_vector_push_back(ctxt, &i.dims, expr, cscript_parsed_expression);
-      token_require(ctxt, token_it, token_it_end, "]");
+      token_require(ctxt, token_it, token_it_end, CSCRIPT_T_RIGHT_SQUARE_BRACKET);
       }
     if (current_token_type(token_it, token_it_end) == CSCRIPT_T_LEFT_SQUARE_BRACKET)
       {
@@ -525,7 +498,7 @@ cscript_statement make_int(cscript_context* ctxt, token** token_it, token** toke
     cscript_vector_push_back(ctxt, &stmts.statements, stmt, cscript_statement);
     if (current_token_type(token_it, token_it_end) == CSCRIPT_T_COMMA)
       {
-      token_require(ctxt, token_it, token_it_end, ",");
+      token_require(ctxt, token_it, token_it_end, CSCRIPT_T_COMMA);
       }
     else
       {
@@ -553,9 +526,10 @@ cscript_statement make_float(cscript_context* ctxt, token** token_it, token** to
     f.column_nr = (*token_it)->column_nr;
     f.filename = make_null_string();
     f.expr = make_null_expr();
+    f.symbol = -1;
     cscript_vector_init(ctxt, &f.dims, cscript_parsed_expression);
     if (first_time)
-      token_require(ctxt, token_it, token_it_end, "float");
+      token_require(ctxt, token_it, token_it_end, CSCRIPT_T_KEYWORD_FLOAT);
 
     if (check_token_available(ctxt, token_it, token_it_end))
       cscript_string_copy(ctxt, &f.name, &(*token_it)->value);
@@ -567,7 +541,7 @@ cscript_statement make_float(cscript_context* ctxt, token** token_it, token** to
       token_next(ctxt, token_it, token_it_end);
       cscript_parsed_expression expr = cscript_make_expression(ctxt, token_it, token_it_end);
       cscript_vector_push_back(ctxt, &f.dims, expr, cscript_parsed_expression);
-      token_require(ctxt, token_it, token_it_end, "]");
+      token_require(ctxt, token_it, token_it_end, CSCRIPT_T_RIGHT_SQUARE_BRACKET);
       }
     if (current_token_type(token_it, token_it_end) == CSCRIPT_T_LEFT_SQUARE_BRACKET)
       {
@@ -588,7 +562,7 @@ cscript_statement make_float(cscript_context* ctxt, token** token_it, token** to
     cscript_vector_push_back(ctxt, &stmts.statements, stmt, cscript_statement);
     if (current_token_type(token_it, token_it_end) == CSCRIPT_T_COMMA)
       {
-      token_require(ctxt, token_it, token_it_end, ",");
+      token_require(ctxt, token_it, token_it_end, CSCRIPT_T_COMMA);
       }
     else
       {
@@ -602,14 +576,16 @@ cscript_statement make_float(cscript_context* ctxt, token** token_it, token** to
   return outstmt;
   }
 
-cscript_vector make_statements(cscript_context* ctxt, token** token_it, token** token_it_end, const char* terminator)
+cscript_vector make_statements(cscript_context* ctxt, token** token_it, token** token_it_end, int terminator)
   {
   cscript_vector stmts;
   cscript_vector_init(ctxt, &stmts, cscript_statement);
   if (check_token_available(ctxt, token_it, token_it_end) == 0)
     return stmts;
-  while (strcmp((*token_it)->value.string_ptr, terminator) != 0)
+  while ((*token_it)->type != terminator)
     {
+    if (ctxt->number_of_syntax_errors > CSCRIPT_MAX_SYNTAX_ERRORS)
+      return stmts;
     cscript_statement stmt = cscript_make_statement(ctxt, token_it, token_it_end);
     cscript_vector_push_back(ctxt, &stmts, stmt, cscript_statement);
     check_for_semicolon(ctxt, token_it, token_it_end, &stmt);
@@ -623,8 +599,8 @@ cscript_vector make_statements(cscript_context* ctxt, token** token_it, token**
 cscript_statement make_scoped(cscript_context* ctxt, token** token_it, token** token_it_end)
   {
   cscript_scoped_statements scoped;
-  token_require(ctxt, token_it, token_it_end, "{");
-  scoped.statements = make_statements(ctxt, token_it, token_it_end, "}");
+  token_require(ctxt, token_it, token_it_end, CSCRIPT_T_LEFT_CURLY_BRACE);
+  scoped.statements = make_statements(ctxt, token_it, token_it_end, CSCRIPT_T_RIGHT_CURLY_BRACE);
   cscript_statement outstmt;
   outstmt.type = cscript_statement_type_scoped;
   outstmt.statement.scoped = scoped;
@@ -637,21 +613,21 @@ cscript_statement make_if(cscript_context* ctxt, token** token_it, token** token
   i.line_nr = (*token_it)->line_nr;
   i.column_nr = (*token_it)->column_nr;
   i.filename = make_null_string();
-  token_require(ctxt, token_it, token_it_end, "if");
-  token_require(ctxt, token_it, token_it_end, "(");
+  token_require(ctxt, token_it, token_it_end, CSCRIPT_T_KEYWORD_IF);
+  token_require(ctxt, token_it, token_it_end, CSCRIPT_T_LEFT_ROUND_BRACKET);
   cscript_vector_init(ctxt, &i.condition, cscript_parsed_expression);
   cscript_parsed_expression cond = cscript_make_expression(ctxt, token_it, token_it_end);
   cscript_vector_push_back(ctxt, &i.condition, cond, cscript_parsed_expression);
-  token_require(ctxt, token_it, token_it_end, ")");
+  token_require(ctxt, token_it, token_it_end, CSCRIPT_T_RIGHT_ROUND_BRACKET);
   //token_require(ctxt, token_it, token_it_end, "{");
   //i.body = make_statements(ctxt, token_it, token_it_end, "}");
   cscript_statement scoped = make_scoped(ctxt, token_it, token_it_end);
   cscript_vector_init(ctxt, &i.body, cscript_statement);
   cscript_vector_push_back(ctxt, &i.body, scoped, cscript_statement);
-  if (current_token_equals(token_it, token_it_end, "else") != 0)
+  if (current_token_type(token_it, token_it_end) == CSCRIPT_T_KEYWORD_ELSE)
     {
-    token_require(ctxt, token_it, token_it_end, "else");
-    if (current_token_equals(token_it, token_it_end, "if") != 0)
+    token_require(ctxt, token_it, token_it_end, CSCRIPT_T_KEYWORD_ELSE);
+    if (current_token_type(token_it, token_it_end) == CSCRIPT_T_KEYWORD_IF)
       {
       cscript_statement i2 = make_if(ctxt, token_it, token_it_end);
       cscript_vector_init(ctxt, &i.alternative, cscript_statement);
@@ -682,23 +658,25 @@ cscript_statement make_for(cscript_context* ctxt, token** token_it, token** toke
   f.line_nr = (*token_it)->line_nr;
   f.column_nr = (*token_it)->column_nr;
   f.filename = make_null_string();
-  token_require(ctxt, token_it, token_it_end, "for");
-  token_require(ctxt, token_it, token_it_end, "(");
+  token_require(ctxt, token_it, token_it_end, CSCRIPT_T_KEYWORD_FOR);
+  token_require(ctxt, token_it, token_it_end, CSCRIPT_T_LEFT_ROUND_BRACKET);
   cscript_vector_init(ctxt, &f.init_cond_inc, cscript_statement);
   cscript_statement init = cscript_make_statement(ctxt, token_it, token_it_end);
   cscript_vector_push_back(ctxt, &f.init_cond_inc, init, cscript_statement);
-  token_require(ctxt, token_it, token_it_end, ";");
+  token_require(ctxt, token_it, token_it_end, CSCRIPT_T_SEMICOLON);
   cscript_statement cond = cscript_make_statement(ctxt, token_it, token_it_end);
   cscript_vector_push_back(ctxt, &f.init_cond_inc, cond, cscript_statement);
-  token_require(ctxt, token_it, token_it_end, ";");
+  token_require(ctxt, token_it, token_it_end, CSCRIPT_T_SEMICOLON);
   cscript_statement inc = cscript_make_statement(ctxt, token_it, token_it_end);
   cscript_vector_push_back(ctxt, &f.init_cond_inc, inc, cscript_statement);
-  token_require(ctxt, token_it, token_it_end, ")");
+  token_require(ctxt, token_it, token_it_end, CSCRIPT_T_RIGHT_ROUND_BRACKET);
   //token_require(ctxt, token_it, token_it_end, "{");
   //f.statements = make_statements(ctxt, token_it, token_it_end, "}");
   cscript_statement scoped = make_scoped(ctxt, token_it, token_it_end);
   cscript_vector_init(ctxt, &f.statements, cscript_statement);
   cscript_vector_push_back(ctxt, &f.statements, scoped, cscript_statement);
+  f.parallel = 0;
+  f.reductions = make_null_vector();
   cscript_statement outstmt;
   outstmt.type = cscript_statement_type_for;
   outstmt.statement.forloop = f;
@@ -711,26 +689,99 @@ cscript_statement make_while(cscript_context* ctxt, token** token_it, token** to
   f.line_nr = (*token_it)->line_nr;
   f.column_nr = (*token_it)->column_nr;
   f.filename = make_null_string();
-  token_require(ctxt, token_it, token_it_end, "while");
-  token_require(ctxt, token_it, token_it_end, "(");
+  token_require(ctxt, token_it, token_it_end, CSCRIPT_T_KEYWORD_WHILE);
+  token_require(ctxt, token_it, token_it_end, CSCRIPT_T_LEFT_ROUND_BRACKET);
   cscript_vector_init(ctxt, &f.init_cond_inc, cscript_statement);
   cscript_statement nop = make_nop();
   cscript_vector_push_back(ctxt, &f.init_cond_inc, nop, cscript_statement);
   cscript_statement cond = cscript_make_statement(ctxt, token_it, token_it_end);
   cscript_vector_push_back(ctxt, &f.init_cond_inc, cond, cscript_statement);
   cscript_vector_push_back(ctxt, &f.init_cond_inc, nop, cscript_statement);
-  token_require(ctxt, token_it, token_it_end, ")");
+  token_require(ctxt, token_it, token_it_end, CSCRIPT_T_RIGHT_ROUND_BRACKET);
   //token_require(ctxt, token_it, token_it_end, "{");
   //f.statements = make_statements(ctxt, token_it, token_it_end, "}");
   cscript_statement scoped = make_scoped(ctxt, token_it, token_it_end);
   cscript_vector_init(ctxt, &f.statements, cscript_statement);
   cscript_vector_push_back(ctxt, &f.statements, scoped, cscript_statement);
+  f.parallel = 0;
+  f.reductions = make_null_vector();
   cscript_statement outstmt;
   outstmt.type = cscript_statement_type_for;
   outstmt.statement.forloop = f;
   return outstmt;
   }
 
+static int is_reduction(token** token_it, token** token_it_end)
+  {
+  return current_token_equals(token_it, token_it_end, "sum") || current_token_equals(token_it, token_it_end, "min") || current_token_equals(token_it, token_it_end, "max");
+  }
+
+static int is_parallel_for(token** token_it, token** token_it_end)
+  {
+  uint64_t dist = *token_it_end - *token_it;
+  if (dist < 3)
+    return 0;
+  token* t = *token_it + 1;
+  if (t->type == CSCRIPT_T_KEYWORD_FOR)
+    return 1;
+  if (t->type == CSCRIPT_T_LEFT_ROUND_BRACKET && dist >= 4)
+    {
+    ++t;
+    return (t->type == CSCRIPT_T_ID && (t + 1)->type == CSCRIPT_T_ID && is_reduction(&t, token_it_end)) ? 1 : 0;
+    }
+  return 0;
+  }
+
+/*
+parallel for (int i = start; i < end; ++i) { ... }
+parallel(sum s, min m, max n) for (int i = start; i < end; ++i) { ... }
+*/
+cscript_statement make_parallel_for(cscript_context* ctxt, token** token_it, token** token_it_end)
+  {
+  cscript_vector reductions;
+  cscript_vector_init(ctxt, &reductions, cscript_parsed_reduction);
+  token_next(ctxt, token_it, token_it_end); // parallel
+  if (current_token_type(token_it, token_it_end) == CSCRIPT_T_LEFT_ROUND_BRACKET)
+    {
+    token_next(ctxt, token_it, token_it_end);
+    for (;;)
+      {
+      cscript_parsed_reduction r;
+      if (current_token_equals(token_it, token_it_end, "sum"))
+        r.op = cscript_reduction_sum;
+      else if (current_token_equals(token_it, token_it_end, "min"))
+        r.op = cscript_reduction_min;
+      else if (current_token_equals(token_it, token_it_end, "max"))
+        r.op = cscript_reduction_max;
+      else
+        {
+        cscript_string* fn = NULL;
+        if (ctxt->filenames_list.vector_size > 0)
+          fn = cscript_vector_back(&ctxt->filenames_list, cscript_string);
+        if (check_token_available(ctxt, token_it, token_it_end))
+          cscript_syntax_error_cstr(ctxt, CSCRIPT_ERROR_EXPECTED_KEYWORD, (*token_it)->line_nr, (*token_it)->column_nr, fn, "sum");
+        break;
+        }
+      token_next(ctxt, token_it, token_it_end);
+      if (current_token_type(token_it, token_it_end) != CSCRIPT_T_ID)
+        {
+        token_require(ctxt, token_it, token_it_end, CSCRIPT_T_ID);
+        break;
+        }
+      r.var = make_variable(ctxt, token_it, token_it_end);
+      cscript_vector_push_back(ctxt, &reductions, r, cscript_parsed_reduction);
+      if (current_token_type(token_it, token_it_end) != CSCRIPT_T_COMMA)
+        break;
+      token_next(ctxt, token_it, token_it_end);
+      }
+    token_require(ctxt, token_it, token_it_end, CSCRIPT_T_RIGHT_ROUND_BRACKET);
+    }
+  cscript_statement stmt = make_for(ctxt, token_it, token_it_end);
+  stmt.statement.forloop.parallel = 1;
+  stmt.statement.forloop.reductions = reductions;
+  return stmt;
+  }
+
 cscript_statement make_assignment(cscript_context* ctxt, token** token_it, token** token_it_end)
   {
   cscript_parsed_assignment a;
@@ -742,6 +793,7 @@ cscript_statement make_assignment(cscript_context* ctxt, token** token_it, token
   a.dims = make_null_vector();
   a.op = make_null_string();
   a.expr = make_null_expr();
+  a.symbol = -1;
   cscript_statement outstmt;
   outstmt.type = cscript_statement_type_assignment;
   if (a.derefence)
@@ -773,7 +825,7 @@ cscript_statement make_assignment(cscript_context* ctxt, token** token_it, token
     cscript_vector_init(ctxt, &a.dims, cscript_parsed_expression);
     cscript_parsed_expression dims_expr = cscript_make_expression(ctxt, token_it, token_it_end);
     cscript_vector_push_back(ctxt, &a.dims, dims_expr, cscript_parsed_expression);
-    token_require(ctxt, token_it, token_it_end, "]");
+    token_require(ctxt, token_it, token_it_end, CSCRIPT_T_RIGHT_SQUARE_BRACKET);
     }
   if (current_token_type(token_it, token_it_end) == CSCRIPT_T_LEFT_SQUARE_BRACKET)
     {
@@ -808,78 +860,55 @@ cscript_parsed_expression cscript_make_expression(cscript_context* ctxt, token**
   cscript_vector_push_back(ctxt, &expr.operands, r1, cscript_parsed_relop);
   while (1)
     {
-    if (token_it == token_it_end)
-      break;
-    const uint32_t len = (*token_it)->value.string_length;
-    if (len > 2)
-      break;
-    char op1 = (*token_it)->value.string_ptr[0];
-    char op2 = (*token_it)->value.string_ptr[1];
-    switch (op1)
+    switch (current_token_type(token_it, token_it_end))
       {
-      case '<':
+      case CSCRIPT_T_RELATIVE_LESS:
       {
-      if (len == 1)
-        {
-        cscript_vector_push_back(ctxt, &expr.fops, cscript_op_less, int);
-        token_next(ctxt, token_it, token_it_end);
-        cscript_parsed_relop r2 = cscript_make_relop(ctxt, token_it, token_it_end);
-        cscript_vector_push_back(ctxt, &expr.operands, r2, cscript_parsed_relop);
-        continue;
-        }
-      else if (len == 2 && op2 == '=')
-        {
-        cscript_vector_push_back(ctxt, &expr.fops, cscript_op_leq, int);
-        token_next(ctxt, token_it, token_it_end);
-        cscript_parsed_relop r2 = cscript_make_relop(ctxt, token_it, token_it_end);
-        cscript_vector_push_back(ctxt, &expr.operands, r2, cscript_parsed_relop);
-        continue;
-        }
-      break;
+      cscript_vector_push_back(ctxt, &expr.fops, cscript_op_less, int);
+      token_next(ctxt, token_it, token_it_end);
+      cscript_parsed_relop r2 = cscript_make_relop(ctxt, token_it, token_it_end);
+      cscript_vector_push_back(ctxt, &expr.operands, r2, cscript_parsed_relop);
+      continue;
       }
-      case '>':
+      case CSCRIPT_T_RELATIVE_LEQ:
       {
-      if (len == 1)
-        {
-        cscript_vector_push_back(ctxt, &expr.fops, cscript_op_greater, int);
-        token_next(ctxt, token_it, token_it_end);
-        cscript_parsed_relop r2 = cscript_make_relop(ctxt, token_it, token_it_end);
-        cscript_vector_push_back(ctxt, &expr.operands, r2, cscript_parsed_relop);
-        continue;
-        }
-      else if (len == 2 && op2 == '=')
-        {
-        cscript_vector_push_back(ctxt, &expr.fops, cscript_op_geq, int);
-        token_next(ctxt, token_it, token_it_end);
-        cscript_parsed_relop r2 = cscript_make_relop(ctxt, token_it, token_it_end);
-        cscript_vector_push_back(ctxt, &expr.operands, r2, cscript_parsed_relop);
-        continue;
-        }
-      break;
+      cscript_vector_push_back(ctxt, &expr.fops, cscript_op_leq, int);
+      token_next(ctxt, token_it, token_it_end);
+      cscript_parsed_relop r2 = cscript_make_relop(ctxt, token_it, token_it_end);
+      cscript_vector_push_back(ctxt, &expr.operands, r2, cscript_parsed_relop);
+      continue;
       }
-      case '=':
+      case CSCRIPT_T_RELATIVE_GREATER:
       {
-      if (len == 2 && op2 == '=')
-        {
-        cscript_vector_push_back(ctxt, &expr.fops, cscript_op_equal, int);
-        token_next(ctxt, token_it, token_it_end);
-        cscript_parsed_relop r2 = cscript_make_relop(ctxt, token_it, token_it_end);
-        cscript_vector_push_back(ctxt, &expr.operands, r2, cscript_parsed_relop);
-        continue;
-        }
-      break;
+      cscript_vector_push_back(ctxt, &expr.fops, cscript_op_greater, int);
+      token_next(ctxt, token_it, token_it_end);
+      cscript_parsed_relop r2 = cscript_make_relop(ctxt, token_it, token_it_end);
+      cscript_vector_push_back(ctxt, &expr.operands, r2, cscript_parsed_relop);
+      continue;
       }
-      case '!':
+      case CSCRIPT_T_RELATIVE_GEQ:
       {
-      if (len == 2 && op2 == '=')
-        {
-        cscript_vector_push_back(ctxt, &expr.fops, cscript_op_not_equal, int);
-        token_next(ctxt, token_it, token_it_end);
-        cscript_parsed_relop r2 = cscript_make_relop(ctxt, token_it, token_it_end);
-        cscript_vector_push_back(ctxt, &expr.operands, r2, cscript_parsed_relop);
-        continue;
-        }
-      break;
+      cscript_vector_push_back(ctxt, &expr.fops, cscript_op_geq, int);
+      token_next(ctxt, token_it, token_it_end);
+      cscript_parsed_relop r2 = cscript_make_relop(ctxt, token_it, token_it_end);
+      cscript_vector_push_back(ctxt, &expr.operands, r2, cscript_parsed_relop);
+      continue;
+      }
+      case CSCRIPT_T_RELATIVE_EQUAL:
+      {
+      cscript_vector_push_back(ctxt, &expr.fops, cscript_op_equal, int);
+      token_next(ctxt, token_it, token_it_end);
+      cscript_parsed_relop r2 = cscript_make_relop(ctxt, token_it, token_it_end);
+      cscript_vector_push_back(ctxt, &expr.operands, r2, cscript_parsed_relop);
+      continue;
+      }
+      case CSCRIPT_T_RELATIVE_NOTEQUAL:
+      {
+      cscript_vector_push_back(ctxt, &expr.fops, cscript_op_not_equal, int);
+      token_next(ctxt, token_it, token_it_end);
+      cscript_parsed_relop r2 = cscript_make_relop(ctxt, token_it, token_it_end);
+      cscript_vector_push_back(ctxt, &expr.operands, r2, cscript_parsed_relop);
+      continue;
       }
       default:
         break;
@@ -904,7 +933,7 @@ cscript_vector make_parameters(cscript_context* ctxt, token** token_it, token**
       token_next(ctxt, token_it, token_it_end);
       return pars;
       }
-    if (t != *token_it_end && t->type != CSCRIPT_T_ID)
+    if (t != *token_it_end && t->type != CSCRIPT_T_KEYWORD_INT && t->type != CSCRIPT_T_KEYWORD_FLOAT && t->type != CSCRIPT_T_ID)
       return pars; // this is an expression probably
     if (token_next(ctxt, token_it, token_it_end) == 0)
       return pars;
@@ -916,39 +945,44 @@ cscript_vector make_parameters(cscript_context* ctxt, token** token_it, token**
         {
         break;
         }
-      if (current_token_type(token_it, token_it_end) != CSCRIPT_T_ID)
+      if (*token_it == *token_it_end)
         {
         cscript_string* fn = NULL;
         if (ctxt->filenames_list.vector_size > 0)
           fn = cscript_vector_back(&ctxt->filenames_list, cscript_string);
-        cscript_syntax_error_cstr(ctxt, CSCRIPT_ERROR_BAD_SYNTAX, (*token_it)->line_nr, (*token_it)->column_nr, fn, "invalid parameter declaration");
+        cscript_syntax_error_cstr(ctxt, CSCRIPT_ERROR_NO_TOKENS, last_token.line_nr, last_token.column_nr, fn, "");
         return pars;
         }
       cscript_parameter p;
       p.line_nr = (*token_it)->line_nr;
       p.column_nr = (*token_it)->column_nr;
       p.filename = make_null_string();
-      if (strcmp((*token_it)->value.string_ptr, "int") == 0)
+      p.symbol = -1;
+      switch (current_token_type(token_it, token_it_end))
         {
-        token_require(ctxt, token_it, token_it_end, "int");
+        case CSCRIPT_T_KEYWORD_INT:
+        {
+        token_next(ctxt, token_it, token_it_end);
         p.type = cscript_parameter_type_fixnum;
         if (current_token_type(token_it, token_it_end) == CSCRIPT_T_MUL)
           {
           p.type = cscript_parameter_type_fixnum_pointer;
           token_next(ctxt, token_it, token_it_end);
           }
+        break;
         }
-      else if (strcmp((*token_it)->value.string_ptr, "float") == 0)
+        case CSCRIPT_T_KEYWORD_FLOAT:
         {
-        token_require(ctxt, token_it, token_it_end, "float");
+        token_next(ctxt, token_it, token_it_end);
         p.type = cscript_parameter_type_flonum;
         if (current_token_type(token_it, token_it_end) == CSCRIPT_T_MUL)
           {
           p.type = cscript_parameter_type_flonum_pointer;
           token_next(ctxt, token_it, token_it_end);
           }
+        break;
         }
-      else
+        default:
         {
         cscript_string* fn = NULL;
         if (ctxt->filenames_list.vector_size > 0)
@@ -956,6 +990,7 @@ cscript_vector make_parameters(cscript_context* ctxt, token** token_it, token**
         cscript_syntax_error_cstr(ctxt, CSCRIPT_ERROR_BAD_SYNTAX, (*token_it)->line_nr, (*token_it)->column_nr, fn, "invalid parameter declaration");
         return pars;
         }
+        }
       if (current_token_type(token_it, token_it_end) != CSCRIPT_T_ID)
         {
         cscript_string* fn = NULL;
@@ -972,7 +1007,7 @@ cscript_vector make_parameters(cscript_context* ctxt, token** token_it, token**
         }
       else
         {
-        token_require(ctxt, token_it, token_it_end, ",");
+        token_require(ctxt, token_it, token_it_end, CSCRIPT_T_COMMA);
         }
       if (first_time != 0)
         {
@@ -981,7 +1016,7 @@ cscript_vector make_parameters(cscript_context* ctxt, token** token_it, token**
       cscript_vector_push_back(ctxt, &pars, p, cscript_parameter);
       first_time = 0;
       }
-    token_require(ctxt, token_it, token_it_end, ")");
+    token_require(ctxt, token_it, token_it_end, CSCRIPT_T_RIGHT_ROUND_BRACKET);
     }
   return pars;
   }
@@ -1020,31 +1055,36 @@ cscript_statement cscript_make_statement(cscript_context* ctxt, token** token_it
     nop.statement.nop.column_nr = (*token_it)->column_nr;
     return nop;
     }
+    case CSCRIPT_T_KEYWORD_INT:
+    {
+    cscript_statement stmt = make_int(ctxt, token_it, token_it_end);
+    return stmt;
+    }
+    case CSCRIPT_T_KEYWORD_FLOAT:
+    {
+    cscript_statement stmt = make_float(ctxt, token_it, token_it_end);
+    return stmt;
+    }
+    case CSCRIPT_T_KEYWORD_FOR:
+    {
+    cscript_statement stmt = make_for(ctxt, token_it, token_it_end);
+    return stmt;
+    }
+    case CSCRIPT_T_KEYWORD_WHILE:
+    {
+    cscript_statement stmt = make_while(ctxt, token_it, token_it_end);
+    return stmt;
+    }
+    case CSCRIPT_T_KEYWORD_IF:
+    {
+    cscript_statement stmt = make_if(ctxt, token_it, token_it_end);
+    return stmt;
+    }
     case CSCRIPT_T_ID:
     {
-    if (strcmp((*token_it)->value.string_ptr, "int") == 0)
-      {
-      cscript_statement stmt = make_int(ctxt, token_it, token_it_end);
-      return stmt;
-      }
-    if (strcmp((*token_it)->value.string_ptr, "float") == 0)
-      {
-      cscript_statement stmt = make_float(ctxt, token_it, token_it_end);
-      return stmt;
-      }
-    if (strcmp((*token_it)->value.string_ptr, "for") == 0)
-      {
-      cscript_statement stmt = make_for(ctxt, token_it, token_it_end);
-      return stmt;
-      }
-    if (strcmp((*token_it)->value.string_ptr, "while") == 0)
-      {
-      cscript_statement stmt = make_while(ctxt, token_it, token_it_end);
-      return stmt;
-      }
-    if (strcmp((*token_it)->value.string_ptr, "if") == 0)
+    if (current_token_equals(token_it, token_it_end, "parallel") && is_parallel_for(token_it, token_it_end))
       {
-      cscript_statement stmt = make_if(ctxt, token_it, token_it_end);
+      cscript_statement stmt = make_parallel_for(ctxt, token_it, token_it_end);
       return stmt;
       }
     uint64_t dist = *token_it_end - *token_it;
@@ -1148,6 +1188,7 @@ cscript_program make_program(cscript_context* ctxt, cscript_vector* tokens)
   invalidate_popped();
   cscript_program prog;
   cscript_vector_init(ctxt, &prog.statements, cscript_statement);
+  prog.number_of_symbols = 0;
 
   token* token_it = cscript_vector_begin(tokens, token);
   token* token_it_end = cscript_vector_end(tokens, token);
@@ -1253,6 +1294,7 @@ static void postvisit_for(cscript_context* ctxt, cscript_visitor* v, cscript_par
   cscript_string_destroy(ctxt, &f->filename);
   cscript_vector_destroy(ctxt, &f->init_cond_inc);
   cscript_vector_destroy(ctxt, &f->statements);
+  cscript_vector_destroy(ctxt, &f->reductions);
   }
 static void postvisit_if(cscript_context* ctxt, cscript_visitor* v, cscript_parsed_if* i)
   {
@@ -67,6 +67,7 @@ typedef struct cscript_parsed_variable
   cscript_string filename;
   cscript_vector dims; //  vector of type cscript_parsed_expression
   int dereference;
+  int symbol; // local variable id assigned by alpha conversion, -1 for globals and unknown names
   } cscript_parsed_variable;
 
 typedef struct cscript_parsed_fixnum
@@ -74,6 +75,7 @@ typedef struct cscript_parsed_fixnum
   cscript_string name;
   cscript_parsed_expression expr;
   cscript_vector dims; //  vector of type cscript_parsed_expression
+  int symbol; // local variable id assigned by alpha conversion, -1 for globals
   int line_nr, column_nr;
   cscript_string filename;
   } cscript_parsed_fixnum;
@@ -83,6 +85,7 @@ typedef struct cscript_parsed_flonum
   cscript_string name;
   cscript_parsed_expression expr;
   cscript_vector dims; //  vector of type cscript_parsed_expression
+  int symbol; // local variable id assigned by alpha conversion, -1 for globals
   int line_nr, column_nr;
   cscript_string filename;
   } cscript_parsed_flonum;
@@ -94,6 +97,7 @@ typedef struct cscript_parsed_assignment
   cscript_parsed_expression expr;
   cscript_vector dims; //  vector of type cscript_parsed_expression
   int derefence;
+  int symbol; // local variable id assigned by alpha conversion, -1 for globals and unknown names
   int line_nr, column_nr;
   cscript_string filename;
   } cscript_parsed_assignment;
@@ -161,10 +165,22 @@ typedef struct cscript_scoped_statements
   cscript_vector statements;
   } cscript_scoped_statements;
 
+#define cscript_reduction_sum 0
+#define cscript_reduction_min 1
+#define cscript_reduction_max 2
+
+typedef struct cscript_parsed_reduction
+  {
+  int op;
+  cscript_parsed_variable var;
+  } cscript_parsed_reduction;
+
 typedef struct cscript_parsed_for
   {
   cscript_vector init_cond_inc;
   cscript_vector statements;
+  int parallel;
+  cscript_vector reductions; // vector of type cscript_parsed_reduction, only for parallel loops
   int line_nr, column_nr;
   cscript_string filename;
   } cscript_parsed_for;
@@ -216,6 +232,7 @@ typedef struct cscript_parameter
   {
   cscript_string name;
   int type;
+  int symbol; // local variable id assigned by alpha conversion, -1 for globals
   int line_nr, column_nr;
   cscript_string filename;
   } cscript_parameter;
@@ -224,6 +241,7 @@ typedef struct cscript_program
   {
   cscript_vector parameters;
   cscript_vector statements;
+  int number_of_symbols; // number of local variable ids assigned by alpha conversion
   } cscript_program;
 
 CSCRIPT_API cscript_statement cscript_make_statement(cscript_context* ctxt, token** token_it, token** token_it_end);
@@ -0,0 +1,111 @@
+#include "pool.h"
+#include "context.h"
+#include "memory.h"
+#include "thread.h"
+
+#include <string.h>
+
+// the idle contexts are linked through their next_idle field, so that releasing a context allocates nothing
+typedef struct pool_shard
+  {
+  cscript_mutex mutex;
+  cscript_context* idle;
+  } pool_shard;
+
+struct cscript_context_pool
+  {
+  cscript_context* ctxt; // the context whose externals and globals are shared
+  cscript_memsize stack_size;
+  int max_size;
+  int number_of_contexts; // number of contexts created by the pool
+  cscript_mutex mutex; // protects number_of_contexts
+  pool_shard shards[CSCRIPT_CONTEXT_POOL_SHARDS];
+  };
+
+static CSCRIPT_THREAD_LOCAL char thread_tag;
+
+static int home_shard()
+  {
+  uint64_t h = (uint64_t)(uintptr_t)&thread_tag;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return (int)(h % CSCRIPT_CONTEXT_POOL_SHARDS);
+  }
+
+static cscript_context* pop_context(pool_shard* shard)
+  {
+  cscript_mutex_lock(&shard->mutex);
+  cscript_context* ctxt = shard->idle;
+  if (ctxt != NULL)
+    {
+    shard->idle = ctxt->next_idle;
+    ctxt->next_idle = NULL;
+    }
+  cscript_mutex_unlock(&shard->mutex);
+  return ctxt;
+  }
+
+cscript_context_pool* cscript_context_pool_new(cscript_context* ctxt, cscript_memsize stack_size, int max_size)
+  {
+  cscript_context_pool* pool = cscript_new(ctxt, cscript_context_pool);
+  pool->ctxt = ctxt;
+  pool->stack_size = stack_size;
+  pool->max_size = max_size;
+  pool->number_of_contexts = 0;
+  cscript_mutex_init(&pool->mutex);
+  for (int i = 0; i < CSCRIPT_CONTEXT_POOL_SHARDS; ++i)
+    {
+    cscript_mutex_init(&pool->shards[i].mutex);
+    pool->shards[i].idle = NULL;
+    }
+  return pool;
+  }
+
+void cscript_context_pool_free(cscript_context_pool* pool)
+  {
+  cscript_context* ctxt = pool->ctxt;
+  for (int i = 0; i < CSCRIPT_CONTEXT_POOL_SHARDS; ++i)
+    {
+    while (pool->shards[i].idle != NULL)
+      {
+      cscript_context* idle = pool->shards[i].idle;
+      pool->shards[i].idle = idle->next_idle;
+      cscript_context_destroy(idle);
+      --pool->number_of_contexts;
+      }
+    cscript_mutex_destroy(&pool->shards[i].mutex);
+    }
+  cscript_assert(pool->number_of_contexts == 0); // all contexts should have been released
+  cscript_mutex_destroy(&pool->mutex);
+  cscript_delete(ctxt, pool);
+  }
+
+cscript_context* cscript_context_pool_acquire(cscript_context_pool* pool)
+  {
+  const int home = home_shard();
+  cscript_context* ctxt = pop_context(&pool->shards[home]);
+  for (int i = 1; ctxt == NULL && i < CSCRIPT_CONTEXT_POOL_SHARDS; ++i)
+    ctxt = pop_context(&pool->shards[(home + i) % CSCRIPT_CONTEXT_POOL_SHARDS]);
+  if (ctxt != NULL)
+    return ctxt;
+  cscript_mutex_lock(&pool->mutex);
+  int can_create = (pool->max_size <= 0 || pool->number_of_contexts < pool->max_size) ? 1 : 0;
+  if (can_create)
+    ++pool->number_of_contexts;
+  cscript_mutex_unlock(&pool->mutex);
+  if (!can_create)
+    return NULL;
+  return cscript_context_init_shared(pool->ctxt, pool->stack_size);
+  }
+
+void cscript_context_pool_release(cscript_context_pool* pool, cscript_context* ctxt)
+  {
+  cscript_assert(ctxt->global == pool->ctxt->global);
+  cscript_context_reset_shared(ctxt, pool->ctxt);
+  pool_shard* shard = &pool->shards[home_shard()];
+  cscript_mutex_lock(&shard->mutex);
+  ctxt->next_idle = shard->idle;
+  shard->idle = ctxt;
+  cscript_mutex_unlock(&shard->mutex);
+  }
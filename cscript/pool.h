@@ -0,0 +1,16 @@
+#ifndef CSCRIPT_POOL_H
+#define CSCRIPT_POOL_H
+
+#include "cscript.h"
+
+/*
+Idle contexts of a pool are kept in CSCRIPT_CONTEXT_POOL_SHARDS freelists, each with its own lock.
+Every thread has a home freelist, derived from the address of a thread local variable, so that
+threads acquire and release contexts without contending with each other in the common case.
+A thread only looks at the other freelists when its home freelist is empty.
+*/
+#ifndef CSCRIPT_CONTEXT_POOL_SHARDS
+#define CSCRIPT_CONTEXT_POOL_SHARDS 16
+#endif
+
+#endif //CSCRIPT_POOL_H
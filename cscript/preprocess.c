@@ -4,14 +4,78 @@
 #include "constprop.h"
 #include "remdeadvar.h"
 #include "alpha.h"
+#include "reassoc.h"
+#include "report.h"
+#include "syscalls.h"
+
+#include <stddef.h>
+
+static int budget_exceeded(double start, const cscript_compile_options* options)
+  {
+  if (options->time_budget == 0)
+    return 0;
+  return cscript_wall_time() - start >= cast(double, options->time_budget) ? 1 : 0;
+  }
 
 void cscript_preprocess(cscript_context* ctxt, cscript_program* prog)
   {
+  cscript_compile_options options;
+  cscript_compile_options_init(&options, 2);
+  cscript_preprocess_ex(ctxt, prog, &options);
+  }
+
+void cscript_preprocess_ex(cscript_context* ctxt, cscript_program* prog, const cscript_compile_options* options)
+  {
+  const double start = cscript_wall_time();
+  // alpha conversion is not optional: the compiler relies on unique variable names
+  cscript_compile_phase_begin(ctxt, cscript_compile_phase_alpha_conversion);
   cscript_alpha_conversion(ctxt, prog);
-  for (int i = 0; i < 2; ++i)
+  cscript_compile_phase_end(ctxt);
+  for (int i = 0; i < options->optimization_rounds; ++i)
+    {
+    if (budget_exceeded(start, options))
+      return;
+    // the rewriting passes of a round share one traversal of the tree
+    cscript_visitor* visitors[3];
+    int number_of_visitors = 0;
+    cscript_constant_propagation_visitor* propagation = NULL;
+    cscript_reassociation_visitor* reassociation = NULL;
+    cscript_constant_folding_visitor* folding = NULL;
+    if (options->constant_propagation)
+      {
+      cscript_compile_phase_begin(ctxt, cscript_compile_phase_constant_propagation);
+      propagation = cscript_constant_propagation_visitor_new(ctxt, prog);
+      cscript_compile_phase_end(ctxt);
+      visitors[number_of_visitors++] = propagation->visitor;
+      }
+    if (options->fast_math)
+      {
+      reassociation = cscript_reassociation_visitor_new(ctxt);
+      visitors[number_of_visitors++] = reassociation->visitor;
+      }
+    if (options->constant_folding)
+      {
+      folding = cscript_constant_folding_visitor_new(ctxt);
+      visitors[number_of_visitors++] = folding->visitor;
+      }
+    if (number_of_visitors > 0 && !budget_exceeded(start, options))
+      {
+      cscript_compile_phase_begin(ctxt, cscript_compile_phase_constant_folding);
+      cscript_fused_visitor* fused = cscript_fused_visitor_new(ctxt, visitors, number_of_visitors);
+      cscript_visit_program(ctxt, fused->visitor, prog);
+      cscript_fused_visitor_free(ctxt, fused);
+      cscript_compile_phase_end(ctxt);
+      }
+    cscript_constant_folding_visitor_free(ctxt, folding);
+    cscript_reassociation_visitor_free(ctxt, reassociation);
+    cscript_constant_propagation_visitor_free(ctxt, propagation);
+    }
+  if (budget_exceeded(start, options))
+    return;
+  if (options->remove_dead_variables)
     {
-    cscript_constant_propagation(ctxt, prog);
-    cscript_constant_folding(ctxt, prog);
+    cscript_compile_phase_begin(ctxt, cscript_compile_phase_remove_dead_variables);
+    cscript_remove_dead_variables(ctxt, prog);
+    cscript_compile_phase_end(ctxt);
     }
-  cscript_remove_dead_variables(ctxt, prog);
-  }
\ No newline at end of file
+  }
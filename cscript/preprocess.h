@@ -5,5 +5,6 @@
 #include "parser.h"
 
 CSCRIPT_API void cscript_preprocess(cscript_context* ctxt, cscript_program* prog);
+CSCRIPT_API void cscript_preprocess_ex(cscript_context* ctxt, cscript_program* prog, const cscript_compile_options* options);
 
 #endif //CSCRIPT_PREPROCESS_H
\ No newline at end of file
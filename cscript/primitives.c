@@ -14,86 +14,86 @@
 #include <string.h>
 #include <stdio.h>
 
-void cscript_primitive_add_fixnum(cscript_context* ctxt, int a)
+void cscript_primitive_add_fixnum(cscript_fixnum* stack, int a)
   {
-  cscript_fixnum* ra = cscript_vector_at(&ctxt->stack, a, cscript_fixnum);
+  cscript_fixnum* ra = stack + a;
   cscript_fixnum* rb = ra + 1;
   *ra += *rb;
   }
 
-void cscript_primitive_add_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_add_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   cscript_flonum* rb = ra + 1;
   *ra += *rb;
   }
 
-void cscript_primitive_sub_fixnum(cscript_context* ctxt, int a)
+void cscript_primitive_sub_fixnum(cscript_fixnum* stack, int a)
   {
-  cscript_fixnum* ra = cscript_vector_at(&ctxt->stack, a, cscript_fixnum);
+  cscript_fixnum* ra = stack + a;
   cscript_fixnum* rb = ra + 1;
   *ra -= *rb;
   }
 
-void cscript_primitive_sub_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_sub_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   cscript_flonum* rb = ra + 1;
   *ra -= *rb;
   }
 
-void cscript_primitive_mul_fixnum(cscript_context* ctxt, int a)
+void cscript_primitive_mul_fixnum(cscript_fixnum* stack, int a)
   {
-  cscript_fixnum* ra = cscript_vector_at(&ctxt->stack, a, cscript_fixnum);
+  cscript_fixnum* ra = stack + a;
   cscript_fixnum* rb = ra + 1;
   *ra *= *rb;
   }
 
-void cscript_primitive_mul_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_mul_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   cscript_flonum* rb = ra + 1;
   *ra *= *rb;
   }
 
-void cscript_primitive_div_fixnum(cscript_context* ctxt, int a)
+void cscript_primitive_div_fixnum(cscript_fixnum* stack, int a)
   {
-  cscript_fixnum* ra = cscript_vector_at(&ctxt->stack, a, cscript_fixnum);
+  cscript_fixnum* ra = stack + a;
   cscript_fixnum* rb = ra + 1;
   *ra /= *rb;
   }
 
-void cscript_primitive_div_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_div_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   cscript_flonum* rb = ra + 1;
   *ra /= *rb;
   }
 
-void cscript_primitive_mod_fixnum(cscript_context* ctxt, int a)
+void cscript_primitive_mod_fixnum(cscript_fixnum* stack, int a)
   {
-  cscript_fixnum* ra = cscript_vector_at(&ctxt->stack, a, cscript_fixnum);
+  cscript_fixnum* ra = stack + a;
   cscript_fixnum* rb = ra + 1;
   *ra = *ra % *rb;
   }
 
-void cscript_primitive_mod_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_mod_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   cscript_flonum* rb = ra + 1;
   *ra = fmod(*ra, *rb);
   }
 
-void cscript_primitive_less_fixnum(cscript_context* ctxt, int a)
+void cscript_primitive_less_fixnum(cscript_fixnum* stack, int a)
   {
-  cscript_fixnum* ra = cscript_vector_at(&ctxt->stack, a, cscript_fixnum);
+  cscript_fixnum* ra = stack + a;
   cscript_fixnum* rb = ra + 1;
   *ra = *ra < *rb ? 1 : 0;
   }
 
-void cscript_primitive_less_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_less_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   cscript_flonum* rb = ra + 1;
   if (*ra < *rb)
     {
@@ -105,16 +105,16 @@ void cscript_primitive_less_flonum(cscript_context* ctxt, int a)
     }
   }
 
-void cscript_primitive_leq_fixnum(cscript_context* ctxt, int a)
+void cscript_primitive_leq_fixnum(cscript_fixnum* stack, int a)
   {
-  cscript_fixnum* ra = cscript_vector_at(&ctxt->stack, a, cscript_fixnum);
+  cscript_fixnum* ra = stack + a;
   cscript_fixnum* rb = ra + 1;
   *ra = *ra <= *rb ? 1 : 0;
   }
 
-void cscript_primitive_leq_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_leq_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   cscript_flonum* rb = ra + 1;
   if (*ra <= *rb)
     {
@@ -126,16 +126,16 @@ void cscript_primitive_leq_flonum(cscript_context* ctxt, int a)
     }
   }
 
-void cscript_primitive_greater_fixnum(cscript_context* ctxt, int a)
+void cscript_primitive_greater_fixnum(cscript_fixnum* stack, int a)
   {
-  cscript_fixnum* ra = cscript_vector_at(&ctxt->stack, a, cscript_fixnum);
+  cscript_fixnum* ra = stack + a;
   cscript_fixnum* rb = ra + 1;
   *ra = *ra > *rb ? 1 : 0;
   }
 
-void cscript_primitive_greater_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_greater_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   cscript_flonum* rb = ra + 1;
   if (*ra > *rb)
     {
@@ -147,16 +147,16 @@ void cscript_primitive_greater_flonum(cscript_context* ctxt, int a)
     }
   }
 
-void cscript_primitive_geq_fixnum(cscript_context* ctxt, int a)
+void cscript_primitive_geq_fixnum(cscript_fixnum* stack, int a)
   {
-  cscript_fixnum* ra = cscript_vector_at(&ctxt->stack, a, cscript_fixnum);
+  cscript_fixnum* ra = stack + a;
   cscript_fixnum* rb = ra + 1;
   *ra = *ra >= *rb ? 1 : 0;
   }
 
-void cscript_primitive_geq_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_geq_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   cscript_flonum* rb = ra + 1;
   if (*ra >= *rb)
     {
@@ -168,16 +168,16 @@ void cscript_primitive_geq_flonum(cscript_context* ctxt, int a)
     }
   }
 
-void cscript_primitive_equal_fixnum(cscript_context* ctxt, int a)
+void cscript_primitive_equal_fixnum(cscript_fixnum* stack, int a)
   {
-  cscript_fixnum* ra = cscript_vector_at(&ctxt->stack, a, cscript_fixnum);
+  cscript_fixnum* ra = stack + a;
   cscript_fixnum* rb = ra + 1;
   *ra = *ra == *rb ? 1 : 0;
   }
 
-void cscript_primitive_equal_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_equal_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   cscript_flonum* rb = ra + 1;
   if (*ra == *rb)
     {
@@ -189,16 +189,16 @@ void cscript_primitive_equal_flonum(cscript_context* ctxt, int a)
     }
   }
 
-void cscript_primitive_not_equal_fixnum(cscript_context* ctxt, int a)
+void cscript_primitive_not_equal_fixnum(cscript_fixnum* stack, int a)
   {
-  cscript_fixnum* ra = cscript_vector_at(&ctxt->stack, a, cscript_fixnum);
+  cscript_fixnum* ra = stack + a;
   cscript_fixnum* rb = ra + 1;
   *ra = *ra != *rb ? 1 : 0;
   }
 
-void cscript_primitive_not_equal_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_not_equal_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   cscript_flonum* rb = ra + 1;
   if (*ra != *rb)
     {
@@ -210,201 +210,201 @@ void cscript_primitive_not_equal_flonum(cscript_context* ctxt, int a)
     }
   }
 
-void cscript_primitive_sqrt_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_sqrt_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   *ra = sqrt(*ra);
   }
 
-void cscript_primitive_sin_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_sin_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   *ra = sin(*ra);
   }
 
-void cscript_primitive_cos_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_cos_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   *ra = cos(*ra);
   }
 
-void cscript_primitive_exp_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_exp_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   *ra = exp(*ra);
   }
 
-void cscript_primitive_log_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_log_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   *ra = log(*ra);
   }
 
-void cscript_primitive_log2_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_log2_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   *ra = log2(*ra);
   }
 
-void cscript_primitive_fabs_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_fabs_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   *ra = fabs(*ra);
   }
 
-void cscript_primitive_tan_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_tan_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   *ra = tan(*ra);
   }
 
-void cscript_primitive_atan_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_atan_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
   *ra = atan(*ra);
   }
 
-void cscript_primitive_atan2_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_atan2_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
-  cscript_flonum* rb = cscript_vector_at(&ctxt->stack, a + 1, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
+  cscript_flonum* rb = cast(cscript_flonum*, stack + a + 1);
   *ra = atan2(*ra, *rb);
   }
 
-void cscript_primitive_pow_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_pow_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
-  cscript_flonum* rb = cscript_vector_at(&ctxt->stack, a + 1, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
+  cscript_flonum* rb = cast(cscript_flonum*, stack + a + 1);
   *ra = pow(*ra, *rb);
   }
 
-void cscript_primitive_min_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_min_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
-  cscript_flonum* rb = cscript_vector_at(&ctxt->stack, a + 1, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
+  cscript_flonum* rb = cast(cscript_flonum*, stack + a + 1);
   *ra = *ra < *rb ? *ra : *rb;
   }
 
-void cscript_primitive_max_flonum(cscript_context* ctxt, int a)
+void cscript_primitive_max_flonum(cscript_fixnum* stack, int a)
   {
-  cscript_flonum* ra = cscript_vector_at(&ctxt->stack, a, cscript_flonum);
-  cscript_flonum* rb = cscript_vector_at(&ctxt->stack, a + 1, cscript_flonum);
+  cscript_flonum* ra = cast(cscript_flonum*, stack + a);
+  cscript_flonum* rb = cast(cscript_flonum*, stack + a + 1);
   *ra = *ra > *rb ? *ra : *rb;
   }
 
-void cscript_call_primitive(cscript_context* ctxt, cscript_fixnum function_id, int a)
+int cscript_call_primitive(cscript_fixnum* stack, cscript_fixnum function_id, int a)
   {
   switch (function_id)
     {
     case CSCRIPT_ADD_FIXNUM:
-      cscript_primitive_add_fixnum(ctxt, a);
+      cscript_primitive_add_fixnum(stack, a);
       break;
     case CSCRIPT_ADD_FLONUM:
-      cscript_primitive_add_flonum(ctxt, a);
+      cscript_primitive_add_flonum(stack, a);
       break;
     case CSCRIPT_SUB_FIXNUM:
-      cscript_primitive_sub_fixnum(ctxt, a);
+      cscript_primitive_sub_fixnum(stack, a);
       break;
     case CSCRIPT_SUB_FLONUM:
-      cscript_primitive_sub_flonum(ctxt, a);
+      cscript_primitive_sub_flonum(stack, a);
       break;
     case CSCRIPT_MUL_FIXNUM:
-      cscript_primitive_mul_fixnum(ctxt, a);
+      cscript_primitive_mul_fixnum(stack, a);
       break;
     case CSCRIPT_MUL_FLONUM:
-      cscript_primitive_mul_flonum(ctxt, a);
+      cscript_primitive_mul_flonum(stack, a);
       break;
     case CSCRIPT_DIV_FIXNUM:
-      cscript_primitive_div_fixnum(ctxt, a);
+      cscript_primitive_div_fixnum(stack, a);
       break;
     case CSCRIPT_DIV_FLONUM:
-      cscript_primitive_div_flonum(ctxt, a);
+      cscript_primitive_div_flonum(stack, a);
       break;
     case CSCRIPT_MOD_FIXNUM:
-      cscript_primitive_mod_fixnum(ctxt, a);
+      cscript_primitive_mod_fixnum(stack, a);
       break;
     case CSCRIPT_MOD_FLONUM:
-      cscript_primitive_mod_flonum(ctxt, a);
+      cscript_primitive_mod_flonum(stack, a);
       break;
     case CSCRIPT_LESS_FIXNUM:
-      cscript_primitive_less_fixnum(ctxt, a);
+      cscript_primitive_less_fixnum(stack, a);
       break;
     case CSCRIPT_LESS_FLONUM:
-      cscript_primitive_less_flonum(ctxt, a);
+      cscript_primitive_less_flonum(stack, a);
       break;
     case CSCRIPT_LEQ_FIXNUM:
-      cscript_primitive_leq_fixnum(ctxt, a);
+      cscript_primitive_leq_fixnum(stack, a);
       break;
     case CSCRIPT_LEQ_FLONUM:
-      cscript_primitive_leq_flonum(ctxt, a);
+      cscript_primitive_leq_flonum(stack, a);
       break;
     case CSCRIPT_GREATER_FIXNUM:
-      cscript_primitive_greater_fixnum(ctxt, a);
+      cscript_primitive_greater_fixnum(stack, a);
       break;
     case CSCRIPT_GREATER_FLONUM:
-      cscript_primitive_greater_flonum(ctxt, a);
+      cscript_primitive_greater_flonum(stack, a);
       break;
     case CSCRIPT_GEQ_FIXNUM:
-      cscript_primitive_geq_fixnum(ctxt, a);
+      cscript_primitive_geq_fixnum(stack, a);
       break;
     case CSCRIPT_GEQ_FLONUM:
-      cscript_primitive_geq_flonum(ctxt, a);
+      cscript_primitive_geq_flonum(stack, a);
       break;
     case CSCRIPT_EQUAL_FIXNUM:
-      cscript_primitive_equal_fixnum(ctxt, a);
+      cscript_primitive_equal_fixnum(stack, a);
       break;
     case CSCRIPT_EQUAL_FLONUM:
-      cscript_primitive_equal_flonum(ctxt, a);
+      cscript_primitive_equal_flonum(stack, a);
       break;
     case CSCRIPT_NOT_EQUAL_FIXNUM:
-      cscript_primitive_not_equal_fixnum(ctxt, a);
+      cscript_primitive_not_equal_fixnum(stack, a);
       break;
     case CSCRIPT_NOT_EQUAL_FLONUM:
-      cscript_primitive_not_equal_flonum(ctxt, a);
+      cscript_primitive_not_equal_flonum(stack, a);
       break;
     case CSCRIPT_SQRT_FLONUM:
-      cscript_primitive_sqrt_flonum(ctxt, a);
+      cscript_primitive_sqrt_flonum(stack, a);
       break;
     case CSCRIPT_SIN_FLONUM:
-      cscript_primitive_sin_flonum(ctxt, a);
+      cscript_primitive_sin_flonum(stack, a);
       break;
     case CSCRIPT_COS_FLONUM:
-      cscript_primitive_cos_flonum(ctxt, a);
+      cscript_primitive_cos_flonum(stack, a);
       break;
     case CSCRIPT_EXP_FLONUM:
-      cscript_primitive_exp_flonum(ctxt, a);
+      cscript_primitive_exp_flonum(stack, a);
       break;
     case CSCRIPT_LOG_FLONUM:
-      cscript_primitive_log_flonum(ctxt, a);
+      cscript_primitive_log_flonum(stack, a);
       break;
     case CSCRIPT_LOG2_FLONUM:
-      cscript_primitive_log2_flonum(ctxt, a);
+      cscript_primitive_log2_flonum(stack, a);
       break;
     case CSCRIPT_FABS_FLONUM:
-      cscript_primitive_fabs_flonum(ctxt, a);
+      cscript_primitive_fabs_flonum(stack, a);
       break;
     case CSCRIPT_TAN_FLONUM:
-      cscript_primitive_tan_flonum(ctxt, a);
+      cscript_primitive_tan_flonum(stack, a);
       break;
     case CSCRIPT_ATAN_FLONUM:
-      cscript_primitive_atan_flonum(ctxt, a);
+      cscript_primitive_atan_flonum(stack, a);
       break;
     case CSCRIPT_ATAN2_FLONUM:
-      cscript_primitive_atan2_flonum(ctxt, a);
+      cscript_primitive_atan2_flonum(stack, a);
       break;
     case CSCRIPT_POW_FLONUM:
-      cscript_primitive_pow_flonum(ctxt, a);
+      cscript_primitive_pow_flonum(stack, a);
       break;
     case CSCRIPT_MIN_FLONUM:
-      cscript_primitive_min_flonum(ctxt, a);
+      cscript_primitive_min_flonum(stack, a);
       break;
     case CSCRIPT_MAX_FLONUM:
-      cscript_primitive_max_flonum(ctxt, a);
+      cscript_primitive_max_flonum(stack, a);
       break;
     default:
-      cscript_throw(ctxt, CSCRIPT_ERROR_NOT_IMPLEMENTED);
-      break;
+      return 0;
     }
+  return 1;
   }
 
 static void map_insert(cscript_context* ctxt, cscript_map* m, const char* str, int value)
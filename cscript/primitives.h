@@ -41,45 +41,47 @@ typedef enum
   CSCRIPT_POW_FLONUM,
   CSCRIPT_MIN_FLONUM,
   CSCRIPT_MAX_FLONUM,
+  CSCRIPT_PARALLEL_FOR, // not a primitive: CALLPRIM A, CSCRIPT_PARALLEL_FOR, C runs parallel loop C for R(A) <= i < R(A+1), see parallel.h
   } cscript_primitives;
 
-void cscript_primitive_add_fixnum(cscript_context* ctxt, int a);
-void cscript_primitive_add_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_sub_fixnum(cscript_context* ctxt, int a);
-void cscript_primitive_sub_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_mul_fixnum(cscript_context* ctxt, int a);
-void cscript_primitive_mul_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_div_fixnum(cscript_context* ctxt, int a);
-void cscript_primitive_div_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_mod_fixnum(cscript_context* ctxt, int a);
-void cscript_primitive_mod_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_less_fixnum(cscript_context* ctxt, int a);
-void cscript_primitive_less_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_leq_fixnum(cscript_context* ctxt, int a);
-void cscript_primitive_leq_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_greater_fixnum(cscript_context* ctxt, int a);
-void cscript_primitive_greater_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_geq_fixnum(cscript_context* ctxt, int a);
-void cscript_primitive_geq_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_equal_fixnum(cscript_context* ctxt, int a);
-void cscript_primitive_equal_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_not_equal_fixnum(cscript_context* ctxt, int a);
-void cscript_primitive_not_equal_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_sqrt_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_sin_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_cos_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_exp_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_log_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_log2_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_fabs_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_tan_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_atan_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_atan2_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_pow_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_min_flonum(cscript_context* ctxt, int a);
-void cscript_primitive_max_flonum(cscript_context* ctxt, int a);
+void cscript_primitive_add_fixnum(cscript_fixnum* stack, int a);
+void cscript_primitive_add_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_sub_fixnum(cscript_fixnum* stack, int a);
+void cscript_primitive_sub_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_mul_fixnum(cscript_fixnum* stack, int a);
+void cscript_primitive_mul_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_div_fixnum(cscript_fixnum* stack, int a);
+void cscript_primitive_div_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_mod_fixnum(cscript_fixnum* stack, int a);
+void cscript_primitive_mod_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_less_fixnum(cscript_fixnum* stack, int a);
+void cscript_primitive_less_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_leq_fixnum(cscript_fixnum* stack, int a);
+void cscript_primitive_leq_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_greater_fixnum(cscript_fixnum* stack, int a);
+void cscript_primitive_greater_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_geq_fixnum(cscript_fixnum* stack, int a);
+void cscript_primitive_geq_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_equal_fixnum(cscript_fixnum* stack, int a);
+void cscript_primitive_equal_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_not_equal_fixnum(cscript_fixnum* stack, int a);
+void cscript_primitive_not_equal_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_sqrt_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_sin_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_cos_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_exp_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_log_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_log2_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_fabs_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_tan_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_atan_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_atan2_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_pow_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_min_flonum(cscript_fixnum* stack, int a);
+void cscript_primitive_max_flonum(cscript_fixnum* stack, int a);
 
-void cscript_call_primitive(cscript_context* ctxt, cscript_fixnum prim_id, int a);
+// executes primitive prim_id on stack[a] and stack[a+1]. Returns 0 if prim_id is not a known primitive.
+int cscript_call_primitive(cscript_fixnum* stack, cscript_fixnum prim_id, int a);
 
 cscript_map* generate_primitives_map(cscript_context* ctxt);
 
@@ -0,0 +1,341 @@
+#include "reassoc.h"
+#include "context.h"
+#include "visitor.h"
+#include "constant.h"
+#include "map.h"
+
+#include <string.h>
+
+#define CSCRIPT_REASSOCIATION_MIN_CHAIN 4
+
+typedef struct cscript_reassociation_leaf
+  {
+  cscript_parsed_term term;
+  int negative;
+  } cscript_reassociation_leaf;
+
+static cscript_object* find_primitive(cscript_context* ctxt, cscript_string* s)
+  {
+  cscript_object key;
+  key.type = cscript_object_type_string;
+  key.value.s = *s;
+  cscript_object* res = cscript_map_get(ctxt, ctxt->global->primitives_map, &key);
+  return res;
+  }
+
+static int is_pure_expression(cscript_context* ctxt, cscript_parsed_expression* e);
+
+static int is_pure_expressions(cscript_context* ctxt, cscript_vector* exprs)
+  {
+  cscript_parsed_expression* it = cscript_vector_begin(exprs, cscript_parsed_expression);
+  cscript_parsed_expression* it_end = cscript_vector_end(exprs, cscript_parsed_expression);
+  for (; it != it_end; ++it)
+    {
+    if (is_pure_expression(ctxt, it) == 0)
+      return 0;
+    }
+  return 1;
+  }
+
+// a factor is pure if evaluating it has no side effects, so that it can be evaluated in any order
+static int is_pure_factor(cscript_context* ctxt, cscript_parsed_factor* f)
+  {
+  switch (f->type)
+    {
+    case cscript_factor_type_number:
+      return 1;
+    case cscript_factor_type_expression:
+      return is_pure_expression(ctxt, &f->factor.expr);
+    case cscript_factor_type_variable:
+      return is_pure_expressions(ctxt, &f->factor.var.dims);
+    case cscript_factor_type_function:
+      if (find_primitive(ctxt, &f->factor.fun.name) == NULL)
+        return 0; // external functions can have side effects
+      return is_pure_expressions(ctxt, &f->factor.fun.args);
+    default:
+      return 0;
+    }
+  }
+
+static int is_pure_term(cscript_context* ctxt, cscript_parsed_term* t)
+  {
+  cscript_parsed_factor* it = cscript_vector_begin(&t->operands, cscript_parsed_factor);
+  cscript_parsed_factor* it_end = cscript_vector_end(&t->operands, cscript_parsed_factor);
+  for (; it != it_end; ++it)
+    {
+    if (is_pure_factor(ctxt, it) == 0)
+      return 0;
+    }
+  return 1;
+  }
+
+static int is_pure_relop(cscript_context* ctxt, cscript_parsed_relop* r)
+  {
+  cscript_parsed_term* it = cscript_vector_begin(&r->operands, cscript_parsed_term);
+  cscript_parsed_term* it_end = cscript_vector_end(&r->operands, cscript_parsed_term);
+  for (; it != it_end; ++it)
+    {
+    if (is_pure_term(ctxt, it) == 0)
+      return 0;
+    }
+  return 1;
+  }
+
+static int is_pure_expression(cscript_context* ctxt, cscript_parsed_expression* e)
+  {
+  cscript_parsed_relop* it = cscript_vector_begin(&e->operands, cscript_parsed_relop);
+  cscript_parsed_relop* it_end = cscript_vector_end(&e->operands, cscript_parsed_relop);
+  for (; it != it_end; ++it)
+    {
+    if (is_pure_relop(ctxt, it) == 0)
+      return 0;
+    }
+  return 1;
+  }
+
+// wraps the relop as a parenthesized expression in a new factor
+static cscript_parsed_factor make_factor_from_relop(cscript_context* ctxt, cscript_parsed_relop r)
+  {
+  cscript_parsed_factor f;
+  f.type = cscript_factor_type_expression;
+  f.sign = '+';
+  f.factor.expr.filename = make_null_string();
+  f.factor.expr.line_nr = r.line_nr;
+  f.factor.expr.column_nr = r.column_nr;
+  cscript_vector_init(ctxt, &f.factor.expr.operands, cscript_parsed_relop);
+  cscript_vector_init(ctxt, &f.factor.expr.fops, int);
+  cscript_vector_push_back(ctxt, &f.factor.expr.operands, r, cscript_parsed_relop);
+  return f;
+  }
+
+static cscript_parsed_relop make_empty_relop(cscript_context* ctxt, int line_nr, int column_nr)
+  {
+  cscript_parsed_relop r;
+  r.filename = make_null_string();
+  r.line_nr = line_nr;
+  r.column_nr = column_nr;
+  cscript_vector_init(ctxt, &r.operands, cscript_parsed_term);
+  cscript_vector_init(ctxt, &r.fops, int);
+  return r;
+  }
+
+static cscript_parsed_term make_empty_term(cscript_context* ctxt, int line_nr, int column_nr)
+  {
+  cscript_parsed_term t;
+  t.filename = make_null_string();
+  t.line_nr = line_nr;
+  t.column_nr = column_nr;
+  cscript_vector_init(ctxt, &t.operands, cscript_parsed_factor);
+  cscript_vector_init(ctxt, &t.fops, int);
+  return t;
+  }
+
+static void negate_term(cscript_parsed_term* t)
+  {
+  cscript_parsed_factor* f = cscript_vector_begin(&t->operands, cscript_parsed_factor);
+  f->sign = f->sign == '-' ? '+' : '-';
+  }
+
+/*
+Builds a balanced tree for the sum of leaves[lo..hi).
+The returned leaf has the same value as the sum if leaf.negative is 0, or the negated value otherwise.
+*/
+static cscript_reassociation_leaf build_sum(cscript_context* ctxt, cscript_reassociation_leaf* leaves, int lo, int hi)
+  {
+  if (hi - lo == 1)
+    return leaves[lo];
+  int mid = (lo + hi) / 2;
+  cscript_reassociation_leaf left = build_sum(ctxt, leaves, lo, mid);
+  cscript_reassociation_leaf right = build_sum(ctxt, leaves, mid, hi);
+  cscript_parsed_relop r = make_empty_relop(ctxt, left.term.line_nr, left.term.column_nr);
+  cscript_vector_push_back(ctxt, &r.operands, left.term, cscript_parsed_term);
+  cscript_vector_push_back(ctxt, &r.operands, right.term, cscript_parsed_term);
+  cscript_vector_push_back(ctxt, &r.fops, left.negative == right.negative ? cscript_op_plus : cscript_op_minus, int);
+  cscript_reassociation_leaf result;
+  result.negative = left.negative;
+  result.term = make_empty_term(ctxt, r.line_nr, r.column_nr);
+  cscript_parsed_factor f = make_factor_from_relop(ctxt, r);
+  cscript_vector_push_back(ctxt, &result.term.operands, f, cscript_parsed_factor);
+  return result;
+  }
+
+static cscript_parsed_factor build_product(cscript_context* ctxt, cscript_parsed_factor* leaves, int lo, int hi, int line_nr, int column_nr)
+  {
+  if (hi - lo == 1)
+    return leaves[lo];
+  int mid = (lo + hi) / 2;
+  cscript_parsed_term t = make_empty_term(ctxt, line_nr, column_nr);
+  cscript_parsed_factor left = build_product(ctxt, leaves, lo, mid, line_nr, column_nr);
+  cscript_parsed_factor right = build_product(ctxt, leaves, mid, hi, line_nr, column_nr);
+  cscript_vector_push_back(ctxt, &t.operands, left, cscript_parsed_factor);
+  cscript_vector_push_back(ctxt, &t.operands, right, cscript_parsed_factor);
+  cscript_vector_push_back(ctxt, &t.fops, cscript_op_mul, int);
+  cscript_parsed_relop r = make_empty_relop(ctxt, line_nr, column_nr);
+  cscript_vector_push_back(ctxt, &r.operands, t, cscript_parsed_term);
+  return make_factor_from_relop(ctxt, r);
+  }
+
+static void postvisit_term(cscript_context* ctxt, cscript_visitor* v, cscript_parsed_term* t)
+  {
+  UNUSED(v);
+  int n = (int)t->operands.vector_size;
+  if (n < 2)
+    return;
+  int* op_it = cscript_vector_begin(&t->fops, int);
+  int* op_it_end = cscript_vector_end(&t->fops, int);
+  for (; op_it != op_it_end; ++op_it)
+    {
+    if (*op_it != cscript_op_mul) // division and modulo are not associative
+      return;
+    }
+  if (is_pure_term(ctxt, t) == 0)
+    return;
+  int nr_of_constants = 0;
+  int constants_leading = 1;
+  for (int i = 0; i < n; ++i)
+    {
+    if (cscript_is_constant_factor(ctxt, cscript_vector_at(&t->operands, i, cscript_parsed_factor)))
+      {
+      if (nr_of_constants != i)
+        constants_leading = 0;
+      ++nr_of_constants;
+      }
+    }
+  if (constants_leading && n < CSCRIPT_REASSOCIATION_MIN_CHAIN)
+    return;
+  cscript_vector leaves;
+  cscript_vector_init_reserve(ctxt, &leaves, n, cscript_parsed_factor);
+  for (int pass = 0; pass < 2; ++pass)
+    {
+    for (int i = 0; i < n; ++i)
+      {
+      cscript_parsed_factor* f = cscript_vector_at(&t->operands, i, cscript_parsed_factor);
+      if (cscript_is_constant_factor(ctxt, f) == (pass == 0 ? 1 : 0))
+        {
+        cscript_vector_push_back(ctxt, &leaves, *f, cscript_parsed_factor);
+        }
+      }
+    }
+  cscript_parsed_factor* l = cscript_vector_begin(&leaves, cscript_parsed_factor);
+  int m = n;
+  if (nr_of_constants > 1)
+    {
+    l[0] = build_product(ctxt, l, 0, nr_of_constants, t->line_nr, t->column_nr);
+    for (int i = nr_of_constants; i < n; ++i)
+      l[i - nr_of_constants + 1] = l[i];
+    m = n - nr_of_constants + 1;
+    }
+  cscript_vector_destroy(ctxt, &t->operands);
+  cscript_vector_destroy(ctxt, &t->fops);
+  cscript_vector_init(ctxt, &t->operands, cscript_parsed_factor);
+  cscript_vector_init(ctxt, &t->fops, int);
+  if (m == 1)
+    {
+    cscript_vector_push_back(ctxt, &t->operands, l[0], cscript_parsed_factor);
+    }
+  else
+    {
+    int mid = m / 2;
+    cscript_parsed_factor left = build_product(ctxt, l, 0, mid, t->line_nr, t->column_nr);
+    cscript_parsed_factor right = build_product(ctxt, l, mid, m, t->line_nr, t->column_nr);
+    cscript_vector_push_back(ctxt, &t->operands, left, cscript_parsed_factor);
+    cscript_vector_push_back(ctxt, &t->operands, right, cscript_parsed_factor);
+    cscript_vector_push_back(ctxt, &t->fops, cscript_op_mul, int);
+    }
+  cscript_vector_destroy(ctxt, &leaves);
+  }
+
+static void postvisit_relop(cscript_context* ctxt, cscript_visitor* v, cscript_parsed_relop* r)
+  {
+  UNUSED(v);
+  int n = (int)r->operands.vector_size;
+  if (n < 2)
+    return;
+  if (is_pure_relop(ctxt, r) == 0)
+    return;
+  int nr_of_constants = 0;
+  int constants_leading = 1;
+  for (int i = 0; i < n; ++i)
+    {
+    if (cscript_is_constant_term(ctxt, cscript_vector_at(&r->operands, i, cscript_parsed_term)))
+      {
+      if (nr_of_constants != i)
+        constants_leading = 0;
+      ++nr_of_constants;
+      }
+    }
+  if (constants_leading && n < CSCRIPT_REASSOCIATION_MIN_CHAIN)
+    return;
+  cscript_vector leaves;
+  cscript_vector_init_reserve(ctxt, &leaves, n, cscript_reassociation_leaf);
+  for (int pass = 0; pass < 2; ++pass)
+    {
+    for (int i = 0; i < n; ++i)
+      {
+      cscript_parsed_term* t = cscript_vector_at(&r->operands, i, cscript_parsed_term);
+      if (cscript_is_constant_term(ctxt, t) == (pass == 0 ? 1 : 0))
+        {
+        cscript_reassociation_leaf leaf;
+        leaf.term = *t;
+        leaf.negative = (i > 0 && *cscript_vector_at(&r->fops, i - 1, int) == cscript_op_minus) ? 1 : 0;
+        cscript_vector_push_back(ctxt, &leaves, leaf, cscript_reassociation_leaf);
+        }
+      }
+    }
+  cscript_reassociation_leaf* l = cscript_vector_begin(&leaves, cscript_reassociation_leaf);
+  int m = n;
+  if (nr_of_constants > 1)
+    {
+    l[0] = build_sum(ctxt, l, 0, nr_of_constants);
+    for (int i = nr_of_constants; i < n; ++i)
+      l[i - nr_of_constants + 1] = l[i];
+    m = n - nr_of_constants + 1;
+    }
+  cscript_vector_destroy(ctxt, &r->operands);
+  cscript_vector_destroy(ctxt, &r->fops);
+  cscript_vector_init(ctxt, &r->operands, cscript_parsed_term);
+  cscript_vector_init(ctxt, &r->fops, int);
+  if (m == 1)
+    {
+    if (l[0].negative)
+      negate_term(&l[0].term);
+    cscript_vector_push_back(ctxt, &r->operands, l[0].term, cscript_parsed_term);
+    }
+  else
+    {
+    int mid = m / 2;
+    cscript_reassociation_leaf left = build_sum(ctxt, l, 0, mid);
+    cscript_reassociation_leaf right = build_sum(ctxt, l, mid, m);
+    if (left.negative)
+      negate_term(&left.term);
+    cscript_vector_push_back(ctxt, &r->operands, left.term, cscript_parsed_term);
+    cscript_vector_push_back(ctxt, &r->operands, right.term, cscript_parsed_term);
+    cscript_vector_push_back(ctxt, &r->fops, right.negative ? cscript_op_minus : cscript_op_plus, int);
+    }
+  cscript_vector_destroy(ctxt, &leaves);
+  }
+
+cscript_reassociation_visitor* cscript_reassociation_visitor_new(cscript_context* ctxt)
+  {
+  cscript_reassociation_visitor* v = cscript_new(ctxt, cscript_reassociation_visitor);
+  v->visitor = cscript_visitor_new(ctxt, v);
+  v->visitor->postvisit_relop = postvisit_relop;
+  v->visitor->postvisit_term = postvisit_term;
+  return v;
+  }
+
+void cscript_reassociation_visitor_free(cscript_context* ctxt, cscript_reassociation_visitor* v)
+  {
+  if (v)
+    {
+    v->visitor->destroy(ctxt, v->visitor);
+    cscript_delete(ctxt, v);
+    }
+  }
+
+void cscript_reassociation(cscript_context* ctxt, cscript_program* program)
+  {
+  cscript_reassociation_visitor* v = cscript_reassociation_visitor_new(ctxt);
+  cscript_visit_program(ctxt, v->visitor, program);
+  cscript_reassociation_visitor_free(ctxt, v);
+  }
@@ -0,0 +1,23 @@
+#ifndef CSCRIPT_REASSOC_H
+#define CSCRIPT_REASSOC_H
+
+#include "cscript.h"
+#include "parser.h"
+#include "visitor.h"
+
+/*
+Reorders sums and products so that constant operands come first (and can be folded by
+cscript_constant_folding), and rewrites long chains into balanced trees.
+This changes the order of floating point operations, so it should only be called under fast-math.
+*/
+typedef struct cscript_reassociation_visitor
+  {
+  cscript_visitor* visitor;
+  } cscript_reassociation_visitor;
+
+cscript_reassociation_visitor* cscript_reassociation_visitor_new(cscript_context* ctxt);
+void cscript_reassociation_visitor_free(cscript_context* ctxt, cscript_reassociation_visitor* v);
+
+void cscript_reassociation(cscript_context* ctxt, cscript_program* program);
+
+#endif //CSCRIPT_REASSOC_H
@@ -0,0 +1,227 @@
+#include "records.h"
+#include "context.h"
+#include "memory.h"
+#include "syscalls.h"
+#include "thread.h"
+
+#include <string.h>
+
+typedef struct io_job
+  {
+  int fd_in;
+  int fd_out;
+  char* read_buffer;
+  int read_size;
+  int bytes_read;
+  const char* write_buffer;
+  int write_size;
+  int failed;
+  cscript_mutex mutex;
+  cscript_condition requested_changed;
+  cscript_condition done;
+  int requested; // a block should be written and read, set by the computing thread and cleared by the I/O thread
+  int stop; // the I/O thread should exit
+  } io_job;
+
+// reads until buffer is full or the end of the file is reached. Returns the number of bytes read, or -1 on failure.
+static int read_block(int fd, char* buffer, int size)
+  {
+  int total = 0;
+  while (total < size)
+    {
+    const int n = cscript_read(fd, buffer + total, cast(unsigned int, size - total));
+    if (n < 0)
+      return -1;
+    if (n == 0)
+      break;
+    total += n;
+    }
+  return total;
+  }
+
+static int write_block(int fd, const char* buffer, int size)
+  {
+  int total = 0;
+  while (total < size)
+    {
+    const int n = cscript_write(fd, buffer + total, cast(unsigned int, size - total));
+    if (n <= 0)
+      return 0;
+    total += n;
+    }
+  return 1;
+  }
+
+static void io_run(void* data)
+  {
+  io_job* job = cast(io_job*, data);
+  if (job->write_size > 0 && !write_block(job->fd_out, job->write_buffer, job->write_size))
+    job->failed = 1;
+  job->bytes_read = read_block(job->fd_in, job->read_buffer, job->read_size);
+  if (job->bytes_read < 0)
+    job->failed = 1;
+  }
+
+// every field should lie inside the record, and should fit in the argument registers
+static int valid_layout(cscript_context* ctxt, const cscript_record_layout* layout)
+  {
+  if (layout->record_size <= 0)
+    return 0;
+  if (layout->number_of_fields < 0 || layout->number_of_fields > (int)ctxt->stack.vector_size)
+    return 0;
+  if (layout->number_of_fields > 0 && layout->field_offsets == NULL)
+    return 0;
+  for (int f = 0; f < layout->number_of_fields; ++f)
+    {
+    const int offset = layout->field_offsets[f];
+    if (offset < 0 || offset > layout->record_size - (int)sizeof(cscript_fixnum))
+      return 0;
+    }
+  return 1;
+  }
+
+// the I/O thread of a stream handles the requested blocks until it is stopped
+static void io_thread_run(void* data)
+  {
+  io_job* job = cast(io_job*, data);
+  cscript_mutex_lock(&job->mutex);
+  for (;;)
+    {
+    while (!job->requested && !job->stop)
+      cscript_condition_wait(&job->requested_changed, &job->mutex);
+    if (!job->requested)
+      break;
+    cscript_mutex_unlock(&job->mutex);
+    io_run(job);
+    cscript_mutex_lock(&job->mutex);
+    job->requested = 0;
+    cscript_condition_signal(&job->done);
+    }
+  cscript_mutex_unlock(&job->mutex);
+  }
+
+static void io_request(io_job* job)
+  {
+  cscript_mutex_lock(&job->mutex);
+  job->requested = 1;
+  cscript_condition_signal(&job->requested_changed);
+  cscript_mutex_unlock(&job->mutex);
+  }
+
+static void io_stop(io_job* job)
+  {
+  cscript_mutex_lock(&job->mutex);
+  job->stop = 1;
+  cscript_condition_signal(&job->requested_changed);
+  cscript_mutex_unlock(&job->mutex);
+  }
+
+static void io_wait(io_job* job)
+  {
+  cscript_mutex_lock(&job->mutex);
+  while (job->requested)
+    cscript_condition_wait(&job->done, &job->mutex);
+  cscript_mutex_unlock(&job->mutex);
+  }
+
+cscript_fixnum cscript_run_stream(cscript_context* ctxt, cscript_function* fun, const char* in_path, const cscript_record_layout* layout, const char* out_path)
+  {
+  cscript_assert(fun != NULL);
+  if (!valid_layout(ctxt, layout))
+    return -1;
+  int records_per_block = CSCRIPT_STREAM_BLOCK_SIZE / layout->record_size;
+  if (records_per_block < 1)
+    records_per_block = 1;
+  const int in_block_size = records_per_block * layout->record_size;
+
+  io_job job;
+  job.fd_in = cscript_open_binary_input_file(in_path);
+  if (job.fd_in < 0)
+    return -1;
+  job.fd_out = cscript_open_binary_output_file(out_path);
+  if (job.fd_out < 0)
+    {
+    cscript_close_file(job.fd_in);
+    return -1;
+    }
+  char* in[2];
+  cscript_fixnum* out[2];
+  for (int i = 0; i < 2; ++i)
+    {
+    in[i] = cscript_newvector(ctxt, in_block_size, char);
+    out[i] = cscript_newvector(ctxt, records_per_block, cscript_fixnum);
+    }
+
+  cscript_fixnum* frame = cscript_vector_begin(&ctxt->stack, cscript_fixnum);
+  const cscript_externals externals = cscript_get_externals(ctxt);
+  cscript_fixnum number_of_records = 0;
+  int failed = 0;
+  int current = 0;
+  int pending_write_size = 0;
+  int bytes = read_block(job.fd_in, in[current], in_block_size);
+  if (bytes < 0)
+    failed = 1;
+  // one I/O thread serves all blocks. If it cannot be started, the blocks are read and written in between.
+  cscript_mutex_init(&job.mutex);
+  cscript_condition_init(&job.requested_changed);
+  cscript_condition_init(&job.done);
+  job.requested = 0;
+  job.stop = 0;
+  cscript_thread io_thread;
+  const int io_thread_started = !failed && bytes >= layout->record_size ? cscript_thread_create(&io_thread, io_thread_run, &job) : 0;
+  while (!failed && bytes >= layout->record_size)
+    {
+    // the previous results are written and the next block is read while the current block is computed
+    job.read_buffer = in[1 - current];
+    job.read_size = in_block_size;
+    job.write_buffer = cast(const char*, out[1 - current]);
+    job.write_size = pending_write_size;
+    job.failed = 0;
+    if (io_thread_started)
+      io_request(&job);
+    else
+      io_run(&job);
+
+    const int records = bytes / layout->record_size;
+    const char* record = in[current];
+    for (int r = 0; r < records; ++r, record += layout->record_size)
+      {
+      for (int f = 0; f < layout->number_of_fields; ++f)
+        memcpy(frame + f, record + layout->field_offsets[f], sizeof(cscript_fixnum));
+      const cscript_fixnum* result = cscript_run_frame(fun, &externals, frame);
+      if (result == NULL)
+        {
+        failed = 1;
+        break;
+        }
+      out[current][r] = *result;
+      }
+
+    if (io_thread_started)
+      io_wait(&job);
+    failed |= job.failed;
+    number_of_records += records;
+    pending_write_size = records * (int)sizeof(cscript_fixnum);
+    bytes = job.bytes_read;
+    current = 1 - current;
+    }
+  if (io_thread_started)
+    {
+    io_stop(&job);
+    cscript_thread_join(&io_thread);
+    }
+  cscript_condition_destroy(&job.requested_changed);
+  cscript_condition_destroy(&job.done);
+  cscript_mutex_destroy(&job.mutex);
+  if (!failed && pending_write_size > 0 && !write_block(job.fd_out, cast(const char*, out[1 - current]), pending_write_size))
+    failed = 1;
+
+  for (int i = 0; i < 2; ++i)
+    {
+    cscript_freevector(ctxt, in[i], in_block_size, char);
+    cscript_freevector(ctxt, out[i], records_per_block, cscript_fixnum);
+    }
+  cscript_close_file(job.fd_in);
+  cscript_close_file(job.fd_out);
+  return failed ? -1 : number_of_records;
+  }
@@ -0,0 +1,14 @@
+#ifndef CSCRIPT_RECORDS_H
+#define CSCRIPT_RECORDS_H
+
+#include "cscript.h"
+
+/*
+Number of bytes that cscript_run_stream reads per block. One block is read from the input file
+while the previous block is being computed, so two input blocks and two output blocks are kept in memory.
+*/
+#ifndef CSCRIPT_STREAM_BLOCK_SIZE
+#define CSCRIPT_STREAM_BLOCK_SIZE (1 << 22)
+#endif
+
+#endif //CSCRIPT_RECORDS_H
@@ -8,66 +8,49 @@
 typedef struct cscript_is_used_variable_visitor
   {
   cscript_visitor* visitor;
-  cscript_map* is_unused;
+  cscript_vector* is_unused; // vector of type int, indexed by symbol id
   } cscript_is_used_variable_visitor;
 
+static void set_unused(cscript_vector* is_unused, int symbol, int value)
+  {
+  if (symbol >= 0)
+    *cscript_vector_at(is_unused, symbol, int) = value;
+  }
+
+static int get_unused(cscript_vector* is_unused, int symbol)
+  {
+  return symbol >= 0 ? *cscript_vector_at(is_unused, symbol, int) : 0;
+  }
+
 static int previsit_fixnum(cscript_context* ctxt, cscript_visitor* v, cscript_parsed_fixnum* fx)
   {
   cscript_is_used_variable_visitor* vis = (cscript_is_used_variable_visitor*)(v->impl);
-  cscript_object key;
-  key.type = cscript_object_type_string;
-  cscript_string_copy(ctxt, &key.value.s, &fx->name);
-  cscript_object* value = cscript_map_insert(ctxt, vis->is_unused, &key);
-  value->type = cscript_object_type_fixnum;
-  if (fx->name.string_ptr[0] == '$' || fx->dims.vector_size > 0)
-    value->value.fx = 0;
-  else
-    value->value.fx = 1;
+  UNUSED(ctxt);
+  set_unused(vis->is_unused, fx->symbol, fx->dims.vector_size > 0 ? 0 : 1);
   return 1;
   }
 
 static int previsit_flonum(cscript_context* ctxt, cscript_visitor* v, cscript_parsed_flonum* fl)
   {
   cscript_is_used_variable_visitor* vis = (cscript_is_used_variable_visitor*)(v->impl);
-  cscript_object key;
-  key.type = cscript_object_type_string;
-  cscript_string_copy(ctxt, &key.value.s, &fl->name);
-  cscript_object* value = cscript_map_insert(ctxt, vis->is_unused, &key);
-  value->type = cscript_object_type_fixnum;
-  if (fl->name.string_ptr[0] == '$' || fl->dims.vector_size > 0)
-    value->value.fx = 0;
-  else
-    value->value.fx = 1;
+  UNUSED(ctxt);
+  set_unused(vis->is_unused, fl->symbol, fl->dims.vector_size > 0 ? 0 : 1);
   return 1;
   }
 
 static int previsit_lvalueop(cscript_context* ctxt, cscript_visitor* v, cscript_parsed_lvalue_operator* l)
   {
   cscript_is_used_variable_visitor* vis = (cscript_is_used_variable_visitor*)(v->impl);
-  cscript_object key;
-  key.type = cscript_object_type_string;
-  key.value.s = l->lvalue.name;
-  cscript_object* value = cscript_map_get(ctxt, vis->is_unused, &key);
-  if (value != NULL)
-    {
-    value->type = cscript_object_type_fixnum;
-    value->value.fx = 0;
-    }
+  UNUSED(ctxt);
+  set_unused(vis->is_unused, l->lvalue.symbol, 0);
   return 1;
   }
 
 static int previsit_var(cscript_context* ctxt, cscript_visitor* v, cscript_parsed_variable* var)
   {
   cscript_is_used_variable_visitor* vis = (cscript_is_used_variable_visitor*)(v->impl);
-  cscript_object key;
-  key.type = cscript_object_type_string;
-  key.value.s = var->name;
-  cscript_object* value = cscript_map_get(ctxt, vis->is_unused, &key);
-  if (value != NULL)
-    {
-    value->type = cscript_object_type_fixnum;
-    value->value.fx = 0;
-    }
+  UNUSED(ctxt);
+  set_unused(vis->is_unused, var->symbol, 0);
   return 1;
   }
 
@@ -94,7 +77,7 @@ static void cscript_is_used_variable_visitor_free(cscript_context* ctxt, cscript
 typedef struct cscript_remove_dead_variables_visitor
   {
   cscript_visitor* visitor;
-  cscript_map* is_unused;
+  cscript_vector* is_unused;
   cscript_program* program;
   } cscript_remove_dead_variables_visitor;
 
@@ -105,11 +88,7 @@ static int previsit_statement(cscript_context* ctxt, cscript_visitor* v, cscript
     {
     case cscript_statement_type_fixnum:
     {
-    cscript_object key;
-    key.type = cscript_object_type_string;
-    key.value.s = s->statement.fixnum.name;
-    cscript_object* value = cscript_map_get(ctxt, vis->is_unused, &key);
-    if (value != NULL && value->value.fx != 0)
+    if (get_unused(vis->is_unused, s->statement.fixnum.symbol))
       {
       cscript_statement_destroy(ctxt, s);
       s->type = cscript_statement_type_nop;
@@ -120,11 +99,7 @@ static int previsit_statement(cscript_context* ctxt, cscript_visitor* v, cscript
     }
     case cscript_statement_type_flonum:
     {
-    cscript_object key;
-    key.type = cscript_object_type_string;
-    key.value.s = s->statement.flonum.name;
-    cscript_object* value = cscript_map_get(ctxt, vis->is_unused, &key);
-    if (value != NULL && value->value.fx != 0)
+    if (get_unused(vis->is_unused, s->statement.flonum.symbol))
       {
       cscript_statement_destroy(ctxt, s);
       s->type = cscript_statement_type_nop;
@@ -135,11 +110,7 @@ static int previsit_statement(cscript_context* ctxt, cscript_visitor* v, cscript
     }
     case cscript_statement_type_assignment:
     {
-    cscript_object key;
-    key.type = cscript_object_type_string;
-    key.value.s = s->statement.assignment.name;
-    cscript_object* value = cscript_map_get(ctxt, vis->is_unused, &key);
-    if (value != NULL && value->value.fx != 0)
+    if (get_unused(vis->is_unused, s->statement.assignment.symbol))
       {
       cscript_statement_destroy(ctxt, s);
       s->type = cscript_statement_type_nop;
@@ -173,18 +144,20 @@ static void cscript_remove_dead_variables_visitor_free(cscript_context* ctxt, cs
 
 void cscript_remove_dead_variables(cscript_context* ctxt, cscript_program* program)
   {
-  cscript_map* is_unused = cscript_map_new(ctxt, 0, 8);
+  cscript_vector is_unused;
+  cscript_vector_init_with_size(ctxt, &is_unused, program->number_of_symbols, int);
+  if (program->number_of_symbols > 0)
+    memset(is_unused.vector_ptr, 0, program->number_of_symbols * sizeof(int));
   cscript_is_used_variable_visitor* v1 = cscript_is_used_variable_visitor_new(ctxt);
-  v1->is_unused = is_unused;
+  v1->is_unused = &is_unused;
   cscript_visit_program(ctxt, v1->visitor, program);
   cscript_is_used_variable_visitor_free(ctxt, v1);
 
   cscript_remove_dead_variables_visitor* v2 = cscript_remove_dead_variables_visitor_new(ctxt);
-  v2->is_unused = is_unused;
+  v2->is_unused = &is_unused;
   v2->program = program;
   cscript_visit_program(ctxt, v2->visitor, program);
   cscript_remove_dead_variables_visitor_free(ctxt, v2);
 
-  cscript_map_keys_free(ctxt, is_unused);
-  cscript_map_free(ctxt, is_unused);
-  }
\ No newline at end of file
+  cscript_vector_destroy(ctxt, &is_unused);
+  }
@@ -0,0 +1,168 @@
+#include "report.h"
+#include "context.h"
+#include "memory.h"
+#include "visitor.h"
+#include "syscalls.h"
+
+#include <string.h>
+
+void cscript_compile_report_enable(cscript_context* ctxt, int enable)
+  {
+  if (enable && ctxt->recorder == NULL)
+    {
+    cscript_compile_recorder* r = cscript_new(ctxt, cscript_compile_recorder);
+    memset(&r->report, 0, sizeof(cscript_compile_report));
+    r->phase = -1;
+    r->phase_start = 0.0;
+    r->start = 0.0;
+    ctxt->recorder = r;
+    }
+  else if (!enable)
+    cscript_compile_recorder_free(ctxt);
+  }
+
+int cscript_get_compile_report(cscript_context* ctxt, cscript_compile_report* report)
+  {
+  if (ctxt->recorder == NULL)
+    return 0;
+  *report = ctxt->recorder->report;
+  return 1;
+  }
+
+void cscript_compile_recorder_free(cscript_context* ctxt)
+  {
+  if (ctxt->recorder != NULL)
+    {
+    cscript_compile_recorder* r = ctxt->recorder;
+    ctxt->recorder = NULL;
+    cscript_delete(ctxt, r);
+    }
+  }
+
+void cscript_compile_report_begin(cscript_context* ctxt)
+  {
+  ctxt->memory_category = cscript_memory_other;
+  cscript_compile_recorder* r = ctxt->recorder;
+  if (r == NULL)
+    return;
+  memset(&r->report, 0, sizeof(cscript_compile_report));
+  r->phase = -1;
+  r->start = cscript_wall_time();
+  }
+
+void cscript_compile_report_end(cscript_context* ctxt)
+  {
+  cscript_compile_recorder* r = ctxt->recorder;
+  if (r == NULL)
+    return;
+  r->report.time = cscript_wall_time() - r->start;
+  }
+
+static cscript_memory_category phase_memory_category(cscript_compile_phase phase)
+  {
+  switch (phase)
+    {
+    case cscript_compile_phase_tokenize:
+      return cscript_memory_tokens;
+    case cscript_compile_phase_code_generation:
+    case cscript_compile_phase_single_pass:
+      return cscript_memory_bytecode;
+    default:
+      return cscript_memory_ast;
+    }
+  }
+
+void cscript_compile_phase_begin(cscript_context* ctxt, cscript_compile_phase phase)
+  {
+  ctxt->memory_category = phase_memory_category(phase);
+  cscript_compile_recorder* r = ctxt->recorder;
+  if (r == NULL)
+    return;
+  cscript_assert(r->phase < 0);
+  r->phase = cast(int, phase);
+  r->phase_start = cscript_wall_time();
+  }
+
+void cscript_compile_phase_end(cscript_context* ctxt)
+  {
+  ctxt->memory_category = cscript_memory_other;
+  cscript_compile_recorder* r = ctxt->recorder;
+  if (r == NULL || r->phase < 0)
+    return;
+  cscript_compile_phase_stats* stats = &r->report.phases[r->phase];
+  stats->time += cscript_wall_time() - r->phase_start;
+  ++stats->number_of_runs;
+  r->phase = -1;
+  }
+
+void cscript_compile_report_tokens(cscript_context* ctxt, cscript_memsize number_of_tokens)
+  {
+  if (ctxt->recorder != NULL)
+    ctxt->recorder->report.number_of_tokens = number_of_tokens;
+  }
+
+void cscript_compile_report_fast_path(cscript_context* ctxt)
+  {
+  if (ctxt->recorder != NULL)
+    ctxt->recorder->report.fast_path = 1;
+  }
+
+static int count_statement(cscript_context* ctxt, cscript_visitor* v, cscript_statement* s)
+  {
+  UNUSED(ctxt);
+  UNUSED(s);
+  ++*cast(cscript_memsize*, v->impl);
+  return 1;
+  }
+
+static int count_expression(cscript_context* ctxt, cscript_visitor* v, cscript_parsed_expression* e)
+  {
+  UNUSED(ctxt);
+  UNUSED(e);
+  ++*cast(cscript_memsize*, v->impl);
+  return 1;
+  }
+
+static int count_relop(cscript_context* ctxt, cscript_visitor* v, cscript_parsed_relop* r)
+  {
+  UNUSED(ctxt);
+  UNUSED(r);
+  ++*cast(cscript_memsize*, v->impl);
+  return 1;
+  }
+
+static int count_term(cscript_context* ctxt, cscript_visitor* v, cscript_parsed_term* t)
+  {
+  UNUSED(ctxt);
+  UNUSED(t);
+  ++*cast(cscript_memsize*, v->impl);
+  return 1;
+  }
+
+static int count_factor(cscript_context* ctxt, cscript_visitor* v, cscript_parsed_factor* f)
+  {
+  UNUSED(ctxt);
+  UNUSED(f);
+  ++*cast(cscript_memsize*, v->impl);
+  return 1;
+  }
+
+void cscript_compile_report_nodes(cscript_context* ctxt, cscript_program* prog, int optimized)
+  {
+  cscript_compile_recorder* r = ctxt->recorder;
+  if (r == NULL)
+    return;
+  cscript_memsize number_of_nodes = 0;
+  cscript_visitor* v = cscript_visitor_new(ctxt, &number_of_nodes);
+  v->previsit_statement = count_statement;
+  v->previsit_expression = count_expression;
+  v->previsit_relop = count_relop;
+  v->previsit_term = count_term;
+  v->previsit_factor = count_factor;
+  cscript_visit_program(ctxt, v, prog);
+  v->destroy(ctxt, v);
+  if (optimized)
+    r->report.number_of_optimized_nodes = number_of_nodes;
+  else
+    r->report.number_of_nodes = number_of_nodes;
+  }
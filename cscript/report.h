@@ -0,0 +1,39 @@
+#ifndef CSCRIPT_REPORT_H
+#define CSCRIPT_REPORT_H
+
+#include "cscript.h"
+#include "parser.h"
+
+/*
+Compile reports are only collected by contexts that enabled them with cscript_compile_report_enable; for other
+contexts the functions below return at once. A phase runs from cscript_compile_phase_begin to
+cscript_compile_phase_end, and phases do not nest. While a phase is active, cscript_realloc counts the blocks that
+are allocated or grown, and the bytes they add, for that phase, including blocks that are served by the arena.
+A phase that runs more than once, such as the optimization rounds, accumulates its statistics.
+Phases also set the memory category of the allocations of ctxt (see cscript_memory_stats), also when reporting
+is off.
+*/
+
+typedef struct cscript_compile_recorder
+  {
+  cscript_compile_report report;
+  int phase; // active phase, -1 outside a phase
+  double phase_start; // in milliseconds
+  double start; // of the compilation, in milliseconds
+  } cscript_compile_recorder;
+
+// starts the report of a new compilation
+void cscript_compile_report_begin(cscript_context* ctxt);
+void cscript_compile_report_end(cscript_context* ctxt);
+
+void cscript_compile_phase_begin(cscript_context* ctxt, cscript_compile_phase phase);
+void cscript_compile_phase_end(cscript_context* ctxt);
+
+void cscript_compile_report_tokens(cscript_context* ctxt, cscript_memsize number_of_tokens);
+// counts the nodes of prog, as number_of_nodes or, if optimized is nonzero, as number_of_optimized_nodes
+void cscript_compile_report_nodes(cscript_context* ctxt, cscript_program* prog, int optimized);
+void cscript_compile_report_fast_path(cscript_context* ctxt);
+
+void cscript_compile_recorder_free(cscript_context* ctxt);
+
+#endif //CSCRIPT_REPORT_H
@@ -0,0 +1,318 @@
+#include "spmd.h"
+#include "context.h"
+#include "error.h"
+#include "vm.h"
+#include "primitives.h"
+#include "limits.h"
+
+#include <string.h>
+
+#define LANES CSCRIPT_SPMD_LANES
+
+#define FX(r) (regs + (r)*LANES)
+#define FL(r) cast(cscript_flonum*, regs + (r)*LANES)
+
+/*
+Binary primitives operate on R(A) and R(A+1) for all lanes, and only keep the result for
+the lanes in the execution mask. Inactive lanes hold stale values, so fixnum arithmetic is done
+unsigned (see FX_WRAP), as a signed overflow on a lane whose result is discarded is still undefined.
+*/
+#define FX_WRAP(op) cast(cscript_fixnum, cast(uint64_t, x) op cast(uint64_t, y))
+
+#define SPMD_BINARY_OP(type, REG, expr) \
+  { \
+  type* ra = REG(a); \
+  const type* rb = REG(a + 1); \
+  for (int l = 0; l < LANES; ++l) \
+    { \
+    const type x = ra[l]; \
+    const type y = rb[l]; \
+    const type r = (expr); \
+    ra[l] = mask[l] ? r : x; \
+    } \
+  }
+
+#define SPMD_COMPARE_OP(type, REG, expr) \
+  { \
+  type* ra = REG(a); \
+  const type* rb = REG(a + 1); \
+  cscript_fixnum* res = FX(a); \
+  for (int l = 0; l < LANES; ++l) \
+    { \
+    const type x = ra[l]; \
+    const type y = rb[l]; \
+    const cscript_fixnum r = (expr) ? 1 : 0; \
+    if (mask[l]) \
+      res[l] = r; \
+    } \
+  }
+
+int cscript_spmd_supported(cscript_function* fun)
+  {
+  const cscript_instruction* it = cscript_vector_begin(&fun->code, cscript_instruction);
+  const cscript_instruction* it_end = cscript_vector_end(&fun->code, cscript_instruction);
+  for (; it != it_end; ++it)
+    {
+    switch (CSCRIPT_GET_OPCODE(*it))
+      {
+      case CSCRIPT_OPCODE_STORE_MEMORY:
+      case CSCRIPT_OPCODE_LOAD_MEMORY:
+      case CSCRIPT_OPCODE_CALLFOREIGN:
+      case CSCRIPT_OPCODE_STOREGLOBAL:
+      case CSCRIPT_OPCODE_ADDRESS: // the registers of a lane are not contiguous in memory
+        return 0;
+      case CSCRIPT_OPCODE_CALLPRIM: // parallel for loops run their body on a row-major frame
+        if (CSCRIPT_GETARG_B(*it) == CSCRIPT_PARALLEL_FOR)
+          return 0;
+        break;
+      default:
+        break;
+      }
+    }
+  return 1;
+  }
+
+static void call_primitive(cscript_context* ctxt, cscript_fixnum* regs, const cscript_fixnum* mask, int b, int a)
+  {
+  switch (b)
+    {
+    case CSCRIPT_ADD_FIXNUM: SPMD_BINARY_OP(cscript_fixnum, FX, FX_WRAP(+)); break;
+    case CSCRIPT_ADD_FLONUM: SPMD_BINARY_OP(cscript_flonum, FL, x + y); break;
+    case CSCRIPT_SUB_FIXNUM: SPMD_BINARY_OP(cscript_fixnum, FX, FX_WRAP(-)); break;
+    case CSCRIPT_SUB_FLONUM: SPMD_BINARY_OP(cscript_flonum, FL, x - y); break;
+    case CSCRIPT_MUL_FIXNUM: SPMD_BINARY_OP(cscript_fixnum, FX, FX_WRAP(*)); break;
+    case CSCRIPT_MUL_FLONUM: SPMD_BINARY_OP(cscript_flonum, FL, x * y); break;
+    case CSCRIPT_DIV_FLONUM: SPMD_BINARY_OP(cscript_flonum, FL, x / y); break;
+    case CSCRIPT_MIN_FLONUM: SPMD_BINARY_OP(cscript_flonum, FL, x < y ? x : y); break;
+    case CSCRIPT_MAX_FLONUM: SPMD_BINARY_OP(cscript_flonum, FL, x > y ? x : y); break;
+    case CSCRIPT_LESS_FIXNUM: SPMD_COMPARE_OP(cscript_fixnum, FX, x < y); break;
+    case CSCRIPT_LESS_FLONUM: SPMD_COMPARE_OP(cscript_flonum, FL, x < y); break;
+    case CSCRIPT_LEQ_FIXNUM: SPMD_COMPARE_OP(cscript_fixnum, FX, x <= y); break;
+    case CSCRIPT_LEQ_FLONUM: SPMD_COMPARE_OP(cscript_flonum, FL, x <= y); break;
+    case CSCRIPT_GREATER_FIXNUM: SPMD_COMPARE_OP(cscript_fixnum, FX, x > y); break;
+    case CSCRIPT_GREATER_FLONUM: SPMD_COMPARE_OP(cscript_flonum, FL, x > y); break;
+    case CSCRIPT_GEQ_FIXNUM: SPMD_COMPARE_OP(cscript_fixnum, FX, x >= y); break;
+    case CSCRIPT_GEQ_FLONUM: SPMD_COMPARE_OP(cscript_flonum, FL, x >= y); break;
+    case CSCRIPT_EQUAL_FIXNUM: SPMD_COMPARE_OP(cscript_fixnum, FX, x == y); break;
+    case CSCRIPT_EQUAL_FLONUM: SPMD_COMPARE_OP(cscript_flonum, FL, x == y); break;
+    case CSCRIPT_NOT_EQUAL_FIXNUM: SPMD_COMPARE_OP(cscript_fixnum, FX, x != y); break;
+    case CSCRIPT_NOT_EQUAL_FLONUM: SPMD_COMPARE_OP(cscript_flonum, FL, x != y); break;
+    default:
+    {
+    // integer division can trap on inactive lanes, and the math functions are not vectorized,
+    // so these primitives are called lane by lane on a scalar copy of the operands
+    cscript_fixnum operands[2];
+    for (int l = 0; l < LANES; ++l)
+      {
+      if (mask[l] == 0)
+        continue;
+      operands[0] = FX(a)[l];
+      operands[1] = FX(a + 1)[l];
+      if (!cscript_call_primitive(operands, b, 0))
+        cscript_throw(ctxt, CSCRIPT_ERROR_NOT_IMPLEMENTED);
+      FX(a)[l] = operands[0];
+      }
+    break;
+    }
+    }
+  }
+
+/*
+Every lane has its own program counter. In each step the instruction with the lowest program
+counter of all running lanes is executed for all lanes at that program counter (the execution mask).
+Lanes that diverge on a NEQ instruction wait until the others catch up, so that they reconverge
+after an if statement or a loop.
+*/
+static void run_block(cscript_context* ctxt, cscript_function* fun, cscript_fixnum* regs, int number_of_lanes, cscript_fixnum* results)
+  {
+  const cscript_instruction* code = cscript_vector_begin(&fun->code, cscript_instruction);
+  const int code_size = (int)fun->code.vector_size;
+  const cscript_fixnum* globals = cscript_vector_begin(&ctxt->globals, cscript_fixnum);
+  int pc[LANES];
+  int returned[LANES];
+  cscript_fixnum mask[LANES];
+  for (int l = 0; l < LANES; ++l)
+    {
+    pc[l] = l < number_of_lanes ? 0 : code_size;
+    returned[l] = 0;
+    }
+  for (;;)
+    {
+    int current = code_size;
+    for (int l = 0; l < LANES; ++l)
+      {
+      if (pc[l] < current)
+        current = pc[l];
+      }
+    if (current == code_size)
+      break;
+    for (int l = 0; l < LANES; ++l)
+      mask[l] = pc[l] == current ? 1 : 0;
+    const cscript_instruction instruc = code[current];
+    int next = current + 1;
+    switch (CSCRIPT_GET_OPCODE(instruc))
+      {
+      case CSCRIPT_OPCODE_MOVE:
+      {
+      cscript_fixnum* ra = FX(CSCRIPT_GETARG_A(instruc));
+      const cscript_fixnum* rb = FX(CSCRIPT_GETARG_B(instruc));
+      for (int l = 0; l < LANES; ++l)
+        ra[l] = mask[l] ? rb[l] : ra[l];
+      break;
+      }
+      case CSCRIPT_OPCODE_MOVE_TO_ARR:
+      {
+      const int a = CSCRIPT_GETARG_A(instruc);
+      const cscript_fixnum* rb = FX(CSCRIPT_GETARG_B(instruc));
+      const cscript_fixnum* rc = FX(CSCRIPT_GETARG_C(instruc));
+      for (int l = 0; l < LANES; ++l)
+        {
+        if (mask[l])
+          FX(a + rb[l])[l] = rc[l];
+        }
+      break;
+      }
+      case CSCRIPT_OPCODE_MOVE_FROM_ARR:
+      {
+      cscript_fixnum* ra = FX(CSCRIPT_GETARG_A(instruc));
+      const int b = CSCRIPT_GETARG_B(instruc);
+      const cscript_fixnum* rc = FX(CSCRIPT_GETARG_C(instruc));
+      for (int l = 0; l < LANES; ++l)
+        {
+        if (mask[l])
+          ra[l] = FX(b + rc[l])[l];
+        }
+      break;
+      }
+      case CSCRIPT_OPCODE_LOADGLOBAL:
+      {
+      cscript_fixnum* ra = FX(CSCRIPT_GETARG_A(instruc));
+      const cscript_fixnum g = globals[CSCRIPT_GETARG_Bx(instruc)];
+      for (int l = 0; l < LANES; ++l)
+        ra[l] = mask[l] ? g : ra[l];
+      break;
+      }
+      case CSCRIPT_OPCODE_LOADK:
+      {
+      cscript_fixnum* ra = FX(CSCRIPT_GETARG_A(instruc));
+      const cscript_fixnum k = *cscript_vector_at(&fun->constants, CSCRIPT_GETARG_Bx(instruc), cscript_fixnum);
+      for (int l = 0; l < LANES; ++l)
+        ra[l] = mask[l] ? k : ra[l];
+      break;
+      }
+      case CSCRIPT_OPCODE_SETFIXNUM:
+      {
+      cscript_fixnum* ra = FX(CSCRIPT_GETARG_A(instruc));
+      const cscript_fixnum k = cast(cscript_fixnum, CSCRIPT_GETARG_sBx(instruc));
+      for (int l = 0; l < LANES; ++l)
+        ra[l] = mask[l] ? k : ra[l];
+      break;
+      }
+      case CSCRIPT_OPCODE_CALLPRIM:
+      {
+      call_primitive(ctxt, regs, mask, CSCRIPT_GETARG_B(instruc), CSCRIPT_GETARG_A(instruc));
+      break;
+      }
+      case CSCRIPT_OPCODE_CAST:
+      {
+      const int a = CSCRIPT_GETARG_A(instruc);
+      if (CSCRIPT_GETARG_B(instruc) == cscript_number_type_flonum)
+        {
+        for (int l = 0; l < LANES; ++l)
+          {
+          const cscript_flonum r = cast(cscript_flonum, FX(a)[l]);
+          if (mask[l])
+            FL(a)[l] = r;
+          }
+        }
+      else
+        {
+        // converting a stale flonum that is out of range is undefined, so only the active lanes are converted
+        for (int l = 0; l < LANES; ++l)
+          {
+          if (mask[l])
+            FX(a)[l] = cast(cscript_fixnum, FL(a)[l]);
+          }
+        }
+      break;
+      }
+      case CSCRIPT_OPCODE_NEQ:
+      {
+      const cscript_fixnum* ra = FX(CSCRIPT_GETARG_A(instruc));
+      const cscript_fixnum b = CSCRIPT_GETARG_B(instruc);
+      const int c = CSCRIPT_GETARG_C(instruc);
+      cscript_assert(current + 1 < code_size && CSCRIPT_GET_OPCODE(code[current + 1]) == CSCRIPT_OPCODE_JMP);
+      const int jump_target = current + 2 + CSCRIPT_GETARG_sBx(code[current + 1]);
+      for (int l = 0; l < LANES; ++l)
+        {
+        if (mask[l])
+          pc[l] = ((ra[l] != b) == (c == 0)) ? current + 2 : jump_target;
+        }
+      continue;
+      }
+      case CSCRIPT_OPCODE_JMP:
+      {
+      next = current + 1 + CSCRIPT_GETARG_sBx(instruc);
+      break;
+      }
+      case CSCRIPT_OPCODE_RETURN:
+      {
+      const int a = CSCRIPT_GETARG_A(instruc);
+      const int b = CSCRIPT_GETARG_B(instruc);
+      const cscript_fixnum* r = (a != 0 && b > 0) ? FX(a) : FX(0);
+      for (int l = 0; l < LANES; ++l)
+        {
+        if (mask[l])
+          {
+          results[l] = r[l];
+          returned[l] = 1;
+          }
+        }
+      next = code_size;
+      break;
+      }
+      default:
+        cscript_throw(ctxt, CSCRIPT_ERROR_NOT_IMPLEMENTED);
+      }
+    for (int l = 0; l < LANES; ++l)
+      {
+      if (mask[l])
+        pc[l] = next;
+      }
+    }
+  for (int l = 0; l < number_of_lanes; ++l)
+    {
+    if (returned[l] == 0)
+      results[l] = FX(fun->result_position)[l];
+    }
+  }
+
+void cscript_run_spmd(cscript_context* ctxt, cscript_function* fun, const cscript_fixnum* args, int number_of_arguments, int args_stride, int count, cscript_fixnum* results)
+  {
+  cscript_assert(fun != NULL);
+  cscript_assert(number_of_arguments >= 0 && number_of_arguments <= (int)ctxt->stack.vector_size);
+  cscript_assert(args_stride >= number_of_arguments);
+  if (cscript_spmd_supported(fun) == 0)
+    {
+    cscript_run_batch(ctxt, fun, args, number_of_arguments, args_stride, count, results);
+    return;
+    }
+  const cscript_memsize number_of_registers = ctxt->stack.vector_size;
+  const cscript_memsize regs_size = number_of_registers * LANES * sizeof(cscript_fixnum);
+  cscript_fixnum* regs = cast(cscript_fixnum*, cscript_malloc(ctxt, regs_size));
+  memset(regs, 0, regs_size);
+  cscript_fixnum block_results[LANES];
+  for (int first = 0; first < count; first += LANES)
+    {
+    const int number_of_lanes = count - first < LANES ? count - first : LANES;
+    for (int l = 0; l < number_of_lanes; ++l)
+      {
+      const cscript_fixnum* row = args + cast(size_t, first + l) * cast(size_t, args_stride);
+      for (int i = 0; i < number_of_arguments; ++i)
+        FX(i)[l] = row[i];
+      }
+    run_block(ctxt, fun, regs, number_of_lanes, block_results);
+    memcpy(results + first, block_results, cast(size_t, number_of_lanes) * sizeof(cscript_fixnum));
+    }
+  cscript_free(ctxt, regs, regs_size);
+  }
@@ -0,0 +1,23 @@
+#ifndef CSCRIPT_SPMD_H
+#define CSCRIPT_SPMD_H
+
+#include "cscript.h"
+#include "func.h"
+
+/*
+Number of argument rows that are executed in lockstep by cscript_run_spmd.
+Each register holds one value per lane, stored contiguously, so that the lane loops
+can be vectorized by the C compiler (8 lanes of 64 bit fill an AVX-512 register or two AVX2 registers).
+*/
+#ifndef CSCRIPT_SPMD_LANES
+#define CSCRIPT_SPMD_LANES 8
+#endif
+
+/*
+Returns 1 if the function can be executed lane-parallel.
+Functions that access memory through pointers, call external functions or write global variables
+depend on the order of execution of the rows, and are executed row by row instead.
+*/
+int cscript_spmd_supported(cscript_function* fun);
+
+#endif //CSCRIPT_SPMD_H
@@ -1,10 +1,15 @@
 #include "syscalls.h"
 
 #ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
 #include <io.h>
 #include <sys\stat.h>
 #else
 #include <unistd.h>
+#include <time.h>
 #endif
 #include <fcntl.h>
 #include <stdlib.h>
@@ -55,6 +60,24 @@ int cscript_open_input_file(const char* filename)
 #endif
   }
 
+int cscript_open_binary_output_file(const char* filename)
+  {
+#ifdef _WIN32
+  return _open(filename, _O_CREAT | _O_WRONLY | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+  return cscript_open_output_file(filename);
+#endif
+  }
+
+int cscript_open_binary_input_file(const char* filename)
+  {
+#ifdef _WIN32
+  return _open(filename, _O_RDONLY | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+  return cscript_open_input_file(filename);
+#endif
+  }
+
 int cscript_close_file(int fd)
   {
   if (fd < 0)
@@ -75,6 +98,20 @@ long cscript_tell(int fd)
 #endif
   }
 
+double cscript_wall_time(void)
+  {
+#ifdef _WIN32
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return cast(double, counter.QuadPart) * 1000.0 / cast(double, frequency.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return cast(double, ts.tv_sec) * 1000.0 + cast(double, ts.tv_nsec) / 1000000.0;
+#endif
+  }
+
 const char* cscript_getenv(const char* name)
   {
   return getenv(name);
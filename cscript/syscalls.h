@@ -12,10 +12,18 @@ int cscript_open_output_file(const char* filename);
 
 int cscript_open_input_file(const char* filename);
 
+// same as cscript_open_output_file and cscript_open_input_file, but without newline translation on Windows
+int cscript_open_binary_output_file(const char* filename);
+
+int cscript_open_binary_input_file(const char* filename);
+
 int cscript_close_file(int fd);
 
 long cscript_tell(int fd);
 
+// monotonic wall clock in milliseconds
+double cscript_wall_time(void);
+
 const char* cscript_getenv(const char* name);
 
 int cscript_putenv(const char* name, const char* value);
@@ -0,0 +1,156 @@
+#include "thread.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+static DWORD WINAPI thread_start(LPVOID data)
+  {
+  cscript_thread* t = (cscript_thread*)data;
+  t->fun(t->data);
+  return 0;
+  }
+#else
+static void* thread_start(void* data)
+  {
+  cscript_thread* t = (cscript_thread*)data;
+  t->fun(t->data);
+  return NULL;
+  }
+#endif
+
+int cscript_thread_create(cscript_thread* t, cscript_thread_function fun, void* data)
+  {
+  t->fun = fun;
+  t->data = data;
+#ifdef _WIN32
+  t->handle = CreateThread(NULL, 0, thread_start, t, 0, NULL);
+  return t->handle != NULL ? 1 : 0;
+#else
+  return pthread_create(&t->handle, NULL, thread_start, t) == 0 ? 1 : 0;
+#endif
+  }
+
+void cscript_thread_join(cscript_thread* t)
+  {
+#ifdef _WIN32
+  WaitForSingleObject(t->handle, INFINITE);
+  CloseHandle(t->handle);
+#else
+  pthread_join(t->handle, NULL);
+#endif
+  }
+
+void cscript_mutex_init(cscript_mutex* m)
+  {
+#ifdef _WIN32
+  InitializeCriticalSection(&m->cs);
+#else
+  pthread_mutex_init(&m->m, NULL);
+#endif
+  }
+
+void cscript_mutex_destroy(cscript_mutex* m)
+  {
+#ifdef _WIN32
+  DeleteCriticalSection(&m->cs);
+#else
+  pthread_mutex_destroy(&m->m);
+#endif
+  }
+
+void cscript_mutex_lock(cscript_mutex* m)
+  {
+#ifdef _WIN32
+  EnterCriticalSection(&m->cs);
+#else
+  pthread_mutex_lock(&m->m);
+#endif
+  }
+
+void cscript_mutex_unlock(cscript_mutex* m)
+  {
+#ifdef _WIN32
+  LeaveCriticalSection(&m->cs);
+#else
+  pthread_mutex_unlock(&m->m);
+#endif
+  }
+
+void cscript_condition_init(cscript_condition* c)
+  {
+#ifdef _WIN32
+  InitializeConditionVariable(&c->cv);
+#else
+  pthread_cond_init(&c->cv, NULL);
+#endif
+  }
+
+void cscript_condition_destroy(cscript_condition* c)
+  {
+#ifdef _WIN32
+  (void)c; // windows condition variables need no cleanup
+#else
+  pthread_cond_destroy(&c->cv);
+#endif
+  }
+
+void cscript_condition_wait(cscript_condition* c, cscript_mutex* m)
+  {
+#ifdef _WIN32
+  SleepConditionVariableCS(&c->cv, &m->cs, INFINITE);
+#else
+  pthread_cond_wait(&c->cv, &m->m);
+#endif
+  }
+
+void cscript_condition_signal(cscript_condition* c)
+  {
+#ifdef _WIN32
+  WakeConditionVariable(&c->cv);
+#else
+  pthread_cond_signal(&c->cv);
+#endif
+  }
+
+void cscript_condition_broadcast(cscript_condition* c)
+  {
+#ifdef _WIN32
+  WakeAllConditionVariable(&c->cv);
+#else
+  pthread_cond_broadcast(&c->cv);
+#endif
+  }
+
+#ifdef _WIN32
+static BOOL CALLBACK once_start(PINIT_ONCE once, PVOID parameter, PVOID* context)
+  {
+  (void)once;
+  (void)context;
+  void (*fun)(void) = (void (*)(void))parameter;
+  fun();
+  return TRUE;
+  }
+#endif
+
+void cscript_call_once(cscript_once* o, void (*fun)(void))
+  {
+#ifdef _WIN32
+  InitOnceExecuteOnce(&o->once, once_start, (PVOID)fun, NULL);
+#else
+  pthread_once(&o->once, fun);
+#endif
+  }
+
+int cscript_hardware_concurrency()
+  {
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  int n = (int)info.dwNumberOfProcessors;
+#else
+  int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return n > 0 ? n : 1;
+  }
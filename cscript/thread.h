@@ -0,0 +1,89 @@
+#ifndef CSCRIPT_THREAD_H
+#define CSCRIPT_THREAD_H
+
+#include "cscript.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#ifdef _MSC_VER
+#define CSCRIPT_THREAD_LOCAL __declspec(thread)
+#else
+#define CSCRIPT_THREAD_LOCAL __thread
+#endif
+
+typedef void (*cscript_thread_function)(void* data);
+
+typedef struct cscript_thread
+  {
+#ifdef _WIN32
+  HANDLE handle;
+#else
+  pthread_t handle;
+#endif
+  cscript_thread_function fun;
+  void* data;
+  } cscript_thread;
+
+typedef struct cscript_mutex
+  {
+#ifdef _WIN32
+  CRITICAL_SECTION cs;
+#else
+  pthread_mutex_t m;
+#endif
+  } cscript_mutex;
+
+typedef struct cscript_condition
+  {
+#ifdef _WIN32
+  CONDITION_VARIABLE cv;
+#else
+  pthread_cond_t cv;
+#endif
+  } cscript_condition;
+
+typedef struct cscript_once
+  {
+#ifdef _WIN32
+  INIT_ONCE once;
+#else
+  pthread_once_t once;
+#endif
+  } cscript_once;
+
+#ifdef _WIN32
+#define CSCRIPT_ONCE_INIT { INIT_ONCE_STATIC_INIT }
+#else
+#define CSCRIPT_ONCE_INIT { PTHREAD_ONCE_INIT }
+#endif
+
+// the thread object should stay alive until cscript_thread_join is called. Returns 0 on failure.
+int cscript_thread_create(cscript_thread* t, cscript_thread_function fun, void* data);
+void cscript_thread_join(cscript_thread* t);
+
+void cscript_mutex_init(cscript_mutex* m);
+void cscript_mutex_destroy(cscript_mutex* m);
+void cscript_mutex_lock(cscript_mutex* m);
+void cscript_mutex_unlock(cscript_mutex* m);
+
+void cscript_condition_init(cscript_condition* c);
+void cscript_condition_destroy(cscript_condition* c);
+// m should be locked by the calling thread. Wakeups can be spurious, so the waited for state should be checked in a loop.
+void cscript_condition_wait(cscript_condition* c, cscript_mutex* m);
+void cscript_condition_signal(cscript_condition* c);
+void cscript_condition_broadcast(cscript_condition* c);
+
+// calls fun exactly once for o, which is initialized with CSCRIPT_ONCE_INIT, also if several threads call it at the same time
+void cscript_call_once(cscript_once* o, void (*fun)(void));
+
+// number of logical processors, at least 1
+int cscript_hardware_concurrency();
+
+#endif //CSCRIPT_THREAD_H
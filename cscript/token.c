@@ -23,9 +23,9 @@ cscript_fixnum cscript_to_fixnum(const char* value)
 #endif
   }
 
-int cscript_is_number(int* is_real, int* is_scientific, const char* value)
+static int is_number_ranged(int* is_real, int* is_scientific, const char* value, const char* value_end)
   {
-  if (value[0] == '\0')
+  if (value == value_end)
     return 0;
   int i = 0;
   if (value[0] == 'e' || value[0] == 'E')
@@ -35,13 +35,13 @@ int cscript_is_number(int* is_real, int* is_scientific, const char* value)
   if (value[0] == '-' || value[0] == '+')
     {
     ++i;
-    if (value[1] == '\0')
+    if (value + 1 == value_end)
       return 0;
     }
   *is_real = 0;
   *is_scientific = 0;
   const char* s = value + i;
-  while (*s != '\0')
+  while (s != value_end)
     {
     if (isdigit((unsigned char)(*s)) == 0)
       {
@@ -51,19 +51,19 @@ int cscript_is_number(int* is_real, int* is_scientific, const char* value)
         {
         *is_scientific = 1;
         *is_real = 1;
-        if (*(s + 1) == '\0')
+        if (s + 1 == value_end)
           return 0;
         if (*(s + 1) == '-' || *(s + 1) == '+')
           {
           ++s;
           }
-        if (*(s + 1) == '\0')
+        if (s + 1 == value_end)
           return 0;
         }
       else if (*is_real && (*s == 'f' || *s == 'F'))
         {
         ++s;
-        if (*s == '\0')
+        if (s == value_end)
           {
           return 1;
           }
@@ -77,6 +77,11 @@ int cscript_is_number(int* is_real, int* is_scientific, const char* value)
   return 1;
   }
 
+int cscript_is_number(int* is_real, int* is_scientific, const char* value)
+  {
+  return is_number_ranged(is_real, is_scientific, value, value + strlen(value));
+  }
+
 static int ignore_character(char ch)
   {
   return (ch == ' ' || ch == '\n' || ch == '\t' || ch == '\r');
@@ -103,492 +108,356 @@ token cscript_make_token_cstr(cscript_context* ctxt, int type, int line_nr, int
   }
 
 
-static int treat_buffer_token(cscript_context* ctxt, cscript_string* buff, token* tok, int line_nr, int column_nr)
+int cscript_keyword_type(const char* word, int length)
   {
-  int result = 0;
-  if (buff->string_length != 0 && *cscript_string_front(buff) != '\0')
+  switch (length)
     {
-    int is_real;
-    int is_scientific;
-    if (cscript_is_number(&is_real, &is_scientific, buff->string_ptr))
-      {
-      if (is_real)
-        {
-        *tok = cscript_make_token(ctxt, CSCRIPT_T_FLONUM, line_nr, column_nr - (int)buff->string_length, buff);
-        result = 1;
-        }
-      else
-        {
-        *tok = cscript_make_token(ctxt, CSCRIPT_T_FIXNUM, line_nr, column_nr - (int)buff->string_length, buff);
-        result = 1;
-        }
-      }
-    else
-      {
-      *tok = cscript_make_token(ctxt, CSCRIPT_T_ID, line_nr, column_nr - (int)buff->string_length, buff);
-      result = 1;
-      }
+    case 2:
+      if (word[0] == 'i' && word[1] == 'f')
+        return CSCRIPT_T_KEYWORD_IF;
+      break;
+    case 3:
+      if (word[0] == 'i' && word[1] == 'n' && word[2] == 't')
+        return CSCRIPT_T_KEYWORD_INT;
+      if (word[0] == 'f' && word[1] == 'o' && word[2] == 'r')
+        return CSCRIPT_T_KEYWORD_FOR;
+      break;
+    case 4:
+      if (memcmp(word, "else", 4) == 0)
+        return CSCRIPT_T_KEYWORD_ELSE;
+      break;
+    case 5:
+      if (word[0] == 'f' && memcmp(word, "float", 5) == 0)
+        return CSCRIPT_T_KEYWORD_FLOAT;
+      if (word[0] == 'w' && memcmp(word, "while", 5) == 0)
+        return CSCRIPT_T_KEYWORD_WHILE;
+      break;
+    default:
+      break;
     }
+  return CSCRIPT_T_ID;
+  }
 
-  cscript_string_clear(buff);
-  return result;
+const char* cscript_token_type_text(int type)
+  {
+  switch (type)
+    {
+    case CSCRIPT_T_LEFT_ROUND_BRACKET: return "(";
+    case CSCRIPT_T_RIGHT_ROUND_BRACKET: return ")";
+    case CSCRIPT_T_LEFT_SQUARE_BRACKET: return "[";
+    case CSCRIPT_T_RIGHT_SQUARE_BRACKET: return "]";
+    case CSCRIPT_T_LEFT_CURLY_BRACE: return "{";
+    case CSCRIPT_T_RIGHT_CURLY_BRACE: return "}";
+    case CSCRIPT_T_RELATIVE_LESS: return "<";
+    case CSCRIPT_T_RELATIVE_LEQ: return "<=";
+    case CSCRIPT_T_RELATIVE_GREATER: return ">";
+    case CSCRIPT_T_RELATIVE_GEQ: return ">=";
+    case CSCRIPT_T_RELATIVE_EQUAL: return "==";
+    case CSCRIPT_T_RELATIVE_NOTEQUAL: return "!=";
+    case CSCRIPT_T_FIXNUM: return "integer";
+    case CSCRIPT_T_FLONUM: return "number";
+    case CSCRIPT_T_ID: return "variable";
+    case CSCRIPT_T_ASSIGNMENT: return "=";
+    case CSCRIPT_T_ASSIGNMENT_PLUS: return "+=";
+    case CSCRIPT_T_ASSIGNMENT_MINUS: return "-=";
+    case CSCRIPT_T_ASSIGNMENT_MUL: return "*=";
+    case CSCRIPT_T_ASSIGNMENT_DIV: return "/=";
+    case CSCRIPT_T_INCREMENT: return "++";
+    case CSCRIPT_T_DECREMENT: return "--";
+    case CSCRIPT_T_PLUS: return "+";
+    case CSCRIPT_T_MINUS: return "-";
+    case CSCRIPT_T_MUL: return "*";
+    case CSCRIPT_T_DIV: return "/";
+    case CSCRIPT_T_NOT: return "!";
+    case CSCRIPT_T_SEMICOLON: return ";";
+    case CSCRIPT_T_COMMA: return ",";
+    case CSCRIPT_T_AMPERSAND: return "&";
+    case CSCRIPT_T_PERCENT: return "%";
+    case CSCRIPT_T_KEYWORD_INT: return "int";
+    case CSCRIPT_T_KEYWORD_FLOAT: return "float";
+    case CSCRIPT_T_KEYWORD_IF: return "if";
+    case CSCRIPT_T_KEYWORD_ELSE: return "else";
+    case CSCRIPT_T_KEYWORD_FOR: return "for";
+    case CSCRIPT_T_KEYWORD_WHILE: return "while";
+    default: return "";
+    }
   }
 
-int cscript_read_token_polymorph(token* tok, cscript_context* ctxt, cscript_string* buff, void* str, cscript_read_token_state* state, cscript_get_char_fun get_char, cscript_next_char_fun next_char, cscript_get_position_fun get_position)
+void cscript_token_destroy(cscript_context* ctxt, token* tok)
   {
-  tok->value.string_ptr = 0;
-  tok->value.string_capacity = 0;
-  tok->value.string_length = 0;
-  tok->type = CSCRIPT_T_BAD;
-  cscript_assert(buff->string_length == 0);
+  cscript_string_destroy(ctxt, &tok->value);
+  }
 
+void destroy_tokens_vector(cscript_context* ctxt, cscript_vector* tokens)
+  {
+  token* it = cscript_vector_begin(tokens, token);
+  token* it_end = cscript_vector_end(tokens, token);
+  for (; it != it_end; ++it)
+    {
+    cscript_token_destroy(ctxt, it);
+    }
+  cscript_vector_destroy(ctxt, tokens);
+  }
+
+typedef struct span_scanner
+  {
+  const char* script;
+  cscript_memsize length;
+  cscript_memsize position;
+  cscript_memsize word_start; // first character of the identifier or number that is being read
+  int word_length;
+  int line_nr;
+  int column_nr;
+  } span_scanner;
+
+// read == 0 equals a peek
+static int scanner_get_char(char* ch, span_scanner* sc, int read)
+  {
+  if (sc->position >= sc->length)
+    return 0;
+  *ch = sc->script[sc->position];
+  sc->position += read;
+  return 1;
+  }
+
+static void make_span(cscript_token_span* span, cscript_memsize offset, int length, int type, int line_nr, int column_nr)
+  {
+  span->offset = offset;
+  span->length = length;
+  span->type = type;
+  span->line_nr = line_nr;
+  span->column_nr = column_nr;
+  }
+
+static int flush_word(cscript_token_span* span, span_scanner* sc)
+  {
+  if (sc->word_length == 0)
+    return 0;
+  const char* word = sc->script + sc->word_start;
+  int is_real;
+  int is_scientific;
+  int type;
+  if (is_number_ranged(&is_real, &is_scientific, word, word + sc->word_length))
+    type = is_real ? CSCRIPT_T_FLONUM : CSCRIPT_T_FIXNUM;
+  else
+    type = cscript_keyword_type(word, sc->word_length);
+  make_span(span, sc->word_start, sc->word_length, type, sc->line_nr, sc->column_nr - sc->word_length);
+  sc->word_length = 0;
+  return 1;
+  }
+
+// returns the length of the operator or bracket that starts with ch, or 0 if ch is part of an identifier or number
+static int read_punctuation(int* type, char ch, char next)
+  {
+  switch (ch)
+    {
+    case '(': *type = CSCRIPT_T_LEFT_ROUND_BRACKET; return 1;
+    case ')': *type = CSCRIPT_T_RIGHT_ROUND_BRACKET; return 1;
+    case '[': *type = CSCRIPT_T_LEFT_SQUARE_BRACKET; return 1;
+    case ']': *type = CSCRIPT_T_RIGHT_SQUARE_BRACKET; return 1;
+    case '{': *type = CSCRIPT_T_LEFT_CURLY_BRACE; return 1;
+    case '}': *type = CSCRIPT_T_RIGHT_CURLY_BRACE; return 1;
+    case ';': *type = CSCRIPT_T_SEMICOLON; return 1;
+    case ',': *type = CSCRIPT_T_COMMA; return 1;
+    case '%': *type = CSCRIPT_T_PERCENT; return 1;
+    case '&': *type = CSCRIPT_T_AMPERSAND; return 1;
+    case '+':
+      if (next == '=') { *type = CSCRIPT_T_ASSIGNMENT_PLUS; return 2; }
+      if (next == '+') { *type = CSCRIPT_T_INCREMENT; return 2; }
+      *type = CSCRIPT_T_PLUS; return 1;
+    case '-':
+      if (next == '=') { *type = CSCRIPT_T_ASSIGNMENT_MINUS; return 2; }
+      if (next == '-') { *type = CSCRIPT_T_DECREMENT; return 2; }
+      *type = CSCRIPT_T_MINUS; return 1;
+    case '*':
+      if (next == '=') { *type = CSCRIPT_T_ASSIGNMENT_MUL; return 2; }
+      *type = CSCRIPT_T_MUL; return 1;
+    case '/':
+      if (next == '=') { *type = CSCRIPT_T_ASSIGNMENT_DIV; return 2; }
+      *type = CSCRIPT_T_DIV; return 1;
+    case '<':
+      if (next == '=') { *type = CSCRIPT_T_RELATIVE_LEQ; return 2; }
+      *type = CSCRIPT_T_RELATIVE_LESS; return 1;
+    case '>':
+      if (next == '=') { *type = CSCRIPT_T_RELATIVE_GEQ; return 2; }
+      *type = CSCRIPT_T_RELATIVE_GREATER; return 1;
+    case '=':
+      if (next == '=') { *type = CSCRIPT_T_RELATIVE_EQUAL; return 2; }
+      *type = CSCRIPT_T_ASSIGNMENT; return 1;
+    case '!':
+      if (next == '=') { *type = CSCRIPT_T_RELATIVE_NOTEQUAL; return 2; }
+      *type = CSCRIPT_T_NOT; return 1;
+    default:
+      return 0;
+    }
+  }
+
+/*
+Reads the next token of the script. Identifiers and numbers are collected until whitespace, a comment or
+punctuation follows. Lines and columns start at 1, and the column of a token is that of its first character.
+*/
+static int read_span(cscript_token_span* span, span_scanner* sc)
+  {
   char s;
-  int valid_chars_remaining = get_char(&s, str, 0);
+  int valid_chars_remaining = scanner_get_char(&s, sc, 0);
   while (valid_chars_remaining)
     {
     if (ignore_character(s))
       {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
+      if (flush_word(span, sc))
         return 1;
-        }
       while (ignore_character(s) && valid_chars_remaining)
         {
         if (s == '\n')
           {
-          ++state->line_nr;
-          state->column_nr = 0;
+          ++sc->line_nr;
+          sc->column_nr = 0;
           }
-        next_char(str);
-        valid_chars_remaining = get_char(&s, str, 0);
-        ++state->column_nr;
+        ++sc->position;
+        valid_chars_remaining = scanner_get_char(&s, sc, 0);
+        ++sc->column_nr;
         }
       if (!valid_chars_remaining)
         break;
       }
-
-    const cscript_fixnum str_position = get_position(str);
-
-    switch (s)
-      {
-      case '(':
-      {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_LEFT_ROUND_BRACKET, state->line_nr, state->column_nr, "(");
-      ++state->column_nr;
-      return 1;
-      }
-      case ')':
-      {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_RIGHT_ROUND_BRACKET, state->line_nr, state->column_nr, ")");
-      ++state->column_nr;
-      return 1;
-      }
-      case '[':
-      {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_LEFT_SQUARE_BRACKET, state->line_nr, state->column_nr, "[");
-      ++state->column_nr;
-      return 1;
-      }
-      case ']':
-      {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_RIGHT_SQUARE_BRACKET, state->line_nr, state->column_nr, "]");
-      ++state->column_nr;
-      return 1;
-      }   
-      case ';':
-      {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_SEMICOLON, state->line_nr, state->column_nr, ";");
-      ++state->column_nr;
-      return 1;
-      }      
-      case ',':
-      {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_COMMA, state->line_nr, state->column_nr, ",");
-      ++state->column_nr;
-      return 1;
-      }
-      case '{':
-      {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_LEFT_CURLY_BRACE, state->line_nr, state->column_nr, "{");
-      ++state->column_nr;
-      return 1;
-      }
-      case '}':
-      {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_RIGHT_CURLY_BRACE, state->line_nr, state->column_nr, "}");
-      ++state->column_nr;
-      return 1;
-      }
-      case '%':
-      {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_PERCENT, state->line_nr, state->column_nr, "%");
-      ++state->column_nr;
-      return 1;
-      }
-      case '&':
-      {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_AMPERSAND, state->line_nr, state->column_nr, "&");
-      ++state->column_nr;
-      return 1;
-      }
-      case '+':
-      {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      char t;
-      int valid_peek = get_char(&t, str, 0); // peek
-      if (valid_peek && t == '=')
-        {
-        *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_ASSIGNMENT_PLUS, state->line_nr, state->column_nr, "+=");
-        next_char(str);
-        state->column_nr += 2;
-        return 1;
-        }
-      else if (valid_peek && t == '+')
-        {
-        *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_INCREMENT, state->line_nr, state->column_nr, "++");
-        next_char(str);
-        state->column_nr += 2;
-        return 1;
-        }
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_PLUS, state->line_nr, state->column_nr, "+");
-      ++state->column_nr;
-      return 1;
-      }
-      case '-':
+    const char next = sc->position + 1 < sc->length ? sc->script[sc->position + 1] : '\0';
+    if (s == '/' && next == '/') // comment till end of the line
       {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      char t;
-      int valid_peek = get_char(&t, str, 0); // peek
-      if (valid_peek && t == '=')
-        {
-        *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_ASSIGNMENT_MINUS, state->line_nr, state->column_nr, "-=");
-        next_char(str);
-        state->column_nr += 2;
+      if (flush_word(span, sc))
         return 1;
-        }
-      else if (valid_peek && t == '-')
-        {
-        *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_DECREMENT, state->line_nr, state->column_nr, "--");
-        next_char(str);
-        state->column_nr += 2;
-        return 1;
-        }
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_MINUS, state->line_nr, state->column_nr, "-");
-      ++state->column_nr;
-      return 1;
-      }
-      case '*':
-      {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      char t;
-      int valid_peek = get_char(&t, str, 0); // peek
-      if (valid_peek && t == '=')
-        {
-        *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_ASSIGNMENT_MUL, state->line_nr, state->column_nr, "*=");
-        next_char(str);
-        state->column_nr += 2;
-        return 1;
-        }
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_MUL, state->line_nr, state->column_nr, "*");
-      ++state->column_nr;
-      return 1;
-      }
-      case '<':
-      {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      char t;
-      int valid_peek = get_char(&t, str, 0); // peek
-      if (valid_peek && t == '=')
-        {
-        *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_RELATIVE_LEQ, state->line_nr, state->column_nr, "<=");
-        next_char(str);
-        state->column_nr += 2;
-        return 1;
-        }
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_RELATIVE_LESS, state->line_nr, state->column_nr, "<");
-      ++state->column_nr;
-      return 1;
-      }
-      case '>':
-      {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      char t;
-      int valid_peek = get_char(&t, str, 0); // peek
-      if (valid_peek && t == '=')
-        {
-        *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_RELATIVE_GEQ, state->line_nr, state->column_nr, ">=");
-        next_char(str);
-        state->column_nr += 2;
-        return 1;
-        }
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_RELATIVE_GREATER, state->line_nr, state->column_nr, ">");
-      ++state->column_nr;
-      return 1;
-      }
-      case '=':
-      {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      char t;
-      int valid_peek = get_char(&t, str, 0); // peek
-      if (valid_peek && t == '=')
-        {
-        *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_RELATIVE_EQUAL, state->line_nr, state->column_nr, "==");
-        next_char(str);
-        state->column_nr += 2;
-        return 1;
-        }
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_ASSIGNMENT, state->line_nr, state->column_nr, "=");
-      ++state->column_nr;
-      return 1;
-      }
-      case '!':
-      {      
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      char t;
-      int valid_peek = get_char(&t, str, 0); // peek
-      if (valid_peek && t == '=')
-        {
-        *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_RELATIVE_NOTEQUAL, state->line_nr, state->column_nr, "!=");
-        next_char(str);
-        state->column_nr += 2;
-        return 1;
-        }
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_NOT, state->line_nr, state->column_nr, "!");
-      ++state->column_nr;
-      return 1;
+      ++sc->position;
+      while (valid_chars_remaining && s != '\n')
+        valid_chars_remaining = scanner_get_char(&s, sc, 1);
+      valid_chars_remaining = scanner_get_char(&s, sc, 0);
+      ++sc->line_nr;
+      sc->column_nr = 1;
+      continue;
       }
-      case '/':
+    if (s == '/' && next == '*') // multiline comment
       {
-      if (treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr))
-        {
-        return 1;
-        }
-      next_char(str);
-      char t;
-      int valid_peek = get_char(&t, str, 0); // peek
-      if (valid_peek && t == '=')
-        {
-        *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_ASSIGNMENT_DIV, state->line_nr, state->column_nr, "/=");
-        next_char(str);
-        state->column_nr += 2;
+      if (flush_word(span, sc))
         return 1;
-        }
-      else if (valid_peek && t == '/') // comment till end of the line
-        {
-        while (valid_chars_remaining && s != '\n') // comment, so skip till end of the line
-          valid_chars_remaining = get_char(&s, str, 1);
-        valid_chars_remaining = get_char(&s, str, 0);
-        ++state->line_nr;
-        state->column_nr = 1;
-        break;
-        }
-      else if (valid_peek && t == '*') // multiline comment
-        {
-        valid_chars_remaining = get_char(&s, str, 1);
-        valid_chars_remaining = get_char(&s, str, 1);
-        ++state->column_nr;
-        int end_of_comment_found = 0;
-        while (!end_of_comment_found)
+      ++sc->position;
+      valid_chars_remaining = scanner_get_char(&s, sc, 1);
+      valid_chars_remaining = scanner_get_char(&s, sc, 1);
+      ++sc->column_nr;
+      int end_of_comment_found = 0;
+      while (!end_of_comment_found)
+        {
+        while (valid_chars_remaining && s != '*')
           {
-          while (valid_chars_remaining && s != '*')
+          if (s == '\n')
             {
-            if (s == '\n')
-              {
-              ++state->line_nr;
-              state->column_nr = 0;
-              }
-            valid_chars_remaining = get_char(&s, str, 1);
-            ++state->column_nr;
+            ++sc->line_nr;
+            sc->column_nr = 0;
             }
-          if (!valid_chars_remaining)
-            {
+          valid_chars_remaining = scanner_get_char(&s, sc, 1);
+          ++sc->column_nr;
+          }
+        if (!valid_chars_remaining)
+          end_of_comment_found = 1;
+        else
+          {
+          valid_chars_remaining = scanner_get_char(&s, sc, 1);
+          if (valid_chars_remaining && s == '/')
             end_of_comment_found = 1;
-            }
-          else
-            {
-            valid_chars_remaining = get_char(&s, str, 1);
-            if (valid_chars_remaining && s == '/')
-              end_of_comment_found = 1;
-            }
           }
-        valid_chars_remaining = get_char(&s, str, 0);
-        ++state->column_nr;
-        break;
         }
-      *tok = cscript_make_token_cstr(ctxt, CSCRIPT_T_DIV, state->line_nr, state->column_nr, "/");
-      ++state->column_nr;
-      return 1;
+      valid_chars_remaining = scanner_get_char(&s, sc, 0);
+      ++sc->column_nr;
+      continue;
       }
-      } // switch (s)
-
-
-    if ((str_position == get_position(str)) && valid_chars_remaining)
+    int type;
+    const int length = read_punctuation(&type, s, next);
+    if (length > 0)
       {
-      cscript_string_push_back(ctxt, buff, s);
-      next_char(str);
-      valid_chars_remaining = get_char(&s, str, 0);
-      ++state->column_nr;
+      if (flush_word(span, sc))
+        return 1;
+      make_span(span, sc->position, length, type, sc->line_nr, sc->column_nr);
+      sc->position += length;
+      sc->column_nr += length;
+      return 1;
       }
-
+    if (sc->word_length == 0)
+      sc->word_start = sc->position;
+    ++sc->word_length;
+    ++sc->position;
+    valid_chars_remaining = scanner_get_char(&s, sc, 0);
+    ++sc->column_nr;
     }
-  return treat_buffer_token(ctxt, buff, tok, state->line_nr, state->column_nr);
+  return flush_word(span, sc);
   }
 
-
-// read == 0 equals a peek
-static int _stream_get_char(char* ch, void* st, int read)
+static void scanner_init(span_scanner* sc, const char* script, cscript_memsize length, cscript_memsize position)
   {
-  cscript_stream* str = cast(cscript_stream*, st);
-  if (str->position >= str->length)
-    {
-    return 0;
-    }
-  *ch = str->data[str->position];
-  str->position += read;
-  return 1;
+  sc->script = script;
+  sc->length = length;
+  sc->position = position;
+  sc->word_start = 0;
+  sc->word_length = 0;
+  sc->line_nr = 1;
+  sc->column_nr = 1;
   }
 
-static void _stream_next_char(void* st)
+cscript_vector cscript_script2spans(cscript_context* ctxt, const char* script)
   {
-  cscript_stream* str = cast(cscript_stream*, st);
-  ++str->position;
+  cscript_vector spans;
+  cscript_vector_init(ctxt, &spans, cscript_token_span);
+  span_scanner sc;
+  scanner_init(&sc, script, cast(cscript_memsize, strlen(script)), 0);
+  cscript_token_span span;
+  while (read_span(&span, &sc))
+    {
+    cscript_vector_push_back(ctxt, &spans, span, cscript_token_span);
+    }
+  return spans;
   }
 
-static cscript_fixnum _stream_get_position(void* st)
+cscript_vector cscript_script2tokens(cscript_context* ctxt, const char* script)
   {
-  cscript_stream* str = cast(cscript_stream*, st);
-  return cast(cscript_fixnum, str->position);
+  cscript_vector spans = cscript_script2spans(ctxt, script);
+  cscript_vector tokens = cscript_spans2tokens(ctxt, script, &spans);
+  cscript_vector_destroy(ctxt, &spans);
+  return tokens;
   }
 
-int cscript_read_token(token* tok, cscript_context* ctxt, cscript_string* buff, cscript_stream* str, cscript_read_token_state* state)
+static token span2token(cscript_context* ctxt, const char* script, const cscript_token_span* span)
   {
-  return cscript_read_token_polymorph(tok, ctxt, buff, cast(void*, str), state, &_stream_get_char, &_stream_next_char, &_stream_get_position);
+  token tok;
+  tok.type = span->type;
+  tok.line_nr = span->line_nr;
+  tok.column_nr = span->column_nr;
+  cscript_string_init_ranged(ctxt, &tok.value, script + span->offset, script + span->offset + span->length);
+  return tok;
   }
 
-cscript_vector tokenize(cscript_context* ctxt, cscript_stream* str)
+cscript_vector cscript_spans2tokens(cscript_context* ctxt, const char* script, const cscript_vector* spans)
   {
   cscript_vector tokens;
-  cscript_vector_init(ctxt, &tokens, token);
-
-  cscript_string buff;
-  cscript_string_init(ctxt, &buff, "");
-
-  cscript_read_token_state state;
-  state.line_nr = 1;
-  state.column_nr = 1;
-
-  token tok;
-  while (cscript_read_token(&tok, ctxt, &buff, str, &state))
+  cscript_vector_init_reserve(ctxt, &tokens, spans->vector_size, token);
+  const cscript_token_span* it = cscript_vector_begin(spans, cscript_token_span);
+  const cscript_token_span* it_end = cscript_vector_end(spans, cscript_token_span);
+  for (; it != it_end; ++it)
     {
+    token tok = span2token(ctxt, script, it);
     cscript_vector_push_back(ctxt, &tokens, tok, token);
     }
-
-  cscript_string_destroy(ctxt, &buff);
   return tokens;
   }
 
-void cscript_token_destroy(cscript_context* ctxt, token* tok)
-  {
-  cscript_string_destroy(ctxt, &tok->value);
-  }
-
-void destroy_tokens_vector(cscript_context* ctxt, cscript_vector* tokens)
+// the stream is read from its current position to its end with the scanner of cscript_script2spans
+cscript_vector tokenize(cscript_context* ctxt, cscript_stream* str)
   {
-  token* it = cscript_vector_begin(tokens, token);
-  token* it_end = cscript_vector_end(tokens, token);
-  for (; it != it_end; ++it)
+  cscript_vector tokens;
+  cscript_vector_init(ctxt, &tokens, token);
+  span_scanner sc;
+  scanner_init(&sc, str->data, str->length, str->position);
+  cscript_token_span span;
+  while (read_span(&span, &sc))
     {
-    cscript_token_destroy(ctxt, it);
+    token tok = span2token(ctxt, str->data, &span);
+    cscript_vector_push_back(ctxt, &tokens, tok, token);
     }
-  cscript_vector_destroy(ctxt, tokens);
-  }
-
-cscript_vector cscript_script2tokens(cscript_context* ctxt, const char* script)
-  {
-  cscript_stream str;
-  cscript_stream_init(ctxt, &str, 10);
-  cscript_memsize len = cast(cscript_memsize, strlen(script));
-  cscript_stream_write(ctxt, &str, script, len, 0);
-  cscript_stream_rewind(&str);
-  cscript_vector tokens = tokenize(ctxt, &str);
-  cscript_stream_close(ctxt, &str);
+  str->position = sc.position;
   return tokens;
-  }
\ No newline at end of file
+  }
@@ -43,9 +43,25 @@ enum token_type
   CSCRIPT_T_SEMICOLON,
   CSCRIPT_T_COMMA,
   CSCRIPT_T_AMPERSAND,
-  CSCRIPT_T_PERCENT
+  CSCRIPT_T_PERCENT,
+  CSCRIPT_T_KEYWORD_INT,
+  CSCRIPT_T_KEYWORD_FLOAT,
+  CSCRIPT_T_KEYWORD_IF,
+  CSCRIPT_T_KEYWORD_ELSE,
+  CSCRIPT_T_KEYWORD_FOR,
+  CSCRIPT_T_KEYWORD_WHILE
   };
 
+/*
+* Returns the keyword type of the identifier of the given length, or CSCRIPT_T_ID if it is no keyword.
+* The words parallel, sum, min and max are no keywords: they only have a special meaning in front of a
+* for loop, and can be used as names elsewhere.
+*/
+int cscript_keyword_type(const char* word, int length);
+
+// the text of a token of the given type, or a description of it for identifiers and numbers, for error messages
+const char* cscript_token_type_text(int type);
+
 
 typedef struct token 
   {
@@ -58,28 +74,36 @@ typedef struct token
 token cscript_make_token(cscript_context* ctxt, int type, int line_nr, int column_nr, cscript_string* value);
 token cscript_make_token_cstr(cscript_context* ctxt, int type, int line_nr, int column_nr, const char* value);
 
-typedef struct cscript_read_token_state
-  {
-  int line_nr;
-  int column_nr;
-  } cscript_read_token_state;
-
-int cscript_read_token(token* tok, cscript_context* ctxt, cscript_string* buff, cscript_stream* str, cscript_read_token_state* state);
-
-typedef int (*cscript_get_char_fun)(char*, void*, int);
-typedef void (*cscript_next_char_fun)(void*);
-typedef cscript_fixnum (*cscript_get_position_fun)(void*);
-int cscript_read_token_polymorph(token* tok, cscript_context* ctxt, cscript_string* buff, void* str, cscript_read_token_state* state, cscript_get_char_fun get_char, cscript_next_char_fun next_char, cscript_get_position_fun get_position);
-
 void cscript_token_destroy(cscript_context* ctxt, token* tok);
 
 /*
 * return vector contains token types
+* The stream is read from its current position with the scanner of cscript_script2spans.
 */
 CSCRIPT_API cscript_vector tokenize(cscript_context* ctxt, cscript_stream* str);
 
 CSCRIPT_API void destroy_tokens_vector(cscript_context* ctxt, cscript_vector* tokens);
 
+/*
+* A token that refers to its text in the script instead of owning a copy of it.
+*/
+typedef struct cscript_token_span
+  {
+  cscript_memsize offset; // position of the first character in the script
+  int length;
+  int type;
+  int line_nr;
+  int column_nr;
+  } cscript_token_span;
+
+/*
+* Scans the script in place and returns a vector of type cscript_token_span.
+* No memory is allocated per token, and numbers are classified while scanning.
+*/
+CSCRIPT_API cscript_vector cscript_script2spans(cscript_context* ctxt, const char* script);
+
 CSCRIPT_API cscript_vector cscript_script2tokens(cscript_context* ctxt, const char* script);
+// converts the spans of script, as returned by cscript_script2spans, to a vector of type token
+CSCRIPT_API cscript_vector cscript_spans2tokens(cscript_context* ctxt, const char* script, const cscript_vector* spans);
 
 #endif //CSCRIPT_TOKEN_H
\ No newline at end of file
@@ -675,6 +675,14 @@ static void visit_entry(cscript_context* ctxt, cscript_visitor* vis, cscript_vis
         {
         cscript_vector_push_back(ctxt, &(vis->v), make_entry(cast(void*, stmt_rit), CSCRIPT_VISITOR_STATEMENT_PRE), cscript_visitor_entry);
         }
+      cscript_parsed_reduction* red_it = cscript_vector_begin(&cast(cscript_parsed_for*, e.entry)->reductions, cscript_parsed_reduction);
+      cscript_parsed_reduction* red_it_end = cscript_vector_end(&cast(cscript_parsed_for*, e.entry)->reductions, cscript_parsed_reduction);
+      cscript_parsed_reduction* red_rit = red_it_end - 1;
+      cscript_parsed_reduction* red_rit_end = red_it - 1;
+      for (; red_rit != red_rit_end; --red_rit) // IMPORTANT: brackets necessary, as cscript_vector_push_back is a C macro
+        {
+        cscript_vector_push_back(ctxt, &(vis->v), make_entry(cast(void*, &red_rit->var), CSCRIPT_VISITOR_VAR_PRE), cscript_visitor_entry);
+        }
       }
     break;
     }
@@ -794,3 +802,120 @@ void cscript_visit_program(cscript_context* ctxt, cscript_visitor* vis, cscript_
 
   visit(ctxt, vis);
   }
+
+#define CSCRIPT_FUSED_PREVISIT(callback, node_type) \
+  static int fused_##callback(cscript_context* ctxt, cscript_visitor* v, node_type* node) \
+    { \
+    cscript_fused_visitor* fused = (cscript_fused_visitor*)(v->impl); \
+    cscript_visitor** it = cscript_vector_begin(&fused->visitors, cscript_visitor*); \
+    cscript_visitor** it_end = cscript_vector_end(&fused->visitors, cscript_visitor*); \
+    for (; it != it_end; ++it) \
+      { \
+      if ((*it)->callback(ctxt, *it, node) == 0) \
+        return 0; \
+      } \
+    return 1; \
+    }
+
+#define CSCRIPT_FUSED_VISIT(callback, node_type) \
+  static void fused_##callback(cscript_context* ctxt, cscript_visitor* v, node_type* node) \
+    { \
+    cscript_fused_visitor* fused = (cscript_fused_visitor*)(v->impl); \
+    cscript_visitor** it = cscript_vector_begin(&fused->visitors, cscript_visitor*); \
+    cscript_visitor** it_end = cscript_vector_end(&fused->visitors, cscript_visitor*); \
+    for (; it != it_end; ++it) \
+      (*it)->callback(ctxt, *it, node); \
+    }
+
+CSCRIPT_FUSED_PREVISIT(previsit_statement, cscript_statement)
+CSCRIPT_FUSED_VISIT(postvisit_statement, cscript_statement)
+CSCRIPT_FUSED_PREVISIT(previsit_statements, cscript_comma_separated_statements)
+CSCRIPT_FUSED_VISIT(postvisit_statements, cscript_comma_separated_statements)
+CSCRIPT_FUSED_PREVISIT(previsit_scoped_statements, cscript_scoped_statements)
+CSCRIPT_FUSED_VISIT(postvisit_scoped_statements, cscript_scoped_statements)
+CSCRIPT_FUSED_PREVISIT(previsit_expression, cscript_parsed_expression)
+CSCRIPT_FUSED_VISIT(postvisit_expression, cscript_parsed_expression)
+CSCRIPT_FUSED_PREVISIT(previsit_assignment, cscript_parsed_assignment)
+CSCRIPT_FUSED_VISIT(postvisit_assignment, cscript_parsed_assignment)
+CSCRIPT_FUSED_PREVISIT(previsit_lvalueop, cscript_parsed_lvalue_operator)
+CSCRIPT_FUSED_VISIT(postvisit_lvalueop, cscript_parsed_lvalue_operator)
+CSCRIPT_FUSED_VISIT(visit_number, cscript_parsed_number)
+CSCRIPT_FUSED_PREVISIT(previsit_term, cscript_parsed_term)
+CSCRIPT_FUSED_VISIT(postvisit_term, cscript_parsed_term)
+CSCRIPT_FUSED_PREVISIT(previsit_relop, cscript_parsed_relop)
+CSCRIPT_FUSED_VISIT(postvisit_relop, cscript_parsed_relop)
+CSCRIPT_FUSED_PREVISIT(previsit_var, cscript_parsed_variable)
+CSCRIPT_FUSED_VISIT(postvisit_var, cscript_parsed_variable)
+CSCRIPT_FUSED_PREVISIT(previsit_fixnum, cscript_parsed_fixnum)
+CSCRIPT_FUSED_VISIT(postvisit_fixnum, cscript_parsed_fixnum)
+CSCRIPT_FUSED_PREVISIT(previsit_flonum, cscript_parsed_flonum)
+CSCRIPT_FUSED_VISIT(postvisit_flonum, cscript_parsed_flonum)
+CSCRIPT_FUSED_PREVISIT(previsit_factor, cscript_parsed_factor)
+CSCRIPT_FUSED_VISIT(postvisit_factor, cscript_parsed_factor)
+CSCRIPT_FUSED_PREVISIT(previsit_for, cscript_parsed_for)
+CSCRIPT_FUSED_VISIT(postvisit_for, cscript_parsed_for)
+CSCRIPT_FUSED_PREVISIT(previsit_if, cscript_parsed_if)
+CSCRIPT_FUSED_VISIT(postvisit_if, cscript_parsed_if)
+CSCRIPT_FUSED_PREVISIT(previsit_function, cscript_parsed_function)
+CSCRIPT_FUSED_VISIT(postvisit_function, cscript_parsed_function)
+CSCRIPT_FUSED_PREVISIT(previsit_expression_list, cscript_parsed_expression_list)
+CSCRIPT_FUSED_VISIT(postvisit_expression_list, cscript_parsed_expression_list)
+CSCRIPT_FUSED_VISIT(visit_parameter, cscript_parameter)
+CSCRIPT_FUSED_VISIT(visit_nop, cscript_parsed_nop)
+
+cscript_fused_visitor* cscript_fused_visitor_new(cscript_context* ctxt, cscript_visitor** visitors, int number_of_visitors)
+  {
+  cscript_fused_visitor* v = cscript_new(ctxt, cscript_fused_visitor);
+  cscript_vector_init_reserve(ctxt, &v->visitors, number_of_visitors, cscript_visitor*);
+  for (int i = 0; i < number_of_visitors; ++i)
+    {
+    cscript_vector_push_back(ctxt, &v->visitors, visitors[i], cscript_visitor*);
+    }
+  v->visitor = cscript_visitor_new(ctxt, v);
+  v->visitor->previsit_statement = fused_previsit_statement;
+  v->visitor->postvisit_statement = fused_postvisit_statement;
+  v->visitor->previsit_statements = fused_previsit_statements;
+  v->visitor->postvisit_statements = fused_postvisit_statements;
+  v->visitor->previsit_scoped_statements = fused_previsit_scoped_statements;
+  v->visitor->postvisit_scoped_statements = fused_postvisit_scoped_statements;
+  v->visitor->previsit_expression = fused_previsit_expression;
+  v->visitor->postvisit_expression = fused_postvisit_expression;
+  v->visitor->previsit_assignment = fused_previsit_assignment;
+  v->visitor->postvisit_assignment = fused_postvisit_assignment;
+  v->visitor->previsit_lvalueop = fused_previsit_lvalueop;
+  v->visitor->postvisit_lvalueop = fused_postvisit_lvalueop;
+  v->visitor->visit_number = fused_visit_number;
+  v->visitor->previsit_term = fused_previsit_term;
+  v->visitor->postvisit_term = fused_postvisit_term;
+  v->visitor->previsit_relop = fused_previsit_relop;
+  v->visitor->postvisit_relop = fused_postvisit_relop;
+  v->visitor->previsit_var = fused_previsit_var;
+  v->visitor->postvisit_var = fused_postvisit_var;
+  v->visitor->previsit_fixnum = fused_previsit_fixnum;
+  v->visitor->postvisit_fixnum = fused_postvisit_fixnum;
+  v->visitor->previsit_flonum = fused_previsit_flonum;
+  v->visitor->postvisit_flonum = fused_postvisit_flonum;
+  v->visitor->previsit_factor = fused_previsit_factor;
+  v->visitor->postvisit_factor = fused_postvisit_factor;
+  v->visitor->previsit_for = fused_previsit_for;
+  v->visitor->postvisit_for = fused_postvisit_for;
+  v->visitor->previsit_if = fused_previsit_if;
+  v->visitor->postvisit_if = fused_postvisit_if;
+  v->visitor->previsit_function = fused_previsit_function;
+  v->visitor->postvisit_function = fused_postvisit_function;
+  v->visitor->previsit_expression_list = fused_previsit_expression_list;
+  v->visitor->postvisit_expression_list = fused_postvisit_expression_list;
+  v->visitor->visit_parameter = fused_visit_parameter;
+  v->visitor->visit_nop = fused_visit_nop;
+  return v;
+  }
+
+void cscript_fused_visitor_free(cscript_context* ctxt, cscript_fused_visitor* v)
+  {
+  if (v)
+    {
+    cscript_vector_destroy(ctxt, &v->visitors);
+    v->visitor->destroy(ctxt, v->visitor);
+    cscript_delete(ctxt, v);
+    }
+  }
@@ -106,4 +106,25 @@ void cscript_visit_expression(cscript_context* ctxt, cscript_visitor* vis, cscri
 void cscript_visit_statement(cscript_context* ctxt, cscript_visitor* vis, cscript_statement* stmt);
 void cscript_visit_program(cscript_context* ctxt, cscript_visitor* vis, cscript_program* p);
 
+/*
+A fused visitor runs the callbacks of several visitors in a single traversal of the tree. At every node the
+callbacks are called in the order of the visitors. The children of a node are skipped for all visitors as soon
+as one previsit callback returns 0; the remaining visitors do not see that node.
+Visitors can be fused when each of them only rewrites the node it is given or the nodes below it, and does not
+need the results of a complete traversal by another visitor. This holds for constant folding, reassociation
+and the substitution step of constant propagation, but not for alpha conversion or the analyses that first
+collect information about the whole tree.
+The traversal itself uses an explicit stack (see visit in visitor.c), so that deeply nested scripts do not
+overflow the C stack.
+*/
+typedef struct cscript_fused_visitor
+  {
+  cscript_visitor* visitor;
+  cscript_vector visitors; // vector of type cscript_visitor*
+  } cscript_fused_visitor;
+
+cscript_fused_visitor* cscript_fused_visitor_new(cscript_context* ctxt, cscript_visitor** visitors, int number_of_visitors);
+// the fused visitors are not freed
+void cscript_fused_visitor_free(cscript_context* ctxt, cscript_fused_visitor* v);
+
 #endif //CSCRIPT_VISITOR_H
\ No newline at end of file
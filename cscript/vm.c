@@ -7,6 +7,7 @@
 #include "syscalls.h"
 #include "limits.h"
 #include "foreign.h"
+#include "parallel.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -189,10 +190,11 @@ static cscript_string instruction_to_string(cscript_context* ctxt, cscript_instr
     {
     const int a = CSCRIPT_GETARG_A(instruc);
     const int b = CSCRIPT_GETARG_B(instruc);
+    const int c = CSCRIPT_GETARG_C(instruc);
     cscript_string_append_cstr(ctxt, &s, "EQ if R(");
     cscript_int_to_char(buffer, a);
     cscript_string_append_cstr(ctxt, &s, buffer);
-    cscript_string_append_cstr(ctxt, &s, ") != ");
+    cscript_string_append_cstr(ctxt, &s, c == 0 ? ") != " : ") == ");
     cscript_int_to_char(buffer, b);
     cscript_string_append_cstr(ctxt, &s, buffer);
     cscript_string_append_cstr(ctxt, &s, " then skip next line");
@@ -222,6 +224,19 @@ static cscript_string instruction_to_string(cscript_context* ctxt, cscript_instr
     cscript_string_append_cstr(ctxt, &s, ")");
     break;
     }
+    case CSCRIPT_OPCODE_ADDRESS:
+    {
+    const int a = CSCRIPT_GETARG_A(instruc);
+    const int b = CSCRIPT_GETARG_B(instruc);
+    cscript_string_append_cstr(ctxt, &s, "ADDRESS R(");
+    cscript_int_to_char(buffer, a);
+    cscript_string_append_cstr(ctxt, &s, buffer);
+    cscript_string_append_cstr(ctxt, &s, ") := &R(");
+    cscript_int_to_char(buffer, b);
+    cscript_string_append_cstr(ctxt, &s, buffer);
+    cscript_string_append_cstr(ctxt, &s, ")");
+    break;
+    }
     case CSCRIPT_OPCODE_RETURN:
     {
     const int a = CSCRIPT_GETARG_A(instruc);
@@ -239,14 +254,27 @@ static cscript_string instruction_to_string(cscript_context* ctxt, cscript_instr
   }
 
 
-cscript_fixnum* cscript_run(cscript_context* ctxt, cscript_function* fun)
+/*
+Executes fun on the registers in stack. ctxt is only used to report errors and can be NULL.
+Returns NULL if an instruction could not be executed.
+If state is not NULL, execution starts at state->pc, and is suspended when a backward jump is taken after
+budget backward jumps. In that case state->pc is set to the jump target and state->status to cscript_run_suspended.
+*/
+static cscript_fixnum* run(cscript_context* ctxt, const cscript_function* fun, cscript_fixnum* stack, cscript_fixnum* globals, const cscript_external_function* externals, cscript_run_state* state, cscript_memsize budget)
   {
   cscript_assert(fun != NULL);
-  const cscript_instruction* pc = cscript_vector_begin(&(fun)->code, cscript_instruction);  
-  const cscript_instruction* pc_end = cscript_vector_end(&(fun)->code, cscript_instruction);
+  const cscript_instruction* pc_begin = cscript_vector_begin(&fun->code, cscript_instruction);
+  const cscript_instruction* pc = pc_begin;
+  const cscript_instruction* pc_end = cscript_vector_end(&fun->code, cscript_instruction);
+  if (state != NULL)
+    {
+    cscript_assert(state->pc <= fun->code.vector_size);
+    pc += state->pc;
+    state->status = cscript_run_finished;
+    }
   while (pc < pc_end)
     {
-    cscript_assert(pc < cscript_vector_end(&(fun)->code, cscript_instruction));
+    cscript_assert(pc < cscript_vector_end(&fun->code, cscript_instruction));
     const cscript_instruction instruc = *pc++;
     const int opcode = CSCRIPT_GET_OPCODE(instruc);
     cscript_assert((opcode == CSCRIPT_OPCODE_JMP) || (CSCRIPT_GETARG_A(instruc) < cscript_maxstack));
@@ -256,7 +284,7 @@ cscript_fixnum* cscript_run(cscript_context* ctxt, cscript_function* fun)
       {
       const int a = CSCRIPT_GETARG_A(instruc);
       const int b = CSCRIPT_GETARG_B(instruc);
-      memcpy(((cscript_fixnum*)ctxt->stack.vector_ptr)+a, ((cscript_fixnum*)ctxt->stack.vector_ptr) + b, sizeof(cscript_fixnum));
+      memcpy(stack+a, stack + b, sizeof(cscript_fixnum));
       continue;
       }
       case CSCRIPT_OPCODE_MOVE_TO_ARR:
@@ -265,8 +293,8 @@ cscript_fixnum* cscript_run(cscript_context* ctxt, cscript_function* fun)
       const int b = CSCRIPT_GETARG_B(instruc);
       const int c = CSCRIPT_GETARG_C(instruc);
       //R(A + R(B)) := R(C)
-      cscript_fixnum rb = *(((cscript_fixnum*)ctxt->stack.vector_ptr) + b);
-      memcpy(((cscript_fixnum*)ctxt->stack.vector_ptr) + a + rb, ((cscript_fixnum*)ctxt->stack.vector_ptr) + c, sizeof(cscript_fixnum));
+      cscript_fixnum rb = *(stack + b);
+      memcpy(stack + a + rb, stack + c, sizeof(cscript_fixnum));
       continue;
       }
       case CSCRIPT_OPCODE_MOVE_FROM_ARR:
@@ -275,16 +303,16 @@ cscript_fixnum* cscript_run(cscript_context* ctxt, cscript_function* fun)
       const int b = CSCRIPT_GETARG_B(instruc);
       const int c = CSCRIPT_GETARG_C(instruc);
       //R(A) := R(B+R(C))
-      cscript_fixnum rc = *(((cscript_fixnum*)ctxt->stack.vector_ptr) + c);
-      memcpy(((cscript_fixnum*)ctxt->stack.vector_ptr) + a, ((cscript_fixnum*)ctxt->stack.vector_ptr) + b + rc, sizeof(cscript_fixnum));
+      cscript_fixnum rc = *(stack + c);
+      memcpy(stack + a, stack + b + rc, sizeof(cscript_fixnum));
       continue;
       }
       case CSCRIPT_OPCODE_STORE_MEMORY:
       {
       const int a = CSCRIPT_GETARG_A(instruc);
       const int b = CSCRIPT_GETARG_B(instruc);
-      cscript_fixnum ra = *(((cscript_fixnum*)ctxt->stack.vector_ptr) + a);
-      cscript_fixnum rb = *(((cscript_fixnum*)ctxt->stack.vector_ptr) + b);
+      cscript_fixnum ra = *(stack + a);
+      cscript_fixnum rb = *(stack + b);
       cscript_fixnum* ptr_ra = cast(cscript_fixnum*, ra);
       *ptr_ra = rb;
       continue;
@@ -293,38 +321,38 @@ cscript_fixnum* cscript_run(cscript_context* ctxt, cscript_function* fun)
       {
       const int a = CSCRIPT_GETARG_A(instruc);
       const int b = CSCRIPT_GETARG_B(instruc);      
-      cscript_fixnum rb = *(((cscript_fixnum*)ctxt->stack.vector_ptr) + b);
+      cscript_fixnum rb = *(stack + b);
       cscript_fixnum* ptr_rb = cast(cscript_fixnum*, rb);
-      memcpy(((cscript_fixnum*)ctxt->stack.vector_ptr) + a, ptr_rb, sizeof(cscript_fixnum));
+      memcpy(stack + a, ptr_rb, sizeof(cscript_fixnum));
       continue;
       }
       case CSCRIPT_OPCODE_LOADGLOBAL:
       {
       const int a = CSCRIPT_GETARG_A(instruc);
       const int bx = CSCRIPT_GETARG_Bx(instruc);
-      memcpy(((cscript_fixnum*)ctxt->stack.vector_ptr) + a, ((cscript_fixnum*)ctxt->globals.vector_ptr) + bx, sizeof(cscript_fixnum));
+      memcpy(stack + a, globals + bx, sizeof(cscript_fixnum));
       continue;
       }
       case CSCRIPT_OPCODE_STOREGLOBAL:
       {
       const int a = CSCRIPT_GETARG_A(instruc);
       const int bx = CSCRIPT_GETARG_Bx(instruc);
-      memcpy(((cscript_fixnum*)ctxt->globals.vector_ptr) + bx, ((cscript_fixnum*)ctxt->stack.vector_ptr) + a, sizeof(cscript_fixnum));
+      memcpy(globals + bx, stack + a, sizeof(cscript_fixnum));
       continue;
       }
       case CSCRIPT_OPCODE_LOADK:
       {
       const int a = CSCRIPT_GETARG_A(instruc);
       const int bx = CSCRIPT_GETARG_Bx(instruc);
-      cscript_fixnum* target = cscript_vector_at(&ctxt->stack, a, cscript_fixnum);
-      const cscript_fixnum* k = cscript_vector_at(&(fun)->constants, bx, cscript_fixnum);
+      cscript_fixnum* target = (stack + a);
+      const cscript_fixnum* k = cscript_vector_at(&fun->constants, bx, cscript_fixnum);
       memcpy(target, k, sizeof(cscript_fixnum));
       continue;
       }
       case CSCRIPT_OPCODE_SETFIXNUM:
       {
       const int a = CSCRIPT_GETARG_A(instruc);
-      cscript_fixnum* target = cscript_vector_at(&ctxt->stack, a, cscript_fixnum);
+      cscript_fixnum* target = (stack + a);
       const int b = CSCRIPT_GETARG_sBx(instruc);
       *target = cast(cscript_fixnum, b);
       continue;
@@ -333,7 +361,11 @@ cscript_fixnum* cscript_run(cscript_context* ctxt, cscript_function* fun)
       {
       const int a = CSCRIPT_GETARG_A(instruc);
       const int b = CSCRIPT_GETARG_B(instruc);
-      cscript_call_primitive(ctxt, b, a);
+      if (!cscript_call_primitive(stack, b, a))
+        {
+        if (b != CSCRIPT_PARALLEL_FOR || !cscript_run_parallel_loop(fun, CSCRIPT_GETARG_C(instruc), stack, a, globals, externals))
+          return NULL;
+        }
       continue;
       }
       case CSCRIPT_OPCODE_CALLFOREIGN:
@@ -341,10 +373,10 @@ cscript_fixnum* cscript_run(cscript_context* ctxt, cscript_function* fun)
       const int a = CSCRIPT_GETARG_A(instruc);
       const int b = CSCRIPT_GETARG_B(instruc);
       const int c = CSCRIPT_GETARG_C(instruc);
-      cscript_fixnum* ra = cscript_vector_at(&ctxt->stack, a, cscript_fixnum);
-      cscript_assert(b < (int)ctxt->externals.vector_size);
-      cscript_external_function* ext = cscript_vector_at(&ctxt->externals, b, cscript_external_function);      
-      cscript_object result = cscript_call_external(ctxt, ext, a, (int)c);
+      cscript_fixnum* ra = (stack + a);
+      cscript_assert(externals != NULL);
+      const cscript_external_function* ext = externals + b;
+      cscript_object result = cscript_call_external(ctxt, ext, stack, a, (int)c);
       switch (result.type)
         {
         case cscript_object_type_fixnum:
@@ -364,22 +396,30 @@ cscript_fixnum* cscript_run(cscript_context* ctxt, cscript_function* fun)
       const int b = CSCRIPT_GETARG_B(instruc);
       if (b == cscript_number_type_flonum)
         {
-        cscript_flonum ra = cast(cscript_flonum, *cscript_vector_at(&ctxt->stack, a, cscript_fixnum));
-        memcpy(cscript_vector_at(&ctxt->stack, a, cscript_fixnum), &ra, sizeof(cscript_fixnum));
+        cscript_flonum ra = cast(cscript_flonum, *(stack + a));
+        memcpy((stack + a), &ra, sizeof(cscript_fixnum));
         }
       else if (b == cscript_number_type_fixnum)
         {
-        cscript_fixnum ra = cast(cscript_fixnum, *cscript_vector_at(&ctxt->stack, a, cscript_flonum));
-        memcpy(cscript_vector_at(&ctxt->stack, a, cscript_fixnum), &ra, sizeof(cscript_fixnum));
+        cscript_fixnum ra = cast(cscript_fixnum, *cast(cscript_flonum*, stack + a));
+        memcpy((stack + a), &ra, sizeof(cscript_fixnum));
         }
       continue;
       }
+      case CSCRIPT_OPCODE_ADDRESS:
+      {
+      const int a = CSCRIPT_GETARG_A(instruc);
+      const int b = CSCRIPT_GETARG_B(instruc);
+      *(stack + a) = cast(cscript_fixnum, stack + b);
+      continue;
+      }
       case CSCRIPT_OPCODE_NEQ:
       {      
       const int a = CSCRIPT_GETARG_A(instruc);
       const int b = CSCRIPT_GETARG_B(instruc);
-      const cscript_fixnum* ra = cscript_vector_at(&ctxt->stack, a, cscript_fixnum);
-      if (*ra != b)
+      const int c = CSCRIPT_GETARG_C(instruc);
+      const cscript_fixnum* ra = (stack + a);
+      if ((*ra != b) == (c == 0))
         {
         ++pc;
         }
@@ -389,6 +429,12 @@ cscript_fixnum* cscript_run(cscript_context* ctxt, cscript_function* fun)
         cscript_assert(CSCRIPT_GET_OPCODE(next_i) == CSCRIPT_OPCODE_JMP);
         const int offset = CSCRIPT_GETARG_sBx(next_i);
         pc += offset;
+        if (offset < 0 && state != NULL && budget-- == 0)
+          {
+          state->pc = cast(cscript_memsize, pc - pc_begin);
+          state->status = cscript_run_suspended;
+          return stack;
+          }
         }        
       continue;
       }
@@ -396,6 +442,12 @@ cscript_fixnum* cscript_run(cscript_context* ctxt, cscript_function* fun)
       {
       const int sbx = CSCRIPT_GETARG_sBx(instruc);
       pc += sbx;
+      if (sbx < 0 && state != NULL && budget-- == 0)
+        {
+        state->pc = cast(cscript_memsize, pc - pc_begin);
+        state->status = cscript_run_suspended;
+        return stack;
+        }
       continue;
       }
       case CSCRIPT_OPCODE_RETURN:
@@ -406,18 +458,83 @@ cscript_fixnum* cscript_run(cscript_context* ctxt, cscript_function* fun)
         {
         for (int j = 0; j < b; ++j)
           {
-          cscript_fixnum* retj = cscript_vector_at(&ctxt->stack, j, cscript_fixnum);
-          const cscript_fixnum* srcj = cscript_vector_at(&ctxt->stack, a + j, cscript_fixnum);
+          cscript_fixnum* retj = (stack + j);
+          const cscript_fixnum* srcj = (stack + a + j);
           *retj = *srcj;
           }
         }      
-      return cscript_vector_at(&ctxt->stack, 0, cscript_fixnum);
+      return (stack + 0);
       }
       default:
-        cscript_throw(ctxt, CSCRIPT_ERROR_NOT_IMPLEMENTED);
+        return NULL;
       }
     }
-  return cscript_vector_at(&ctxt->stack, fun->result_position, cscript_fixnum);
+  return (stack + fun->result_position);
+  }
+
+cscript_fixnum* cscript_run(cscript_context* ctxt, cscript_function* fun)
+  {
+  cscript_fixnum* stack = cscript_vector_begin(&ctxt->stack, cscript_fixnum);
+  cscript_fixnum* globals = cscript_vector_begin(&ctxt->globals, cscript_fixnum);
+  const cscript_external_function* externals = cscript_vector_begin(&ctxt->externals, cscript_external_function);
+  cscript_fixnum* result = run(ctxt, fun, stack, globals, externals, NULL, 0);
+  if (result == NULL)
+    cscript_throw(ctxt, CSCRIPT_ERROR_NOT_IMPLEMENTED);
+  return result;
+  }
+
+cscript_fixnum* cscript_run_frame(const cscript_function* fun, const cscript_externals* externals, cscript_fixnum* frame)
+  {
+  cscript_assert(frame != NULL);
+  if (externals != NULL)
+    return run(NULL, fun, frame, externals->globals, externals->functions, NULL, 0);
+  return run(NULL, fun, frame, NULL, NULL, NULL, 0);
+  }
+
+void cscript_run_state_init(cscript_run_state* state)
+  {
+  state->pc = 0;
+  state->status = cscript_run_finished;
+  state->result = NULL;
+  }
+
+cscript_run_status cscript_run_slice(cscript_context* ctxt, cscript_function* fun, cscript_memsize budget, cscript_run_state* state)
+  {
+  cscript_fixnum* stack = cscript_vector_begin(&ctxt->stack, cscript_fixnum);
+  cscript_fixnum* globals = cscript_vector_begin(&ctxt->globals, cscript_fixnum);
+  const cscript_external_function* externals = cscript_vector_begin(&ctxt->externals, cscript_external_function);
+  cscript_fixnum* result = run(ctxt, fun, stack, globals, externals, state, budget);
+  if (result == NULL)
+    cscript_throw(ctxt, CSCRIPT_ERROR_NOT_IMPLEMENTED);
+  if (state->status == cscript_run_finished)
+    {
+    state->pc = 0;
+    state->result = result;
+    }
+  else
+    state->result = NULL;
+  return state->status;
+  }
+
+void cscript_run_batch(cscript_context* ctxt, cscript_function* fun, const cscript_fixnum* args, int number_of_arguments, int args_stride, int count, cscript_fixnum* results)
+  {
+  cscript_assert(fun != NULL);
+  cscript_assert(number_of_arguments >= 0 && number_of_arguments <= (int)ctxt->stack.vector_size);
+  cscript_assert(args_stride >= number_of_arguments);
+  // the stack, globals and externals are not reallocated while running, so they are looked up once for all rows
+  cscript_fixnum* stack = cscript_vector_begin(&ctxt->stack, cscript_fixnum);
+  cscript_fixnum* globals = cscript_vector_begin(&ctxt->globals, cscript_fixnum);
+  const cscript_external_function* externals = cscript_vector_begin(&ctxt->externals, cscript_external_function);
+  const size_t row_size = cast(size_t, number_of_arguments) * sizeof(cscript_fixnum);
+  for (int i = 0; i < count; ++i)
+    {
+    memcpy(stack, args, row_size);
+    args += args_stride;
+    const cscript_fixnum* result = run(ctxt, fun, stack, globals, externals, NULL, 0);
+    if (result == NULL)
+      cscript_throw(ctxt, CSCRIPT_ERROR_NOT_IMPLEMENTED);
+    results[i] = *result;
+    }
   }
 
 cscript_string cscript_fun_to_string(cscript_context* ctxt, cscript_function* fun)
@@ -81,15 +81,16 @@ typedef enum
   CSCRIPT_OPCODE_SETFIXNUM,     /*  A sBx    R(A) := sBx        */
   CSCRIPT_OPCODE_CALLPRIM,      /*  A B	     R(A) := (B)(R(A),R(A+1),...) */
   CSCRIPT_OPCODE_CALLFOREIGN,   /*  A B C    R(A) := (B)(R(A),R(A+1), ..., R(A+C)) with B a fixnum indicating the index in ctxt->externals*/
-  CSCRIPT_OPCODE_NEQ,           /*  A B      if (type of R(A) != B) then pc++, else perform the following JMP instruction on the next line*/  
+  CSCRIPT_OPCODE_NEQ,           /*  A B C    if ((R(A) != B) == (C == 0)) then pc++, else perform the following JMP instruction on the next line*/  
   CSCRIPT_OPCODE_JMP,           /*  sBx      PC += sBx					*/
   CSCRIPT_OPCODE_RETURN,        /*  A B	     return R(A), ... ,R(A+B-1) */
   CSCRIPT_OPCODE_LOADGLOBAL,    /*  A Bx     R(A) := Global(Bx) */
   CSCRIPT_OPCODE_STOREGLOBAL,   /*  A Bx     Global(Bx) := R(A) */
   CSCRIPT_OPCODE_CAST,          /*  A B      R(A) := (B)R(A)    */
+  CSCRIPT_OPCODE_ADDRESS,       /*  A B      R(A) := &R(B)      */
   } cscript_opcode;
 
-#define CSCRIPT_NUM_OPCODES (cast(int, CSCRIPT_OPCODE_RETURN+1))
+#define CSCRIPT_NUM_OPCODES (cast(int, CSCRIPT_OPCODE_ADDRESS+1))
 
 #define CSCRIPT_GET_OPCODE(i)	(cast(cscript_opcode, (i)&CSCRIPT_MASK1(CSCRIPT_SIZE_OPCODE,0)))
 #define CSCRIPT_SET_OPCODE(i,o)	((i) = (((i)&CSCRIPT_MASK0(CSCRIPT_SIZE_OPCODE,0)) | cast(cscript_instruction, o)))